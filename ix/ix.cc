@@ -28,7 +28,7 @@ RC IndexManager::createFile(const string &fileName)
 {
 	int err;
 
-	err = _pf_manager->createFile(fileName);
+	err = _pf_manager->createFile(fileName, PFM_CHECKSUMS);
 
 	if (err != 0)
 	{
@@ -45,22 +45,24 @@ RC IndexManager::createLeaf(IXFileHandle &ixfileHandle, const RID &rid, const vo
 {
     NodeHeader leafHeader;
     int keySize = getKeySize(key, attribute);
-    leafHeader.freeSpaceOffset = PAGE_SIZE - keySize;
+    leafHeader.freeSpaceOffset = IX_NODE_END - keySize;
     leafHeader.numEntries = 1;
     leafHeader.isLeaf = true;
     leafHeader.nextNode = NONODE;
     leafHeader.previousNode = NONODE;
 
-    void * leafPage = malloc(PAGE_SIZE);
-    memset(leafPage, 0, PAGE_SIZE);
+    // Build the leaf directly in a freshly appended buffer pool page
+    void * leafPage;
+    RC rc = ixfileHandle.newPage(pageNumber, leafPage);
+    if (rc != SUCCESS)
+        return rc;
     memcpy((char*)leafPage+leafHeader.freeSpaceOffset, key, keySize);
     setNodeHeader(leafHeader, leafPage);
     LeafEntry entry;
     entry.rid = rid;
     entry.offSet = leafHeader.freeSpaceOffset;
     setLeafEntry(leafPage, 0, entry);
-    ixfileHandle.appendPage(leafPage);
-    pageNumber = ixfileHandle.getNumberOfPages()-1;
+    return ixfileHandle.unpinPage(pageNumber, true);
 }
 
 RC IndexManager::destroyFile(const string &fileName)
@@ -74,10 +76,10 @@ RC IndexManager::destroyFile(const string &fileName)
 	return 0;
 }
 
-RC IndexManager::openFile(const string &fileName, IXFileHandle &ixfileHandle)
+RC IndexManager::openFile(const string &fileName, IXFileHandle &ixfileHandle, OpenMode openMode)
 {
 	int err;
-	err = _pf_manager->openFile(fileName, ixfileHandle);
+	err = _pf_manager->openFile(fileName, ixfileHandle, openMode);
 	if (err != 0)
 	{
 		return 1; //bad pfm file opening
@@ -105,9 +107,10 @@ RC IndexManager::insertEntry(IXFileHandle &ixfileHandle, const Attribute &attrib
     to_insert.rid = rid;
 
     //start search from root
-    unsigned* parentNum = (unsigned*)malloc(sizeof(int));
-    int nodeNum = searchTree(ixfileHandle, key, attribute, 0, *parentNum);
-    void * node = malloc(PAGE_SIZE);
+    unsigned parentNum = 0;
+    int nodeNum = searchTree(ixfileHandle, key, attribute, 0, parentNum);
+    ScratchPage nodePage;
+    void * node = nodePage.data();
     memset(node, 0, PAGE_SIZE);
 
     //tree was empty, search returned null
@@ -116,27 +119,29 @@ RC IndexManager::insertEntry(IXFileHandle &ixfileHandle, const Attribute &attrib
      * Lets add our first leaf.
      */
     if(nodeNum == NONODE){
-        void * rootPage = malloc(PAGE_SIZE);
-        memset(rootPage, 0, PAGE_SIZE);
+        void * rootPage;
+        PageNum rootNum;
+        if (ixfileHandle.newPage(rootNum, rootPage) != SUCCESS)
+            return -1;
         NodeHeader rootHeader;
         rootHeader.isLeaf = false;
-        rootHeader.freeSpaceOffset = PAGE_SIZE;
+        rootHeader.freeSpaceOffset = IX_NODE_END;
         rootHeader.nextNode = NONODE;
         rootHeader.previousNode = NONODE;
         rootHeader.numEntries = 0;
         setNodeHeader(rootHeader, rootPage);
-        ixfileHandle.appendPage(rootPage);
+        ixfileHandle.unpinPage(rootNum, true);
 
         unsigned newPageNumber;
         createLeaf(ixfileHandle, rid, key, newPageNumber, attribute);
-        void * root = malloc(PAGE_SIZE);
-        memset(root, 0, PAGE_SIZE);
+        void * root;
         // The first page is the root node
-        ixfileHandle.readPage(0, root);
+        if (ixfileHandle.fetchPage(0, root) != SUCCESS)
+            return -1;
         NonLeafEntry entry;
 
         int keySize = getKeySize(key, attribute);
-        entry.offset = PAGE_SIZE - keySize;
+        entry.offset = IX_NODE_END - keySize;
         memcpy((char*)root+entry.offset, key, keySize);
         entry.greaterThanNode = newPageNumber;
         entry.lessThanNode = NONODE;
@@ -145,16 +150,15 @@ RC IndexManager::insertEntry(IXFileHandle &ixfileHandle, const Attribute &attrib
         header.freeSpaceOffset -= keySize;
         setNodeHeader(header, root);
         setNonLeafEntry(root, 0, entry);
-        ixfileHandle.writePage(0, root);
-        return 0;
+        return ixfileHandle.unpinPage(0, true);
     }
     if(nodeNum == NEWLESSTHANNODE){
         unsigned newPageNumber;
         createLeaf(ixfileHandle, rid, key, newPageNumber, attribute);
         //now point the parent at the new leaf
-        void * parentNode = malloc(PAGE_SIZE);
-        memset(parentNode, 0, PAGE_SIZE);        
-        ixfileHandle.readPage((int)*parentNum, parentNode);
+        ScratchPage parentPage;
+        void * parentNode = parentPage.data();
+        readNode(ixfileHandle, (int)parentNum, parentNode);
         NonLeafEntry nle = getNonLeafEntry(parentNode, 0);//we know its the leftmost/smallest entry
         nle.lessThanNode = (int)newPageNumber;
         setNonLeafEntry(parentNode, 0, nle);
@@ -163,12 +167,12 @@ RC IndexManager::insertEntry(IXFileHandle &ixfileHandle, const Attribute &attrib
         int rightNodeNum = nle.greaterThanNode;
 
         //now load the nodes
-        void * leftNode = malloc(PAGE_SIZE);
-        memset(leftNode, 0, PAGE_SIZE);        
-        ixfileHandle.readPage((int)newPageNumber, leftNode);
-        void * rightNode = malloc(PAGE_SIZE);
-        memset(rightNode, 0, PAGE_SIZE);        
-        ixfileHandle.readPage(rightNodeNum, rightNode);
+        ScratchPage leftPage;
+        void * leftNode = leftPage.data();
+        readNode(ixfileHandle, (int)newPageNumber, leftNode);
+        ScratchPage rightPage;
+        void * rightNode = rightPage.data();
+        readNode(ixfileHandle, rightNodeNum, rightNode);
         //get the headers
         NodeHeader lh = getNodeHeader(leftNode);
         NodeHeader rh = getNodeHeader(rightNode);
@@ -179,12 +183,12 @@ RC IndexManager::insertEntry(IXFileHandle &ixfileHandle, const Attribute &attrib
         setNodeHeader(lh, leftNode);
         setNodeHeader(rh, rightNode);
         //write to disk
-        ixfileHandle.writePage((int)*parentNum, parentNode);
-        ixfileHandle.writePage(rightNodeNum, rightNode);
-        ixfileHandle.writePage((int)newPageNumber, leftNode);
+        writeNode(ixfileHandle, (int)parentNum, parentNode);
+        writeNode(ixfileHandle, rightNodeNum, rightNode);
+        writeNode(ixfileHandle, (int)newPageNumber, leftNode);
         return SUCCESS;
     }
-    ixfileHandle.readPage(nodeNum, node);
+    readNode(ixfileHandle, nodeNum, node);
 
     //we now have proper node. Search through sorted record & insert at proper location
     //get number of entries
@@ -193,18 +197,20 @@ RC IndexManager::insertEntry(IXFileHandle &ixfileHandle, const Attribute &attrib
     int new_offset = header.freeSpaceOffset - keySize;
     if(freeSpaceStart(node)+sizeof(LeafEntry) > new_offset){
         //No space to insert. We have to split :(
-        void * parentNode = malloc(PAGE_SIZE);
-        memset(parentNode, 0, PAGE_SIZE);
-        ixfileHandle.readPage(*parentNum, parentNode);
+        ScratchPage parentPage;
+        void * parentNode = parentPage.data();
+        readNode(ixfileHandle, parentNum, parentNode);
 
-	    void * newNode = malloc(PAGE_SIZE);
+	    ScratchPage newPage;
+	    void * newNode = newPage.data();
         memset(newNode, 0, PAGE_SIZE);
         
 
 	int rightNum = header.nextNode;
-	void * rightNode = malloc(PAGE_SIZE);
+	ScratchPage rightPage;
+	void * rightNode = rightPage.data();
         memset(newNode, 0, PAGE_SIZE);
-        ixfileHandle.readPage(rightNum, rightNode);
+        readNode(ixfileHandle, rightNum, rightNode);
 
 	NodeHeader parentHeader = getNodeHeader(parentNode);
 	NodeHeader newHeader = getNodeHeader(newNode);
@@ -256,7 +262,7 @@ RC IndexManager::insertEntry(IXFileHandle &ixfileHandle, const Attribute &attrib
             // update node header
             header.numEntries++;
             setNodeHeader(header, node);
-            ixfileHandle.writePage(nodeNum, node);
+            writeNode(ixfileHandle, nodeNum, node);
             return SUCCESS;
         }
     }
@@ -266,16 +272,16 @@ RC IndexManager::insertEntry(IXFileHandle &ixfileHandle, const Attribute &attrib
     // update node header
     header.numEntries++;
     setNodeHeader(header, node);
-    ixfileHandle.writePage(nodeNum, node);
+    writeNode(ixfileHandle, nodeNum, node);
     return SUCCESS;
 }
 
 int IndexManager::getKeySize(const void * key, const Attribute &attribute)
 {
     if(attribute.type == TypeVarChar){
-        int * strLen = (int*)malloc(sizeof(int));
-        memcpy(strLen, key, sizeof(int));
-        return *strLen;
+        int strLen;
+        memcpy(&strLen, key, sizeof(int));
+        return strLen;
     }
     return sizeof(int);
 }
@@ -295,17 +301,18 @@ RC IndexManager::deleteEntry(IXFileHandle &ixfileHandle, const Attribute &attrib
 {
 
     //start search from root
-    void * node = malloc(PAGE_SIZE);
+    ScratchPage nodePage;
+    void * node = nodePage.data();
     memset(node, 0, PAGE_SIZE);
-    unsigned* parentNum = (unsigned*)malloc(sizeof(int));
-    int nodeNum = searchTree(ixfileHandle, key, attribute, 0, *parentNum);
+    unsigned parentNum = 0;
+    int nodeNum = searchTree(ixfileHandle, key, attribute, 0, parentNum);
 
-    ixfileHandle.readPage(nodeNum, node);
+    readNode(ixfileHandle, nodeNum, node);
     int rc = deleteEntryOnPage(node, rid);
     if(rc==-1){
         return -1;
     }
-    return ixfileHandle.writePage(nodeNum, node);
+    return writeNode(ixfileHandle, nodeNum, node);
 }
 
 RC IndexManager::deleteEntryOnPage(void * node, const RID &rid)
@@ -325,7 +332,7 @@ RC IndexManager::deleteEntryOnPage(void * node, const RID &rid)
             int start = le.offSet;
             int end = 0;
             if(i==header.numEntries-1){
-                end = PAGE_SIZE;
+                end = IX_NODE_END;
             }else{
                 LeafEntry le2 = getLeafEntry(node, i+1);
                 end = le2.offSet;
@@ -400,12 +407,14 @@ int IndexManager::searchTree(IXFileHandle &ixfileHandle, const void* value, cons
     if(ixfileHandle.getNumberOfPages() == 0){
         return -1;
     }
-    void * node = malloc(PAGE_SIZE);
-    memset(node, 0, PAGE_SIZE);
+    void * node;
     //always start at root!
-    ixfileHandle.readPage(nodeNum, node);
+    if(ixfileHandle.fetchPage(nodeNum, node) != SUCCESS){
+        return NONODE;
+    }
     NodeHeader header = getNodeHeader(node);
     if(header.isLeaf){
+        ixfileHandle.unpinPage(nodeNum, false);
         return nodeNum;
     }
     parentNodeNumber = nodeNum;
@@ -415,6 +424,7 @@ int IndexManager::searchTree(IXFileHandle &ixfileHandle, const void* value, cons
         NonLeafEntry entry = getNonLeafEntry(node, i);
         void * min_val = getValue(node, entry.offset, attribute);
         if(compareVals(value, min_val, attribute) < 0){
+            ixfileHandle.unpinPage(nodeNum, false);
             if(entry.lessThanNode != NONODE){
                 return searchTree(ixfileHandle, value, attribute, entry.lessThanNode, parentNodeNumber);
             }else{
@@ -424,6 +434,7 @@ int IndexManager::searchTree(IXFileHandle &ixfileHandle, const void* value, cons
     }
     //if we get here we know there is only one place to search
     NonLeafEntry entry = getNonLeafEntry(node, header.numEntries-1);
+    ixfileHandle.unpinPage(nodeNum, false);
     return searchTree(ixfileHandle, value, attribute, entry.greaterThanNode, parentNodeNumber);
 }
 
@@ -431,33 +442,39 @@ int IndexManager::getMostLeftLeafNumber(IXFileHandle &ixfileHandle){
     if(ixfileHandle.getNumberOfPages() == 0){
         return -1;
     }
-    void * node = malloc(PAGE_SIZE);
-    memset(node, 0, PAGE_SIZE);
+    void * node;
     //always start at root!
-    ixfileHandle.readPage(0, node);
+    if(ixfileHandle.fetchPage(0, node) != SUCCESS){
+        return -1;
+    }
     NodeHeader header = getNodeHeader(node);
     if(header.isLeaf){
+        ixfileHandle.unpinPage(0, false);
         return -1;
     }
     NonLeafEntry entry = getNonLeafEntry(node, 0);
+    ixfileHandle.unpinPage(0, false);
     int nodeNum = entry.lessThanNode;
     if(nodeNum == NONODE)
         nodeNum = entry.greaterThanNode;
-    void * tempNode = malloc(PAGE_SIZE);
     while(true){
-        memset(tempNode, 0, PAGE_SIZE);
-        ixfileHandle.readPage(nodeNum, tempNode);
-        header = getNodeHeader(tempNode);
-        if(header.isLeaf)
+        // No node points back at the root, page 0 here means an unwritten node
+        if(nodeNum == 0 || ixfileHandle.fetchPage(nodeNum, node) != SUCCESS){
+            return -1;
+        }
+        header = getNodeHeader(node);
+        if(header.isLeaf){
+            ixfileHandle.unpinPage(nodeNum, false);
             break;
+        }
         else{
-            entry = getNonLeafEntry(tempNode, 0);
+            entry = getNonLeafEntry(node, 0);
+            ixfileHandle.unpinPage(nodeNum, false);
             nodeNum = entry.lessThanNode;
             if(nodeNum == NONODE)
                 nodeNum = entry.greaterThanNode;
         }
     }
-    free(tempNode);
     return nodeNum;
 }
 
@@ -465,61 +482,54 @@ int IndexManager::getMostRightLeafNumber(IXFileHandle &ixfileHandle){
     if(ixfileHandle.getNumberOfPages() == 0){
         return -1;
     }
-    void * node = malloc(PAGE_SIZE);
-    memset(node, 0, PAGE_SIZE);
+    void * node;
     //always start at root!
-    ixfileHandle.readPage(0, node);
+    if(ixfileHandle.fetchPage(0, node) != SUCCESS){
+        return -1;
+    }
     NodeHeader header = getNodeHeader(node);
     if(header.isLeaf){
+        ixfileHandle.unpinPage(0, false);
         return -1;
     }
     NonLeafEntry entry = getNonLeafEntry(node, header.numEntries-1);
+    ixfileHandle.unpinPage(0, false);
     int nodeNum = entry.greaterThanNode;
     if(nodeNum == NONODE)
         nodeNum = entry.lessThanNode;
-    void * tempNode = malloc(PAGE_SIZE);
     while(true){
-        memset(tempNode, 0, PAGE_SIZE);
-        ixfileHandle.readPage(nodeNum, tempNode);
-        header = getNodeHeader(tempNode);
-        if(header.isLeaf)
+        // No node points back at the root, page 0 here means an unwritten node
+        if(nodeNum == 0 || ixfileHandle.fetchPage(nodeNum, node) != SUCCESS){
+            return -1;
+        }
+        header = getNodeHeader(node);
+        if(header.isLeaf){
+            ixfileHandle.unpinPage(nodeNum, false);
             break;
+        }
         else{
-            entry = getNonLeafEntry(tempNode, header.numEntries-1);
+            entry = getNonLeafEntry(node, header.numEntries-1);
+            ixfileHandle.unpinPage(nodeNum, false);
             nodeNum = entry.greaterThanNode;
             if(nodeNum == NONODE)
                 nodeNum = entry.greaterThanNode;
         }
     }
-    free(tempNode);
     return nodeNum;
 }
 
 /*
- * Get a value from a node given the node and the offset in bytes
+ * Get a value from a node given the node and the offset in bytes.
+ * The value is not copied, it stays valid for as long as the node does.
 */
 	void* getValue(void * node, int offset, const Attribute &attribute)
 	{
-	    void * value;
-	    int size = 0;
-	    if(attribute.type != TypeVarChar){
-		size = sizeof(int);
-	    }
-	    else
-	    {
-		size = *(int*)((char*)(node)+offset);
-	    }
-	    //need to handle varchars still
-	    value = malloc(size);
 	    if (attribute.type != TypeVarChar)
 	    {
-		memcpy(value, (char*)node+offset, size);
-	    }
-	    else
-	    {
-		memcpy(value, (char*)node+offset+sizeof(int), size);
+		return (char*)node+offset;
 	    }
-	    return value;
+	    //need to handle varchars still
+	    return (char*)node+offset+sizeof(int);
 	}
 
 	/*
@@ -648,6 +658,36 @@ void IndexManager::setNonLeafEntry(void * page, unsigned entryNumber, NonLeafEnt
             );
 }
 
+/*
+ * Copy a node out of the buffer pool into a private buffer.
+ * On failure the buffer is zeroed, like a fresh node.
+ */
+RC IndexManager::readNode(IXFileHandle &ixfileHandle, int pageNum, void * node) const
+{
+    void * page;
+    RC rc = ixfileHandle.fetchPage(pageNum, page);
+    if(rc != SUCCESS){
+        memset(node, 0, PAGE_SIZE);
+        return rc;
+    }
+    memcpy(node, page, PAGE_SIZE);
+    return ixfileHandle.unpinPage(pageNum, false);
+}
+
+/*
+ * Copy a private buffer back into the buffer pool, marking the page dirty
+ */
+RC IndexManager::writeNode(IXFileHandle &ixfileHandle, int pageNum, const void * node) const
+{
+    void * page;
+    RC rc = ixfileHandle.fetchPage(pageNum, page);
+    if(rc != SUCCESS){
+        return rc;
+    }
+    memcpy(page, node, PAGE_SIZE);
+    return ixfileHandle.unpinPage(pageNum, true);
+}
+
 /*
  * Scan the BTree.
  * Search for the first lowKey node. Then search for the last
@@ -685,50 +725,116 @@ RC IndexManager::scan(IXFileHandle &ixfileHandle,
     }
     ix_ScanIterator.endNode = nodeNum;
     ix_ScanIterator.ixfileHandle = &ixfileHandle;
+    // Leaves are not allocated in key order, so read-ahead follows the order the tree gives them
+    // for the range. A range within one leaf has nothing to read ahead.
+    ix_ScanIterator.leafOrder.clear();
+    ix_ScanIterator.leafPosition = 0;
+    ix_ScanIterator.readAheadPosition = 0;
+    if(ixfileHandle.getReadAhead() > 0 && ix_ScanIterator.currentNode != ix_ScanIterator.endNode){
+        collectLeaves(ixfileHandle, 0, attribute, lowKey, highKey, ix_ScanIterator.leafOrder, 0);
+    }
     ix_ScanIterator.startFlag = 1;
     ix_ScanIterator.attribute = attribute;
     ix_ScanIterator.lowKeyInclusive = lowKeyInclusive;
     ix_ScanIterator.highKeyInclusive = highKeyInclusive;
-    int size;
-	if (attribute.type != TypeVarChar)
-	{
-		size = sizeof(int);
-	}
-	else
-	{
-		size = sizeof(int) + *(int*)lowKey;
-	}
-    if(lowKey == NULL)
-        ix_ScanIterator.lowKey = NULL;
-    else{
-        ix_ScanIterator.lowKey = malloc(size);
-    	memcpy(ix_ScanIterator.lowKey, lowKey, size);
+    // The iterator keeps its own copies of the keys, in buffers it reuses from scan to scan
+    ix_ScanIterator.lowKey = copyKey(lowKey, attribute, ix_ScanIterator.lowKeyBuffer);
+    ix_ScanIterator.highKey = copyKey(highKey, attribute, ix_ScanIterator.highKeyBuffer);
+    return 0;
+}
+
+/*
+ * Copy key into buffer, growing it only if the key doesn't fit.
+ * Returns the copy, or NULL for a NULL key.
+ */
+void* IndexManager::copyKey(const void *key, const Attribute &attribute, vector<char> &buffer)
+{
+    if(key == NULL){
+        return NULL;
     }
-	if (attribute.type != TypeVarChar)
-	{
-		size = sizeof(int);
-	}
-	else
-	{
-		size = sizeof(int) + *(int*)highKey;
-	}
-    if(lowKey == NULL)
-        ix_ScanIterator.lowKey = NULL;
-    else{
-        ix_ScanIterator.highKey = malloc(size);
-        memcpy(ix_ScanIterator.highKey, highKey, size);
+    int size = sizeof(int);
+    if(attribute.type == TypeVarChar){
+        size += getKeySize(key, attribute);
+    }
+    if(buffer.size() < (size_t)size){
+        buffer.resize(size);
+    }
+    memcpy(&buffer[0], key, size);
+    return &buffer[0];
+}
+
+/*
+ * Append the leaves under nodeNum that may hold keys in [lowKey, highKey] to leaves, left to right;
+ * a NULL key leaves that end open. Leaves are never read: the children of a node are all leaves
+ * or none, so only the first child in range is looked at, and it lies on the path the scan has
+ * just searched. Children are copied out before recursing so only one node is pinned at a time.
+ */
+void IndexManager::collectLeaves(IXFileHandle &ixfileHandle, int nodeNum, const Attribute &attribute,
+        const void *lowKey, const void *highKey, vector<int> &leaves, unsigned depth)
+{
+    // A tree this deep can only be a cycle in a damaged file
+    if(depth > 64 || nodeNum < 0 || (unsigned)nodeNum >= ixfileHandle.getNumberOfPages()){
+        return;
+    }
+    void *node;
+    if(ixfileHandle.fetchPage(nodeNum, node) != SUCCESS){
+        return;
+    }
+    NodeHeader header = getNodeHeader(node);
+    if(header.isLeaf){
+        ixfileHandle.unpinPage(nodeNum, false);
+        leaves.push_back(nodeNum);
+        return;
+    }
+    // Child i takes the keys from key i - 1 up to key i, the last child those from the last key on
+    vector<int> children;
+    for(int i = 0; i <= header.numEntries && header.numEntries > 0; i++){
+        if(i < header.numEntries && lowKey != NULL
+           && compareVals(lowKey, getValue(node, getNonLeafEntry(node, i).offset, attribute), attribute) > 0){
+            continue;
+        }
+        if(i > 0 && highKey != NULL
+           && compareVals(highKey, getValue(node, getNonLeafEntry(node, i - 1).offset, attribute), attribute) < 0){
+            break;
+        }
+        int child = i < header.numEntries ? getNonLeafEntry(node, i).lessThanNode
+                                          : getNonLeafEntry(node, i - 1).greaterThanNode;
+        // The root is never anyone's child; NONODE marks a missing one
+        if(child == NONODE || child == 0 || (!children.empty() && children.back() == child)){
+            continue;
+        }
+        children.push_back(child);
+    }
+    ixfileHandle.unpinPage(nodeNum, false);
+    if(children.empty()){
+        return;
+    }
+
+    void *child;
+    if(children[0] >= (int)ixfileHandle.getNumberOfPages() || ixfileHandle.fetchPage(children[0], child) != SUCCESS){
+        return;
+    }
+    bool childrenAreLeaves = getNodeHeader(child).isLeaf;
+    ixfileHandle.unpinPage(children[0], false);
+    for(unsigned i = 0; i < children.size(); i++){
+        if(childrenAreLeaves){
+            leaves.push_back(children[i]);
+        }else{
+            collectLeaves(ixfileHandle, children[i], attribute, lowKey, highKey, leaves, depth + 1);
+        }
     }
-    return 0;
 }
 
 void IndexManager::printBtree(IXFileHandle &ixfileHandle, const Attribute &attribute) const {
 
 		
 	static int depth = 0;	
-	void* page = malloc(PAGE_SIZE);
+	ScratchPage scratch;
+	void* page = scratch.data();
+	memset(page, 0, PAGE_SIZE);
 	if(depth == 0)
 	{
-		ixfileHandle.readPage(0, page);
+		readNode(ixfileHandle, 0, page);
 	}
     	NodeHeader header = getNodeHeader(page);
     	if(header.isLeaf)
@@ -802,8 +908,9 @@ void IndexManager::printBtree(IXFileHandle &ixfileHandle, const Attribute &attri
 
 void IndexManager::printRecur(IXFileHandle ixfileHandle, int pageNum, const Attribute& attribute) const
 {
-	void* page = malloc(PAGE_SIZE);
-	ixfileHandle.readPage(pageNum, page);
+	ScratchPage scratch;
+	void* page = scratch.data();
+	readNode(ixfileHandle, pageNum, page);
     	NodeHeader header = getNodeHeader(page);
     	if(header.isLeaf)
 	{
@@ -903,6 +1010,8 @@ IX_ScanIterator::IX_ScanIterator()
     endNode = NULL;
     startFlag = 0;
     done = false;
+    leafPosition = 0;
+    readAheadPosition = 0;
 }
 
 IX_ScanIterator::~IX_ScanIterator()
@@ -921,13 +1030,12 @@ RC IX_ScanIterator::getNextEntry(RID &rid, void *key)
 {
     if(done)
         return IX_EOF;
-    void *startNode = malloc(PAGE_SIZE);
-    memset(startNode, 0, PAGE_SIZE);
-    ixfileHandle->readPage(currentNode, startNode);
-
-    void *eNode = malloc(PAGE_SIZE);
-    memset(eNode, 0, PAGE_SIZE);
-    ixfileHandle->readPage(endNode, eNode);
+    readAhead();
+    // Work directly on the leaf pinned in the buffer pool
+    void *startNode;
+    int pinnedNode = currentNode;
+    if(ixfileHandle->fetchPage(pinnedNode, startNode) != SUCCESS)
+        return IX_EOF;
 
     NodeHeader header = getNodeHeader(startNode);
     // Is this the last node?
@@ -992,8 +1100,13 @@ RC IX_ScanIterator::getNextEntry(RID &rid, void *key)
             }
             currentEntryNumber = 0;
             currentNode = header.nextNode;
+            // Page 0 is the root, so a leaf never links to it unless it was never written
+            if(currentNode == 0){
+                done = true;
+            }
         }
         startFlag = 0;
+        ixfileHandle->unpinPage(pinnedNode, false);
         cout << rid.pageNum << endl;
         return 0;
     }
@@ -1005,6 +1118,7 @@ RC IX_ScanIterator::getNextEntry(RID &rid, void *key)
             rid = leaf.rid;
             key = entryValue;
         } else{
+            ixfileHandle->unpinPage(pinnedNode, false);
             return IX_EOF;
         }
     } else{
@@ -1012,6 +1126,7 @@ RC IX_ScanIterator::getNextEntry(RID &rid, void *key)
             rid = leaf.rid;
             key = entryValue;
         } else{
+            ixfileHandle->unpinPage(pinnedNode, false);
             return IX_EOF;
         }
     }
@@ -1024,7 +1139,11 @@ RC IX_ScanIterator::getNextEntry(RID &rid, void *key)
         }
         currentEntryNumber = 0;
         currentNode = header.nextNode;
+        if(currentNode == 0){
+            done = true;
+        }
     }
+    ixfileHandle->unpinPage(pinnedNode, false);
     return 0;
 }
 
@@ -1033,9 +1152,46 @@ RC IX_ScanIterator::close()
     currentNode = NULL;
     endNode = NULL;
     startFlag = 0;
+    leafOrder.clear();
     return 0;
 }
 
+/*
+ * Keep the leaves after the current one loading into the buffer pool.
+ * The window is topped up in one batch once half of it has been consumed.
+ */
+void IX_ScanIterator::readAhead()
+{
+    unsigned window = ixfileHandle->getReadAhead();
+    if(window == 0 || leafOrder.empty()){
+        return;
+    }
+    // The scan only moves forward, so pick up the search where we left off
+    while(leafPosition < leafOrder.size() && leafOrder[leafPosition] != currentNode){
+        leafPosition++;
+    }
+    if(leafPosition >= leafOrder.size()){
+        leafOrder.clear();
+        return;
+    }
+
+    unsigned first = max(readAheadPosition, leafPosition + 1);
+    unsigned last = min(leafPosition + window, (unsigned)leafOrder.size() - 1);
+    if(first > last || first > leafPosition + window / 2 + 1){
+        return;
+    }
+    readAheadPages.clear();
+    for(unsigned i = first; i <= last; i++){
+        readAheadPages.push_back(leafOrder[i]);
+        // Nothing past the end of the range is needed
+        if(leafOrder[i] == endNode){
+            break;
+        }
+    }
+    ixfileHandle->prefetchPages(readAheadPages);
+    readAheadPosition = last + 1;
+}
+
 
 IXFileHandle::IXFileHandle()
 {
@@ -1049,21 +1205,27 @@ IXFileHandle::~IXFileHandle()
 }
 
 RC IXFileHandle::readPage(PageNum pageNum, void *data){
-    FileHandle::readPage(pageNum, data);
+    RC rc = FileHandle::readPage(pageNum, data);
     ixReadPageCounter++;
-    return 0;
+    return rc;
 }
 
 RC IXFileHandle::writePage(PageNum pageNum, const void *data){
-    FileHandle::writePage(pageNum, data);
+    RC rc = FileHandle::writePage(pageNum, data);
     ixWritePageCounter++;
-    return 0;
+    return rc;
 }
 
 RC IXFileHandle::appendPage(const void *data){
-    FileHandle::appendPage(data);
+    RC rc = FileHandle::appendPage(data);
     ixAppendPageCounter++;
-    return 0;
+    return rc;
+}
+
+RC IXFileHandle::submitRead(PageNum pageNum, void *data, ReadCallback callback, void *context){
+    RC rc = FileHandle::submitRead(pageNum, data, callback, context);
+    ixReadPageCounter++;
+    return rc;
 }
 
 RC IXFileHandle::collectCounterValues(unsigned &readPageCount, unsigned &writePageCount, unsigned &appendPageCount)
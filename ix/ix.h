@@ -15,6 +15,9 @@
 void* getValue(void * node, int offset, const Attribute &attribute);
 int compareVals(const void * val1, void * val2, const Attribute &attribute);
 
+// Keys are packed downwards from IX_NODE_END; the page checksum trailer follows it
+#define IX_NODE_END (PAGE_SIZE - PFM_CHECKSUM_SIZE)
+
 typedef struct NodeHeader
 {
     uint16_t numEntries;
@@ -54,7 +57,7 @@ class IndexManager {
         RC destroyFile(const string &fileName);
 
         // Open an index and return an ixfileHandle.
-        RC openFile(const string &fileName, IXFileHandle &ixfileHandle);
+        RC openFile(const string &fileName, IXFileHandle &ixfileHandle, OpenMode openMode = OPEN_BUFFERED);
 
         // Close an ixfileHandle for an index.
         RC closeFile(IXFileHandle &ixfileHandle);
@@ -98,6 +101,11 @@ class IndexManager {
         int getMostLeftLeafNumber(IXFileHandle &ixfileHandle);
         int getMostRightLeafNumber(IXFileHandle &ixfileHandle);
         RC deleteEntryOnPage(void * node, const RID &rid);
+        RC readNode(IXFileHandle &ixfileHandle, int pageNum, void * node) const;
+        RC writeNode(IXFileHandle &ixfileHandle, int pageNum, const void * node) const;
+        void collectLeaves(IXFileHandle &ixfileHandle, int nodeNum, const Attribute &attribute,
+                           const void *lowKey, const void *highKey, vector<int> &leaves, unsigned depth);
+        void* copyKey(const void *key, const Attribute &attribute, vector<char> &buffer);
 };
 
 //We want to use these functions in scan iterator and they don't require any specific members of IndexManager, so I moved them outside
@@ -117,7 +125,14 @@ class IX_ScanIterator {
         Attribute attribute;
         void *lowKey;
         void *highKey;
+        vector<char> lowKeyBuffer;     // Where lowKey and highKey point, kept between scans
+        vector<char> highKeyBuffer;
         int currentEntryNumber;
+        // Leaves in key order and how far we got through them, for read-ahead
+        vector<int> leafOrder;
+        unsigned leafPosition;
+        unsigned readAheadPosition;
+        vector<PageNum> readAheadPages;
 		// Constructor
         IX_ScanIterator();
 
@@ -129,6 +144,9 @@ class IX_ScanIterator {
 
         // Terminate index scan
         RC close();
+
+    private:
+        void readAhead();
 };
 
 
@@ -144,6 +162,7 @@ public:
     RC readPage(PageNum pageNum, void *data);
     RC writePage(PageNum pageNum, const void *data);
     RC appendPage(const void *data);
+    RC submitRead(PageNum pageNum, void *data, ReadCallback callback, void *context);
 
     // Constructor
     IXFileHandle();
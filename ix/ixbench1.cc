@@ -0,0 +1,128 @@
+#include <iostream>
+#include <iomanip>
+#include <cmath>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <time.h>
+
+#include "ix.h"
+#include "ix_test_util.h"
+
+// Benchmark 1: what the page size of this build buys.
+// PAGE_SIZE is a build setting, so compare sizes by rebuilding, e.g.
+//   for s in 4096 8192 16384 32768 65536; do make clean; make bench PAGE_SIZE=$s; ./ixbench1; done
+
+const int numRecords = 100000;
+const int numPointReads = 20000;
+const unsigned numIndexKeys = 10000000;
+
+static double elapsedSeconds(const struct timespec &start, const struct timespec &end)
+{
+    return (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+// Full scans and random point reads of a record-based file
+int IXBench_1_records(RecordBasedFileManager *rbfm)
+{
+    RC rc;
+    string fileName = "bench1_records";
+
+    remove(fileName.c_str());
+    rc = rbfm->createFile(fileName);
+    assert(rc == success && "Creating the file should not fail.");
+
+    FileHandle fileHandle;
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+    fileHandle.setDurability(DURABILITY_EXPLICIT);
+
+    vector<Attribute> recordDescriptor;
+    createRecordDescriptor(recordDescriptor);
+
+    unsigned char nullsIndicator = 0;
+    void *record = malloc(100);
+    int recordSize = 0;
+    vector<RID> rids(numRecords);
+    for (int i = 0; i < numRecords; i++)
+    {
+        prepareRecord(recordDescriptor.size(), &nullsIndicator, 8, "Anteater", i, 170.1, i * 10, record, &recordSize);
+        rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rids[i]);
+        assert(rc == success && "Inserting a record should not fail.");
+    }
+    rc = fileHandle.sync();
+    assert(rc == success && "Syncing the file should not fail.");
+
+    vector<string> attributeNames;
+    attributeNames.push_back("Age");
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    RBFM_ScanIterator rbfmScanIterator;
+    rc = rbfm->scan(fileHandle, recordDescriptor, "", NO_OP, NULL, attributeNames, rbfmScanIterator);
+    assert(rc == success && "Scanning the file should not fail.");
+    RID rid;
+    int scanned = 0;
+    while (rbfmScanIterator.getNextRecord(rid, record) != RBFM_EOF)
+        scanned++;
+    rbfmScanIterator.close();
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double scanSeconds = elapsedSeconds(start, end);
+    assert(scanned == numRecords && "The scan should see every record.");
+
+    srand(1);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < numPointReads; i++)
+    {
+        rc = rbfm->readRecord(fileHandle, recordDescriptor, rids[rand() % numRecords], record);
+        assert(rc == success && "Reading a record should not fail.");
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double readSeconds = elapsedSeconds(start, end);
+
+    cout << "Records:     " << numRecords << " in " << fileHandle.getNumberOfPages() << " pages" << endl;
+    cout << "Scan:        " << fixed << setprecision(0) << numRecords / scanSeconds << " records/s" << endl;
+    cout << "Point reads: " << numPointReads / readSeconds << " reads/s" << endl;
+
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+    rc = rbfm->destroyFile(fileName);
+    assert(rc == success && "Destroying the file should not fail.");
+
+    free(record);
+    return 0;
+}
+
+// Fan-out and height of a B+ tree over 4 byte keys, from the node layout.
+// A leaf holds a LeafEntry and a key per entry, an inner node a NonLeafEntry and a key.
+int IXBench_1_tree()
+{
+    unsigned keySize = sizeof(int);
+    unsigned space = PAGE_SIZE - sizeof(NodeHeader);
+    unsigned leafCapacity = space / (sizeof(LeafEntry) + keySize);
+    unsigned fanOut = space / (sizeof(NonLeafEntry) + keySize) + 1;
+
+    // Leaves of a bulk loaded tree are full; every level above divides by the fan-out
+    unsigned nodes = (numIndexKeys + leafCapacity - 1) / leafCapacity;
+    unsigned height = 1;
+    while (nodes > 1)
+    {
+        nodes = (nodes + fanOut - 1) / fanOut;
+        height++;
+    }
+
+    cout << "Leaf entries:  " << leafCapacity << endl;
+    cout << "Fan-out:       " << fanOut << endl;
+    cout << "Height for " << numIndexKeys << " keys: " << height << endl;
+    return 0;
+}
+
+int main()
+{
+    RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
+
+    cout << "Page size " << PAGE_SIZE << endl;
+    IXBench_1_records(rbfm);
+    IXBench_1_tree();
+    return 0;
+}
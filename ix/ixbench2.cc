@@ -0,0 +1,211 @@
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <time.h>
+
+#include "ix.h"
+#include "ix_test_util.h"
+#include "../rbf/alloc_hook.h"
+
+// Benchmark 2: heap allocations on the hot paths.
+// Every allocation the program makes is counted. After a warm-up round, which fills the
+// buffer pool and the per-thread scratch pages and layouts, record and index operations
+// should not make any.
+
+const int numRecords = 20000;
+const int numIndexKeys = 200;
+const int numOps = 1000000;
+const int warmUpRounds = 1000;
+
+typedef enum { OP_INSERT = 0, OP_READ, OP_UPDATE, OP_DELETE, OP_SCAN, OP_INDEX_SCAN, OP_INDEX_NEXT, OP_COUNT } Op;
+
+const char *opNames[OP_COUNT] = { "insertRecord", "readRecord", "updateRecord", "deleteRecord",
+                                  "getNextRecord", "index scan", "getNextEntry" };
+
+static double elapsedSeconds(const struct timespec &start, const struct timespec &end)
+{
+    return (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+typedef struct BenchState
+{
+    RecordBasedFileManager *rbfm;
+    IndexManager *indexManager;
+    FileHandle fileHandle;
+    IXFileHandle ixfileHandle;
+    vector<Attribute> recordDescriptor;
+    Attribute keyAttribute;
+    vector<string> attributeNames;
+    vector<RID> rids;
+    void *record;
+    void *returnedData;
+    RBFM_ScanIterator rbfmScanIterator;
+    IX_ScanIterator ixScanIterator;
+    int scanLimit;
+} BenchState;
+
+// Round i of every operation; returns how many allocations each one made
+static void runRound(BenchState &state, int i, unsigned long allocations[OP_COUNT])
+{
+    RC rc;
+    int recordSize = 0;
+    unsigned char nullsIndicator = 0;
+    int index = i % numRecords;
+    unsigned long before;
+
+    before = allocationCount();
+    rc = state.rbfm->readRecord(state.fileHandle, state.recordDescriptor, state.rids[index], state.returnedData);
+    assert(rc == success && "Reading a record should not fail.");
+    allocations[OP_READ] += allocationCount() - before;
+
+    // Same size, so the record stays where it is
+    prepareRecord(state.recordDescriptor.size(), &nullsIndicator, 8, "Anteater", index, 170.1, i, state.record, &recordSize);
+    before = allocationCount();
+    rc = state.rbfm->updateRecord(state.fileHandle, state.recordDescriptor, state.record, state.rids[index]);
+    assert(rc == success && "Updating a record should not fail.");
+    allocations[OP_UPDATE] += allocationCount() - before;
+
+    before = allocationCount();
+    rc = state.rbfm->deleteRecord(state.fileHandle, state.recordDescriptor, state.rids[index]);
+    assert(rc == success && "Deleting a record should not fail.");
+    allocations[OP_DELETE] += allocationCount() - before;
+
+    before = allocationCount();
+    rc = state.rbfm->insertRecord(state.fileHandle, state.recordDescriptor, state.record, state.rids[index]);
+    assert(rc == success && "Inserting a record should not fail.");
+    allocations[OP_INSERT] += allocationCount() - before;
+
+    // One record of a long running scan, started over when it runs out
+    RID rid;
+    before = allocationCount();
+    if (state.rbfmScanIterator.getNextRecord(rid, state.returnedData) == RBFM_EOF)
+    {
+        state.rbfmScanIterator.close();
+        rc = state.rbfm->scan(state.fileHandle, state.recordDescriptor, "Age", GE_OP, &state.scanLimit,
+                              state.attributeNames, state.rbfmScanIterator);
+        assert(rc == success && "Scanning the file should not fail.");
+    }
+    allocations[OP_SCAN] += allocationCount() - before;
+
+    // A short index range and its first entry
+    int lowKey = i % numIndexKeys;
+    int highKey = lowKey + 5;
+    before = allocationCount();
+    rc = state.indexManager->scan(state.ixfileHandle, state.keyAttribute, &lowKey, &highKey, true, true, state.ixScanIterator);
+    assert(rc == success && "Scanning the index should not fail.");
+    allocations[OP_INDEX_SCAN] += allocationCount() - before;
+
+    int key;
+    before = allocationCount();
+    state.ixScanIterator.getNextEntry(rid, &key);
+    allocations[OP_INDEX_NEXT] += allocationCount() - before;
+    state.ixScanIterator.close();
+}
+
+int IXBench_2()
+{
+    RC rc;
+    BenchState state;
+    state.rbfm = RecordBasedFileManager::instance();
+    state.indexManager = IndexManager::instance();
+    string fileName = "bench2_records";
+    string indexFileName = "bench2_idx";
+
+    remove(fileName.c_str());
+    remove(indexFileName.c_str());
+
+    // The records
+    rc = state.rbfm->createFile(fileName);
+    assert(rc == success && "Creating the file should not fail.");
+    rc = state.rbfm->openFile(fileName, state.fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+    createRecordDescriptor(state.recordDescriptor);
+    state.attributeNames.push_back("EmpName");
+    state.attributeNames.push_back("Salary");
+    state.scanLimit = 0;
+
+    state.record = malloc(100);
+    state.returnedData = malloc(100);
+    int recordSize = 0;
+    unsigned char nullsIndicator = 0;
+    state.rids.resize(numRecords);
+    for (int i = 0; i < numRecords; i++)
+    {
+        prepareRecord(state.recordDescriptor.size(), &nullsIndicator, 8, "Anteater", i, 170.1, i * 10, state.record, &recordSize);
+        rc = state.rbfm->insertRecord(state.fileHandle, state.recordDescriptor, state.record, state.rids[i]);
+        assert(rc == success && "Inserting a record should not fail.");
+    }
+    rc = state.rbfm->scan(state.fileHandle, state.recordDescriptor, "Age", GE_OP, &state.scanLimit,
+                          state.attributeNames, state.rbfmScanIterator);
+    assert(rc == success && "Scanning the file should not fail.");
+
+    // An index small enough for one leaf; insertEntry and getNextEntry print as they go
+    streambuf *output = cout.rdbuf(NULL);
+    state.keyAttribute.name = "Age";
+    state.keyAttribute.type = TypeInt;
+    state.keyAttribute.length = 4;
+    rc = state.indexManager->createFile(indexFileName);
+    assert(rc == success && "Creating the index should not fail.");
+    rc = state.indexManager->openFile(indexFileName, state.ixfileHandle);
+    assert(rc == success && "Opening the index should not fail.");
+    for (int key = 0; key < numIndexKeys; key++)
+    {
+        RID rid;
+        rid.pageNum = key;
+        rid.slotNum = key + 1;
+        rc = state.indexManager->insertEntry(state.ixfileHandle, state.keyAttribute, &key, rid);
+        assert(rc == success && "Inserting an index entry should not fail.");
+    }
+
+    unsigned long allocations[OP_COUNT] = { 0 };
+    for (int i = 0; i < warmUpRounds; i++)
+        runRound(state, i, allocations);
+
+    // The measured rounds
+    memset(allocations, 0, sizeof(allocations));
+    int rounds = numOps / OP_COUNT;
+    struct timespec start, end;
+    unsigned long before = allocationCount();
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < rounds; i++)
+        runRound(state, warmUpRounds + i, allocations);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    unsigned long total = allocationCount() - before;
+
+    cout.rdbuf(output);
+    cout.clear();
+
+    cout << rounds * OP_COUNT << " operations in " << fixed << setprecision(3) << elapsedSeconds(start, end) << " s" << endl;
+    cout << setw(16) << "operation" << setw(10) << "calls" << setw(14) << "allocations" << endl;
+    for (int op = 0; op < OP_COUNT; op++)
+        cout << setw(16) << opNames[op] << setw(10) << rounds << setw(14) << allocations[op] << endl;
+    cout << setw(16) << "whole loop" << setw(10) << rounds * OP_COUNT << setw(14) << total << endl;
+
+    state.rbfmScanIterator.close();
+    rc = state.indexManager->closeFile(state.ixfileHandle);
+    assert(rc == success && "Closing the index should not fail.");
+    rc = state.indexManager->destroyFile(indexFileName);
+    assert(rc == success && "Destroying the index should not fail.");
+    rc = state.rbfm->closeFile(state.fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+    rc = state.rbfm->destroyFile(fileName);
+    assert(rc == success && "Destroying the file should not fail.");
+
+    free(state.record);
+    free(state.returnedData);
+
+    if (total != 0)
+    {
+        cout << "[FAIL] The hot paths should not allocate once warm." << endl;
+        return -1;
+    }
+    cout << "No allocations once warm." << endl;
+    return 0;
+}
+
+int main()
+{
+    return IXBench_2();
+}
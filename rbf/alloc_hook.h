@@ -0,0 +1,77 @@
+#ifndef _alloc_hook_h_
+#define _alloc_hook_h_
+
+// Test hook counting the heap allocations a program makes. It stands in for the C
+// allocator, which operator new also goes through, and hands every call on to glibc.
+// Include it from exactly one source file of a test or benchmark program.
+
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+void *__libc_memalign(size_t alignment, size_t size);
+void __libc_free(void *ptr);
+}
+
+static std::atomic<unsigned long> allocationCounter(0);
+
+// Heap allocations made so far, by any thread
+static unsigned long allocationCount()
+{
+    return allocationCounter.load();
+}
+
+extern "C" {
+
+void *malloc(size_t size) noexcept
+{
+    allocationCounter++;
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size) noexcept
+{
+    allocationCounter++;
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *ptr, size_t size) noexcept
+{
+    allocationCounter++;
+    return __libc_realloc(ptr, size);
+}
+
+void *memalign(size_t alignment, size_t size) noexcept
+{
+    allocationCounter++;
+    return __libc_memalign(alignment, size);
+}
+
+void *aligned_alloc(size_t alignment, size_t size) noexcept
+{
+    allocationCounter++;
+    return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void **memptr, size_t alignment, size_t size) noexcept
+{
+    allocationCounter++;
+    void *ptr = __libc_memalign(alignment, size);
+    if (ptr == NULL)
+        return ENOMEM;
+    *memptr = ptr;
+    return 0;
+}
+
+void free(void *ptr) noexcept
+{
+    __libc_free(ptr);
+}
+
+}
+
+#endif
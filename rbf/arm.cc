@@ -0,0 +1,242 @@
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "arm.h"
+
+// Shared rings of an io_uring instance, set up with the raw system calls
+struct IoUring
+{
+    int fd;
+    unsigned *sqHead;
+    unsigned *sqTail;
+    unsigned *sqMask;
+    unsigned *sqArray;
+    struct io_uring_sqe *sqes;
+    unsigned *cqHead;
+    unsigned *cqTail;
+    unsigned *cqMask;
+    struct io_uring_cqe *cqes;
+};
+
+AsyncReadManager* AsyncReadManager::_ar_manager = NULL;
+
+AsyncReadManager* AsyncReadManager::instance()
+{
+    if(!_ar_manager)
+        _ar_manager = new AsyncReadManager();
+
+    return _ar_manager;
+}
+
+AsyncReadManager::AsyncReadManager()
+: ring(NULL)
+{
+    // ARM_NO_IO_URING forces the thread pool, e.g. to compare the two backends
+    if (getenv("ARM_NO_IO_URING") == NULL && setupRing())
+    {
+        reaper = thread(&AsyncReadManager::reap, this);
+        reaper.detach();
+        return;
+    }
+
+    for (unsigned i = 0; i < ARM_WORKERS; i++)
+    {
+        workers.push_back(thread(&AsyncReadManager::work, this));
+        workers.back().detach();
+    }
+}
+
+// The manager lives as long as the process; its threads are detached
+AsyncReadManager::~AsyncReadManager()
+{
+}
+
+RC AsyncReadManager::submit(int fd, off_t offset, void *data, size_t length, ReadCallback callback, void *context)
+{
+    ReadRequest *request = new ReadRequest;
+    request->fd = fd;
+    request->offset = offset;
+    request->data = data;
+    request->length = length;
+    request->callback = callback;
+    request->context = context;
+    request->iov = NULL;
+
+    if (ring != NULL)
+        return submitToRing(request);
+
+    lock_guard<mutex> guard(queueLatch);
+    queue.push_back(request);
+    queued.notify_one();
+    return SUCCESS;
+}
+
+bool AsyncReadManager::usingIoUring()
+{
+    return ring != NULL;
+}
+
+// Private helper methods ///////////////////////////////////////////////////////////////////
+
+bool AsyncReadManager::setupRing()
+{
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    int fd = syscall(__NR_io_uring_setup, ARM_QUEUE_DEPTH, &params);
+    if (fd < 0)
+        return false;
+
+    size_t sqSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    size_t cqSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    bool singleMap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (singleMap && cqSize > sqSize)
+        sqSize = cqSize;
+
+    char *sq = (char *) mmap(NULL, sqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (sq == MAP_FAILED)
+    {
+        close(fd);
+        return false;
+    }
+    char *cq = sq;
+    if (!singleMap)
+    {
+        cq = (char *) mmap(NULL, cqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (cq == MAP_FAILED)
+        {
+            munmap(sq, sqSize);
+            close(fd);
+            return false;
+        }
+    }
+    void *sqes = mmap(NULL, params.sq_entries * sizeof(struct io_uring_sqe), PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED)
+    {
+        if (!singleMap)
+            munmap(cq, cqSize);
+        munmap(sq, sqSize);
+        close(fd);
+        return false;
+    }
+
+    ring = new IoUring;
+    ring->fd = fd;
+    ring->sqHead = (unsigned *) (sq + params.sq_off.head);
+    ring->sqTail = (unsigned *) (sq + params.sq_off.tail);
+    ring->sqMask = (unsigned *) (sq + params.sq_off.ring_mask);
+    ring->sqArray = (unsigned *) (sq + params.sq_off.array);
+    ring->sqes = (struct io_uring_sqe *) sqes;
+    ring->cqHead = (unsigned *) (cq + params.cq_off.head);
+    ring->cqTail = (unsigned *) (cq + params.cq_off.tail);
+    ring->cqMask = (unsigned *) (cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *) (cq + params.cq_off.cqes);
+    return true;
+}
+
+RC AsyncReadManager::submitToRing(ReadRequest *request)
+{
+    request->iov = new struct iovec;
+    request->iov->iov_base = request->data;
+    request->iov->iov_len = request->length;
+
+    lock_guard<mutex> guard(submitLatch);
+
+    // The kernel consumes entries on every io_uring_enter below, so there is always room
+    unsigned tail = *ring->sqTail;
+    unsigned index = tail & *ring->sqMask;
+    struct io_uring_sqe *sqe = &ring->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_READV;
+    sqe->fd = request->fd;
+    sqe->addr = (unsigned long) request->iov;
+    sqe->len = 1;
+    sqe->off = request->offset;
+    sqe->user_data = (unsigned long) request;
+    ring->sqArray[index] = index;
+    __atomic_store_n(ring->sqTail, tail + 1, __ATOMIC_RELEASE);
+
+    int submitted;
+    do
+        submitted = syscall(__NR_io_uring_enter, ring->fd, 1, 0, 0, NULL, 0);
+    while (submitted < 0 && (errno == EINTR || errno == EAGAIN || errno == EBUSY));
+
+    if (submitted != 1)
+    {
+        // Take the entry back and read synchronously instead
+        __atomic_store_n(ring->sqTail, tail, __ATOMIC_RELEASE);
+        ssize_t done = pread(request->fd, request->data, request->length, request->offset);
+        request->callback(request->context, finishRead(request, done));
+        delete request->iov;
+        delete request;
+    }
+    return SUCCESS;
+}
+
+// Completion thread of the io_uring backend
+void AsyncReadManager::reap()
+{
+    while (true)
+    {
+        unsigned head = *ring->cqHead;
+        if (head == __atomic_load_n(ring->cqTail, __ATOMIC_ACQUIRE))
+        {
+            syscall(__NR_io_uring_enter, ring->fd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+            continue;
+        }
+
+        struct io_uring_cqe *cqe = &ring->cqes[head & *ring->cqMask];
+        ReadRequest *request = (ReadRequest *) (unsigned long) cqe->user_data;
+        ssize_t done = cqe->res;
+        __atomic_store_n(ring->cqHead, head + 1, __ATOMIC_RELEASE);
+
+        request->callback(request->context, finishRead(request, done));
+        delete request->iov;
+        delete request;
+    }
+}
+
+// Worker thread of the fallback backend
+void AsyncReadManager::work()
+{
+    while (true)
+    {
+        ReadRequest *request;
+        {
+            unique_lock<mutex> guard(queueLatch);
+            while (queue.empty())
+                queued.wait(guard);
+            request = queue.front();
+            queue.pop_front();
+        }
+
+        ssize_t done = pread(request->fd, request->data, request->length, request->offset);
+        request->callback(request->context, finishRead(request, done));
+        delete request;
+    }
+}
+
+// Complete a short read synchronously and turn the result into an RC
+RC AsyncReadManager::finishRead(ReadRequest *request, ssize_t done)
+{
+    if (done < 0)
+        return FH_READ_FAILED;
+
+    size_t total = done;
+    while (total < request->length)
+    {
+        ssize_t n = pread(request->fd, (char *) request->data + total, request->length - total, request->offset + total);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return FH_READ_FAILED;
+        total += n;
+    }
+    return SUCCESS;
+}
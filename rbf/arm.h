@@ -0,0 +1,69 @@
+#ifndef _arm_h_
+#define _arm_h_
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#include "pfm.h"
+
+#define ARM_WORKERS      4      // Threads of the fallback backend
+#define ARM_QUEUE_DEPTH  64     // io_uring submission queue entries
+
+// One read in flight
+typedef struct ReadRequest
+{
+    int fd;
+    off_t offset;
+    void *data;
+    size_t length;
+    ReadCallback callback;
+    void *context;
+    struct iovec *iov;          // Only used by the io_uring backend
+} ReadRequest;
+
+struct IoUring;
+
+// Asynchronous page reads underneath FileHandle::submitReads and buffer pool read-ahead.
+// Reads go through io_uring when the kernel allows it, otherwise through a small pool
+// of threads doing blocking preads. Either way completions are delivered by calling
+// the request's callback on a background thread.
+class AsyncReadManager
+{
+public:
+    static AsyncReadManager* instance();
+
+    RC submit(int fd, off_t offset, void *data, size_t length, ReadCallback callback, void *context);
+    bool usingIoUring();
+
+protected:
+    AsyncReadManager();
+    ~AsyncReadManager();
+
+private:
+    static AsyncReadManager *_ar_manager;
+
+    // io_uring backend
+    IoUring *ring;
+    mutex submitLatch;
+    thread reaper;
+
+    // Thread pool backend
+    vector<thread> workers;
+    mutex queueLatch;
+    condition_variable queued;
+    deque<ReadRequest*> queue;
+
+    // Private helper methods
+    bool setupRing();
+    RC submitToRing(ReadRequest *request);
+    void reap();
+    void work();
+    static RC finishRead(ReadRequest *request, ssize_t done);
+};
+
+#endif
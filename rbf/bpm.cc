@@ -0,0 +1,464 @@
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include "bpm.h"
+
+BufferPoolManager* BufferPoolManager::_bp_manager = NULL;
+
+BufferPoolManager* BufferPoolManager::instance()
+{
+    if(!_bp_manager)
+        _bp_manager = new BufferPoolManager();
+
+    return _bp_manager;
+}
+
+BufferPoolManager::BufferPoolManager()
+: policy(CLOCK_REPLACEMENT), clockHand(0), hitCounter(0), missCounter(0), evictionCounter(0)
+{
+    allocateFrames(BPM_DEFAULT_FRAMES);
+}
+
+BufferPoolManager::~BufferPoolManager()
+{
+    freeFrames();
+}
+
+RC BufferPoolManager::configure(unsigned frameCount, ReplacementPolicy newPolicy)
+{
+    lock_guard<recursive_mutex> guard(latch);
+    if (frameCount == 0)
+        return BPM_BAD_CONFIG;
+
+    // We can't move pages out from under their users
+    for (unsigned i = 0; i < frames.size(); i++)
+    {
+        if (frames[i].pinCount > 0)
+            return BPM_FRAMES_PINNED;
+    }
+
+    // Write back and drop everything currently cached
+    for (unsigned i = 0; i < frames.size(); i++)
+    {
+        Frame &frame = frames[i];
+        if (frame.file == NULL)
+            continue;
+        if (frame.dirty && writeBack(frame))
+            return FH_WRITE_FAILED;
+        frame.file->frames.erase(frame.pageNum);
+        frame.file = NULL;
+    }
+
+    freeFrames();
+    policy = newPolicy;
+    allocateFrames(frameCount);
+    return SUCCESS;
+}
+
+RC BufferPoolManager::fetchPage(FileHandle &fileHandle, PageNum pageNum, void *&page)
+{
+    PagedFile *file = fileHandle.getFile();
+    if (file == NULL)
+        return FH_READ_FAILED;
+
+    unique_lock<recursive_mutex> guard(latch);
+
+    // Hit: just pin the frame, once another thread is done reading it in
+    Frame *cached;
+    while ((cached = lookup(file, pageNum)) != NULL && cached->loading)
+        loaded.wait(guard);
+    if (cached != NULL)
+    {
+        pin(file->frames[pageNum]);
+        hitCounter++;
+        fileHandle.bufferHitCounter++;
+        page = cached->data;
+        return SUCCESS;
+    }
+
+    // Miss: claim a frame so nobody else loads the same page
+    unsigned frameNum;
+    RC rc = getVictim(fileHandle, frameNum);
+    if (rc)
+        return rc;
+
+    Frame &frame = frames[frameNum];
+    frame.file = file;
+    frame.pageNum = pageNum;
+    frame.dirty = false;
+    frame.loading = true;
+    file->frames[pageNum] = frameNum;
+    pin(frameNum);
+
+    // Read the page through the handle so its counters see the I/O
+    guard.unlock();
+    rc = fileHandle.readPage(pageNum, frame.data);
+    guard.lock();
+
+    frame.loading = false;
+    loaded.notify_all();
+    if (rc)
+    {
+        dropFrame(frameNum);
+        return rc;
+    }
+
+    missCounter++;
+    fileHandle.bufferMissCounter++;
+    page = frame.data;
+    return SUCCESS;
+}
+
+RC BufferPoolManager::prefetchPages(FileHandle &fileHandle, const vector<PageNum> &pageNums)
+{
+    PagedFile *file = fileHandle.getFile();
+    if (file == NULL)
+        return FH_READ_FAILED;
+
+    // Claim a frame for every page we have to read, pinned until its read completes
+    vector<unsigned> claimed;
+    {
+        lock_guard<recursive_mutex> guard(latch);
+        for (unsigned i = 0; i < pageNums.size(); i++)
+        {
+            PageNum pageNum = pageNums[i];
+            if (pageNum >= fileHandle.getNumberOfPages() || lookup(file, pageNum) != NULL)
+                continue;
+
+            unsigned frameNum;
+            if (getVictim(fileHandle, frameNum))
+                break;
+
+            Frame &frame = frames[frameNum];
+            frame.file = file;
+            frame.pageNum = pageNum;
+            frame.dirty = false;
+            frame.loading = true;
+            file->frames[pageNum] = frameNum;
+            pin(frameNum);
+
+            missCounter++;
+            fileHandle.bufferMissCounter++;
+            claimed.push_back(frameNum);
+        }
+    }
+
+    for (unsigned i = 0; i < claimed.size(); i++)
+    {
+        Frame &frame = frames[claimed[i]];
+        void *context = (void *) (uintptr_t) claimed[i];
+        RC rc = fileHandle.submitRead(frame.pageNum, frame.data, prefetchDone, context);
+        if (rc)
+            prefetchDone(context, rc);
+    }
+    return SUCCESS;
+}
+
+RC BufferPoolManager::newPage(FileHandle &fileHandle, PageNum &pageNum, void *&page)
+{
+    PagedFile *file = fileHandle.getFile();
+    if (file == NULL)
+        return FH_WRITE_FAILED;
+
+    lock_guard<recursive_mutex> guard(latch);
+    unsigned frameNum;
+    RC rc = getVictim(fileHandle, frameNum);
+    if (rc)
+        return rc;
+
+    // Reserve the page on disk right away so the file's page count stays accurate
+    Frame &frame = frames[frameNum];
+    memset(frame.data, 0, PAGE_SIZE);
+    rc = fileHandle.appendPage(frame.data);
+    if (rc)
+        return rc;
+
+    pageNum = fileHandle.getNumberOfPages() - 1;
+    frame.file = file;
+    frame.pageNum = pageNum;
+    frame.dirty = false;
+    file->frames[pageNum] = frameNum;
+    pin(frameNum);
+
+    page = frame.data;
+    return SUCCESS;
+}
+
+RC BufferPoolManager::unpinPage(FileHandle &fileHandle, PageNum pageNum, bool dirty)
+{
+    lock_guard<recursive_mutex> guard(latch);
+    PagedFile *file = fileHandle.getFile();
+    Frame *frame = lookup(file, pageNum);
+    if (frame == NULL || frame->pinCount == 0)
+        return FH_PAGE_NOT_PINNED;
+
+    frame->dirty = frame->dirty || dirty;
+    if (--frame->pinCount == 0 && policy == LRU_REPLACEMENT)
+        frame->lruPos = lruList.insert(lruList.end(), file->frames[pageNum]);
+
+    return SUCCESS;
+}
+
+RC BufferPoolManager::flushPage(FileHandle &fileHandle, PageNum pageNum)
+{
+    lock_guard<recursive_mutex> guard(latch);
+    Frame *frame = lookup(fileHandle.getFile(), pageNum);
+    if (frame == NULL || !frame->dirty)
+        return SUCCESS;
+
+    RC rc = fileHandle.writePage(pageNum, frame->data);
+    if (rc)
+        return rc;
+    frame->dirty = false;
+    return SUCCESS;
+}
+
+RC BufferPoolManager::flushFile(FileHandle &fileHandle)
+{
+    PagedFile *file = fileHandle.getFile();
+    if (file == NULL)
+        return SUCCESS;
+
+    unique_lock<recursive_mutex> guard(latch);
+    waitForLoads(file, guard);
+
+    RC result = SUCCESS;
+    for (auto it = file->frames.begin(); it != file->frames.end(); ++it)
+    {
+        RC rc = flushPage(fileHandle, it->first);
+        if (rc)
+            result = rc;
+    }
+    return result;
+}
+
+void BufferPoolManager::discardFile(PagedFile *file)
+{
+    unique_lock<recursive_mutex> guard(latch);
+    waitForLoads(file, guard);
+
+    for (auto it = file->frames.begin(); it != file->frames.end(); ++it)
+    {
+        unsigned frameNum = it->second;
+        Frame &frame = frames[frameNum];
+        // Free frames are handed out before any cached page
+        if (policy == LRU_REPLACEMENT)
+        {
+            if (frame.pinCount == 0)
+                lruList.erase(frame.lruPos);
+            frame.lruPos = lruList.insert(lruList.begin(), frameNum);
+        }
+        frame.file = NULL;
+        frame.pinCount = 0;
+        frame.dirty = false;
+        frame.referenced = false;
+    }
+    file->frames.clear();
+}
+
+RC BufferPoolManager::flushIfDirty(PagedFile *file, PageNum pageNum)
+{
+    lock_guard<recursive_mutex> guard(latch);
+    Frame *frame = lookup(file, pageNum);
+    if (frame == NULL || !frame->dirty)
+        return SUCCESS;
+
+    RC rc = writeBack(*frame);
+    if (rc)
+        return rc;
+    frame->dirty = false;
+    return SUCCESS;
+}
+
+void BufferPoolManager::refresh(PagedFile *file, PageNum pageNum, const void *data)
+{
+    lock_guard<recursive_mutex> guard(latch);
+    Frame *frame = lookup(file, pageNum);
+    if (frame == NULL || frame->loading)
+        return;
+
+    if (frame->data != data)
+        memcpy(frame->data, data, PAGE_SIZE);
+    frame->dirty = false;
+}
+
+bool BufferPoolManager::isDirty(PagedFile *file, PageNum pageNum)
+{
+    lock_guard<recursive_mutex> guard(latch);
+    Frame *frame = lookup(file, pageNum);
+    return frame != NULL && frame->dirty;
+}
+
+RC BufferPoolManager::collectCounterValues(unsigned &hitCount, unsigned &missCount, unsigned &evictionCount)
+{
+    lock_guard<recursive_mutex> guard(latch);
+    hitCount      = hitCounter;
+    missCount     = missCounter;
+    evictionCount = evictionCounter;
+    return SUCCESS;
+}
+
+unsigned BufferPoolManager::getFrameCount()
+{
+    return frames.size();
+}
+
+ReplacementPolicy BufferPoolManager::getReplacementPolicy()
+{
+    return policy;
+}
+
+// Private helper methods ///////////////////////////////////////////////////////////////////
+
+void BufferPoolManager::allocateFrames(unsigned frameCount)
+{
+    frames.resize(frameCount);
+    lruList.clear();
+    clockHand = 0;
+    for (unsigned i = 0; i < frameCount; i++)
+    {
+        frames[i].file = NULL;
+        frames[i].pageNum = 0;
+        frames[i].pinCount = 0;
+        frames[i].dirty = false;
+        frames[i].referenced = false;
+        frames[i].loading = false;
+        frames[i].data = allocPage();
+        if (policy == LRU_REPLACEMENT)
+            frames[i].lruPos = lruList.insert(lruList.end(), i);
+    }
+}
+
+void BufferPoolManager::freeFrames()
+{
+    for (unsigned i = 0; i < frames.size(); i++)
+        freePage(frames[i].data);
+    frames.clear();
+    lruList.clear();
+}
+
+Frame *BufferPoolManager::lookup(PagedFile *file, PageNum pageNum)
+{
+    if (file == NULL)
+        return NULL;
+    auto it = file->frames.find(pageNum);
+    if (it == file->frames.end())
+        return NULL;
+    return &frames[it->second];
+}
+
+// Find an unpinned frame and empty it, writing its page back first if needed
+RC BufferPoolManager::getVictim(FileHandle &fileHandle, unsigned &frameNum)
+{
+    bool found = false;
+    if (policy == LRU_REPLACEMENT)
+    {
+        if (!lruList.empty())
+        {
+            frameNum = lruList.front();
+            found = true;
+        }
+    }
+    else
+    {
+        // Two sweeps are enough: the first one clears every reference bit
+        for (unsigned i = 0; i < 2 * frames.size(); i++)
+        {
+            Frame &frame = frames[clockHand];
+            unsigned current = clockHand;
+            clockHand = (clockHand + 1) % frames.size();
+
+            if (frame.pinCount > 0)
+                continue;
+            if (frame.file != NULL && frame.referenced)
+            {
+                frame.referenced = false;
+                continue;
+            }
+            frameNum = current;
+            found = true;
+            break;
+        }
+    }
+    if (!found)
+        return FH_NO_FREE_FRAME;
+
+    Frame &victim = frames[frameNum];
+    if (victim.file == NULL)
+        return SUCCESS;
+
+    if (victim.dirty)
+    {
+        RC rc = writeBack(victim);
+        if (rc)
+            return rc;
+    }
+    victim.file->frames.erase(victim.pageNum);
+    victim.file = NULL;
+    victim.dirty = false;
+    victim.referenced = false;
+
+    evictionCounter++;
+    fileHandle.bufferEvictionCounter++;
+    return SUCCESS;
+}
+
+// Write a frame back to its file. Used for pages that may belong to another handle's file.
+RC BufferPoolManager::writeBack(Frame &frame)
+{
+    if (frame.file->fd < 0)
+        return FH_WRITE_FAILED;
+    return FileHandle::writeFilePage(frame.file, frame.pageNum, frame.data);
+}
+
+// Return a frame whose page could not be read to the free frames
+void BufferPoolManager::dropFrame(unsigned frameNum)
+{
+    Frame &frame = frames[frameNum];
+    frame.file->frames.erase(frame.pageNum);
+    frame.file = NULL;
+    frame.pinCount = 0;
+    frame.referenced = false;
+    if (policy == LRU_REPLACEMENT)
+        frame.lruPos = lruList.insert(lruList.begin(), frameNum);
+}
+
+// Reads in flight write into frames of the file, let them land first
+void BufferPoolManager::waitForLoads(PagedFile *file, unique_lock<recursive_mutex> &guard)
+{
+    bool loading = true;
+    while (loading)
+    {
+        loading = false;
+        for (auto it = file->frames.begin(); it != file->frames.end() && !loading; ++it)
+            loading = frames[it->second].loading;
+        if (loading)
+            loaded.wait(guard);
+    }
+}
+
+// Completion of a read started by prefetchPages
+void BufferPoolManager::prefetchDone(void *context, RC rc)
+{
+    BufferPoolManager *bpm = instance();
+    unsigned frameNum = (uintptr_t) context;
+
+    lock_guard<recursive_mutex> guard(bpm->latch);
+    Frame &frame = bpm->frames[frameNum];
+    frame.loading = false;
+    if (rc)
+        bpm->dropFrame(frameNum);
+    else if (--frame.pinCount == 0 && bpm->policy == LRU_REPLACEMENT)
+        frame.lruPos = bpm->lruList.insert(bpm->lruList.end(), frameNum);
+    bpm->loaded.notify_all();
+}
+
+void BufferPoolManager::pin(unsigned frameNum)
+{
+    Frame &frame = frames[frameNum];
+    if (frame.pinCount == 0 && policy == LRU_REPLACEMENT)
+        lruList.erase(frame.lruPos);
+    frame.pinCount++;
+    frame.referenced = true;
+}
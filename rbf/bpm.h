@@ -0,0 +1,105 @@
+#ifndef _bpm_h_
+#define _bpm_h_
+
+#include <list>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+
+#include "pfm.h"
+
+#define BPM_DEFAULT_FRAMES 256
+
+#define BPM_FRAMES_PINNED  1
+#define BPM_BAD_CONFIG     2
+
+// Page replacement policy used to pick a victim frame on a miss
+typedef enum { CLOCK_REPLACEMENT = 0, LRU_REPLACEMENT } ReplacementPolicy;
+
+// A single buffer pool frame
+// file == NULL means the frame is free
+typedef struct Frame
+{
+    PagedFile *file;
+    PageNum pageNum;
+    unsigned pinCount;
+    bool dirty;
+    bool referenced;                // CLOCK reference bit
+    bool loading;                   // Being read from disk outside the pool lock
+    list<unsigned>::iterator lruPos;  // Position in the LRU list while unpinned
+    void *data;
+} Frame;
+
+// Shared page cache sitting between the record/index managers and the paged files.
+// Pages are cached by file (not by handle), so every handle opened on the same
+// file shares the same frames. Dirty pages are written back when they are evicted,
+// when flushed explicitly, or when the last handle on their file is closed.
+// All operations are thread safe; page reads on a miss run outside the pool lock
+// so threads reading different pages don't wait on each other.
+class BufferPoolManager
+{
+public:
+    static BufferPoolManager* instance();
+
+    // Resize the pool / change policy. Fails if any page is pinned.
+    RC configure(unsigned frameCount, ReplacementPolicy policy);
+
+    RC fetchPage(FileHandle &fileHandle, PageNum pageNum, void *&page);
+    RC newPage(FileHandle &fileHandle, PageNum &pageNum, void *&page);
+    RC unpinPage(FileHandle &fileHandle, PageNum pageNum, bool dirty);
+    RC flushPage(FileHandle &fileHandle, PageNum pageNum);
+
+    // Start asynchronous reads of pages that aren't cached yet. Fetching one of
+    // them waits for its read. Stops early rather than wait for a free frame.
+    RC prefetchPages(FileHandle &fileHandle, const vector<PageNum> &pageNums);
+
+    // Write back every dirty page of the file
+    RC flushFile(FileHandle &fileHandle);
+    // Drop every cached page of the file without writing it back
+    void discardFile(PagedFile *file);
+
+    // Keep the cache coherent with direct FileHandle page I/O
+    RC flushIfDirty(PagedFile *file, PageNum pageNum);
+    void refresh(PagedFile *file, PageNum pageNum, const void *data);
+    bool isDirty(PagedFile *file, PageNum pageNum);
+
+    // Pool-wide counters
+    RC collectCounterValues(unsigned &hitCount, unsigned &missCount, unsigned &evictionCount);
+
+    unsigned getFrameCount();
+    ReplacementPolicy getReplacementPolicy();
+
+protected:
+    BufferPoolManager();
+    ~BufferPoolManager();
+
+private:
+    static BufferPoolManager *_bp_manager;
+
+    vector<Frame> frames;
+    ReplacementPolicy policy;
+    unsigned clockHand;
+    // Unpinned frames, least recently used first (LRU policy only)
+    list<unsigned> lruList;
+
+    unsigned hitCounter;
+    unsigned missCounter;
+    unsigned evictionCounter;
+
+    // Recursive: writes through a FileHandle call back into refresh/flushIfDirty
+    recursive_mutex latch;
+    condition_variable_any loaded;
+
+    // Private helper methods
+    void allocateFrames(unsigned frameCount);
+    void freeFrames();
+    Frame *lookup(PagedFile *file, PageNum pageNum);
+    RC getVictim(FileHandle &fileHandle, unsigned &frameNum);
+    void dropFrame(unsigned frameNum);
+    void waitForLoads(PagedFile *file, unique_lock<recursive_mutex> &guard);
+    static void prefetchDone(void *context, RC rc);
+    RC writeBack(Frame &frame);
+    void pin(unsigned frameNum);
+};
+
+#endif
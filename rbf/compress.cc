@@ -0,0 +1,1330 @@
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <set>
+
+#include "rbfm.h"
+#include "filter.h"
+
+// Compressed pages, see rbfm.h for their layout. Pages are encoded from and decoded to PageRows,
+// a page's records field by field, which is also how an update or vacuum changes them; reads
+// and scans decode straight from the page into the PAX layout instead.
+
+// The records of a compressed page field by field. Values of null fields are meaningless.
+typedef struct FieldValues
+{
+    AttrType type;
+    vector<unsigned char> nulls;
+    vector<uint32_t> values;    // Int values and the bits of Reals
+    vector<string> strings;     // VarChars
+} FieldValues;
+
+typedef struct PageRows
+{
+    unsigned rowCount;
+    vector<unsigned char> used;
+    vector<unsigned char> moved;
+    unsigned overflowCapacity;
+    vector<uint32_t> overflowPages;
+    vector<FieldValues> fields;
+} PageRows;
+
+// A field's codes and how they are best kept
+typedef struct FieldCodes
+{
+    CompressedColumnHeader header;
+    vector<string> dictionary;
+    unsigned dictionaryBytes;
+    vector<uint32_t> codes;
+} FieldCodes;
+
+// What the fields of the records taken so far would encode to, kept up as each record comes
+// so a bulk load sees when the page is full without encoding it again
+typedef struct FieldStats
+{
+    bool nullable;
+    bool seen;                  // A non-null value
+    uint32_t last;              // Last non-null value, Int and Real
+    string lastString;
+    int64_t smallest;           // Int values
+    int64_t largest;            // Int values, Real bits
+    unsigned runs;              // Changes of value, counting the first
+    set<string> dictionary;
+    unsigned dictionaryBytes;
+} FieldStats;
+
+typedef struct PageEstimate
+{
+    unsigned rowCount;
+    unsigned overflowCapacity;
+    vector<FieldStats> fields;
+} PageEstimate;
+
+// A field block as it lies on a compressed page
+typedef struct EncodedField
+{
+    CompressedColumnHeader header;
+    const char *nulls;          // NULL when no row is null
+    const char *offsets;        // VarChar dictionary: dictionarySize + 1 uint16_t offsets into strings
+    const char *strings;
+    const char *codes;
+} EncodedField;
+
+static unsigned roundUp8(unsigned bytes)
+{
+    return (bytes + 7) / 8 * 8;
+}
+
+// Bits it takes to write every code up to maxCode
+static unsigned codeWidth(uint64_t maxCode)
+{
+    unsigned width = 0;
+    while (width < 32 && (maxCode >> width) != 0)
+        width++;
+    return width;
+}
+
+static unsigned overflowPageCount(unsigned rowCount, unsigned overflowCapacity)
+{
+    return (rowCount + overflowCapacity - 1) / overflowCapacity;
+}
+
+// The header, used and moved rows bitmaps and overflow page table, where the field blocks start
+static unsigned compressedBlocksOffset(unsigned rowCount, unsigned overflowPages)
+{
+    return sizeof(CompressedPageHeader) + 2 * paxBitmapBytes(rowCount) + roundUp8(overflowPages * sizeof(uint32_t));
+}
+
+// Bytes of a field block of rowCount rows, picking the smaller of packed codes and runs
+static unsigned fieldBlockBytes(AttrType type, unsigned rowCount, bool nullable, unsigned width, unsigned runs,
+                                unsigned dictionarySize, unsigned dictionaryBytes, uint8_t &encoding)
+{
+    unsigned bytes = sizeof(CompressedColumnHeader) + (nullable ? paxBitmapBytes(rowCount) : 0);
+    if (type == TypeVarChar)
+        bytes += roundUp8((dictionarySize + 1) * sizeof(uint16_t)) + roundUp8(dictionaryBytes);
+    unsigned packedBytes = ((uint64_t) rowCount * width + 63) / 64 * sizeof(uint64_t);
+    unsigned runBytes = runs * sizeof(CompressedRun);
+    encoding = runBytes < packedBytes ? RBFM_CODES_RUNS : RBFM_CODES_PACKED;
+    return bytes + min(packedBytes, runBytes);
+}
+
+// Decoded, every field of every row takes a PAX cell and every VarChar of the dictionaries its
+// bytes; PaxVarChar offsets must reach all of it
+static bool decodedPageFits(unsigned rowCount, unsigned fieldCount, unsigned stringBytes)
+{
+    return paxColumnOffset(rowCount, fieldCount) + stringBytes <= UINT16_MAX;
+}
+
+static uint32_t unpackCode(const char *codes, unsigned width, unsigned row)
+{
+    if (width == 0)
+        return 0;
+    uint64_t bit = (uint64_t) row * width;
+    uint64_t word;
+    memcpy(&word, codes + bit / 64 * sizeof(uint64_t), sizeof(uint64_t));
+    uint64_t code = word >> (bit % 64);
+    // The code runs on into the next word
+    if (bit % 64 + width > 64)
+    {
+        memcpy(&word, codes + (bit / 64 + 1) * sizeof(uint64_t), sizeof(uint64_t));
+        code |= word << (64 - bit % 64);
+    }
+    return code & (((uint64_t) 1 << width) - 1);
+}
+
+// codes must be zeroed beforehand
+static void packCode(char *codes, unsigned width, unsigned row, uint32_t code)
+{
+    if (width == 0)
+        return;
+    uint64_t bit = (uint64_t) row * width;
+    uint64_t word;
+    memcpy(&word, codes + bit / 64 * sizeof(uint64_t), sizeof(uint64_t));
+    word |= (uint64_t) code << (bit % 64);
+    memcpy(codes + bit / 64 * sizeof(uint64_t), &word, sizeof(uint64_t));
+    if (bit % 64 + width > 64)
+    {
+        memcpy(&word, codes + (bit / 64 + 1) * sizeof(uint64_t), sizeof(uint64_t));
+        word |= (uint64_t) code >> (64 - bit % 64);
+        memcpy(codes + (bit / 64 + 1) * sizeof(uint64_t), &word, sizeof(uint64_t));
+    }
+}
+
+static CompressedRun getRun(const EncodedField &field, unsigned i)
+{
+    CompressedRun run;
+    memcpy(&run, field.codes + i * sizeof(CompressedRun), sizeof(CompressedRun));
+    return run;
+}
+
+// The code of one row; runs are searched for the first that ends past it
+static uint32_t getCode(const EncodedField &field, unsigned row)
+{
+    if (field.header.encoding == RBFM_CODES_PACKED)
+        return unpackCode(field.codes, field.header.width, row);
+    unsigned low = 0, high = field.header.runs - 1;
+    while (low < high)
+    {
+        unsigned middle = (low + high) / 2;
+        if (getRun(field, middle).end > row)
+            high = middle;
+        else
+            low = middle + 1;
+    }
+    return getRun(field, low).code;
+}
+
+// The codes of rows 0..rowCount
+static void getCodes(const EncodedField &field, unsigned rowCount, uint32_t *codes)
+{
+    unsigned width = field.header.width;
+    if (field.header.encoding == RBFM_CODES_PACKED && width == 32)
+    {
+        // Little-endian words hold them as an array would
+        memcpy(codes, field.codes, rowCount * sizeof(uint32_t));
+        return;
+    }
+    if (field.header.encoding == RBFM_CODES_PACKED && width == 0)
+    {
+        memset(codes, 0, rowCount * sizeof(uint32_t));
+        return;
+    }
+    if (field.header.encoding == RBFM_CODES_PACKED)
+    {
+        // Take the codes off one word at a time
+        uint64_t mask = ((uint64_t) 1 << width) - 1;
+        uint64_t word;
+        memcpy(&word, field.codes, sizeof(uint64_t));
+        const char *next = field.codes + sizeof(uint64_t);
+        unsigned shift = 0;
+        for (unsigned row = 0; row < rowCount; row++)
+        {
+            uint64_t code = word >> shift;
+            shift += width;
+            if (shift >= 64)
+            {
+                shift -= 64;
+                if (shift > 0 || row + 1 < rowCount)
+                {
+                    memcpy(&word, next, sizeof(uint64_t));
+                    next += sizeof(uint64_t);
+                    if (shift > 0)
+                        code |= word << (width - shift);
+                }
+            }
+            codes[row] = code & mask;
+        }
+        return;
+    }
+    unsigned row = 0;
+    for (unsigned i = 0; i < field.header.runs; i++)
+    {
+        CompressedRun run = getRun(field, i);
+        for (; row < run.end; row++)
+            codes[row] = run.code;
+    }
+}
+
+static VarCharView getDictionaryEntry(const EncodedField &field, uint32_t code)
+{
+    uint16_t start, end;
+    memcpy(&start, field.offsets + code * sizeof(uint16_t), sizeof(uint16_t));
+    memcpy(&end, field.offsets + (code + 1) * sizeof(uint16_t), sizeof(uint16_t));
+    VarCharView entry = { field.strings + start, (uint32_t) (end - start) };
+    return entry;
+}
+
+static uint32_t getDictionaryBytes(const EncodedField &field)
+{
+    uint16_t end;
+    memcpy(&end, field.offsets + field.header.dictionarySize * sizeof(uint16_t), sizeof(uint16_t));
+    return end;
+}
+
+static const char *firstFieldBlock(const char *page)
+{
+    CompressedPageHeader header;
+    memcpy(&header, page, sizeof(CompressedPageHeader));
+    return page + compressedBlocksOffset(header.rowCount, header.overflowPages);
+}
+
+static EncodedField readFieldBlock(const char *block, unsigned rowCount)
+{
+    EncodedField field;
+    memcpy(&field.header, block, sizeof(CompressedColumnHeader));
+    const char *next = block + sizeof(CompressedColumnHeader);
+    field.nulls = NULL;
+    if (field.header.nullable)
+    {
+        field.nulls = next;
+        next += paxBitmapBytes(rowCount);
+    }
+    field.offsets = NULL;
+    field.strings = NULL;
+    if (field.header.type == TypeVarChar)
+    {
+        field.offsets = next;
+        next += roundUp8((field.header.dictionarySize + 1) * sizeof(uint16_t));
+        field.strings = next;
+        next += roundUp8(getDictionaryBytes(field));
+    }
+    field.codes = next;
+    return field;
+}
+
+// Field i of a compressed page, found by walking the blocks before it
+static EncodedField getEncodedField(const char *page, unsigned i)
+{
+    CompressedPageHeader header;
+    memcpy(&header, page, sizeof(CompressedPageHeader));
+    const char *block = firstFieldBlock(page);
+    for (; i > 0; i--)
+    {
+        CompressedColumnHeader column;
+        memcpy(&column, block, sizeof(CompressedColumnHeader));
+        block += column.bytes;
+    }
+    return readFieldBlock(block, header.rowCount);
+}
+
+static int compareVarChar(const VarCharView &a, const char *b, uint32_t bLength)
+{
+    int cmp = memcmp(a.data, b, min(a.length, bLength));
+    if (cmp != 0)
+        return cmp;
+    return a.length < bLength ? -1 : a.length > bLength;
+}
+
+static void setBits(uint64_t *bitmap, unsigned from, unsigned to)
+{
+    for (unsigned i = from; i < to; i++)
+        bitmap[i / 64] |= (uint64_t) 1 << (i % 64);
+}
+
+// Field i of a record in the API format, offset being where it starts; moves offset past it.
+// Returns whether the field is there, that is not null.
+static bool readField(const RecordLayout &layout, const char *data, unsigned i, unsigned &offset,
+                      uint32_t &value, const char *&bytes, uint32_t &length)
+{
+    if (data[i / CHAR_BIT] & (1 << (CHAR_BIT - 1 - i % CHAR_BIT)))
+        return false;
+    if (layout.getType(i) == TypeVarChar)
+    {
+        memcpy(&length, data + offset, VARCHAR_LENGTH_SIZE);
+        bytes = data + offset + VARCHAR_LENGTH_SIZE;
+        offset += VARCHAR_LENGTH_SIZE + length;
+        return true;
+    }
+    memcpy(&value, data + offset, INT_SIZE);
+    offset += INT_SIZE;
+    return true;
+}
+
+static void initRows(PageRows &rows, const RecordLayout &layout, unsigned overflowCapacity)
+{
+    rows.rowCount = 0;
+    rows.used.clear();
+    rows.moved.clear();
+    rows.overflowCapacity = overflowCapacity;
+    rows.overflowPages.clear();
+    rows.fields.resize(layout.getFieldCount());
+    for (unsigned i = 0; i < layout.getFieldCount(); i++)
+    {
+        rows.fields[i].type = layout.getType(i);
+        rows.fields[i].nulls.clear();
+        rows.fields[i].values.clear();
+        rows.fields[i].strings.clear();
+    }
+}
+
+// Appends a row no record uses, null in every field
+static void addRow(PageRows &rows)
+{
+    rows.rowCount++;
+    rows.used.push_back(0);
+    rows.moved.push_back(0);
+    rows.overflowPages.resize(overflowPageCount(rows.rowCount, rows.overflowCapacity), 0);
+    for (unsigned i = 0; i < rows.fields.size(); i++)
+    {
+        FieldValues &field = rows.fields[i];
+        field.nulls.push_back(1);
+        if (field.type == TypeVarChar)
+            field.strings.push_back(string());
+        else
+            field.values.push_back(0);
+    }
+}
+
+// Gives the rows no record uses the values of the row before them, or of the first used row
+// for those in front of it, so they add no runs, dictionary entries or null bitmaps
+static void fillUnusedRows(PageRows &rows)
+{
+    unsigned first = 0;
+    while (first < rows.rowCount && !rows.used[first])
+        first++;
+    for (unsigned row = 0; row < rows.rowCount && first < rows.rowCount; row++)
+    {
+        if (rows.used[row])
+            continue;
+        unsigned from = row < first ? first : row - 1;
+        for (unsigned i = 0; i < rows.fields.size(); i++)
+        {
+            FieldValues &field = rows.fields[i];
+            field.nulls[row] = field.nulls[from];
+            if (field.type == TypeVarChar)
+                field.strings[row] = field.strings[from];
+            else
+                field.values[row] = field.values[from];
+        }
+    }
+}
+
+// Puts a record in the API format in row, one past the last adding it
+static void setRow(PageRows &rows, unsigned row, const RecordLayout &layout, const void *data)
+{
+    if (row == rows.rowCount)
+        addRow(rows);
+    rows.used[row] = 1;
+    unsigned offset = layout.getNullIndicatorSize();
+    for (unsigned i = 0; i < rows.fields.size(); i++)
+    {
+        FieldValues &field = rows.fields[i];
+        uint32_t value = 0, length = 0;
+        const char *bytes = NULL;
+        field.nulls[row] = !readField(layout, (const char *) data, i, offset, value, bytes, length);
+        if (field.nulls[row])
+            continue;
+        if (field.type == TypeVarChar)
+            field.strings[row].assign(bytes, length);
+        else
+            field.values[row] = value;
+    }
+}
+
+// Can rows take records of layout: are they of the same fields, with overflow pages laid out
+// the same way?
+static bool rowsFit(const PageRows &rows, const RecordLayout &layout)
+{
+    if (rows.fields.size() != layout.getFieldCount() || rows.overflowCapacity != layout.getPaxCapacity())
+        return false;
+    for (unsigned i = 0; i < rows.fields.size(); i++)
+        if (rows.fields[i].type != layout.getType(i))
+            return false;
+    return true;
+}
+
+// Works out the codes of a field and how to keep them
+static void encodeField(const FieldValues &field, unsigned rowCount, FieldCodes &out)
+{
+    CompressedColumnHeader &header = out.header;
+    memset(&header, 0, sizeof(CompressedColumnHeader));
+    header.type = field.type;
+    out.codes.assign(rowCount, 0);
+    out.dictionary.clear();
+    out.dictionaryBytes = 0;
+
+    // The codes of the non-null values
+    if (field.type == TypeVarChar)
+    {
+        for (unsigned row = 0; row < rowCount; row++)
+            if (!field.nulls[row])
+                out.dictionary.push_back(field.strings[row]);
+        sort(out.dictionary.begin(), out.dictionary.end());
+        out.dictionary.erase(unique(out.dictionary.begin(), out.dictionary.end()), out.dictionary.end());
+        for (unsigned row = 0; row < rowCount; row++)
+            if (!field.nulls[row])
+                out.codes[row] = lower_bound(out.dictionary.begin(), out.dictionary.end(), field.strings[row]) - out.dictionary.begin();
+        for (unsigned i = 0; i < out.dictionary.size(); i++)
+            out.dictionaryBytes += out.dictionary[i].size();
+        header.dictionarySize = out.dictionary.size();
+    }
+    else if (field.type == TypeInt)
+    {
+        bool seen = false;
+        int32_t smallest = 0;
+        for (unsigned row = 0; row < rowCount; row++)
+            if (!field.nulls[row] && (!seen || (int32_t) field.values[row] < smallest))
+            {
+                smallest = field.values[row];
+                seen = true;
+            }
+        header.base = smallest;
+        for (unsigned row = 0; row < rowCount; row++)
+            if (!field.nulls[row])
+                out.codes[row] = (int64_t) (int32_t) field.values[row] - smallest;
+    }
+    else
+    {
+        for (unsigned row = 0; row < rowCount; row++)
+            if (!field.nulls[row])
+                out.codes[row] = field.values[row];
+    }
+
+    // Null rows take the code of the nearest non-null row before them, or after them
+    unsigned first = 0;
+    while (first < rowCount && field.nulls[first])
+        first++;
+    uint32_t code = first < rowCount ? out.codes[first] : 0;
+    uint32_t maxCode = 0;
+    unsigned runs = 0;
+    for (unsigned row = 0; row < rowCount; row++)
+    {
+        if (field.nulls[row])
+        {
+            out.codes[row] = code;
+            header.nullable = 1;
+        }
+        code = out.codes[row];
+        if (row == 0 || code != out.codes[row - 1])
+            runs++;
+        maxCode = max(maxCode, code);
+    }
+    header.width = codeWidth(maxCode);
+    header.runs = runs;
+    header.bytes = fieldBlockBytes(field.type, rowCount, header.nullable, header.width, runs, header.dictionarySize,
+                                   out.dictionaryBytes, header.encoding);
+}
+
+// Encodes rows onto page. Returns false, leaving page undefined, if they do not fit.
+static bool encodePage(const PageRows &rows, void *page)
+{
+    unsigned rowCount = rows.rowCount;
+    unsigned fieldCount = rows.fields.size();
+    vector<FieldCodes> fields(fieldCount);
+    unsigned bytes = compressedBlocksOffset(rowCount, rows.overflowPages.size());
+    unsigned stringBytes = 0;
+    for (unsigned i = 0; i < fieldCount; i++)
+    {
+        encodeField(rows.fields[i], rowCount, fields[i]);
+        bytes += fields[i].header.bytes;
+        stringBytes += fields[i].dictionaryBytes;
+    }
+    if (bytes > RBFM_PAGE_END || !decodedPageFits(rowCount, fieldCount, stringBytes))
+        return false;
+
+    char *out = (char *) page;
+    memset(out, 0, PAGE_SIZE);
+    CompressedPageHeader header;
+    header.kind = RBFM_PAX_COMPRESSED;
+    header.capacity = rowCount;
+    header.fieldCount = fieldCount;
+    header.rowCount = rowCount;
+    header.liveRows = count(rows.used.begin(), rows.used.end(), 1);
+    header.overflowCapacity = rows.overflowCapacity;
+    header.overflowPages = rows.overflowPages.size();
+    header.bytes = bytes;
+    memcpy(out, &header, sizeof(CompressedPageHeader));
+
+    char *used = out + sizeof(CompressedPageHeader);
+    char *moved = used + paxBitmapBytes(rowCount);
+    for (unsigned row = 0; row < rowCount; row++)
+    {
+        setPaxBit(used, row, rows.used[row]);
+        setPaxBit(moved, row, rows.moved[row]);
+    }
+    memcpy(moved + paxBitmapBytes(rowCount), rows.overflowPages.data(), rows.overflowPages.size() * sizeof(uint32_t));
+
+    char *block = out + compressedBlocksOffset(rowCount, rows.overflowPages.size());
+    for (unsigned i = 0; i < fieldCount; i++)
+    {
+        const FieldCodes &field = fields[i];
+        memcpy(block, &field.header, sizeof(CompressedColumnHeader));
+        char *next = block + sizeof(CompressedColumnHeader);
+        if (field.header.nullable)
+        {
+            for (unsigned row = 0; row < rowCount; row++)
+                setPaxBit(next, row, rows.fields[i].nulls[row]);
+            next += paxBitmapBytes(rowCount);
+        }
+        if (field.header.type == TypeVarChar)
+        {
+            char *strings = next + roundUp8((field.dictionary.size() + 1) * sizeof(uint16_t));
+            uint16_t offset = 0;
+            for (unsigned code = 0; code <= field.dictionary.size(); code++)
+            {
+                memcpy(next + code * sizeof(uint16_t), &offset, sizeof(uint16_t));
+                if (code == field.dictionary.size())
+                    break;
+                memcpy(strings + offset, field.dictionary[code].data(), field.dictionary[code].size());
+                offset += field.dictionary[code].size();
+            }
+            next = strings + roundUp8(field.dictionaryBytes);
+        }
+        if (field.header.encoding == RBFM_CODES_PACKED)
+        {
+            for (unsigned row = 0; row < rowCount; row++)
+                packCode(next, field.header.width, row, field.codes[row]);
+        }
+        else
+        {
+            unsigned run = 0;
+            for (unsigned row = 0; row < rowCount; row++)
+            {
+                if (row + 1 < rowCount && field.codes[row + 1] == field.codes[row])
+                    continue;
+                CompressedRun pair = { row + 1, field.codes[row] };
+                memcpy(next + run++ * sizeof(CompressedRun), &pair, sizeof(CompressedRun));
+            }
+        }
+        block += field.header.bytes;
+    }
+    return true;
+}
+
+// The records of a compressed page, field by field
+static void decodeRows(const void *page, PageRows &rows)
+{
+    const char *in = (const char *) page;
+    CompressedPageHeader header;
+    memcpy(&header, in, sizeof(CompressedPageHeader));
+    unsigned rowCount = header.rowCount;
+    rows.rowCount = rowCount;
+    rows.overflowCapacity = header.overflowCapacity;
+    const char *used = in + sizeof(CompressedPageHeader);
+    const char *moved = used + paxBitmapBytes(rowCount);
+    rows.used.resize(rowCount);
+    rows.moved.resize(rowCount);
+    for (unsigned row = 0; row < rowCount; row++)
+    {
+        rows.used[row] = paxBitIsSet(used, row);
+        rows.moved[row] = paxBitIsSet(moved, row);
+    }
+    rows.overflowPages.resize(header.overflowPages);
+    memcpy(rows.overflowPages.data(), moved + paxBitmapBytes(rowCount), header.overflowPages * sizeof(uint32_t));
+
+    rows.fields.resize(header.fieldCount);
+    vector<uint32_t> codes(rowCount);
+    const char *block = firstFieldBlock(in);
+    for (unsigned i = 0; i < header.fieldCount; i++)
+    {
+        EncodedField encoded = readFieldBlock(block, rowCount);
+        block += encoded.header.bytes;
+        FieldValues &field = rows.fields[i];
+        field.type = (AttrType) encoded.header.type;
+        field.nulls.resize(rowCount);
+        field.values.clear();
+        field.strings.clear();
+        getCodes(encoded, rowCount, codes.data());
+        for (unsigned row = 0; row < rowCount; row++)
+        {
+            field.nulls[row] = encoded.nulls != NULL && paxBitIsSet(encoded.nulls, row);
+            // A column null in every row has no dictionary to look codes up in
+            if (field.type == TypeVarChar)
+                field.strings.push_back(field.nulls[row] ? string() : getDictionaryEntry(encoded, codes[row]).str());
+            else
+                field.values.push_back(field.type == TypeInt ? encoded.header.base + codes[row] : codes[row]);
+        }
+    }
+}
+
+static void initEstimate(PageEstimate &estimate, const RecordLayout &layout)
+{
+    estimate.rowCount = 0;
+    estimate.overflowCapacity = layout.getPaxCapacity();
+    estimate.fields.resize(layout.getFieldCount());
+    for (unsigned i = 0; i < estimate.fields.size(); i++)
+    {
+        FieldStats &stats = estimate.fields[i];
+        stats.nullable = false;
+        stats.seen = false;
+        stats.last = 0;
+        stats.lastString.clear();
+        stats.smallest = 0;
+        stats.largest = 0;
+        stats.runs = 0;
+        stats.dictionary.clear();
+        stats.dictionaryBytes = 0;
+    }
+}
+
+// Bytes the page would take with one more record, data in the API format, and UINT_MAX if the
+// records would no longer decode; if add, the record is then counted in
+static unsigned estimatePageBytes(PageEstimate &estimate, const RecordLayout &layout, const char *data, bool add)
+{
+    unsigned rowCount = estimate.rowCount + 1;
+    unsigned bytes = compressedBlocksOffset(rowCount, overflowPageCount(rowCount, estimate.overflowCapacity));
+    unsigned stringBytes = 0;
+    unsigned offset = layout.getNullIndicatorSize();
+    for (unsigned i = 0; i < estimate.fields.size(); i++)
+    {
+        FieldStats &stats = estimate.fields[i];
+        AttrType type = layout.getType(i);
+        uint32_t value = 0, length = 0;
+        const char *string = NULL;
+        bool present = readField(layout, data, i, offset, value, string, length);
+
+        // What the stats become with the record, as encodeField would find them
+        bool nullable = stats.nullable || !present;
+        unsigned runs = stats.runs;
+        int64_t smallest = stats.smallest, largest = stats.largest;
+        unsigned dictionarySize = stats.dictionary.size(), dictionaryBytes = stats.dictionaryBytes;
+        bool newString = false;
+        if (present && type == TypeVarChar)
+        {
+            newString = stats.dictionary.count(std::string(string, length)) == 0;
+            dictionarySize += newString;
+            dictionaryBytes += newString ? length : 0;
+            runs += !stats.seen || stats.lastString.compare(0, std::string::npos, string, length) != 0;
+        }
+        else if (present)
+        {
+            int64_t number = type == TypeInt ? (int64_t) (int32_t) value : (int64_t) value;
+            smallest = stats.seen ? min(smallest, number) : number;
+            largest = stats.seen ? max(largest, number) : number;
+            runs += !stats.seen || value != stats.last;
+        }
+        bool seen = stats.seen || present;
+        unsigned width = 0;
+        if (type == TypeVarChar)
+            width = codeWidth(dictionarySize > 0 ? dictionarySize - 1 : 0);
+        else if (seen)
+            width = codeWidth(type == TypeInt ? largest - smallest : largest);
+        uint8_t encoding;
+        bytes += fieldBlockBytes(type, rowCount, nullable, width, max(runs, 1U), dictionarySize, dictionaryBytes, encoding);
+        stringBytes += dictionaryBytes;
+
+        if (!add)
+            continue;
+        stats.nullable = nullable;
+        stats.seen = seen;
+        stats.runs = runs;
+        stats.smallest = smallest;
+        stats.largest = largest;
+        stats.dictionaryBytes = dictionaryBytes;
+        if (present && type == TypeVarChar)
+        {
+            stats.lastString.assign(string, length);
+            if (newString)
+                stats.dictionary.insert(stats.lastString);
+        }
+        else if (present)
+            stats.last = value;
+    }
+    if (add)
+        estimate.rowCount = rowCount;
+    if (!decodedPageFits(rowCount, estimate.fields.size(), stringBytes))
+        return UINT_MAX;
+    return bytes;
+}
+
+bool RecordBasedFileManager::isCompressedFile(FileHandle &fileHandle)
+{
+    return (fileHandle.getFlags() & RBFM_COMPRESSED) != 0;
+}
+
+// Where the record of row has moved, if it has
+bool RecordBasedFileManager::getOverflowRid(const void *page, unsigned row, RID &rid)
+{
+    CompressedPageHeader header;
+    memcpy(&header, page, sizeof(CompressedPageHeader));
+    const char *moved = (const char *) page + sizeof(CompressedPageHeader) + paxBitmapBytes(header.rowCount);
+    if (!paxBitIsSet(moved, row))
+        return false;
+    memcpy(&rid.pageNum, moved + paxBitmapBytes(header.rowCount) + row / header.overflowCapacity * sizeof(uint32_t), sizeof(uint32_t));
+    rid.slotNum = row % header.overflowCapacity;
+    return true;
+}
+
+// Decodes the record of row into image as the only row of a PAX page. The page's layout fits
+// one record of any length its descriptor allows, so the record always fits.
+void RecordBasedFileManager::decodeCompressedRow(const void *page, unsigned row, void *image)
+{
+    CompressedPageHeader header;
+    memcpy(&header, page, sizeof(CompressedPageHeader));
+    char *out = (char *) image;
+    memset(out, 0, paxColumnOffset(1, header.fieldCount));
+    PaxPageHeader paxHeader;
+    paxHeader.kind = RBFM_PAX_ROWS;
+    paxHeader.capacity = 1;
+    paxHeader.fieldCount = header.fieldCount;
+    paxHeader.rowCount = 1;
+    paxHeader.liveRows = 1;
+    paxHeader.heapOffset = RBFM_PAGE_END;
+    paxHeader.heapBytes = 0;
+    paxHeader.homePage = 0;
+    setPaxBit(out + sizeof(PaxPageHeader), 0, true);
+
+    const char *block = firstFieldBlock((const char *) page);
+    for (unsigned i = 0; i < header.fieldCount; i++)
+    {
+        EncodedField field = readFieldBlock(block, header.rowCount);
+        block += field.header.bytes;
+        char *nulls = out + paxColumnOffset(1, i);
+        char *cell = nulls + paxBitmapBytes(1);
+        if (field.nulls != NULL && paxBitIsSet(field.nulls, row))
+        {
+            setPaxBit(nulls, 0, true);
+            continue;
+        }
+        uint32_t code = getCode(field, row);
+        if (field.header.type == TypeInt)
+            code += field.header.base;
+        if (field.header.type != TypeVarChar)
+        {
+            memcpy(cell, &code, RBFM_PAX_CELL_SIZE);
+            continue;
+        }
+        VarCharView entry = getDictionaryEntry(field, code);
+        paxHeader.heapOffset -= entry.length;
+        paxHeader.heapBytes += entry.length;
+        memcpy(out + paxHeader.heapOffset, entry.data, entry.length);
+        PaxVarChar value;
+        value.offset = paxHeader.heapOffset;
+        value.length = entry.length;
+        memcpy(cell, &value, sizeof(PaxVarChar));
+    }
+    setPaxPageHeader(out, paxHeader);
+}
+
+RC RecordBasedFileManager::insertCompressedRecords(FileHandle &fileHandle, const RecordLayout &layout, const void * const *rows, size_t n, vector<RID> &rids)
+{
+    if (layout.getPaxCapacity() == 0)
+        return RBFM_RECORD_TOO_LARGE;
+
+    void *pageData = allocPage();
+    if (pageData == NULL)
+        return RBFM_MALLOC_FAILED;
+
+    PageRows pageRows;
+    PageEstimate estimate;
+    RC rc = SUCCESS;
+    size_t row = 0;
+    while (row < n && rc == SUCCESS)
+    {
+        // Take records while the page still fits them encoded
+        initRows(pageRows, layout, layout.getPaxCapacity());
+        initEstimate(estimate, layout);
+        size_t first = row;
+        for (; row < n; row++)
+        {
+            if (getPaxVarCharSize(layout, rows[row]) == UINT_MAX)
+            {
+                rc = RBFM_RECORD_TOO_LARGE;
+                break;
+            }
+            if (estimatePageBytes(estimate, layout, (const char *) rows[row], false) > RBFM_PAGE_END)
+                break;
+            estimatePageBytes(estimate, layout, (const char *) rows[row], true);
+            setRow(pageRows, pageRows.rowCount, layout, rows[row]);
+        }
+        if (row == first)
+        {
+            // Not even one record fits a compressed page, the rest go to PAX pages
+            if (rc == SUCCESS)
+            {
+                vector<RID> paxRids(n - row);
+                rc = insertPaxRecords(fileHandle, layout, rows + row, n - row, paxRids);
+                copy(paxRids.begin(), paxRids.end(), rids.begin() + row);
+            }
+            break;
+        }
+        if (!encodePage(pageRows, pageData))
+        {
+            rc = RBFM_RECORD_TOO_LARGE;
+            break;
+        }
+
+        // The page goes wherever the next append lands, after any map page due there; keep the
+        // records it took even if the next one failed
+        RC pageRc = appendFreeSpaceMapPages(fileHandle);
+        PageNum pageNum = fileHandle.getNumberOfPages();
+        if (pageRc == SUCCESS)
+            pageRc = widenZoneMaps(fileHandle, layout, pageNum, rows + first, row - first);
+        if (pageRc)
+        {
+            rc = pageRc;
+            break;
+        }
+        if (fileHandle.appendPage(pageData))
+            pageRc = RBFM_APPEND_FAILED;
+        if (pageRc == SUCCESS)
+            pageRc = updateFreeSpaceMap(fileHandle, pageNum, pageData);
+        for (size_t i = first; i < row; i++)
+        {
+            rids[i].pageNum = pageNum;
+            rids[i].slotNum = i - first;
+        }
+        if (rc == SUCCESS)
+            rc = pageRc;
+    }
+
+    freePage(pageData);
+    return rc;
+}
+
+RC RecordBasedFileManager::readCompressedRecordView(FileHandle &fileHandle, void *pageData, const RID &rid, RecordView &view)
+{
+    RID overflow;
+    if (getOverflowRid(pageData, rid.slotNum, overflow))
+    {
+        fileHandle.unpinPage(rid.pageNum, false);
+        return readPaxRecordView(fileHandle, overflow, view);
+    }
+
+    // The view keeps the decoded record rather than the page
+    if (view.image == NULL)
+        view.image = borrowPage();
+    if (view.image == NULL)
+    {
+        fileHandle.unpinPage(rid.pageNum, false);
+        return RBFM_MALLOC_FAILED;
+    }
+    decodeCompressedRow(pageData, rid.slotNum, view.image);
+    view.attachPax((const char *) view.image, 0);
+    return fileHandle.unpinPage(rid.pageNum, false);
+}
+
+// The row stays encoded; only the bitmaps say it is free
+RC RecordBasedFileManager::deleteCompressedRecord(FileHandle &fileHandle, const RecordLayout &layout, void *pageData, const RID &rid)
+{
+    CompressedPageHeader header;
+    memcpy(&header, pageData, sizeof(CompressedPageHeader));
+    char *used = (char *) pageData + sizeof(CompressedPageHeader);
+    char *moved = used + paxBitmapBytes(header.rowCount);
+
+    RID overflow;
+    if (getOverflowRid(pageData, rid.slotNum, overflow))
+    {
+        RC rc = deletePaxRecord(fileHandle, layout, overflow);
+        if (rc)
+        {
+            fileHandle.unpinPage(rid.pageNum, false);
+            return rc;
+        }
+        setPaxBit(moved, rid.slotNum, false);
+    }
+    setPaxBit(used, rid.slotNum, false);
+    header.liveRows--;
+    memcpy(pageData, &header, sizeof(CompressedPageHeader));
+    return fileHandle.unpinPage(rid.pageNum, true);
+}
+
+RC RecordBasedFileManager::updateCompressedRecord(FileHandle &fileHandle, const RecordLayout &layout, const void *data, void *pageData, const RID &rid)
+{
+    // A record that has moved is updated in its overflow row, where it always fits
+    RID overflow;
+    if (getOverflowRid(pageData, rid.slotNum, overflow))
+    {
+        fileHandle.unpinPage(rid.pageNum, false);
+        return updatePaxRecord(fileHandle, layout, data, overflow);
+    }
+
+    PageRows rows;
+    decodeRows(pageData, rows);
+    if (!rowsFit(rows, layout))
+    {
+        fileHandle.unpinPage(rid.pageNum, false);
+        return RBFM_RECORD_TOO_LARGE;
+    }
+    RC rc = widenZoneMaps(fileHandle, layout, rid.pageNum, &data, 1);
+    if (rc)
+    {
+        fileHandle.unpinPage(rid.pageNum, false);
+        return rc;
+    }
+    setRow(rows, rid.slotNum, layout, data);
+    ScratchPage encoded;
+    if (encodePage(rows, encoded.data()))
+    {
+        memcpy(pageData, encoded.data(), RBFM_PAGE_END);
+        return fileHandle.unpinPage(rid.pageNum, true);
+    }
+
+    // Move the record to its row of the overflow page, laying the page out on first use
+    unsigned table = rid.slotNum / rows.overflowCapacity;
+    overflow.pageNum = rows.overflowPages[table];
+    overflow.slotNum = rid.slotNum % rows.overflowCapacity;
+    void *overflowData;
+    if (overflow.pageNum == 0)
+    {
+        if ((rc = appendRecordBasedPage(fileHandle, overflow.pageNum, overflowData)) == SUCCESS)
+        {
+            newPaxPage(overflowData, layout);
+            PaxPageHeader overflowHeader = getPaxPageHeader(overflowData);
+            overflowHeader.kind = RBFM_PAX_OVERFLOW;
+            overflowHeader.homePage = rid.pageNum;
+            setPaxPageHeader(overflowData, overflowHeader);
+        }
+    }
+    else if (fileHandle.fetchPage(overflow.pageNum, overflowData))
+        rc = RBFM_READ_FAILED;
+    if (rc)
+    {
+        fileHandle.unpinPage(rid.pageNum, false);
+        return rc;
+    }
+    if ((rc = widenZoneMaps(fileHandle, layout, overflow.pageNum, &data, 1)))
+    {
+        fileHandle.unpinPage(overflow.pageNum, false);
+        fileHandle.unpinPage(rid.pageNum, false);
+        return rc;
+    }
+
+    PaxPageHeader overflowHeader = getPaxPageHeader(overflowData);
+    setPaxBit((char *) overflowData + sizeof(PaxPageHeader), overflow.slotNum, true);
+    overflowHeader.rowCount = max(overflowHeader.rowCount, overflow.slotNum + 1);
+    overflowHeader.liveRows++;
+    setPaxPageHeader(overflowData, overflowHeader);
+    if (overflowHeader.heapOffset - paxColumnOffset(overflowHeader.capacity, overflowHeader.fieldCount) < getPaxVarCharSize(layout, data))
+        compactPaxHeap(overflowData, layout);
+    setPaxRecord(overflowData, overflow.slotNum, layout, data);
+    if (fileHandle.unpinPage(overflow.pageNum, true))
+    {
+        fileHandle.unpinPage(rid.pageNum, false);
+        return RBFM_WRITE_FAILED;
+    }
+
+    // The row keeps its old values, which nothing reads any more, so the encoding stays as it is
+    char *moved = (char *) pageData + sizeof(CompressedPageHeader) + paxBitmapBytes(rows.rowCount);
+    setPaxBit(moved, rid.slotNum, true);
+    memcpy(moved + paxBitmapBytes(rows.rowCount) + table * sizeof(uint32_t), &overflow.pageNum, sizeof(uint32_t));
+    return fileHandle.unpinPage(rid.pageNum, true);
+}
+
+// Gives back the page's empty overflow pages and the page itself once no record is left, or
+// drops its trailing unused rows and re-encodes it with the rows of deleted records null
+RC RecordBasedFileManager::vacuumCompressedPage(FileHandle &fileHandle, PageNum pageNum, void *pageData, VacuumStats &stats, bool &changed)
+{
+    PageRows rows;
+    decodeRows(pageData, rows);
+    bool encode = false;
+    for (unsigned i = 0; i < rows.overflowPages.size(); i++)
+    {
+        if (rows.overflowPages[i] == 0)
+            continue;
+        void *overflowData;
+        if (fileHandle.fetchPage(rows.overflowPages[i], overflowData))
+            return RBFM_READ_FAILED;
+        if (getPaxPageHeader(overflowData).liveRows != 0)
+        {
+            fileHandle.unpinPage(rows.overflowPages[i], false);
+            continue;
+        }
+        memset(overflowData, 0, PAGE_SIZE);
+        RC rc = updateFreeSpaceMap(fileHandle, rows.overflowPages[i], overflowData);
+        RC unpinRc = fileHandle.unpinPage(rows.overflowPages[i], true);
+        if (rc || unpinRc)
+            return rc ? rc : unpinRc;
+        stats.pagesReclaimed++;
+        rows.overflowPages[i] = 0;
+        encode = true;
+    }
+
+    CompressedPageHeader header;
+    memcpy(&header, pageData, sizeof(CompressedPageHeader));
+    if (header.liveRows == 0)
+    {
+        memset(pageData, 0, PAGE_SIZE);
+        stats.pagesReclaimed++;
+        stats.pagesCompacted++;
+        changed = true;
+        return SUCCESS;
+    }
+
+    // Overflow pages of the dropped rows were empty, and so given back above
+    unsigned rowCount = rows.rowCount;
+    while (rowCount > 0 && !rows.used[rowCount - 1])
+        rowCount--;
+    if (rowCount != rows.rowCount)
+    {
+        rows.rowCount = rowCount;
+        rows.used.resize(rowCount);
+        rows.moved.resize(rowCount);
+        rows.overflowPages.resize(overflowPageCount(rowCount, rows.overflowCapacity));
+        for (unsigned i = 0; i < rows.fields.size(); i++)
+        {
+            rows.fields[i].nulls.resize(rowCount);
+            if (rows.fields[i].type == TypeVarChar)
+                rows.fields[i].strings.resize(rowCount);
+            else
+                rows.fields[i].values.resize(rowCount);
+        }
+        encode = true;
+    }
+    fillUnusedRows(rows);
+
+    // Keep the new encoding only if it saves room or drops overflow pages
+    ScratchPage encoded;
+    if (!encodePage(rows, encoded.data()))
+        return SUCCESS;
+    CompressedPageHeader encodedHeader;
+    memcpy(&encodedHeader, encoded.data(), sizeof(CompressedPageHeader));
+    if (!encode && encodedHeader.bytes >= header.bytes)
+        return SUCCESS;
+    memcpy(pageData, encoded.data(), RBFM_PAGE_END);
+    stats.pagesCompacted++;
+    changed = true;
+    return SUCCESS;
+}
+
+// Encodes a PAX page laid out for layout in place, each record keeping its row. Returns false,
+// leaving the page as it was, if the page does not get smaller.
+bool RecordBasedFileManager::compressPaxPage(void *page, const RecordLayout &layout)
+{
+    PaxPageHeader header = getPaxPageHeader(page);
+    if (header.kind != RBFM_PAX_ROWS || header.capacity == 0 || !paxPageFits(page, layout))
+        return false;
+
+    PageRows rows;
+    initRows(rows, layout, layout.getPaxCapacity());
+    const char *used = (const char *) page + sizeof(PaxPageHeader);
+    RecordView view;
+    view.attachPax((const char *) page, 0);
+    for (unsigned row = 0; row < header.rowCount; row++)
+    {
+        addRow(rows);
+        if (!paxBitIsSet(used, row))
+            continue;
+        rows.used[row] = 1;
+        view.row = row;
+        for (unsigned i = 0; i < rows.fields.size(); i++)
+        {
+            FieldValues &field = rows.fields[i];
+            field.nulls[row] = view.isNull(i);
+            if (field.nulls[row])
+                continue;
+            uint32_t length;
+            const char *bytes = view.fieldData(i, field.type == TypeVarChar, length);
+            if (field.type == TypeVarChar)
+                field.strings[row].assign(bytes, length);
+            else
+                memcpy(&field.values[row], bytes, INT_SIZE);
+        }
+    }
+
+    fillUnusedRows(rows);
+    ScratchPage encoded;
+    if (!encodePage(rows, encoded.data()))
+        return false;
+    memcpy(page, encoded.data(), RBFM_PAGE_END);
+    return true;
+}
+
+// Scans /////////////////////////////////////////////////////////////////////////////////////
+
+// Evaluate a lone condition on the codes of the page, then decode the fields the scan reads
+// unless no row matched
+void RBFM_ScanIterator::startCompressedPage()
+{
+    encodedPage = pageData;
+    totalSlot = rbfm->getPaxPageHeader(pageData).rowCount;
+    pageFiltered = codesFiltered;
+    allFieldsDecoded = false;
+    if (pageFiltered)
+    {
+        filterCompressedPage();
+        bool matched = false;
+        for (unsigned w = 0; w < selection.size() && !matched; w++)
+            matched = selection[w] != 0;
+        if (!matched)
+            return;
+    }
+    decodePage(false);
+}
+
+// The codes of Ints and VarChars order as their values do, so a comparison with a value turns
+// into one with a code: the value less the base for Ints, its place in the dictionary for
+// VarChars. Ints too wide for the shifted value to stay an int32_t, and Reals, are compared as
+// values. Each run is compared once.
+void RBFM_ScanIterator::filterCompressedPage()
+{
+    const ScanCondition &condition = *rootCondition;
+    const char *page = (const char *) encodedPage;
+    CompressedPageHeader header;
+    memcpy(&header, page, sizeof(CompressedPageHeader));
+    unsigned words = (totalSlot + 63) / 64;
+    selection.assign(words, 0);
+    // Pages written before the attribute was added hold it for no record
+    if (condition.attrIndex >= header.fieldCount)
+        return;
+    EncodedField field = getEncodedField(page, condition.attrIndex);
+
+    CompOp compOp = condition.compOp;
+    int32_t target = 0;
+    bool onCodes = condition.type == TypeVarChar || (condition.type == TypeInt && field.header.width <= 30);
+    if (condition.type == TypeInt && onCodes)
+    {
+        // Codes lie in [0, 2^width), so a value outside it may stand at either end
+        int64_t shifted = (int64_t) condition.intValue - field.header.base;
+        target = max((int64_t) -1, min(shifted, (int64_t) 1 << field.header.width));
+    }
+    else if (condition.type == TypeVarChar)
+    {
+        // Where the value is or would go in the sorted dictionary
+        unsigned low = 0, high = field.header.dictionarySize;
+        while (low < high)
+        {
+            unsigned middle = (low + high) / 2;
+            if (compareVarChar(getDictionaryEntry(field, middle), condition.stringValue, condition.stringLength) < 0)
+                low = middle + 1;
+            else
+                high = middle;
+        }
+        bool found = low < field.header.dictionarySize
+                     && compareVarChar(getDictionaryEntry(field, low), condition.stringValue, condition.stringLength) == 0;
+        switch (condition.compOp)
+        {
+            case EQ_OP: target = found ? low : -1; break;
+            case NE_OP: target = found ? low : -1; break;
+            case LT_OP: target = low; break;
+            case LE_OP: compOp = LT_OP; target = low + found; break;
+            case GT_OP: compOp = GE_OP; target = low + found; break;
+            case GE_OP: target = low; break;
+            default: break;
+        }
+    }
+
+    if (field.header.encoding == RBFM_CODES_RUNS)
+    {
+        unsigned start = 0;
+        for (unsigned i = 0; i < field.header.runs; i++)
+        {
+            CompressedRun run = getRun(field, i);
+            bool passed;
+            if (onCodes)
+                passed = checkScanCondition((int32_t) run.code, compOp, target);
+            else if (condition.type == TypeInt)
+                passed = checkScanCondition((int32_t) (field.header.base + run.code), compOp, condition.intValue);
+            else
+            {
+                float value;
+                memcpy(&value, &run.code, REAL_SIZE);
+                passed = checkScanCondition(value, compOp, condition.realValue);
+            }
+            if (passed)
+                setBits(selection.data(), start, run.end);
+            start = run.end;
+        }
+    }
+    else
+    {
+        intColumn.resize(totalSlot);
+        int32_t *codes = intColumn.data();
+        getCodes(field, totalSlot, (uint32_t *) codes);
+        if (onCodes)
+            selectInt(codes, totalSlot, compOp, target, selection.data());
+        else if (condition.type == TypeInt)
+        {
+            for (unsigned row = 0; row < totalSlot; row++)
+                codes[row] += field.header.base;
+            selectInt(codes, totalSlot, compOp, condition.intValue, selection.data());
+        }
+        else
+            selectReal((const float *) codes, totalSlot, compOp, condition.realValue, selection.data());
+    }
+
+    // Keep the used rows still on the page where the attribute is not null
+    const char *used = page + sizeof(CompressedPageHeader);
+    const char *moved = used + paxBitmapBytes(totalSlot);
+    for (unsigned w = 0; w < words; w++)
+    {
+        uint64_t usedRows, movedRows, nullRows = 0;
+        memcpy(&usedRows, used + w * sizeof(uint64_t), sizeof(uint64_t));
+        memcpy(&movedRows, moved + w * sizeof(uint64_t), sizeof(uint64_t));
+        if (field.nulls != NULL)
+            memcpy(&nullRows, field.nulls + w * sizeof(uint64_t), sizeof(uint64_t));
+        selection[w] &= usedRows & ~movedRows & ~nullRows;
+    }
+}
+
+// Decode the current compressed page into decodedPage as a PAX page holding all its rows, each
+// VarChar field's dictionary copied to the heap once for its cells to point at. Fields the scan
+// does not read are left null unless allFields.
+void RBFM_ScanIterator::decodePage(bool allFields)
+{
+    const char *page = (const char *) encodedPage;
+    CompressedPageHeader header;
+    memcpy(&header, page, sizeof(CompressedPageHeader));
+    unsigned rowCount = header.rowCount;
+    unsigned heapOffset = paxColumnOffset(rowCount, header.fieldCount);
+
+    // Size the page for the dictionaries it needs
+    unsigned bytes = heapOffset;
+    const char *block = firstFieldBlock(page);
+    for (unsigned i = 0; i < header.fieldCount; i++)
+    {
+        EncodedField field = readFieldBlock(block, rowCount);
+        block += field.header.bytes;
+        if (field.header.type == TypeVarChar && (allFields || (i < decodedFields.size() && decodedFields[i])))
+            bytes += getDictionaryBytes(field);
+    }
+    if (decodedPage.size() < bytes)
+        decodedPage.resize(bytes);
+    char *out = decodedPage.data();
+
+    PaxPageHeader paxHeader;
+    paxHeader.kind = RBFM_PAX_ROWS;
+    paxHeader.capacity = rowCount;
+    paxHeader.fieldCount = header.fieldCount;
+    paxHeader.rowCount = rowCount;
+    paxHeader.liveRows = header.liveRows;
+    paxHeader.heapOffset = heapOffset;
+    paxHeader.heapBytes = bytes - heapOffset;
+    paxHeader.homePage = 0;
+    rbfm->setPaxPageHeader(out, paxHeader);
+
+    // Moved records are read from their overflow rows
+    unsigned bitmapBytes = paxBitmapBytes(rowCount);
+    const char *used = page + sizeof(CompressedPageHeader);
+    for (unsigned w = 0; w < bitmapBytes / sizeof(uint64_t); w++)
+    {
+        uint64_t usedRows, movedRows;
+        memcpy(&usedRows, used + w * sizeof(uint64_t), sizeof(uint64_t));
+        memcpy(&movedRows, used + bitmapBytes + w * sizeof(uint64_t), sizeof(uint64_t));
+        usedRows &= ~movedRows;
+        memcpy(out + sizeof(PaxPageHeader) + w * sizeof(uint64_t), &usedRows, sizeof(uint64_t));
+    }
+
+    unsigned heap = heapOffset;
+    block = firstFieldBlock(page);
+    for (unsigned i = 0; i < header.fieldCount; i++)
+    {
+        EncodedField field = readFieldBlock(block, rowCount);
+        block += field.header.bytes;
+        char *nulls = out + paxColumnOffset(rowCount, i);
+        uint32_t *cells = (uint32_t *) (nulls + bitmapBytes);
+        if (!allFields && (i >= decodedFields.size() || !decodedFields[i]))
+        {
+            memset(nulls, 0xFF, bitmapBytes);
+            continue;
+        }
+        if (field.nulls != NULL)
+            memcpy(nulls, field.nulls, bitmapBytes);
+        else
+            memset(nulls, 0, bitmapBytes);
+
+        getCodes(field, rowCount, cells);
+        if (field.header.type == TypeInt)
+        {
+            for (unsigned row = 0; row < rowCount; row++)
+                cells[row] += field.header.base;
+        }
+        else if (field.header.type == TypeVarChar)
+        {
+            // The cell of each code, then of each row
+            uint32_t dictionaryBytes = getDictionaryBytes(field);
+            memcpy(out + heap, field.strings, dictionaryBytes);
+            dictionaryCells.resize(field.header.dictionarySize);
+            PaxVarChar *entries = dictionaryCells.data();
+            for (unsigned code = 0; code < field.header.dictionarySize; code++)
+            {
+                uint16_t offset[2];
+                memcpy(offset, field.offsets + code * sizeof(uint16_t), sizeof(offset));
+                entries[code].offset = heap + offset[0];
+                entries[code].length = offset[1] - offset[0];
+            }
+            // Null rows get an empty cell; all of them may be null, leaving no entries
+            PaxVarChar empty;
+            empty.offset = heap;
+            empty.length = 0;
+            PaxVarChar *values = (PaxVarChar *) cells;
+            for (unsigned row = 0; row < rowCount; row++)
+                values[row] = paxBitIsSet(nulls, row) ? empty : entries[cells[row]];
+            heap += dictionaryBytes;
+        }
+    }
+
+    pageData = out;
+    allFieldsDecoded = allFields;
+}
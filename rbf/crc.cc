@@ -0,0 +1,142 @@
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#elif defined(__aarch64__)
+#include <arm_acle.h>
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+
+#include "crc.h"
+
+// Reflected CRC32C polynomial
+#define CRC32C_POLY 0x82F63B78
+
+typedef uint32_t (*CrcFunction)(uint32_t crc, const unsigned char *data, size_t length);
+
+// table[k][b]: CRC of byte b followed by k zero bytes
+static uint32_t table[8][256];
+
+static void buildTable()
+{
+    for (unsigned b = 0; b < 256; b++)
+    {
+        uint32_t crc = b;
+        for (unsigned bit = 0; bit < 8; bit++)
+            crc = (crc >> 1) ^ (crc & 1 ? CRC32C_POLY : 0);
+        table[0][b] = crc;
+    }
+    for (unsigned b = 0; b < 256; b++)
+        for (unsigned k = 1; k < 8; k++)
+            table[k][b] = (table[k - 1][b] >> 8) ^ table[0][table[k - 1][b] & 0xFF];
+}
+
+// Slicing-by-8: eight table lookups per 8 bytes instead of eight dependent shifts per byte
+static uint32_t crcSlicing8(uint32_t crc, const unsigned char *data, size_t length)
+{
+    while (length > 0 && ((uintptr_t) data & 7) != 0)
+    {
+        crc = (crc >> 8) ^ table[0][(crc ^ *data++) & 0xFF];
+        length--;
+    }
+    while (length >= 8)
+    {
+        uint32_t low, high;
+        memcpy(&low, data, 4);
+        memcpy(&high, data + 4, 4);
+        low ^= crc;
+        crc = table[7][low & 0xFF] ^ table[6][(low >> 8) & 0xFF] ^
+              table[5][(low >> 16) & 0xFF] ^ table[4][low >> 24] ^
+              table[3][high & 0xFF] ^ table[2][(high >> 8) & 0xFF] ^
+              table[1][(high >> 16) & 0xFF] ^ table[0][high >> 24];
+        data += 8;
+        length -= 8;
+    }
+    while (length-- > 0)
+        crc = (crc >> 8) ^ table[0][(crc ^ *data++) & 0xFF];
+    return crc;
+}
+
+#if defined(__x86_64__)
+__attribute__((target("sse4.2")))
+static uint32_t crcHardware(uint32_t crc, const unsigned char *data, size_t length)
+{
+    uint64_t crc64 = crc;
+    while (length > 0 && ((uintptr_t) data & 7) != 0)
+    {
+        crc64 = _mm_crc32_u8((uint32_t) crc64, *data++);
+        length--;
+    }
+    while (length >= 8)
+    {
+        uint64_t word;
+        memcpy(&word, data, 8);
+        crc64 = _mm_crc32_u64(crc64, word);
+        data += 8;
+        length -= 8;
+    }
+    while (length-- > 0)
+        crc64 = _mm_crc32_u8((uint32_t) crc64, *data++);
+    return (uint32_t) crc64;
+}
+
+static bool hasHardwareCrc()
+{
+    return __builtin_cpu_supports("sse4.2");
+}
+#elif defined(__aarch64__)
+__attribute__((target("+crc")))
+static uint32_t crcHardware(uint32_t crc, const unsigned char *data, size_t length)
+{
+    while (length > 0 && ((uintptr_t) data & 7) != 0)
+    {
+        crc = __crc32cb(crc, *data++);
+        length--;
+    }
+    while (length >= 8)
+    {
+        uint64_t word;
+        memcpy(&word, data, 8);
+        crc = __crc32cd(crc, word);
+        data += 8;
+        length -= 8;
+    }
+    while (length-- > 0)
+        crc = __crc32cb(crc, *data++);
+    return crc;
+}
+
+static bool hasHardwareCrc()
+{
+    return (getauxval(AT_HWCAP) & HWCAP_CRC32) != 0;
+}
+#endif
+
+// Pick the implementation once, when the library is loaded
+static CrcFunction chooseCrc()
+{
+    buildTable();
+#if defined(__x86_64__) || defined(__aarch64__)
+    if (hasHardwareCrc())
+        return crcHardware;
+#endif
+    return crcSlicing8;
+}
+
+static CrcFunction crcFunction = chooseCrc();
+
+uint32_t crc32c(const void *data, size_t length)
+{
+    return ~crcFunction(~0U, (const unsigned char *) data, length);
+}
+
+uint32_t crc32cSoftware(const void *data, size_t length)
+{
+    return ~crcSlicing8(~0U, (const unsigned char *) data, length);
+}
+
+bool crc32cHardware()
+{
+    return crcFunction != crcSlicing8;
+}
@@ -0,0 +1,18 @@
+#ifndef _crc_h_
+#define _crc_h_
+
+#include <cstddef>
+#include <stdint.h>
+
+// CRC32C (Castagnoli), the checksum in the trailer of every page of a checksummed file.
+// Uses the SSE4.2 or ARMv8 CRC instructions when the CPU has them and a slicing-by-8
+// table otherwise; all variants give the same result.
+uint32_t crc32c(const void *data, size_t length);
+
+// The table based variant, whatever the CPU supports
+uint32_t crc32cSoftware(const void *data, size_t length);
+
+// Does crc32c use CRC instructions?
+bool crc32cHardware();
+
+#endif
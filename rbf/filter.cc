@@ -0,0 +1,197 @@
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#include "filter.h"
+
+typedef void (*IntKernel)(const int32_t *column, unsigned n, CompOp compOp, int32_t value, uint64_t *selection);
+typedef void (*RealKernel)(const float *column, unsigned n, CompOp compOp, float value, uint64_t *selection);
+
+template <typename T>
+static inline bool compare(T a, CompOp compOp, T b)
+{
+    switch (compOp)
+    {
+        case EQ_OP: return a == b;
+        case LT_OP: return a < b;
+        case LE_OP: return a <= b;
+        case GT_OP: return a > b;
+        case GE_OP: return a >= b;
+        case NE_OP: return a != b;
+        default: return true;
+    }
+}
+
+// Values from first on, one at a time; the vector kernels use it for their tails
+template <typename T>
+static void selectTail(const T *column, unsigned first, unsigned n, CompOp compOp, T value, uint64_t *selection)
+{
+    for (unsigned i = first; i < n; i++)
+        selection[i / 64] |= (uint64_t) compare(column[i], compOp, value) << (i % 64);
+}
+
+static void clearSelection(unsigned n, uint64_t *selection)
+{
+    memset(selection, 0, (n + 63) / 64 * sizeof(uint64_t));
+}
+
+void selectIntScalar(const int32_t *column, unsigned n, CompOp compOp, int32_t value, uint64_t *selection)
+{
+    clearSelection(n, selection);
+    selectTail(column, 0, n, compOp, value, selection);
+}
+
+void selectRealScalar(const float *column, unsigned n, CompOp compOp, float value, uint64_t *selection)
+{
+    clearSelection(n, selection);
+    selectTail(column, 0, n, compOp, value, selection);
+}
+
+#if defined(__x86_64__)
+// Integer vectors only compare for == and >; LE, GE and NE are the complements of GT, LT and EQ
+static inline bool complemented(CompOp compOp)
+{
+    return compOp == LE_OP || compOp == GE_OP || compOp == NE_OP;
+}
+
+// SSE2 is part of x86-64, so these need no check
+static void selectIntSse2(const int32_t *column, unsigned n, CompOp compOp, int32_t value, uint64_t *selection)
+{
+    clearSelection(n, selection);
+    __m128i constant = _mm_set1_epi32(value);
+    unsigned flip = complemented(compOp) ? 0xF : 0;
+    unsigned i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        __m128i values = _mm_loadu_si128((const __m128i *) (column + i));
+        __m128i result;
+        switch (compOp)
+        {
+            case EQ_OP: case NE_OP: result = _mm_cmpeq_epi32(values, constant); break;
+            case GT_OP: case LE_OP: result = _mm_cmpgt_epi32(values, constant); break;
+            case LT_OP: case GE_OP: result = _mm_cmplt_epi32(values, constant); break;
+            default:                result = _mm_set1_epi32(-1); break;
+        }
+        unsigned bits = _mm_movemask_ps(_mm_castsi128_ps(result)) ^ flip;
+        selection[i / 64] |= (uint64_t) bits << (i % 64);
+    }
+    selectTail(column, i, n, compOp, value, selection);
+}
+
+static void selectRealSse2(const float *column, unsigned n, CompOp compOp, float value, uint64_t *selection)
+{
+    clearSelection(n, selection);
+    __m128 constant = _mm_set1_ps(value);
+    unsigned i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        __m128 values = _mm_loadu_ps(column + i);
+        __m128 result;
+        switch (compOp)
+        {
+            case EQ_OP: result = _mm_cmpeq_ps(values, constant); break;
+            case LT_OP: result = _mm_cmplt_ps(values, constant); break;
+            case LE_OP: result = _mm_cmple_ps(values, constant); break;
+            case GT_OP: result = _mm_cmpgt_ps(values, constant); break;
+            case GE_OP: result = _mm_cmpge_ps(values, constant); break;
+            case NE_OP: result = _mm_cmpneq_ps(values, constant); break;
+            default:    result = _mm_castsi128_ps(_mm_set1_epi32(-1)); break;
+        }
+        unsigned bits = _mm_movemask_ps(result);
+        selection[i / 64] |= (uint64_t) bits << (i % 64);
+    }
+    selectTail(column, i, n, compOp, value, selection);
+}
+
+__attribute__((target("avx2")))
+static void selectIntAvx2(const int32_t *column, unsigned n, CompOp compOp, int32_t value, uint64_t *selection)
+{
+    clearSelection(n, selection);
+    __m256i constant = _mm256_set1_epi32(value);
+    unsigned flip = complemented(compOp) ? 0xFF : 0;
+    unsigned i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        __m256i values = _mm256_loadu_si256((const __m256i *) (column + i));
+        __m256i result;
+        switch (compOp)
+        {
+            case EQ_OP: case NE_OP: result = _mm256_cmpeq_epi32(values, constant); break;
+            case GT_OP: case LE_OP: result = _mm256_cmpgt_epi32(values, constant); break;
+            case LT_OP: case GE_OP: result = _mm256_cmpgt_epi32(constant, values); break;
+            default:                result = _mm256_set1_epi32(-1); break;
+        }
+        unsigned bits = _mm256_movemask_ps(_mm256_castsi256_ps(result)) ^ flip;
+        selection[i / 64] |= (uint64_t) bits << (i % 64);
+    }
+    selectTail(column, i, n, compOp, value, selection);
+}
+
+// Ordered comparisons are false for a NaN, the unordered != is true, as in C++
+__attribute__((target("avx2")))
+static void selectRealAvx2(const float *column, unsigned n, CompOp compOp, float value, uint64_t *selection)
+{
+    clearSelection(n, selection);
+    __m256 constant = _mm256_set1_ps(value);
+    unsigned i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        __m256 values = _mm256_loadu_ps(column + i);
+        __m256 result;
+        switch (compOp)
+        {
+            case EQ_OP: result = _mm256_cmp_ps(values, constant, _CMP_EQ_OQ); break;
+            case LT_OP: result = _mm256_cmp_ps(values, constant, _CMP_LT_OQ); break;
+            case LE_OP: result = _mm256_cmp_ps(values, constant, _CMP_LE_OQ); break;
+            case GT_OP: result = _mm256_cmp_ps(values, constant, _CMP_GT_OQ); break;
+            case GE_OP: result = _mm256_cmp_ps(values, constant, _CMP_GE_OQ); break;
+            case NE_OP: result = _mm256_cmp_ps(values, constant, _CMP_NEQ_UQ); break;
+            default:    result = _mm256_castsi256_ps(_mm256_set1_epi32(-1)); break;
+        }
+        unsigned bits = _mm256_movemask_ps(result);
+        selection[i / 64] |= (uint64_t) bits << (i % 64);
+    }
+    selectTail(column, i, n, compOp, value, selection);
+}
+#endif
+
+// Pick the kernels once, when the library is loaded
+static const char *chooseKernels(IntKernel &intKernel, RealKernel &realKernel)
+{
+#if defined(__x86_64__)
+    if (__builtin_cpu_supports("avx2"))
+    {
+        intKernel = selectIntAvx2;
+        realKernel = selectRealAvx2;
+        return "avx2";
+    }
+    intKernel = selectIntSse2;
+    realKernel = selectRealSse2;
+    return "sse2";
+#else
+    intKernel = selectIntScalar;
+    realKernel = selectRealScalar;
+    return "scalar";
+#endif
+}
+
+static IntKernel intKernel;
+static RealKernel realKernel;
+static const char *kernelName = chooseKernels(intKernel, realKernel);
+
+void selectInt(const int32_t *column, unsigned n, CompOp compOp, int32_t value, uint64_t *selection)
+{
+    intKernel(column, n, compOp, value, selection);
+}
+
+void selectReal(const float *column, unsigned n, CompOp compOp, float value, uint64_t *selection)
+{
+    realKernel(column, n, compOp, value, selection);
+}
+
+const char *selectKernel()
+{
+    return kernelName;
+}
@@ -0,0 +1,24 @@
+#ifndef _filter_h_
+#define _filter_h_
+
+#include <stdint.h>
+
+#include "rbfm.h"
+
+// Predicate kernels for scans, evaluated a page worth of values at a time.
+// Each compares column[0..n) against value and sets bit i of selection (bit i % 64 of word
+// i / 64) for every column[i] compOp value that holds; NO_OP selects every value. selection
+// must hold (n + 63) / 64 words, and bits past n are left clear. Comparisons follow C++:
+// a NaN satisfies only NE_OP. Uses AVX2 when the CPU has it, SSE2 on other x86-64 CPUs and
+// plain loops elsewhere; all variants give the same result.
+void selectInt(const int32_t *column, unsigned n, CompOp compOp, int32_t value, uint64_t *selection);
+void selectReal(const float *column, unsigned n, CompOp compOp, float value, uint64_t *selection);
+
+// The plain variants, whatever the CPU supports
+void selectIntScalar(const int32_t *column, unsigned n, CompOp compOp, int32_t value, uint64_t *selection);
+void selectRealScalar(const float *column, unsigned n, CompOp compOp, float value, uint64_t *selection);
+
+// Instructions selectInt and selectReal use: "avx2", "sse2" or "scalar"
+const char *selectKernel();
+
+#endif
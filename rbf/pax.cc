@@ -0,0 +1,572 @@
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+
+#include "rbfm.h"
+
+// PAX pages, see rbfm.h for their layout. RecordView and the scan iterator read them in place;
+// the record operations of RecordBasedFileManager hand PAX files over to the methods here.
+
+unsigned paxBitmapBytes(unsigned capacity)
+{
+    return (capacity + 63) / 64 * sizeof(uint64_t);
+}
+
+// A null bitmap and its cells, padded to whole words
+unsigned paxColumnBytes(unsigned capacity)
+{
+    return paxBitmapBytes(capacity) + (capacity * RBFM_PAX_CELL_SIZE + 7) / 8 * 8;
+}
+
+// Past the header and the used rows bitmap
+unsigned paxColumnOffset(unsigned capacity, unsigned i)
+{
+    return sizeof(PaxPageHeader) + paxBitmapBytes(capacity) + i * paxColumnBytes(capacity);
+}
+
+bool paxBitIsSet(const char *bitmap, unsigned i)
+{
+    uint64_t word;
+    memcpy(&word, bitmap + i / 64 * sizeof(uint64_t), sizeof(uint64_t));
+    return (word >> (i % 64)) & 1;
+}
+
+void setPaxBit(char *bitmap, unsigned i, bool value)
+{
+    uint64_t word;
+    memcpy(&word, bitmap + i / 64 * sizeof(uint64_t), sizeof(uint64_t));
+    if (value)
+        word |= (uint64_t) 1 << (i % 64);
+    else
+        word &= ~((uint64_t) 1 << (i % 64));
+    memcpy(bitmap + i / 64 * sizeof(uint64_t), &word, sizeof(uint64_t));
+}
+
+bool RecordBasedFileManager::isPaxFile(FileHandle &fileHandle)
+{
+    return (fileHandle.getFlags() & (RBFM_PAX | RBFM_COMPRESSED)) != 0;
+}
+
+PaxPageHeader RecordBasedFileManager::getPaxPageHeader(const void *page)
+{
+    PaxPageHeader header;
+    memcpy(&header, page, sizeof(PaxPageHeader));
+    return header;
+}
+
+void RecordBasedFileManager::setPaxPageHeader(void *page, const PaxPageHeader &header)
+{
+    memcpy(page, &header, sizeof(PaxPageHeader));
+}
+
+// Lays page out for records of layout, with no rows used yet
+void RecordBasedFileManager::newPaxPage(void *page, const RecordLayout &layout)
+{
+    memset(page, 0, PAGE_SIZE);
+    PaxPageHeader header;
+    header.kind = RBFM_PAX_ROWS;
+    header.capacity = layout.getPaxCapacity();
+    header.fieldCount = layout.getFieldCount();
+    header.rowCount = 0;
+    header.liveRows = 0;
+    header.heapOffset = RBFM_PAGE_END;
+    header.heapBytes = 0;
+    header.homePage = 0;
+    setPaxPageHeader(page, header);
+}
+
+// Can page take records of layout: has it never held a record, or is it laid out the same way?
+bool RecordBasedFileManager::paxPageFits(const void *page, const RecordLayout &layout)
+{
+    PaxPageHeader header = getPaxPageHeader(page);
+    return header.capacity == 0 || (header.capacity == layout.getPaxCapacity() && header.fieldCount == layout.getFieldCount());
+}
+
+// The free rows of a page, each counting RBFM_FSM_BUCKET_BYTES; a page never laid out is empty.
+// Overflow and compressed pages take no new records.
+unsigned RecordBasedFileManager::getPaxFreeSpaceSize(void *page)
+{
+    PaxPageHeader header = getPaxPageHeader(page);
+    if (header.kind != RBFM_PAX_ROWS)
+        return 0;
+    if (header.capacity == 0)
+        return RBFM_PAGE_END;
+    return (header.capacity - header.liveRows) * RBFM_FSM_BUCKET_BYTES;
+}
+
+// Heap bytes the VarChars of a record in the API format take, UINT_MAX if one of them is
+// longer than its attribute's declared length
+unsigned RecordBasedFileManager::getPaxVarCharSize(const RecordLayout &layout, const void *data)
+{
+    char *nullIndicator = (char *) data;
+    unsigned offset = layout.getNullIndicatorSize();
+    unsigned size = 0;
+    for (unsigned i = 0; i < layout.getFieldCount(); i++)
+    {
+        if (fieldIsNull(nullIndicator, i))
+            continue;
+        if (layout.getType(i) != TypeVarChar)
+        {
+            offset += INT_SIZE;
+            continue;
+        }
+        uint32_t length;
+        memcpy(&length, (char *) data + offset, VARCHAR_LENGTH_SIZE);
+        if (length > layout.getDescriptor()[i].length)
+            return UINT_MAX;
+        size += length;
+        offset += VARCHAR_LENGTH_SIZE + length;
+    }
+    return size;
+}
+
+// Marks the first free row of a page with room for one used and returns it
+unsigned RecordBasedFileManager::takePaxRow(void *page)
+{
+    PaxPageHeader header = getPaxPageHeader(page);
+    char *used = (char *) page + sizeof(PaxPageHeader);
+    unsigned row = header.rowCount;
+    // Rows freed by deletes come first
+    if (header.liveRows < header.rowCount)
+    {
+        for (unsigned w = 0; w * 64 < header.rowCount; w++)
+        {
+            uint64_t word;
+            memcpy(&word, used + w * sizeof(uint64_t), sizeof(uint64_t));
+            if (~word != 0)
+            {
+                row = w * 64 + __builtin_ctzll(~word);
+                break;
+            }
+        }
+    }
+    setPaxBit(used, row, true);
+    header.rowCount = max(header.rowCount, row + 1);
+    header.liveRows++;
+    setPaxPageHeader(page, header);
+    return row;
+}
+
+// Writes a record in the API format to row of a page laid out for layout. The heap must have
+// contiguous room for its VarChars.
+void RecordBasedFileManager::setPaxRecord(void *page, unsigned row, const RecordLayout &layout, const void *data)
+{
+    PaxPageHeader header = getPaxPageHeader(page);
+    char *nullIndicator = (char *) data;
+    unsigned offset = layout.getNullIndicatorSize();
+    for (unsigned i = 0; i < header.fieldCount; i++)
+    {
+        char *nulls = (char *) page + paxColumnOffset(header.capacity, i);
+        char *cell = nulls + paxBitmapBytes(header.capacity) + row * RBFM_PAX_CELL_SIZE;
+        bool isNull = fieldIsNull(nullIndicator, i);
+        setPaxBit(nulls, row, isNull);
+        memset(cell, 0, RBFM_PAX_CELL_SIZE);
+        if (isNull)
+            continue;
+
+        char *field = (char *) data + offset;
+        if (layout.getType(i) != TypeVarChar)
+        {
+            memcpy(cell, field, INT_SIZE);
+            offset += INT_SIZE;
+            continue;
+        }
+        uint32_t length;
+        memcpy(&length, field, VARCHAR_LENGTH_SIZE);
+        header.heapOffset -= length;
+        header.heapBytes += length;
+        memcpy((char *) page + header.heapOffset, field + VARCHAR_LENGTH_SIZE, length);
+        PaxVarChar value;
+        value.offset = header.heapOffset;
+        value.length = length;
+        memcpy(cell, &value, sizeof(PaxVarChar));
+        offset += VARCHAR_LENGTH_SIZE + length;
+    }
+    setPaxPageHeader(page, header);
+}
+
+// Gives the heap bytes of the record in row back, leaving its VarChars null. The bytes stay
+// holes until the heap is compacted.
+void RecordBasedFileManager::releasePaxRecord(void *page, unsigned row, const RecordLayout &layout)
+{
+    PaxPageHeader header = getPaxPageHeader(page);
+    unsigned fields = min(header.fieldCount, layout.getFieldCount());
+    for (unsigned i = 0; i < fields; i++)
+    {
+        if (layout.getType(i) != TypeVarChar)
+            continue;
+        char *nulls = (char *) page + paxColumnOffset(header.capacity, i);
+        char *cell = nulls + paxBitmapBytes(header.capacity) + row * RBFM_PAX_CELL_SIZE;
+        if (!paxBitIsSet(nulls, row))
+        {
+            PaxVarChar value;
+            memcpy(&value, cell, sizeof(PaxVarChar));
+            header.heapBytes -= value.length;
+        }
+        setPaxBit(nulls, row, true);
+        memset(cell, 0, RBFM_PAX_CELL_SIZE);
+    }
+    setPaxPageHeader(page, header);
+}
+
+// Packs the VarChars of the used rows back against the end of the page, a column at a time,
+// closing the heap's holes. Works from a copy of the heap, as reorganizePage does.
+void RecordBasedFileManager::compactPaxHeap(void *page, const RecordLayout &layout)
+{
+    PaxPageHeader header = getPaxPageHeader(page);
+    ScratchPage scratch;
+    char *heap = (char *) scratch.data();
+    memcpy(heap + header.heapOffset, (char *) page + header.heapOffset, RBFM_PAGE_END - header.heapOffset);
+
+    const char *used = (char *) page + sizeof(PaxPageHeader);
+    uint32_t heapOffset = RBFM_PAGE_END;
+    unsigned fields = min(header.fieldCount, layout.getFieldCount());
+    for (unsigned i = 0; i < fields; i++)
+    {
+        if (layout.getType(i) != TypeVarChar)
+            continue;
+        char *nulls = (char *) page + paxColumnOffset(header.capacity, i);
+        char *cells = nulls + paxBitmapBytes(header.capacity);
+        for (unsigned row = 0; row < header.rowCount; row++)
+        {
+            if (!paxBitIsSet(used, row) || paxBitIsSet(nulls, row))
+                continue;
+            PaxVarChar value;
+            memcpy(&value, cells + row * RBFM_PAX_CELL_SIZE, sizeof(PaxVarChar));
+            heapOffset -= value.length;
+            memcpy((char *) page + heapOffset, heap + value.offset, value.length);
+            value.offset = heapOffset;
+            memcpy(cells + row * RBFM_PAX_CELL_SIZE, &value, sizeof(PaxVarChar));
+        }
+    }
+    header.heapOffset = heapOffset;
+    header.heapBytes = RBFM_PAGE_END - heapOffset;
+    setPaxPageHeader(page, header);
+}
+
+// Pins the page of rid if its row holds a record
+RC RecordBasedFileManager::fetchPaxRow(FileHandle &fileHandle, const RID &rid, void *&pageData)
+{
+    if (fileHandle.fetchPage(rid.pageNum, pageData))
+        return RBFM_READ_FAILED;
+    PaxPageHeader header = getPaxPageHeader(pageData);
+    if (rid.slotNum >= header.rowCount)
+    {
+        fileHandle.unpinPage(rid.pageNum, false);
+        return RBFM_SLOT_DN_EXIST;
+    }
+    if (!paxBitIsSet((char *) pageData + sizeof(PaxPageHeader), rid.slotNum))
+    {
+        fileHandle.unpinPage(rid.pageNum, false);
+        return RBFM_READ_AFTER_DEL;
+    }
+    return SUCCESS;
+}
+
+RC RecordBasedFileManager::insertPaxRecord(FileHandle &fileHandle, const RecordLayout &layout, const void *data, RID &rid)
+{
+    unsigned varCharSize = getPaxVarCharSize(layout, data);
+    if (layout.getPaxCapacity() == 0 || varCharSize == UINT_MAX)
+        return RBFM_RECORD_TOO_LARGE;
+
+    // Any free row will do
+    void *pageData;
+    PageNum pageNum;
+    RC rc;
+    while (true)
+    {
+        if ((rc = findFreePage(fileHandle, RBFM_FSM_BUCKET_BYTES, pageNum, pageData)))
+            return rc;
+        if (paxPageFits(pageData, layout))
+            break;
+        // The rows of a page laid out for another descriptor are not for these records
+        rc = setFreeSpaceBucket(fileHandle, pageNum, 0);
+        fileHandle.unpinPage(pageNum, false);
+        if (rc)
+            return rc;
+    }
+    if ((rc = widenZoneMaps(fileHandle, layout, pageNum, &data, 1)))
+    {
+        fileHandle.unpinPage(pageNum, false);
+        return rc;
+    }
+    if (getPaxPageHeader(pageData).capacity == 0)
+        newPaxPage(pageData, layout);
+
+    // The heap always has room for a full page of records, but may have to close its holes first
+    PaxPageHeader header = getPaxPageHeader(pageData);
+    if (header.heapOffset - paxColumnOffset(header.capacity, header.fieldCount) < varCharSize)
+        compactPaxHeap(pageData, layout);
+
+    rid.pageNum = pageNum;
+    rid.slotNum = takePaxRow(pageData);
+    setPaxRecord(pageData, rid.slotNum, layout, data);
+
+    rc = updateFreeSpaceMap(fileHandle, pageNum, pageData);
+    if (fileHandle.unpinPage(pageNum, true))
+        return RBFM_WRITE_FAILED;
+    return rc;
+}
+
+RC RecordBasedFileManager::insertPaxRecords(FileHandle &fileHandle, const RecordLayout &layout, const void * const *rows, size_t n, vector<RID> &rids)
+{
+    if (layout.getPaxCapacity() == 0)
+        return RBFM_RECORD_TOO_LARGE;
+
+    void *pageData = allocPage();
+    if (pageData == NULL)
+        return RBFM_MALLOC_FAILED;
+
+    RC rc = SUCCESS;
+    size_t row = 0;
+    while (row < n && rc == SUCCESS)
+    {
+        // The page goes wherever the next append lands, after any map page due there
+        if ((rc = appendFreeSpaceMapPages(fileHandle)))
+            break;
+        PageNum pageNum = fileHandle.getNumberOfPages();
+        newPaxPage(pageData, layout);
+
+        // Fill every row of the page; the heap has room for all of them
+        for (; row < n && getPaxPageHeader(pageData).liveRows < layout.getPaxCapacity(); row++)
+        {
+            if (getPaxVarCharSize(layout, rows[row]) == UINT_MAX)
+            {
+                rc = RBFM_RECORD_TOO_LARGE;
+                break;
+            }
+            rids[row].pageNum = pageNum;
+            rids[row].slotNum = takePaxRow(pageData);
+            setPaxRecord(pageData, rids[row].slotNum, layout, rows[row]);
+        }
+        unsigned liveRows = getPaxPageHeader(pageData).liveRows;
+        if (liveRows == 0)
+            break;
+
+        // Write the page out in one go, keeping the records it took even if the next one failed
+        RC pageRc = widenZoneMaps(fileHandle, layout, pageNum, rows + row - liveRows, liveRows);
+        if (pageRc)
+        {
+            rc = pageRc;
+            break;
+        }
+        if (fileHandle.appendPage(pageData))
+            pageRc = RBFM_APPEND_FAILED;
+        else
+            pageRc = updateFreeSpaceMap(fileHandle, pageNum, pageData);
+        if (rc == SUCCESS)
+            rc = pageRc;
+    }
+
+    freePage(pageData);
+    return rc;
+}
+
+RC RecordBasedFileManager::readPaxRecord(FileHandle &fileHandle, const RecordLayout &layout, const RID &rid, void *data)
+{
+    RecordView view;
+    RC rc = readPaxRecordView(fileHandle, rid, view);
+    if (rc)
+        return rc;
+
+    // Fields the page was laid out without read as null
+    char *out = (char *) data;
+    unsigned nullIndicatorSize = layout.getNullIndicatorSize();
+    memset(out, 0, nullIndicatorSize);
+    unsigned offset = nullIndicatorSize;
+    for (unsigned i = 0; i < layout.getFieldCount(); i++)
+    {
+        if (view.isNull(i))
+        {
+            out[i / CHAR_BIT] |= 1 << (CHAR_BIT - 1 - (i % CHAR_BIT));
+            continue;
+        }
+        bool varChar = layout.getType(i) == TypeVarChar;
+        uint32_t length;
+        const char *field = view.fieldData(i, varChar, length);
+        if (varChar)
+        {
+            memcpy(out + offset, &length, VARCHAR_LENGTH_SIZE);
+            offset += VARCHAR_LENGTH_SIZE;
+        }
+        memcpy(out + offset, field, length);
+        offset += length;
+    }
+    return view.release();
+}
+
+RC RecordBasedFileManager::readPaxRecordView(FileHandle &fileHandle, const RID &rid, RecordView &view)
+{
+    void *pageData;
+    RC rc = fetchPaxRow(fileHandle, rid, pageData);
+    if (rc)
+        return rc;
+    if (getPaxPageHeader(pageData).kind == RBFM_PAX_COMPRESSED)
+        return readCompressedRecordView(fileHandle, pageData, rid, view);
+
+    // The view keeps the page pinned
+    view.attachPax((const char *) pageData, rid.slotNum);
+    view.fileHandle = &fileHandle;
+    view.pageNum = rid.pageNum;
+    return SUCCESS;
+}
+
+RC RecordBasedFileManager::deletePaxRecord(FileHandle &fileHandle, const RecordLayout &layout, const RID &rid)
+{
+    void *pageData;
+    RC rc = fetchPaxRow(fileHandle, rid, pageData);
+    // Cannot delete a deleted record
+    if (rc)
+        return rc == RBFM_READ_AFTER_DEL ? RBFM_SLOT_DN_EXIST : rc;
+    if (getPaxPageHeader(pageData).kind == RBFM_PAX_COMPRESSED)
+        return deleteCompressedRecord(fileHandle, layout, pageData, rid);
+
+    releasePaxRecord(pageData, rid.slotNum, layout);
+    setPaxBit((char *) pageData + sizeof(PaxPageHeader), rid.slotNum, false);
+    PaxPageHeader header = getPaxPageHeader(pageData);
+    header.liveRows--;
+    setPaxPageHeader(pageData, header);
+
+    // Record the freed row and hand the changes back to the buffer pool
+    rc = updateFreeSpaceMap(fileHandle, rid.pageNum, pageData);
+    RC unpinRc = fileHandle.unpinPage(rid.pageNum, true);
+    return rc ? rc : unpinRc;
+}
+
+// The record keeps its row, so its RID, and the page's free space does not change. Compressed
+// pages keep the RID too, see rbfm.h.
+RC RecordBasedFileManager::updatePaxRecord(FileHandle &fileHandle, const RecordLayout &layout, const void *data, const RID &rid)
+{
+    unsigned varCharSize = getPaxVarCharSize(layout, data);
+    if (varCharSize == UINT_MAX)
+        return RBFM_RECORD_TOO_LARGE;
+
+    void *pageData;
+    RC rc = fetchPaxRow(fileHandle, rid, pageData);
+    if (rc)
+        return rc;
+    if (getPaxPageHeader(pageData).kind == RBFM_PAX_COMPRESSED)
+        return updateCompressedRecord(fileHandle, layout, data, pageData, rid);
+    // Only the descriptor the page was laid out for is sure to fit the row
+    if (!paxPageFits(pageData, layout))
+    {
+        fileHandle.unpinPage(rid.pageNum, false);
+        return RBFM_RECORD_TOO_LARGE;
+    }
+    if ((rc = widenZoneMaps(fileHandle, layout, rid.pageNum, &data, 1)))
+    {
+        fileHandle.unpinPage(rid.pageNum, false);
+        return rc;
+    }
+
+    releasePaxRecord(pageData, rid.slotNum, layout);
+    PaxPageHeader header = getPaxPageHeader(pageData);
+    if (header.heapOffset - paxColumnOffset(header.capacity, header.fieldCount) < varCharSize)
+        compactPaxHeap(pageData, layout);
+    setPaxRecord(pageData, rid.slotNum, layout, data);
+    return fileHandle.unpinPage(rid.pageNum, true);
+}
+
+RC RecordBasedFileManager::readPaxAttribute(FileHandle &fileHandle, const RecordLayout &layout, const RID &rid, const string &attributeName, void *data)
+{
+    unsigned index = layout.getIndex(attributeName);
+    if (index == layout.getFieldCount())
+        return RBFM_NO_SUCH_ATTR;
+
+    RecordView view;
+    RC rc = readPaxRecordView(fileHandle, rid, view);
+    if (rc)
+        return rc;
+
+    // A one field null indicator, then the value
+    char *out = (char *) data;
+    out[0] = 0;
+    if (view.isNull(index))
+        out[0] |= 1 << (CHAR_BIT - 1);
+    else
+    {
+        bool varChar = layout.getType(index) == TypeVarChar;
+        uint32_t length;
+        const char *field = view.fieldData(index, varChar, length);
+        unsigned offset = 1;
+        if (varChar)
+        {
+            memcpy(out + offset, &length, VARCHAR_LENGTH_SIZE);
+            offset += VARCHAR_LENGTH_SIZE;
+        }
+        memcpy(out + offset, field, length);
+    }
+    return view.release();
+}
+
+// Records never move on PAX pages, so there is nothing to bring home; pages only give back
+// their unused trailing rows and heap holes, or go back to never having been laid out.
+// Compressed pages are left to vacuumCompressedPage.
+RC RecordBasedFileManager::vacuumPax(FileHandle &fileHandle, const RecordLayout &layout, VacuumStats &stats)
+{
+    PageNum numPages = fileHandle.getNumberOfPages();
+    for (PageNum pageNum = 0; pageNum < numPages; pageNum++)
+    {
+        if (isFreeSpaceMapPage(pageNum))
+            continue;
+        void *pageData;
+        if (fileHandle.fetchPage(pageNum, pageData))
+            return RBFM_READ_FAILED;
+
+        PaxPageHeader header = getPaxPageHeader(pageData);
+        bool changed = false;
+        if (header.kind == RBFM_PAX_COMPRESSED)
+        {
+            RC rc = vacuumCompressedPage(fileHandle, pageNum, pageData, stats, changed);
+            if (rc)
+            {
+                fileHandle.unpinPage(pageNum, changed);
+                return rc;
+            }
+        }
+        // Overflow pages go with their compressed page
+        else if (header.kind == RBFM_PAX_OVERFLOW)
+            ;
+        else if (header.capacity != 0 && header.liveRows == 0)
+        {
+            memset(pageData, 0, PAGE_SIZE);
+            stats.pagesReclaimed++;
+            stats.pagesCompacted++;
+            changed = true;
+        }
+        else if (header.capacity != 0)
+        {
+            const char *used = (char *) pageData + sizeof(PaxPageHeader);
+            unsigned rows = header.rowCount;
+            while (rows > 0 && !paxBitIsSet(used, rows - 1))
+                rows--;
+            bool fragmented = header.heapBytes != RBFM_PAGE_END - header.heapOffset && paxPageFits(pageData, layout);
+            if (rows != header.rowCount || fragmented)
+            {
+                header.rowCount = rows;
+                setPaxPageHeader(pageData, header);
+                if (fragmented)
+                    compactPaxHeap(pageData, layout);
+                stats.pagesCompacted++;
+                changed = true;
+            }
+            // A page whose rows have all been taken is as full as it gets
+            if (isCompressedFile(fileHandle) && rows == header.capacity && compressPaxPage(pageData, layout))
+            {
+                stats.pagesCompressed++;
+                changed = true;
+            }
+        }
+        if (!changed)
+        {
+            fileHandle.unpinPage(pageNum, false);
+            continue;
+        }
+        RC rc = updateFreeSpaceMap(fileHandle, pageNum, pageData);
+        RC unpinRc = fileHandle.unpinPage(pageNum, true);
+        if (rc || unpinRc)
+            return rc ? rc : unpinRc;
+    }
+    return SUCCESS;
+}
@@ -1,13 +1,120 @@
 #include <cstdio>
 #include <string>
 
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 
 #include "pfm.h"
+#include "bpm.h"
+#include "arm.h"
+#include "crc.h"
 
 PagedFileManager* PagedFileManager::_pf_manager = NULL;
 
+void *allocPage()
+{
+    void *page;
+    if (posix_memalign(&page, PFM_PAGE_ALIGNMENT, PAGE_SIZE) != 0)
+        return NULL;
+    // Never let stale heap contents reach the disk through the unused part of a page
+    memset(page, 0, PAGE_SIZE);
+    return page;
+}
+
+void freePage(void *page)
+{
+    free(page);
+}
+
+// The pages a thread has given back, freed when the thread exits
+struct ScratchPool
+{
+    void *pages[PFM_SCRATCH_PAGES];
+    unsigned count;
+
+    ScratchPool() : count(0) {}
+    ~ScratchPool()
+    {
+        while (count > 0)
+            freePage(pages[--count]);
+    }
+};
+
+static thread_local ScratchPool scratchPool;
+
+void *borrowPage()
+{
+    if (scratchPool.count > 0)
+        return scratchPool.pages[--scratchPool.count];
+    return allocPage();
+}
+
+void returnPage(void *page)
+{
+    if (page == NULL)
+        return;
+    if (scratchPool.count < PFM_SCRATCH_PAGES)
+        scratchPool.pages[scratchPool.count++] = page;
+    else
+        freePage(page);
+}
+
+// Direct I/O can't use a caller's buffer that isn't aligned, those go through a page of our own
+static bool needsBounce(PagedFile *file, const void *data)
+{
+    return file->direct && (uintptr_t) data % PFM_PAGE_ALIGNMENT != 0;
+}
+
+// The checksum covers everything in front of the trailer
+static uint32_t pageChecksum(const void *page)
+{
+    return crc32c(page, PAGE_SIZE - PFM_CHECKSUM_SIZE);
+}
+
+static bool verifyChecksum(const void *page)
+{
+    uint32_t stored;
+    memcpy(&stored, (const char *) page + PAGE_SIZE - PFM_CHECKSUM_SIZE, PFM_CHECKSUM_SIZE);
+    return stored == pageChecksum(page);
+}
+
+// An asynchronous read of a checksummed file, verified before the caller hears of it
+typedef struct ChecksumRead
+{
+    void *data;
+    ReadCallback callback;
+    void *context;
+} ChecksumRead;
+
+static void checksumReadDone(void *context, RC rc)
+{
+    ChecksumRead *read = (ChecksumRead *) context;
+    if (rc == SUCCESS && !verifyChecksum(read->data))
+        rc = FH_CHECKSUM_FAILED;
+    read->callback(read->context, rc);
+    delete read;
+}
+
+// Guards the layer state of every file
+static mutex layerStateLatch;
+
+// Monotonic clock in milliseconds, for GROUP durability
+static unsigned long long currentMillis()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
 PagedFileManager* PagedFileManager::instance()
 {
     if(!_pf_manager)
@@ -19,6 +126,8 @@ PagedFileManager* PagedFileManager::instance()
 
 PagedFileManager::PagedFileManager()
 {
+    _extentPages = PFM_DEFAULT_EXTENT_PAGES;
+    _groupCommitterStarted = false;
 }
 
 
@@ -27,25 +136,78 @@ PagedFileManager::~PagedFileManager()
 }
 
 
-RC PagedFileManager::createFile(const string &fileName)
+RC PagedFileManager::createFile(const string &fileName, unsigned flags)
 {
+    lock_guard<mutex> guard(_latch);
+
     // If the file already exists, error
     if (fileExists(fileName))
         return PFM_FILE_EXISTS;
 
     // Attempt to open the file for writing
-    FILE *pFile = fopen(fileName.c_str(), "wb");
+    int fd = open(fileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
     // Return an error if we fail
-    if (pFile == NULL)
+    if (fd < 0)
         return PFM_OPEN_FAILED;
 
-    fclose (pFile);
+    // A file removed behind our back may have left cached pages under a reused inode
+    struct stat sb;
+    if (fstat(fd, &sb) == 0)
+    {
+        auto it = _files.find(make_pair(sb.st_dev, sb.st_ino));
+        if (it != _files.end() && it->second->openCount == 0)
+            forgetFile(it->second);
+    }
+
+    // Write the header page of an empty file
+    void *headerPage = allocPage();
+    if (headerPage == NULL)
+    {
+        close(fd);
+        remove(fileName.c_str());
+        return PFM_OPEN_FAILED;
+    }
+    FileHeader *header = (FileHeader *) headerPage;
+    header->magic = PFM_MAGIC;
+    header->version = PFM_VERSION;
+    header->pageCount = 0;
+    header->pageSize = PAGE_SIZE;
+    header->flags = flags;
+    header->exact = 1;
+    ssize_t written = pwrite(fd, headerPage, PAGE_SIZE, 0);
+    freePage(headerPage);
+
+    if (close(fd) != 0 || written != PAGE_SIZE)
+    {
+        remove(fileName.c_str());
+        return PFM_OPEN_FAILED;
+    }
     return SUCCESS;
 }
 
 
 RC PagedFileManager::destroyFile(const string &fileName)
 {
+    lock_guard<mutex> guard(_latch);
+
+    // Cached pages of the file are no longer valid
+    struct stat sb;
+    if (stat(fileName.c_str(), &sb) == 0)
+    {
+        auto it = _files.find(make_pair(sb.st_dev, sb.st_ino));
+        if (it != _files.end())
+        {
+            PagedFile *file = it->second;
+            BufferPoolManager::instance()->discardFile(file);
+            _files.erase(it);
+            // Still open elsewhere: the last closeFile frees it
+            if (file->openCount > 0)
+                file->unlinked = true;
+            else
+                delete file;
+        }
+    }
+
     // If file cannot be successfully removed, error
     if (remove(fileName.c_str()) != 0)
         return PFM_REMOVE_FAILED;
@@ -54,24 +216,83 @@ RC PagedFileManager::destroyFile(const string &fileName)
 }
 
 
-RC PagedFileManager::openFile(const string &fileName, FileHandle &fileHandle)
+RC PagedFileManager::openFile(const string &fileName, FileHandle &fileHandle, OpenMode openMode)
 {
+    lock_guard<mutex> guard(_latch);
+
     // If this handle already has an open file, error
-    if (fileHandle.getfd() != NULL)
+    if (fileHandle.getFile() != NULL)
         return PFM_HANDLE_IN_USE;
 
     // If the file doesn't exist, error
-    if (!fileExists(fileName.c_str()))
+    struct stat sb;
+    if (stat(fileName.c_str(), &sb) != 0)
         return PFM_FILE_DN_EXIST;
 
-    // Open the file for reading/writing in binary mode
-    FILE *pFile;
-    pFile = fopen(fileName.c_str(), "rb+");
+    // If the file is already open, share its state
+    PagedFile *file = NULL;
+    auto it = _files.find(make_pair(sb.st_dev, sb.st_ino));
+    if (it != _files.end())
+    {
+        file = it->second;
+        if (file->openCount > 0)
+        {
+            file->openCount++;
+            fileHandle.setFile(file);
+            return SUCCESS;
+        }
+    }
+
+    // Open the file for reading/writing
+    int fd = -1;
+    bool direct = false;
+    if (openMode == OPEN_DIRECT)
+    {
+        fd = open(fileName.c_str(), O_RDWR | O_DIRECT);
+        direct = (fd >= 0);
+    }
+    if (fd < 0)
+        fd = open(fileName.c_str(), O_RDWR);
     // If we fail, error
-    if (pFile == NULL)
+    if (fd < 0)
         return PFM_OPEN_FAILED;
 
-    fileHandle.setfd(pFile);
+    // Reuse the entry of a closed file whose pages are still cached
+    bool newEntry = (file == NULL);
+    if (newEntry)
+    {
+        file = new PagedFile;
+        file->dev = sb.st_dev;
+        file->ino = sb.st_ino;
+        file->unlinked = false;
+    }
+    file->fd = fd;
+    file->direct = direct;
+
+    // Pick up the logical end of file from the header page
+    if (FileHandle::readHeader(file))
+    {
+        close(fd);
+        file->fd = -1;
+        if (newEntry)
+            delete file;
+        return PFM_BAD_HEADER;
+    }
+    if (newEntry)
+        _files[make_pair(sb.st_dev, sb.st_ino)] = file;
+
+    file->openCount = 1;
+    file->extentPages = _extentPages;
+    file->readAheadPages = PFM_DEFAULT_READ_AHEAD;
+    file->durability = DURABILITY_IMMEDIATE;
+    file->groupPages = DURABILITY_GROUP_PAGES;
+    file->groupMillis = DURABILITY_GROUP_MILLIS;
+    file->pendingPages = 0;
+    file->lastCommit = currentMillis();
+    file->layerState = NULL;
+    file->releaseLayerState = NULL;
+
+    fileHandle.setFile(file);
 
     return SUCCESS;
 }
@@ -79,18 +300,108 @@ RC PagedFileManager::openFile(const string &fileName, FileHandle &fileHandle)
 
 RC PagedFileManager::closeFile(FileHandle &fileHandle)
 {
-    FILE *pFile = fileHandle.getfd();
+    unique_lock<mutex> guard(_latch);
+
+    PagedFile *file = fileHandle.getFile();
 
     // If not an open file, error
-    if (pFile == NULL)
+    if (file == NULL)
         return 1;
 
-    // Flush and close the file
-    fclose(pFile);
+    // Write back any pages modified through the buffer pool
+    RC rc = BufferPoolManager::instance()->flushFile(fileHandle);
 
-    fileHandle.setfd(NULL);
+    fileHandle.setFile(NULL);
+    if (--file->openCount > 0)
+        return rc;
 
-    return SUCCESS;
+    // Anything not written immediately has to be durable once the file is closed
+    if (file->durability != DURABILITY_IMMEDIATE)
+    {
+        if (FileHandle::syncFile(file) && rc == SUCCESS)
+            rc = FH_SYNC_FAILED;
+    }
+    else if (file->headerDirty && FileHandle::writeHeader(file) && rc == SUCCESS)
+        rc = FH_WRITE_FAILED;
+
+    // Close the file
+    close(file->fd);
+    file->fd = -1;
+
+    void *layerState = file->layerState;
+    LayerStateRelease releaseLayerState = file->releaseLayerState;
+    file->layerState = NULL;
+
+    // Keep the entry around only while the buffer pool still caches its pages
+    if (file->unlinked)
+        delete file;
+    else if (file->frames.empty())
+        forgetFile(file);
+
+    // The layer state may hold files of its own, which closing takes the latch for
+    guard.unlock();
+    if (layerState != NULL)
+        releaseLayerState(layerState);
+
+    return rc;
+}
+
+void PagedFileManager::setExtentPages(unsigned extentPages)
+{
+    _extentPages = extentPages > 0 ? extentPages : 1;
+}
+
+unsigned PagedFileManager::getExtentPages()
+{
+    return _extentPages;
+}
+
+void PagedFileManager::wakeGroupCommitter()
+{
+    lock_guard<mutex> guard(_latch);
+    if (!_groupCommitterStarted)
+    {
+        thread(&PagedFileManager::runGroupCommitter, this).detach();
+        _groupCommitterStarted = true;
+    }
+    _groupCommitterWake.notify_one();
+}
+
+// Commits the GROUP files whose pending pages have reached their time limit, then sleeps until
+// the next one does. A file without pending pages wakes the committer when it gets one.
+// Errors are left for the next sync or closeFile to report.
+void PagedFileManager::runGroupCommitter()
+{
+    unique_lock<mutex> guard(_latch);
+    while (true)
+    {
+        unsigned long long now = currentMillis(), next = ULLONG_MAX;
+        for (auto it = _files.begin(); it != _files.end(); ++it)
+        {
+            PagedFile *file = it->second;
+            if (file->openCount == 0 || file->durability != DURABILITY_GROUP || file->pendingPages == 0)
+                continue;
+            unsigned long long due = file->lastCommit + file->groupMillis;
+            if (due > now)
+            {
+                next = min(next, due);
+                continue;
+            }
+            FileHandle fileHandle;
+            fileHandle.setFile(file);
+            // Try again a period later if the commit failed
+            if (fileHandle.sync())
+            {
+                file->lastCommit = now;
+                next = min(next, now + file->groupMillis);
+            }
+            fileHandle.setFile(NULL);
+        }
+        if (next == ULLONG_MAX)
+            _groupCommitterWake.wait(guard);
+        else
+            _groupCommitterWake.wait_for(guard, chrono::milliseconds(next - now));
+    }
 }
 
 // Check if a file already exists
@@ -101,6 +412,14 @@ bool PagedFileManager::fileExists(const string &fileName)
     return stat(fileName.c_str(), &sb) == 0;
 }
 
+// Drop a closed file from the registry along with any pages it still has cached
+void PagedFileManager::forgetFile(PagedFile *file)
+{
+    BufferPoolManager::instance()->discardFile(file);
+    _files.erase(make_pair(file->dev, file->ino));
+    delete file;
+}
+
 
 FileHandle::FileHandle()
 {
@@ -108,7 +427,11 @@ FileHandle::FileHandle()
     writePageCounter = 0;
     appendPageCounter = 0;
 
-    _fd = NULL;
+    bufferHitCounter = 0;
+    bufferMissCounter = 0;
+    bufferEvictionCounter = 0;
+
+    _file = NULL;
 }
 
 
@@ -120,16 +443,16 @@ FileHandle::~FileHandle()
 RC FileHandle::readPage(PageNum pageNum, void *data)
 {
     // If pageNum doesn't exist, error
-    if (getNumberOfPages() < pageNum)
+    if (pageNum >= getNumberOfPages())
         return FH_PAGE_DN_EXIST;
 
-    // Try to seek to the specified page
-    if (fseek(_fd, PAGE_SIZE * pageNum, SEEK_SET))
-        return FH_SEEK_FAILED;
+    // A newer version of the page may still be sitting in the buffer pool
+    if (BufferPoolManager::instance()->flushIfDirty(_file, pageNum))
+        return FH_WRITE_FAILED;
 
-    // Try to read the specified page
-    if (fread(data, 1, PAGE_SIZE, _fd) != PAGE_SIZE)
-        return FH_READ_FAILED;
+    RC rc = readFilePage(_file, pageNum, data);
+    if (rc)
+        return rc;
 
     readPageCounter++;
     return SUCCESS;
@@ -139,52 +462,55 @@ RC FileHandle::readPage(PageNum pageNum, void *data)
 RC FileHandle::writePage(PageNum pageNum, const void *data)
 {
     // Check if the page exists
-    if (getNumberOfPages() < pageNum)
+    if (pageNum >= getNumberOfPages())
         return FH_PAGE_DN_EXIST;
 
-    // Seek to the start of the page
-    if (fseek(_fd, PAGE_SIZE * pageNum, SEEK_SET))
-        return FH_SEEK_FAILED;
+    RC rc = writeFilePage(_file, pageNum, data);
+    if (rc)
+        return rc;
 
-    // Write the page
-    if (fwrite(data, 1, PAGE_SIZE, _fd) == PAGE_SIZE)
-    {
-        // Immediately commit changes to disk
-        fflush(_fd);
-        writePageCounter++;
-        return SUCCESS;
-    }
-    
-    return FH_WRITE_FAILED;
+    // Keep any buffered copy of the page in sync
+    BufferPoolManager::instance()->refresh(_file, pageNum, data);
+    writePageCounter++;
+    return SUCCESS;
 }
 
 
 RC FileHandle::appendPage(const void *data)
 {
-    // Seek to the end of the file
-    if (fseek(_fd, 0, SEEK_END))
-        return FH_SEEK_FAILED;
-
-    // Write the new page
-    if (fwrite(data, 1, PAGE_SIZE, _fd) == PAGE_SIZE)
-    {
-        fflush(_fd);
-        appendPageCounter++;
-        return SUCCESS;
-    }
-    return FH_WRITE_FAILED;
+    PageNum pageNum = getNumberOfPages();
+
+    // Grow the file a whole extent at a time
+    RC rc;
+    bool grown = pageNum >= _file->allocatedPages;
+    if (grown && (rc = extendFile(_file)))
+        return rc;
+
+    // Write the new page into the preallocated space and move the logical end of file.
+    // IMMEDIATE mode writes the header page only when it still claims to be exact or the
+    // extent grew; readHeader finds appends past its page count in the last extent.
+    if ((rc = writeFilePage(_file, pageNum, data)))
+        return rc;
+    _file->numPages++;
+    bool headerExact = !_file->headerDirty;
+    _file->headerDirty = true;
+    if (_file->durability == DURABILITY_IMMEDIATE && (headerExact || grown) &&
+        (rc = writeHeader(_file, false)))
+        return rc;
+
+    // Replace anything the buffer pool cached for a failed read past the old end of file
+    BufferPoolManager::instance()->refresh(_file, pageNum, data);
+    appendPageCounter++;
+    return SUCCESS;
 }
 
 
 unsigned FileHandle::getNumberOfPages()
 {
-    // Use stat to get the file size
-    struct stat sb;
-    if (fstat(fileno(_fd), &sb) != 0)
-        // On error, return 0
+    // Tracked in memory, the file itself may extend past the logical end
+    if (_file == NULL)
         return 0;
-    // Filesize is always PAGE_SIZE * number of pages
-    return sb.st_size / PAGE_SIZE;
+    return _file->numPages;
 }
 
 
@@ -196,12 +522,494 @@ RC FileHandle::collectCounterValues(unsigned &readPageCount, unsigned &writePage
     return SUCCESS;
 }
 
-void FileHandle::setfd(FILE *fd)
+RC FileHandle::fetchPage(PageNum pageNum, void *&page)
 {
-    _fd = fd;
+    return BufferPoolManager::instance()->fetchPage(*this, pageNum, page);
+}
+
+RC FileHandle::newPage(PageNum &pageNum, void *&page)
+{
+    return BufferPoolManager::instance()->newPage(*this, pageNum, page);
+}
+
+RC FileHandle::unpinPage(PageNum pageNum, bool dirty)
+{
+    RC rc = BufferPoolManager::instance()->unpinPage(*this, pageNum, dirty);
+    if (rc != SUCCESS || !dirty)
+        return rc;
+
+    switch (_file->durability)
+    {
+        case DURABILITY_IMMEDIATE:
+            // Write the page through, like a direct writePage
+            return flushPage(pageNum);
+        case DURABILITY_GROUP:
+        {
+            // Commit once enough pages or time have accumulated; the group committer keeps to
+            // the time limit if no more writes come
+            unsigned pending = ++_file->pendingPages;
+            if (pending >= _file->groupPages || currentMillis() - _file->lastCommit >= _file->groupMillis)
+                return sync();
+            if (pending == 1)
+                PagedFileManager::instance()->wakeGroupCommitter();
+            return SUCCESS;
+        }
+        case DURABILITY_EXPLICIT:
+            return SUCCESS;
+    }
+    return SUCCESS;
+}
+
+RC FileHandle::unpinPageLazily(PageNum pageNum)
+{
+    return BufferPoolManager::instance()->unpinPage(*this, pageNum, true);
+}
+
+RC FileHandle::flushPage(PageNum pageNum)
+{
+    return BufferPoolManager::instance()->flushPage(*this, pageNum);
+}
+
+RC FileHandle::collectBufferPoolCounterValues(unsigned &hitCount, unsigned &missCount, unsigned &evictionCount)
+{
+    hitCount      = bufferHitCounter;
+    missCount     = bufferMissCounter;
+    evictionCount = bufferEvictionCounter;
+    return SUCCESS;
+}
+
+RC FileHandle::setDurability(DurabilityMode mode, unsigned groupPages, unsigned groupMillis)
+{
+    if (_file == NULL)
+        return FH_WRITE_FAILED;
+
+    // Don't leave pages behind that the new mode would never commit
+    if (mode == DURABILITY_IMMEDIATE && _file->durability != DURABILITY_IMMEDIATE)
+    {
+        RC rc = sync();
+        if (rc)
+            return rc;
+    }
+
+    _file->durability = mode;
+    _file->groupPages = groupPages > 0 ? groupPages : 1;
+    _file->groupMillis = groupMillis;
+    _file->pendingPages = 0;
+    _file->lastCommit = currentMillis();
+    return SUCCESS;
+}
+
+DurabilityMode FileHandle::getDurability()
+{
+    return _file == NULL ? DURABILITY_IMMEDIATE : _file->durability;
+}
+
+RC FileHandle::sync()
+{
+    if (_file == NULL)
+        return FH_WRITE_FAILED;
+
+    RC rc = BufferPoolManager::instance()->flushFile(*this);
+    if (rc)
+        return rc;
+    return syncFile(_file);
+}
+
+RC FileHandle::mapPages(const void *&pages, unsigned &numPages)
+{
+    if (_file == NULL)
+        return FH_MAP_FAILED;
+
+    // The map reads the file, so it has to hold every change made so far
+    RC rc = BufferPoolManager::instance()->flushFile(*this);
+    if (rc)
+        return rc;
+
+    numPages = getNumberOfPages();
+    if (numPages == 0)
+        return FH_MAP_FAILED;
+
+    // Map from the start of the file to keep the offset aligned, then skip the header page
+    size_t length = PAGE_SIZE * ((size_t) numPages + 1);
+    void *base = mmap(NULL, length, PROT_READ, MAP_SHARED, _file->fd, 0);
+    if (base == MAP_FAILED)
+        return FH_MAP_FAILED;
+    madvise(base, length, MADV_SEQUENTIAL);
+
+    pages = (char *) base + PAGE_SIZE;
+    return SUCCESS;
 }
 
-FILE *FileHandle::getfd()
+RC FileHandle::unmapPages(const void *pages, unsigned numPages)
 {
-    return _fd;
-}
\ No newline at end of file
+    void *base = (char *) pages - PAGE_SIZE;
+    if (munmap(base, PAGE_SIZE * ((size_t) numPages + 1)) != 0)
+        return FH_MAP_FAILED;
+    return SUCCESS;
+}
+
+bool FileHandle::isPageBuffered(PageNum pageNum)
+{
+    return BufferPoolManager::instance()->isDirty(_file, pageNum);
+}
+
+bool FileHandle::isDirect()
+{
+    return _file != NULL && _file->direct;
+}
+
+bool FileHandle::hasChecksums()
+{
+    return _file != NULL && _file->checksums;
+}
+
+unsigned FileHandle::getFlags()
+{
+    return _file != NULL ? _file->flags : 0;
+}
+
+bool FileHandle::checkPage(const void *page)
+{
+    return !hasChecksums() || verifyChecksum(page);
+}
+
+RC FileHandle::submitRead(PageNum pageNum, void *data, ReadCallback callback, void *context)
+{
+    if (pageNum >= getNumberOfPages())
+        return FH_PAGE_DN_EXIST;
+
+    // Same as readPage: the file has to hold the latest version of the page
+    if (BufferPoolManager::instance()->flushIfDirty(_file, pageNum))
+        return FH_WRITE_FAILED;
+
+    // Unaligned buffers can't be handed to the kernel for direct I/O, read those right away
+    if (needsBounce(_file, data))
+    {
+        RC rc = readFilePage(_file, pageNum, data);
+        readPageCounter++;
+        callback(context, rc);
+        return SUCCESS;
+    }
+
+    ChecksumRead *read = NULL;
+    if (_file->checksums)
+    {
+        read = new ChecksumRead;
+        read->data = data;
+        read->callback = callback;
+        read->context = context;
+        callback = checksumReadDone;
+        context = read;
+    }
+
+    RC rc = AsyncReadManager::instance()->submit(_file->fd, PAGE_SIZE * ((off_t) pageNum + 1), data, PAGE_SIZE, callback, context);
+    if (rc)
+    {
+        delete read;
+        return rc;
+    }
+
+    readPageCounter++;
+    return SUCCESS;
+}
+
+RC FileHandle::submitReads(const vector<PageNum> &pageNums, void * const *buffers, ReadBatch &batch)
+{
+    RC result = SUCCESS;
+    for (unsigned i = 0; i < pageNums.size(); i++)
+    {
+        {
+            lock_guard<mutex> guard(batch.latch);
+            batch.pending++;
+        }
+        RC rc = submitRead(pageNums[i], buffers[i], ReadBatch::readDone, &batch);
+        if (rc)
+        {
+            ReadBatch::readDone(&batch, rc);
+            result = rc;
+        }
+    }
+    return result;
+}
+
+RC FileHandle::completeReads(ReadBatch &batch)
+{
+    return batch.wait();
+}
+
+RC FileHandle::readPages(const vector<PageNum> &pageNums, void * const *buffers)
+{
+    ReadBatch batch;
+    submitReads(pageNums, buffers, batch);
+    return completeReads(batch);
+}
+
+RC FileHandle::prefetchPages(const vector<PageNum> &pageNums)
+{
+    return BufferPoolManager::instance()->prefetchPages(*this, pageNums);
+}
+
+void FileHandle::setReadAhead(unsigned pages)
+{
+    if (_file != NULL)
+        _file->readAheadPages = pages;
+}
+
+unsigned FileHandle::getReadAhead()
+{
+    return _file == NULL ? 0 : _file->readAheadPages;
+}
+
+void *FileHandle::getLayerState()
+{
+    if (_file == NULL)
+        return NULL;
+    lock_guard<mutex> guard(layerStateLatch);
+    return _file->layerState;
+}
+
+void *FileHandle::setLayerState(void *state, LayerStateRelease release)
+{
+    if (_file == NULL)
+        return NULL;
+    lock_guard<mutex> guard(layerStateLatch);
+    if (_file->layerState == NULL)
+    {
+        _file->layerState = state;
+        _file->releaseLayerState = release;
+    }
+    return _file->layerState;
+}
+
+void FileHandle::setFile(PagedFile *file)
+{
+    _file = file;
+}
+
+PagedFile *FileHandle::getFile()
+{
+    return _file;
+}
+
+// Positional I/O: no shared file offset, so any number of threads can read one file at once.
+// pread/pwrite may transfer less than asked for, keep going until the page is done.
+static bool readFully(int fd, void *data, size_t length, off_t offset)
+{
+    size_t done = 0;
+    while (done < length)
+    {
+        ssize_t n = pread(fd, (char *) data + done, length - done, offset + done);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        done += n;
+    }
+    return true;
+}
+
+static bool writeFully(int fd, const void *data, size_t length, off_t offset)
+{
+    size_t done = 0;
+    while (done < length)
+    {
+        ssize_t n = pwrite(fd, (const char *) data + done, length - done, offset + done);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        done += n;
+    }
+    return true;
+}
+
+// Uncounted page read, shared by readPage and the buffer pool
+RC FileHandle::readFilePage(PagedFile *file, PageNum pageNum, void *data)
+{
+    void *buffer = needsBounce(file, data) ? borrowPage() : data;
+    if (buffer == NULL)
+        return FH_READ_FAILED;
+
+    // Pages start after the header page
+    bool read = readFully(file->fd, buffer, PAGE_SIZE, PAGE_SIZE * ((off_t) pageNum + 1));
+    if (buffer != data)
+    {
+        memcpy(data, buffer, PAGE_SIZE);
+        returnPage(buffer);
+    }
+    if (!read)
+        return FH_READ_FAILED;
+    if (file->checksums && !verifyChecksum(data))
+        return FH_CHECKSUM_FAILED;
+
+    return SUCCESS;
+}
+
+// Uncounted page write, shared by writePage and the buffer pool
+RC FileHandle::writeFilePage(PagedFile *file, PageNum pageNum, const void *data)
+{
+    // The caller's page is const, the trailer goes into a copy
+    const void *buffer = data;
+    if (needsBounce(file, data) || file->checksums)
+    {
+        void *bounce = borrowPage();
+        if (bounce == NULL)
+            return FH_WRITE_FAILED;
+        memcpy(bounce, data, PAGE_SIZE);
+        if (file->checksums)
+        {
+            uint32_t checksum = pageChecksum(bounce);
+            memcpy((char *) bounce + PAGE_SIZE - PFM_CHECKSUM_SIZE, &checksum, PFM_CHECKSUM_SIZE);
+        }
+        buffer = bounce;
+    }
+
+    // Pages start after the header page
+    bool written = writeFully(file->fd, buffer, PAGE_SIZE, PAGE_SIZE * ((off_t) pageNum + 1));
+    if (buffer != data)
+        returnPage((void *) buffer);
+    if (!written)
+        return FH_WRITE_FAILED;
+
+    return SUCCESS;
+}
+
+// Push everything written so far to stable storage
+RC FileHandle::syncFile(PagedFile *file)
+{
+    if (file->headerDirty && writeHeader(file))
+        return FH_WRITE_FAILED;
+    if (fdatasync(file->fd) != 0)
+        return FH_SYNC_FAILED;
+
+    file->pendingPages = 0;
+    file->lastCommit = currentMillis();
+    return SUCCESS;
+}
+
+// Load the logical page count from the header page and the allocated size from the file
+RC FileHandle::readHeader(PagedFile *file)
+{
+    // Direct I/O transfers whole aligned blocks, so go through a page buffer
+    void *headerPage = borrowPage();
+    if (headerPage == NULL)
+        return FH_READ_FAILED;
+    bool read = readFully(file->fd, headerPage, file->direct ? PAGE_SIZE : sizeof(FileHeader), 0);
+    FileHeader header;
+    memcpy(&header, headerPage, sizeof(FileHeader));
+    returnPage(headerPage);
+    if (!read)
+        return FH_READ_FAILED;
+    if (header.magic != PFM_MAGIC || header.version != PFM_VERSION || header.pageSize != PAGE_SIZE)
+        return FH_READ_FAILED;
+
+    struct stat sb;
+    if (fstat(file->fd, &sb) != 0)
+        return FH_READ_FAILED;
+    unsigned filePages = sb.st_size / PAGE_SIZE;
+
+    file->numPages = header.pageCount;
+    file->checksums = (header.flags & PFM_CHECKSUMS) != 0;
+    file->flags = header.flags;
+    file->allocatedPages = filePages > 0 ? filePages - 1 : 0;
+    if (file->numPages > file->allocatedPages)
+        return FH_READ_FAILED;
+    file->headerDirty = !header.exact;
+    return header.exact ? SUCCESS : recoverPageCount(file);
+}
+
+// The file was not closed since pages were appended without updating the header page:
+// the logical end is past the last page holding anything. An appended page still all
+// zeros is dropped, as if it had never been appended.
+RC FileHandle::recoverPageCount(PagedFile *file)
+{
+    void *page = borrowPage();
+    if (page == NULL)
+        return FH_READ_FAILED;
+    RC rc = SUCCESS;
+    for (PageNum pageNum = file->allocatedPages; pageNum > file->numPages; pageNum--)
+    {
+        if (!readFully(file->fd, page, PAGE_SIZE, PAGE_SIZE * (off_t) pageNum))
+        {
+            rc = FH_READ_FAILED;
+            break;
+        }
+        const char *bytes = (const char *) page;
+        if (bytes[0] != 0 || memcmp(bytes, bytes + 1, PAGE_SIZE - 1) != 0)
+        {
+            file->numPages = pageNum;
+            break;
+        }
+    }
+    returnPage(page);
+    return rc;
+}
+
+// Record the logical end of file in the header page; exact once nothing is appended without it
+RC FileHandle::writeHeader(PagedFile *file, bool exact)
+{
+    void *headerPage = borrowPage();
+    if (headerPage == NULL)
+        return FH_WRITE_FAILED;
+    // The rest of the page reaches the disk too
+    memset(headerPage, 0, PAGE_SIZE);
+    FileHeader *header = (FileHeader *) headerPage;
+    header->magic = PFM_MAGIC;
+    header->version = PFM_VERSION;
+    header->pageCount = file->numPages;
+    header->pageSize = PAGE_SIZE;
+    header->flags = file->flags;
+    header->exact = exact;
+    bool written = writeFully(file->fd, headerPage, file->direct ? PAGE_SIZE : sizeof(FileHeader), 0);
+    returnPage(headerPage);
+    if (!written)
+        return FH_WRITE_FAILED;
+
+    file->headerDirty = !exact;
+    return SUCCESS;
+}
+
+// Preallocate the next extent past the currently allocated pages
+RC FileHandle::extendFile(PagedFile *file)
+{
+    off_t offset = PAGE_SIZE * ((off_t) file->allocatedPages + 1);
+    off_t length = PAGE_SIZE * (off_t) file->extentPages;
+
+    // Not every filesystem supports fallocate, posix_fallocate falls back to writing zeros
+    if (fallocate(file->fd, 0, offset, length) != 0 &&
+        posix_fallocate(file->fd, offset, length) != 0)
+        return FH_ALLOC_FAILED;
+
+    file->allocatedPages += file->extentPages;
+    return SUCCESS;
+}
+
+
+ReadBatch::ReadBatch()
+: pending(0), rc(SUCCESS)
+{
+}
+
+// Never leave reads pointing at a batch that is gone
+ReadBatch::~ReadBatch()
+{
+    wait();
+}
+
+RC ReadBatch::wait()
+{
+    unique_lock<mutex> guard(latch);
+    while (pending > 0)
+        finished.wait(guard);
+    return rc;
+}
+
+void ReadBatch::readDone(void *context, RC rc)
+{
+    ReadBatch *batch = (ReadBatch *) context;
+    lock_guard<mutex> guard(batch->latch);
+    if (rc != SUCCESS && batch->rc == SUCCESS)
+        batch->rc = rc;
+    if (--batch->pending == 0)
+        batch->finished.notify_all();
+}
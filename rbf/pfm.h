@@ -9,33 +9,192 @@
 #define PFM_HANDLE_IN_USE 4
 #define PFM_FILE_DN_EXIST 5
 #define PFM_FILE_NOT_OPEN 6
+#define PFM_BAD_HEADER    7
 
-#define FH_PAGE_DN_EXIST  1
-#define FH_SEEK_FAILED    2
-#define FH_READ_FAILED    3
-#define FH_WRITE_FAILED   4
+#define FH_PAGE_DN_EXIST    1
+#define FH_SEEK_FAILED      2
+#define FH_READ_FAILED      3
+#define FH_WRITE_FAILED     4
+#define FH_NO_FREE_FRAME    5
+#define FH_PAGE_NOT_PINNED  6
+#define FH_SYNC_FAILED      7
+#define FH_ALLOC_FAILED     8
+#define FH_MAP_FAILED       9
+#define FH_CHECKSUM_FAILED  10
 
 typedef unsigned PageNum;
 typedef int RC;
 typedef char byte;
 
+// The page size is fixed at build time, e.g. "make PAGE_SIZE=16384" after a "make clean".
+// Files record the size they were created with and can only be opened by a build using it.
+// Slot directories, record directories and index nodes address a page with 16 bit fields
+// in places, so 64 KB is the upper bound.
+#ifndef PAGE_SIZE
 #define PAGE_SIZE 4096
+#endif
+#if PAGE_SIZE != 4096 && PAGE_SIZE != 8192 && PAGE_SIZE != 16384 && PAGE_SIZE != 32768 && PAGE_SIZE != 65536
+#error "PAGE_SIZE must be 4, 8, 16, 32 or 64 KB"
+#endif
+
+// Every paged file starts with a hidden header page; page 0 as seen through
+// a FileHandle is the second physical page of the file.
+#define PFM_MAGIC   0x46504450  // "PDPF"
+#define PFM_VERSION 9   // 4: record-based files begin with their free-space map
+                        // 5: record pages chain their dead slots
+                        // 6: record pages count the bytes of their holes
+                        // 7: the header keeps the flags of the layers on top
+                        // 8: PAX pages begin with their kind
+                        // 9: the header says whether its page count is exact
+
+// createFile flags
+//   PFM_CHECKSUMS: the last PFM_CHECKSUM_SIZE bytes of every page hold a CRC32C of the rest,
+//                  set when the page is written and verified when it is read. Layers on top
+//                  keep those bytes free whether or not their files use checksums.
+#define PFM_CHECKSUMS 0x1
+#define PFM_CHECKSUM_SIZE 4
+// Flags from PFM_LAYER_FLAGS up belong to the layers on top; the file only keeps them
+#define PFM_LAYER_FLAGS 0x100
+
+// Files grow by this many pages at a time unless configured otherwise
+#define PFM_DEFAULT_EXTENT_PAGES 16
+
+// Pages scans keep in flight ahead of their cursor unless configured otherwise
+#define PFM_DEFAULT_READ_AHEAD 8
+
+// Alignment of page buffers; covers the logical block size of any device O_DIRECT can run on
+#define PFM_PAGE_ALIGNMENT 4096
+
+// Scratch pages each thread keeps for reuse once they are given back
+#define PFM_SCRATCH_PAGES 8
+
+// GROUP durability defaults: commit after this many dirtied pages or this much time
+#define DURABILITY_GROUP_PAGES  64
+#define DURABILITY_GROUP_MILLIS 10
+
 #include <string>
 #include <climits>
+#include <stdint.h>
+#include <cstdio>
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <vector>
+#include <unordered_map>
+#include <utility>
+#include <sys/types.h>
 using namespace std;
 
 class FileHandle;
 
+// Frees the state a layer on top attached to a file, see FileHandle::setLayerState
+typedef void (*LayerStateRelease)(void *state);
+
+// Called once an asynchronous read finishes, on a background thread
+typedef void (*ReadCallback)(void *context, RC rc);
+
+// Page buffers aligned to PFM_PAGE_ALIGNMENT, usable for direct I/O.
+// allocPage returns a zeroed page, or NULL when out of memory; release with freePage.
+void *allocPage();
+void freePage(void *page);
+
+// Short-lived page buffers for hot paths. Every thread keeps the pages it gives back and
+// hands them out again, so a warm thread borrows without touching the heap. The contents
+// of a borrowed page are whatever its last user left there.
+void *borrowPage();
+void returnPage(void *page);
+
+// A page borrowed for the lifetime of a scope
+class ScratchPage
+{
+public:
+    ScratchPage() : page(borrowPage()) {}
+    ~ScratchPage() { returnPage(page); }
+
+    void *data() const { return page; }
+
+private:
+    void *page;
+
+    ScratchPage(const ScratchPage &);
+    ScratchPage &operator=(const ScratchPage &);
+};
+
+// How openFile opens a file
+//   OPEN_BUFFERED: through the OS page cache
+//   OPEN_DIRECT:   with O_DIRECT, so pages are cached only by our buffer pool. Falls back to
+//                  buffered I/O where the filesystem does not support it, see FileHandle::isDirect
+// A file already open elsewhere keeps the mode it was first opened with.
+typedef enum { OPEN_BUFFERED = 0, OPEN_DIRECT } OpenMode;
+
+// Contents of the header page
+typedef struct FileHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t pageCount;     // Logical end of file; pages past it are preallocated
+    uint32_t pageSize;      // PAGE_SIZE of the build that created the file
+    uint32_t flags;         // createFile flags
+    uint32_t exact;         // 0 while appends may have moved the logical end past pageCount
+} FileHeader;
+
+// When modified pages reach the disk
+//   IMMEDIATE: every modified page is handed to the OS as soon as it is unpinned
+//   GROUP:     modified pages are committed (written + fdatasync) once N pages are pending, and
+//              at the latest T milliseconds after the last commit, by a background thread when
+//              no more writes come
+//   EXPLICIT:  modified pages are written only by FileHandle::sync, closeFile, or eviction
+typedef enum { DURABILITY_IMMEDIATE = 0, DURABILITY_GROUP, DURABILITY_EXPLICIT } DurabilityMode;
+
+// State shared by every FileHandle opened on the same file.
+// Opening a file that is already open attaches the new handle to the existing
+// PagedFile, so all handles (and the buffer pool) agree on the file's contents.
+// A PagedFile outlives its last close while the buffer pool still caches its pages.
+typedef struct PagedFile
+{
+    int fd;                     // -1 while the file is closed
+    dev_t dev;
+    ino_t ino;
+    unsigned openCount;
+    bool unlinked;
+    unsigned numPages;          // Logical number of pages
+    unsigned allocatedPages;    // Pages backed by the file, including the preallocated extent
+    unsigned extentPages;
+    bool headerDirty;           // The header page does not hold numPages as exact
+    bool direct;                // Opened with O_DIRECT, I/O has to use aligned buffers
+    bool checksums;             // Created with PFM_CHECKSUMS
+    unsigned flags;             // createFile flags
+    unsigned readAheadPages;
+    DurabilityMode durability;
+    unsigned groupPages;
+    unsigned groupMillis;
+    atomic<unsigned> pendingPages;  // Pages dirtied since the last group commit
+    atomic<unsigned long long> lastCommit;  // Time of the last group commit, in milliseconds
+    void *layerState;           // Attached by the layer on top, released on the last close
+    LayerStateRelease releaseLayerState;
+    // Page number => buffer pool frame holding that page
+    unordered_map<PageNum, unsigned> frames;
+} PagedFile;
+
 class PagedFileManager
 {
 public:
     static PagedFileManager* instance();                                // Access to the _pf_manager instance
 
-    RC createFile    (const string &fileName);                          // Create a new file
+    RC createFile    (const string &fileName, unsigned flags = 0);      // Create a new file
     RC destroyFile   (const string &fileName);                          // Destroy a file
-    RC openFile      (const string &fileName, FileHandle &fileHandle);  // Open a file
+    RC openFile      (const string &fileName, FileHandle &fileHandle,
+                      OpenMode openMode = OPEN_BUFFERED);               // Open a file
     RC closeFile     (FileHandle &fileHandle);                          // Close a file
 
+    // Number of pages appendPage preallocates at once for files opened from now on
+    void setExtentPages(unsigned extentPages);
+    unsigned getExtentPages();
+
+    // A GROUP file has pages pending or a new time limit; starts the group committer if needed
+    void wakeGroupCommitter();
+
 protected:
     PagedFileManager();                                                 // Constructor
     ~PagedFileManager();                                                // Destructor
@@ -43,8 +202,38 @@ protected:
 private:
     static PagedFileManager *_pf_manager;
 
+    // Known files, keyed by (device, inode)
+    map<pair<dev_t, ino_t>, PagedFile*> _files;
+    mutex _latch;               // Guards _files and the open counts
+    unsigned _extentPages;
+    bool _groupCommitterStarted;    // Detached, lives as long as the process
+    condition_variable _groupCommitterWake;
+
     // Private helper methods
     bool fileExists(const string &fileName);
+    void forgetFile(PagedFile *file);
+    void runGroupCommitter();
+};
+
+
+// A group of asynchronous page reads submitted together; see FileHandle::submitReads
+class ReadBatch
+{
+public:
+    ReadBatch();
+    ~ReadBatch();
+
+    RC wait();                                                          // Block until every read is done, returns the first error
+
+    friend class FileHandle;
+
+private:
+    mutex latch;
+    condition_variable finished;
+    unsigned pending;
+    RC rc;
+
+    static void readDone(void *context, RC rc);
 };
 
 
@@ -55,25 +244,83 @@ public:
     unsigned readPageCounter;
     unsigned writePageCounter;
     unsigned appendPageCounter;
+
+    // variables to keep the buffer pool counters for pages fetched through this handle
+    unsigned bufferHitCounter;
+    unsigned bufferMissCounter;
+    unsigned bufferEvictionCounter;
     
     FileHandle();                                                       // Default constructor
-    ~FileHandle();                                                      // Destructor
+    virtual ~FileHandle();                                              // Destructor
 
-    RC readPage(PageNum pageNum, void *data);                           // Get a specific page
-    RC writePage(PageNum pageNum, const void *data);                    // Write a specific page
-    RC appendPage(const void *data);                                    // Append a specific page
+    virtual RC readPage(PageNum pageNum, void *data);                   // Get a specific page
+    virtual RC writePage(PageNum pageNum, const void *data);            // Write a specific page
+    virtual RC appendPage(const void *data);                            // Append a specific page
     unsigned getNumberOfPages();                                        // Get the number of pages in the file
     RC collectCounterValues(unsigned &readPageCount, unsigned &writePageCount, unsigned &appendPageCount);  // Put the current counter values into variables
 
-    // Let PagedFileManager access our private helper methods
+    // Buffer pool access. A fetched page stays pinned in memory until it is unpinned;
+    // pass dirty = true to unpinPage if the page was modified.
+    RC fetchPage(PageNum pageNum, void *&page);                         // Pin a page in the buffer pool
+    RC newPage(PageNum &pageNum, void *&page);                          // Append a zeroed page and pin it
+    RC unpinPage(PageNum pageNum, bool dirty);                          // Release a pinned page
+    RC unpinPageLazily(PageNum pageNum);                                // Release a modified page holding only hints, written back
+                                                                        // on eviction, sync or close whatever the durability mode
+    RC flushPage(PageNum pageNum);                                      // Write a buffered page to disk if dirty
+    RC collectBufferPoolCounterValues(unsigned &hitCount, unsigned &missCount, unsigned &evictionCount);
+
+    // Durability of the file's modified pages; shared by every handle on the file
+    // and reset to IMMEDIATE when the file is opened for the first time.
+    RC setDurability(DurabilityMode mode, unsigned groupPages = DURABILITY_GROUP_PAGES, unsigned groupMillis = DURABILITY_GROUP_MILLIS);
+    DurabilityMode getDurability();
+    RC sync();                                                          // Write every modified page and fdatasync the file
+
+    // Read-only memory map of the file's current pages for sequential scans.
+    // Modified buffered pages are written back first; pages appended afterwards
+    // and pages modified in the buffer pool later are not reflected in the map.
+    RC mapPages(const void *&pages, unsigned &numPages);
+    RC unmapPages(const void *pages, unsigned numPages);
+    bool isPageBuffered(PageNum pageNum);                               // Does the buffer pool hold a newer version than the file?
+    bool isDirect();                                                    // Is the file opened with O_DIRECT?
+    bool hasChecksums();                                                // Was the file created with PFM_CHECKSUMS?
+    unsigned getFlags();                                                // The flags the file was created with
+    bool checkPage(const void *page);                                   // Does the page match its checksum? Always true without checksums
+
+    // Asynchronous reads, through io_uring when available and a thread pool otherwise.
+    // The buffers must stay valid until the reads complete.
+    virtual RC submitRead(PageNum pageNum, void *data, ReadCallback callback, void *context);
+    RC submitReads(const vector<PageNum> &pageNums, void * const *buffers, ReadBatch &batch);
+    RC completeReads(ReadBatch &batch);
+    RC readPages(const vector<PageNum> &pageNums, void * const *buffers);   // Submit and wait
+    RC prefetchPages(const vector<PageNum> &pageNums);                  // Start loading pages into the buffer pool
+
+    // Pages scans read ahead of their cursor; shared by every handle on the file, 0 disables read-ahead
+    void setReadAhead(unsigned pages);
+    unsigned getReadAhead();
+
+    // State a layer on top keeps per open file, shared by every handle on it and released
+    // once the last of them is closed. setLayerState keeps the state already attached, if any,
+    // and returns the one in effect; the caller releases its own state when it lost the race.
+    void *getLayerState();
+    void *setLayerState(void *state, LayerStateRelease release);
+
+    // Let PagedFileManager and BufferPoolManager access our private helper methods
     friend class PagedFileManager;
+    friend class BufferPoolManager;
 
 private:
-    FILE *_fd;
+    PagedFile *_file;
 
     // Private helper methods
-    void setfd(FILE *fd);
-    FILE *getfd();
+    void setFile(PagedFile *file);
+    PagedFile *getFile();
+    static RC readFilePage(PagedFile *file, PageNum pageNum, void *data);
+    static RC writeFilePage(PagedFile *file, PageNum pageNum, const void *data);
+    static RC syncFile(PagedFile *file);
+    static RC readHeader(PagedFile *file);
+    static RC writeHeader(PagedFile *file, bool exact = true);
+    static RC recoverPageCount(PagedFile *file);
+    static RC extendFile(PagedFile *file);
 }; 
 
 #endif
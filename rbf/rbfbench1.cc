@@ -0,0 +1,94 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <cassert>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "pfm.h"
+#include "rbfm.h"
+#include "test_util.h"
+
+using namespace std;
+
+// Benchmark 1: insert throughput under each durability mode
+
+const int numRecords = 10000;
+
+static double elapsedSeconds(const struct timespec &start, const struct timespec &end)
+{
+    return (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+int RBFBench_1(RecordBasedFileManager *rbfm, DurabilityMode mode, const string &modeName)
+{
+    RC rc;
+    string fileName = "bench1";
+
+    remove(fileName.c_str());
+    rc = rbfm->createFile(fileName);
+    assert(rc == success && "Creating the file should not fail.");
+
+    FileHandle fileHandle;
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+
+    rc = fileHandle.setDurability(mode);
+    assert(rc == success && "Setting the durability mode should not fail.");
+
+    vector<Attribute> recordDescriptor;
+    createRecordDescriptor(recordDescriptor);
+
+    int nullFieldsIndicatorActualSize = getActualByteForNullsIndicator(recordDescriptor.size());
+    unsigned char *nullsIndicator = (unsigned char *) malloc(nullFieldsIndicatorActualSize);
+    memset(nullsIndicator, 0, nullFieldsIndicatorActualSize);
+
+    void *record = malloc(100);
+    int recordSize = 0;
+    RID rid;
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < numRecords; i++)
+    {
+        prepareRecord(recordDescriptor.size(), nullsIndicator, 8, "Anteater", i, 170.1, i * 10, record, &recordSize);
+        rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+        assert(rc == success && "Inserting a record should not fail.");
+    }
+    // Closing makes every mode durable, so it is part of the measured work
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    unsigned readPageCount, writePageCount, appendPageCount;
+    fileHandle.collectCounterValues(readPageCount, writePageCount, appendPageCount);
+
+    double seconds = elapsedSeconds(start, end);
+    cout << setw(10) << modeName
+         << setw(14) << fixed << setprecision(0) << numRecords / seconds
+         << setw(12) << setprecision(3) << seconds * 1000
+         << setw(10) << writePageCount
+         << setw(10) << appendPageCount << endl;
+
+    rc = rbfm->destroyFile(fileName);
+    assert(rc == success && "Destroying the file should not fail.");
+
+    free(record);
+    free(nullsIndicator);
+    return 0;
+}
+
+int main()
+{
+    RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
+
+    cout << "Inserting " << numRecords << " records" << endl;
+    cout << setw(10) << "mode" << setw(14) << "inserts/s" << setw(12) << "ms" << setw(10) << "writes" << setw(10) << "appends" << endl;
+
+    RBFBench_1(rbfm, DURABILITY_IMMEDIATE, "IMMEDIATE");
+    RBFBench_1(rbfm, DURABILITY_GROUP, "GROUP");
+    RBFBench_1(rbfm, DURABILITY_EXPLICIT, "EXPLICIT");
+    return 0;
+}
@@ -0,0 +1,197 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <cassert>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "pfm.h"
+#include "bpm.h"
+#include "rbfm.h"
+#include "test_util.h"
+
+using namespace std;
+
+// Benchmark 10: a reporting table of repetitive values in a file of row pages, one of PAX pages
+// and one of compressed pages; their sizes and scans
+
+const int numRecords = 200000;
+const unsigned numFrames = 32768;    // All files stay cached
+const int scanRounds = 5;
+
+const char *regions[] = { "north", "south", "east", "west", "central", "overseas", "online", "wholesale" };
+const char *statuses[] = { "open", "shipped", "returned" };
+
+static double elapsedSeconds(const struct timespec &start, const struct timespec &end)
+{
+    return (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+static void addAttribute(vector<Attribute> &recordDescriptor, const string &name, AttrType type, AttrLength length)
+{
+    Attribute attr;
+    attr.name = name;
+    attr.type = type;
+    attr.length = length;
+    recordDescriptor.push_back(attr);
+}
+
+// Orders as they come in: a day that only grows, a region and status out of a few, a small
+// quantity, a price out of a price list and an id
+static void createOrderRecordDescriptor(vector<Attribute> &recordDescriptor)
+{
+    addAttribute(recordDescriptor, "Day", TypeInt, 4);
+    addAttribute(recordDescriptor, "Region", TypeVarChar, 16);
+    addAttribute(recordDescriptor, "Status", TypeVarChar, 10);
+    addAttribute(recordDescriptor, "Quantity", TypeInt, 4);
+    addAttribute(recordDescriptor, "Price", TypeReal, 4);
+    addAttribute(recordDescriptor, "Id", TypeInt, 4);
+}
+
+static void appendInt(char *data, unsigned &offset, int value)
+{
+    memcpy(data + offset, &value, sizeof(int));
+    offset += sizeof(int);
+}
+
+static void appendVarChar(char *data, unsigned &offset, const char *value)
+{
+    int length = strlen(value);
+    appendInt(data, offset, length);
+    memcpy(data + offset, value, length);
+    offset += length;
+}
+
+static void prepareOrderRecord(int i, void *buffer)
+{
+    char *data = (char *) buffer;
+    unsigned offset = 1;
+    data[0] = 0;
+    appendInt(data, offset, 20000 + i / 500);
+    appendVarChar(data, offset, regions[(i / 7) % 8]);
+    appendVarChar(data, offset, statuses[i % 10 == 0 ? 2 : i % 3 == 0]);
+    appendInt(data, offset, 1 + i * 7 % 20);
+    float price = 9.99f + (i * 13 % 16) * 5.0f;
+    memcpy(data + offset, &price, sizeof(float));
+    offset += sizeof(float);
+    appendInt(data, offset, i);
+}
+
+// Scans for the records meeting the condition, projecting Region and Price
+static double benchScan(RecordBasedFileManager *rbfm, FileHandle &fileHandle, const vector<Attribute> &recordDescriptor,
+                        const string &attribute, CompOp compOp, const void *value, int expected)
+{
+    vector<string> attributeNames;
+    attributeNames.push_back("Region");
+    attributeNames.push_back("Price");
+
+    RID rid;
+    char returnedData[PAGE_SIZE];
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int round = 0; round < scanRounds; round++)
+    {
+        RBFM_ScanIterator rbfmScanIterator;
+        RC rc = rbfm->scan(fileHandle, recordDescriptor, attribute, compOp, value, attributeNames, rbfmScanIterator);
+        assert(rc == success && "Scanning the file should not fail.");
+        int count = 0;
+        while (rbfmScanIterator.getNextRecord(rid, returnedData) != RBFM_EOF)
+            count++;
+        assert(count == expected && "The scan should return the matching records.");
+        rbfmScanIterator.close();
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return elapsedSeconds(start, end) * 1e9 / ((double) scanRounds * numRecords);
+}
+
+static void createBenchFile(RecordBasedFileManager *rbfm, const string &fileName, unsigned flags,
+                            const vector<Attribute> &recordDescriptor, const vector<void *> &rows, FileHandle &fileHandle)
+{
+    remove(fileName.c_str());
+    RC rc = rbfm->createFile(fileName, flags);
+    assert(rc == success && "Creating the file should not fail.");
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+    vector<RID> rids;
+    rc = rbfm->insertRecords(fileHandle, recordDescriptor, &rows[0], numRecords, rids);
+    assert(rc == success && "Inserting a batch of records should not fail.");
+}
+
+int RBFBench_10(RecordBasedFileManager *rbfm)
+{
+    RC rc = BufferPoolManager::instance()->configure(numFrames, CLOCK_REPLACEMENT);
+    assert(rc == success && "Configuring the buffer pool should not fail.");
+
+    vector<Attribute> recordDescriptor;
+    createOrderRecordDescriptor(recordDescriptor);
+    vector<void *> rows(numRecords);
+    for (int i = 0; i < numRecords; i++)
+    {
+        rows[i] = malloc(PAGE_SIZE);
+        prepareOrderRecord(i, rows[i]);
+    }
+
+    const char *fileNames[] = { "bench10_rows", "bench10_pax", "bench10_compressed" };
+    unsigned flags[] = { PFM_CHECKSUMS, PFM_CHECKSUMS | RBFM_PAX, PFM_CHECKSUMS | RBFM_COMPRESSED };
+    FileHandle handles[3];
+    for (int f = 0; f < 3; f++)
+        createBenchFile(rbfm, fileNames[f], flags[f], recordDescriptor, rows, handles[f]);
+    for (int i = 0; i < numRecords; i++)
+        free(rows[i]);
+
+    cout << "Scanning " << numRecords << " orders for 2 of their 6 columns" << endl;
+    cout << "Pages: " << handles[0].getNumberOfPages() << " row, " << handles[1].getNumberOfPages() << " PAX, "
+         << handles[2].getNumberOfPages() << " compressed (" << fixed << setprecision(1)
+         << (double) handles[0].getNumberOfPages() / handles[2].getNumberOfPages() << "x row, "
+         << (double) handles[1].getNumberOfPages() / handles[2].getNumberOfPages() << "x PAX)" << endl;
+    cout << setw(16) << "condition" << setw(14) << "row ns/rec" << setw(14) << "PAX ns/rec" << setw(18) << "compressed ns/rec" << endl;
+
+    // The first scans also warm up the buffer pool
+    for (int f = 0; f < 3; f++)
+        benchScan(rbfm, handles[f], recordDescriptor, "Day", NO_OP, NULL, numRecords);
+
+    char north[20];
+    int length = strlen("north");
+    memcpy(north, &length, sizeof(int));
+    memcpy(north + sizeof(int), "north", length);
+    int firstDays = 20000 + numRecords / 500 / 10, fewItems = 3;
+    float cheap = 20.0f;
+    int northCount = 0, fewCount = 0, cheapCount = 0;
+    for (int i = 0; i < numRecords; i++)
+    {
+        northCount += (i / 7) % 8 == 0;
+        fewCount += 1 + i * 7 % 20 < fewItems;
+        cheapCount += 9.99f + (i * 13 % 16) * 5.0f < cheap;
+    }
+
+    const char *names[] = { "Region = north", "Day < 10%", "Quantity < 3", "Price < 20", "none" };
+    const char *attributes[] = { "Region", "Day", "Quantity", "Price", "Day" };
+    CompOp compOps[] = { EQ_OP, LT_OP, LT_OP, LT_OP, NO_OP };
+    const void *values[] = { north, &firstDays, &fewItems, &cheap, NULL };
+    int expected[] = { northCount, numRecords / 10, fewCount, cheapCount, numRecords };
+    for (unsigned i = 0; i < sizeof(names) / sizeof(names[0]); i++)
+    {
+        double times[3];
+        for (int f = 0; f < 3; f++)
+            times[f] = benchScan(rbfm, handles[f], recordDescriptor, attributes[i], compOps[i], values[i], expected[i]);
+        cout << setw(16) << names[i] << setw(14) << fixed << setprecision(1) << times[0] << setw(14) << times[1]
+             << setw(18) << times[2] << endl;
+    }
+
+    for (int f = 0; f < 3; f++)
+    {
+        rc = rbfm->closeFile(handles[f]);
+        assert(rc == success && "Closing the file should not fail.");
+        rc = rbfm->destroyFile(fileNames[f]);
+        assert(rc == success && "Destroying the file should not fail.");
+    }
+    return 0;
+}
+
+int main()
+{
+    RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
+    return RBFBench_10(rbfm);
+}
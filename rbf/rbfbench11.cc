@@ -0,0 +1,188 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <cassert>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "pfm.h"
+#include "bpm.h"
+#include "rbfm.h"
+#include "test_util.h"
+
+using namespace std;
+
+// Benchmark 11: selective scans of a log whose timestamps grow with the file, with and without
+// zone maps; the pages each scan reads and its time per record
+
+const int numRecords = 200000;
+const unsigned numFrames = 64;      // Scans read most pages from the file
+const int scanRounds = 3;
+
+const char *sources[] = { "kernel", "network", "storage", "scheduler", "audit" };
+
+static double elapsedSeconds(const struct timespec &start, const struct timespec &end)
+{
+    return (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+static void addAttribute(vector<Attribute> &recordDescriptor, const string &name, AttrType type, AttrLength length)
+{
+    Attribute attr;
+    attr.name = name;
+    attr.type = type;
+    attr.length = length;
+    recordDescriptor.push_back(attr);
+}
+
+// Log entries as they are written: a time that only grows, a source, a level and a latency
+// that has nothing to do with the time
+static void createLogRecordDescriptor(vector<Attribute> &recordDescriptor)
+{
+    addAttribute(recordDescriptor, "Time", TypeInt, 4);
+    addAttribute(recordDescriptor, "Source", TypeVarChar, 16);
+    addAttribute(recordDescriptor, "Level", TypeInt, 4);
+    addAttribute(recordDescriptor, "Latency", TypeReal, 4);
+}
+
+static int timeOf(int i) { return 1000000 + i * 3; }
+static float latencyOf(int i) { return (i * 7919 % 10007) / 10.0f; }
+
+static void prepareLogRecord(int i, void *buffer)
+{
+    char *data = (char *) buffer;
+    unsigned offset = 1;
+    data[0] = 0;
+    int time = timeOf(i), level = i % 4;
+    memcpy(data + offset, &time, sizeof(int));
+    offset += sizeof(int);
+    int length = strlen(sources[i % 5]);
+    memcpy(data + offset, &length, sizeof(int));
+    offset += sizeof(int);
+    memcpy(data + offset, sources[i % 5], length);
+    offset += length;
+    memcpy(data + offset, &level, sizeof(int));
+    offset += sizeof(int);
+    float latency = latencyOf(i);
+    memcpy(data + offset, &latency, sizeof(float));
+}
+
+// Scans for the records meeting predicate, projecting Source and Latency
+static double benchScan(RecordBasedFileManager *rbfm, FileHandle &fileHandle, const vector<Attribute> &recordDescriptor,
+                        const Predicate &predicate, int expected, unsigned &reads)
+{
+    vector<string> attributeNames;
+    attributeNames.push_back("Source");
+    attributeNames.push_back("Latency");
+
+    RID rid;
+    char returnedData[PAGE_SIZE];
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int round = 0; round < scanRounds; round++)
+    {
+        RBFM_ScanIterator rbfmScanIterator;
+        RC rc = rbfm->scan(fileHandle, recordDescriptor, predicate, attributeNames, rbfmScanIterator);
+        assert(rc == success && "Scanning the file should not fail.");
+        int count = 0;
+        while (rbfmScanIterator.getNextRecord(rid, returnedData) != RBFM_EOF)
+            count++;
+        assert(count == expected && "The scan should return the matching records.");
+        unsigned writes, appends;
+        rbfmScanIterator.collectCounterValues(reads, writes, appends);
+        rbfmScanIterator.close();
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return elapsedSeconds(start, end) * 1e9 / ((double) scanRounds * numRecords);
+}
+
+static void createBenchFile(RecordBasedFileManager *rbfm, const string &fileName, unsigned flags,
+                            const vector<Attribute> &recordDescriptor, const vector<void *> &rows, FileHandle &fileHandle)
+{
+    remove(fileName.c_str());
+    remove((fileName + RBFM_ZONE_SUFFIX).c_str());
+    RC rc = rbfm->createFile(fileName, flags);
+    assert(rc == success && "Creating the file should not fail.");
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+    vector<RID> rids;
+    rc = rbfm->insertRecords(fileHandle, recordDescriptor, &rows[0], numRecords, rids);
+    assert(rc == success && "Inserting a batch of records should not fail.");
+    if (flags & RBFM_ZONE_MAPS)
+    {
+        rc = rbfm->createZoneMap(fileHandle, recordDescriptor, "Time");
+        assert(rc == success && "Creating a zone map should not fail.");
+        rc = rbfm->createZoneMap(fileHandle, recordDescriptor, "Latency");
+        assert(rc == success && "Creating a zone map should not fail.");
+    }
+}
+
+int RBFBench_11(RecordBasedFileManager *rbfm)
+{
+    RC rc = BufferPoolManager::instance()->configure(numFrames, CLOCK_REPLACEMENT);
+    assert(rc == success && "Configuring the buffer pool should not fail.");
+
+    vector<Attribute> recordDescriptor;
+    createLogRecordDescriptor(recordDescriptor);
+    vector<void *> rows(numRecords);
+    for (int i = 0; i < numRecords; i++)
+    {
+        rows[i] = malloc(PAGE_SIZE);
+        prepareLogRecord(i, rows[i]);
+    }
+
+    const char *fileNames[] = { "bench11_plain", "bench11_zones" };
+    unsigned flags[] = { PFM_CHECKSUMS, PFM_CHECKSUMS | RBFM_ZONE_MAPS };
+    FileHandle handles[2];
+    for (int f = 0; f < 2; f++)
+        createBenchFile(rbfm, fileNames[f], flags[f], recordDescriptor, rows, handles[f]);
+    for (int i = 0; i < numRecords; i++)
+        free(rows[i]);
+
+    int firstHour = timeOf(numRecords / 100), window = timeOf(numRecords / 2), windowEnd = timeOf(numRecords / 2 + numRecords / 20);
+    int exact = timeOf(numRecords / 3);
+    float slow = 999.0f;
+    int slowCount = 0;
+    for (int i = 0; i < numRecords; i++)
+        slowCount += latencyOf(i) > slow;
+
+    vector<Predicate> predicates;
+    predicates.push_back(Predicate::compare("Time", LT_OP, &firstHour));
+    predicates.push_back(Predicate::allOf(Predicate::compare("Time", GE_OP, &window), Predicate::compare("Time", LT_OP, &windowEnd)));
+    predicates.push_back(Predicate::compare("Time", EQ_OP, &exact));
+    predicates.push_back(Predicate::compare("Latency", GT_OP, &slow));
+    predicates.push_back(Predicate::allOf(vector<Predicate>()));
+    const char *names[] = { "Time < 1%", "Time in 5%", "Time = t", "Latency > 999", "none" };
+    int expected[] = { numRecords / 100, numRecords / 20, 1, slowCount, numRecords };
+
+    cout << "Scanning " << numRecords << " log records (" << handles[0].getNumberOfPages() << " pages) for 2 of their 4 columns, "
+         << numFrames << " buffer frames" << endl;
+    cout << setw(16) << "condition" << setw(14) << "pages read" << setw(14) << "ns/rec" << setw(14) << "pages read" << setw(14) << "ns/rec" << endl;
+    cout << setw(16) << "" << setw(28) << "without zone maps" << setw(28) << "with zone maps" << endl;
+    for (unsigned i = 0; i < predicates.size(); i++)
+    {
+        unsigned reads[2];
+        double times[2];
+        for (int f = 0; f < 2; f++)
+            times[f] = benchScan(rbfm, handles[f], recordDescriptor, predicates[i], expected[i], reads[f]);
+        cout << setw(16) << names[i] << setw(14) << reads[0] << setw(14) << fixed << setprecision(1) << times[0]
+             << setw(14) << reads[1] << setw(14) << times[1] << endl;
+    }
+
+    for (int f = 0; f < 2; f++)
+    {
+        rc = rbfm->closeFile(handles[f]);
+        assert(rc == success && "Closing the file should not fail.");
+        rc = rbfm->destroyFile(fileNames[f]);
+        assert(rc == success && "Destroying the file should not fail.");
+    }
+    return 0;
+}
+
+int main()
+{
+    RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
+    return RBFBench_11(rbfm);
+}
@@ -0,0 +1,143 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <cassert>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "pfm.h"
+#include "bpm.h"
+#include "rbfm.h"
+#include "crc.h"
+#include "test_util.h"
+
+using namespace std;
+
+// Benchmark 2: cost of page checksums, on their own and in a scan
+
+const int numRecords = 30000;
+const int numRounds = 5;
+const int numCrcPages = 200000;
+
+static double elapsedSeconds(const struct timespec &start, const struct timespec &end)
+{
+    return (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+// Checksum a page over and over; returns GB/s
+static double crcThroughput(uint32_t (*crc)(const void *, size_t))
+{
+    void *page = allocPage();
+    for (unsigned i = 0; i < PAGE_SIZE; i++)
+        ((char *) page)[i] = i * 31;
+
+    struct timespec start, end;
+    uint32_t sum = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < numCrcPages; i++)
+    {
+        ((char *) page)[0] = i;
+        sum += crc(page, PAGE_SIZE - PFM_CHECKSUM_SIZE);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    freePage(page);
+
+    // Keep the loop from being optimized away
+    if (sum == 1)
+        cout << "";
+    return (double) numCrcPages * PAGE_SIZE / elapsedSeconds(start, end) / 1e9;
+}
+
+// Best of numRounds full scans; returns records/s
+double RBFBench_2(RecordBasedFileManager *rbfm, unsigned flags)
+{
+    RC rc;
+    string fileName = "bench2";
+
+    remove(fileName.c_str());
+    rc = rbfm->createFile(fileName, flags);
+    assert(rc == success && "Creating the file should not fail.");
+
+    FileHandle fileHandle;
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+    fileHandle.setDurability(DURABILITY_EXPLICIT);
+
+    vector<Attribute> recordDescriptor;
+    createRecordDescriptor(recordDescriptor);
+
+    unsigned char nullsIndicator = 0;
+    void *record = malloc(100);
+    int recordSize = 0;
+    RID rid;
+    for (int i = 0; i < numRecords; i++)
+    {
+        prepareRecord(recordDescriptor.size(), &nullsIndicator, 8, "Anteater", i, 170.1, i * 10, record, &recordSize);
+        rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+        assert(rc == success && "Inserting a record should not fail.");
+    }
+    rc = fileHandle.sync();
+    assert(rc == success && "Syncing the file should not fail.");
+
+    vector<string> attributeNames;
+    attributeNames.push_back("Age");
+
+    double best = 0;
+    for (int round = 0; round < numRounds; round++)
+    {
+        // Drop the file's pages from the buffer pool, so every page is read and verified
+        rc = rbfm->closeFile(fileHandle);
+        assert(rc == success && "Closing the file should not fail.");
+        BufferPoolManager::instance()->configure(BPM_DEFAULT_FRAMES, CLOCK_REPLACEMENT);
+        rc = rbfm->openFile(fileName, fileHandle);
+        assert(rc == success && "Opening the file should not fail.");
+
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        RBFM_ScanIterator rbfmScanIterator;
+        rc = rbfm->scan(fileHandle, recordDescriptor, "", NO_OP, NULL, attributeNames, rbfmScanIterator);
+        assert(rc == success && "Scanning the file should not fail.");
+        int scanned = 0;
+        while (rbfmScanIterator.getNextRecord(rid, record) != RBFM_EOF)
+            scanned++;
+        rbfmScanIterator.close();
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        assert(scanned == numRecords && "The scan should see every record.");
+
+        double rate = numRecords / elapsedSeconds(start, end);
+        if (rate > best)
+            best = rate;
+    }
+
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+    rc = rbfm->destroyFile(fileName);
+    assert(rc == success && "Destroying the file should not fail.");
+
+    free(record);
+    return best;
+}
+
+int main()
+{
+    RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
+
+    cout << "CRC32C of a " << PAGE_SIZE << " byte page" << endl;
+    cout << setw(24) << "instructions: " << fixed << setprecision(2);
+    if (crc32cHardware())
+        cout << crcThroughput(crc32c) << " GB/s" << endl;
+    else
+        cout << "not available" << endl;
+    cout << setw(24) << "slicing-by-8: " << crcThroughput(crc32cSoftware) << " GB/s" << endl;
+
+    cout << "Scanning " << numRecords << " records, pages read from the file" << endl;
+    double plain = RBFBench_2(rbfm, 0);
+    double checked = RBFBench_2(rbfm, PFM_CHECKSUMS);
+    cout << setprecision(0);
+    cout << setw(24) << "without checksums: " << plain << " records/s" << endl;
+    cout << setw(24) << "with checksums: " << checked << " records/s" << endl;
+    cout << setw(24) << "overhead: " << setprecision(1) << (plain / checked - 1) * 100 << "%" << endl;
+    return 0;
+}
@@ -0,0 +1,105 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <cassert>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "pfm.h"
+#include "rbfm.h"
+#include "test_util.h"
+
+using namespace std;
+
+// Benchmark 3: loading a table one record at a time against one batch
+
+const int numRecords = 30000;
+
+static double elapsedSeconds(const struct timespec &start, const struct timespec &end)
+{
+    return (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+int RBFBench_3(RecordBasedFileManager *rbfm, DurabilityMode mode, bool batch, const string &name)
+{
+    RC rc;
+    string fileName = "bench3";
+
+    remove(fileName.c_str());
+    rc = rbfm->createFile(fileName);
+    assert(rc == success && "Creating the file should not fail.");
+
+    FileHandle fileHandle;
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+
+    rc = fileHandle.setDurability(mode);
+    assert(rc == success && "Setting the durability mode should not fail.");
+
+    vector<Attribute> recordDescriptor;
+    createRecordDescriptor(recordDescriptor);
+
+    unsigned char nullsIndicator = 0;
+    vector<void *> rows(numRecords);
+    int recordSize = 0;
+    for (int i = 0; i < numRecords; i++)
+    {
+        rows[i] = malloc(100);
+        prepareRecord(recordDescriptor.size(), &nullsIndicator, 8, "Anteater", i, 170.1, i * 10, rows[i], &recordSize);
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (batch)
+    {
+        vector<RID> rids;
+        rc = rbfm->insertRecords(fileHandle, recordDescriptor, &rows[0], numRecords, rids);
+        assert(rc == success && "Inserting a batch of records should not fail.");
+    }
+    else
+    {
+        RID rid;
+        for (int i = 0; i < numRecords; i++)
+        {
+            rc = rbfm->insertRecord(fileHandle, recordDescriptor, rows[i], rid);
+            assert(rc == success && "Inserting a record should not fail.");
+        }
+    }
+    // Closing makes every mode durable, so it is part of the measured work
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    unsigned readPageCount, writePageCount, appendPageCount;
+    fileHandle.collectCounterValues(readPageCount, writePageCount, appendPageCount);
+
+    double seconds = elapsedSeconds(start, end);
+    cout << setw(18) << name
+         << setw(14) << fixed << setprecision(0) << numRecords / seconds
+         << setw(12) << setprecision(3) << seconds * 1000
+         << setw(10) << writePageCount
+         << setw(10) << appendPageCount << endl;
+
+    rc = rbfm->destroyFile(fileName);
+    assert(rc == success && "Destroying the file should not fail.");
+
+    for (int i = 0; i < numRecords; i++)
+        free(rows[i]);
+    return 0;
+}
+
+int main()
+{
+    RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
+
+    cout << "Inserting " << numRecords << " records" << endl;
+    cout << setw(18) << "path" << setw(14) << "inserts/s" << setw(12) << "ms" << setw(10) << "writes" << setw(10) << "appends" << endl;
+
+    RBFBench_3(rbfm, DURABILITY_IMMEDIATE, false, "single IMMEDIATE");
+    RBFBench_3(rbfm, DURABILITY_IMMEDIATE, true, "batch IMMEDIATE");
+    RBFBench_3(rbfm, DURABILITY_EXPLICIT, false, "single EXPLICIT");
+    RBFBench_3(rbfm, DURABILITY_EXPLICIT, true, "batch EXPLICIT");
+    return 0;
+}
@@ -0,0 +1,118 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <cassert>
+#include <algorithm>
+#include <random>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "pfm.h"
+#include "bpm.h"
+#include "rbfm.h"
+#include "test_util.h"
+
+using namespace std;
+
+// Benchmark 4: CPU per operation under delete-heavy churn.
+// Small records, many to a page, deleted in random order so most of them are not the last
+// record packed on their page; then half the space is filled again and everything deleted.
+
+const int numRecords = 200000;
+const unsigned numFrames = 4096;    // The whole file stays cached
+
+static double cpuSeconds()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static void report(const string &phase, int ops, double seconds)
+{
+    cout << setw(24) << phase << setw(10) << ops
+         << setw(14) << fixed << setprecision(0) << seconds * 1e9 / ops << endl;
+}
+
+int RBFBench_4(RecordBasedFileManager *rbfm)
+{
+    RC rc;
+    string fileName = "bench4";
+
+    rc = BufferPoolManager::instance()->configure(numFrames, CLOCK_REPLACEMENT);
+    assert(rc == success && "Configuring the buffer pool should not fail.");
+
+    remove(fileName.c_str());
+    rc = rbfm->createFile(fileName);
+    assert(rc == success && "Creating the file should not fail.");
+
+    FileHandle fileHandle;
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+
+    // Keep the disk out of the measurement
+    rc = fileHandle.setDurability(DURABILITY_EXPLICIT);
+    assert(rc == success && "Setting the durability mode should not fail.");
+
+    vector<Attribute> recordDescriptor;
+    createRecordDescriptor(recordDescriptor);
+
+    unsigned char nullsIndicator = 0;
+    void *record = malloc(100);
+    int recordSize = 0;
+    prepareRecord(recordDescriptor.size(), &nullsIndicator, 8, "Anteater", 25, 170.1, 1000, record, &recordSize);
+    vector<const void *> rows(numRecords, record);
+    vector<RID> rids;
+    rc = rbfm->insertRecords(fileHandle, recordDescriptor, &rows[0], numRecords, rids);
+    assert(rc == success && "Inserting a batch of records should not fail.");
+
+    mt19937 generator(4);
+    shuffle(rids.begin(), rids.end(), generator);
+
+    // Delete half the records
+    int half = numRecords / 2;
+    double start = cpuSeconds();
+    for (int i = 0; i < half; i++)
+    {
+        rc = rbfm->deleteRecord(fileHandle, recordDescriptor, rids[i]);
+        assert(rc == success && "Deleting a record should not fail.");
+    }
+    report("delete half", half, cpuSeconds() - start);
+
+    // Fill the holes again
+    start = cpuSeconds();
+    for (int i = 0; i < half; i++)
+    {
+        rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rids[i]);
+        assert(rc == success && "Inserting a record should not fail.");
+    }
+    report("insert into holes", half, cpuSeconds() - start);
+
+    // Delete everything
+    shuffle(rids.begin(), rids.end(), generator);
+    start = cpuSeconds();
+    for (int i = 0; i < numRecords; i++)
+    {
+        rc = rbfm->deleteRecord(fileHandle, recordDescriptor, rids[i]);
+        assert(rc == success && "Deleting a record should not fail.");
+    }
+    report("delete all", numRecords, cpuSeconds() - start);
+
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+    rc = rbfm->destroyFile(fileName);
+    assert(rc == success && "Destroying the file should not fail.");
+
+    free(record);
+    return 0;
+}
+
+int main()
+{
+    RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
+
+    cout << setw(24) << "phase" << setw(10) << "ops" << setw(14) << "CPU ns/op" << endl;
+    return RBFBench_4(rbfm);
+}
@@ -0,0 +1,148 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <cassert>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "pfm.h"
+#include "bpm.h"
+#include "rbfm.h"
+#include "filter.h"
+#include "test_util.h"
+
+using namespace std;
+
+// Benchmark 5: scans with selective and non-selective Int and Real conditions, and the
+// predicate kernels on their own
+
+const int numRecords = 500000;
+const unsigned numFrames = 8192;    // The whole file stays cached
+const unsigned columnSize = 1 << 20;
+const int kernelRounds = 50;
+
+static double elapsedSeconds(const struct timespec &start, const struct timespec &end)
+{
+    return (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+static void benchScan(RecordBasedFileManager *rbfm, FileHandle &fileHandle, const vector<Attribute> &recordDescriptor,
+                      const string &name, const string &attribute, CompOp compOp, const void *value)
+{
+    vector<string> attributeNames;
+    attributeNames.push_back("Salary");
+    RBFM_ScanIterator rbfmScanIterator;
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    RC rc = rbfm->scan(fileHandle, recordDescriptor, attribute, compOp, value, attributeNames, rbfmScanIterator);
+    assert(rc == success && "Scanning the file should not fail.");
+    RID rid;
+    char returnedData[1 + INT_SIZE];
+    int count = 0;
+    while (rbfmScanIterator.getNextRecord(rid, returnedData) != RBFM_EOF)
+        count++;
+    rbfmScanIterator.close();
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    double seconds = elapsedSeconds(start, end);
+    cout << setw(20) << name << setw(10) << count
+         << setw(12) << fixed << setprecision(2) << seconds * 1000
+         << setw(14) << setprecision(0) << numRecords / seconds << endl;
+}
+
+static void benchKernel(const string &name, bool real, bool vector, const int32_t *ints, const float *reals, uint64_t *selection)
+{
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int round = 0; round < kernelRounds; round++)
+    {
+        if (real)
+            (vector ? selectReal : selectRealScalar)(reals, columnSize, LT_OP, 50.0f, selection);
+        else
+            (vector ? selectInt : selectIntScalar)(ints, columnSize, LT_OP, round, selection);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double seconds = elapsedSeconds(start, end);
+    cout << setw(20) << name << setw(14) << fixed << setprecision(2)
+         << seconds * 1e9 / ((double) kernelRounds * columnSize) << endl;
+}
+
+int RBFBench_5(RecordBasedFileManager *rbfm)
+{
+    RC rc;
+    string fileName = "bench5";
+
+    rc = BufferPoolManager::instance()->configure(numFrames, CLOCK_REPLACEMENT);
+    assert(rc == success && "Configuring the buffer pool should not fail.");
+
+    remove(fileName.c_str());
+    rc = rbfm->createFile(fileName);
+    assert(rc == success && "Creating the file should not fail.");
+
+    FileHandle fileHandle;
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+
+    vector<Attribute> recordDescriptor;
+    createRecordDescriptor(recordDescriptor);
+
+    // Age and Height run 0 to 99 across the records
+    unsigned char nullsIndicator = 0;
+    vector<void *> rows(numRecords);
+    int recordSize = 0;
+    for (int i = 0; i < numRecords; i++)
+    {
+        rows[i] = malloc(100);
+        prepareRecord(recordDescriptor.size(), &nullsIndicator, 8, "Anteater", i % 100, i % 100, i, rows[i], &recordSize);
+    }
+    vector<RID> rids;
+    rc = rbfm->insertRecords(fileHandle, recordDescriptor, &rows[0], numRecords, rids);
+    assert(rc == success && "Inserting a batch of records should not fail.");
+    for (int i = 0; i < numRecords; i++)
+        free(rows[i]);
+
+    cout << "Scanning " << numRecords << " records, predicate kernels: " << selectKernel() << endl;
+    cout << setw(20) << "condition" << setw(10) << "matches" << setw(12) << "ms" << setw(14) << "records/s" << endl;
+    int one = 1;
+    float oneReal = 1.0f;
+    // The first scan also warms up the buffer pool
+    benchScan(rbfm, fileHandle, recordDescriptor, "no condition", "", NO_OP, NULL);
+    benchScan(rbfm, fileHandle, recordDescriptor, "no condition", "", NO_OP, NULL);
+    benchScan(rbfm, fileHandle, recordDescriptor, "Age < 1", "Age", LT_OP, &one);
+    benchScan(rbfm, fileHandle, recordDescriptor, "Age >= 1", "Age", GE_OP, &one);
+    benchScan(rbfm, fileHandle, recordDescriptor, "Height < 1.0", "Height", LT_OP, &oneReal);
+    benchScan(rbfm, fileHandle, recordDescriptor, "Height >= 1.0", "Height", GE_OP, &oneReal);
+
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+    rc = rbfm->destroyFile(fileName);
+    assert(rc == success && "Destroying the file should not fail.");
+
+    // The kernels alone, over a column far larger than a page
+    int32_t *ints = (int32_t *) malloc(columnSize * sizeof(int32_t));
+    float *reals = (float *) malloc(columnSize * sizeof(float));
+    uint64_t *selection = (uint64_t *) malloc(columnSize / 8);
+    for (unsigned i = 0; i < columnSize; i++)
+    {
+        ints[i] = i % 100;
+        reals[i] = i % 100;
+    }
+    cout << endl << setw(20) << "kernel" << setw(14) << "ns/value" << endl;
+    benchKernel(string("Int ") + selectKernel(), false, true, ints, reals, selection);
+    benchKernel("Int scalar", false, false, ints, reals, selection);
+    benchKernel(string("Real ") + selectKernel(), true, true, ints, reals, selection);
+    benchKernel("Real scalar", true, false, ints, reals, selection);
+    free(ints);
+    free(reals);
+    free(selection);
+    return 0;
+}
+
+int main()
+{
+    RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
+    return RBFBench_5(rbfm);
+}
@@ -0,0 +1,161 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <cassert>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "pfm.h"
+#include "bpm.h"
+#include "rbfm.h"
+#include "test_util.h"
+
+using namespace std;
+
+// Benchmark 6: scans of a 30-column table projecting 1, 5 and 20 columns
+
+const int numRecords = 200000;
+const unsigned numColumns = 30;
+const unsigned numFrames = 16384;    // The whole file stays cached
+const int scanRounds = 5;
+
+static double elapsedSeconds(const struct timespec &start, const struct timespec &end)
+{
+    return (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+// Every third column is a VarChar of up to 8 characters, the rest alternate Int and Real
+static void createWideRecordDescriptor(vector<Attribute> &recordDescriptor)
+{
+    for (unsigned i = 0; i < numColumns; i++)
+    {
+        Attribute attr;
+        attr.name = "C" + to_string(i);
+        if (i % 3 == 2)
+        {
+            attr.type = TypeVarChar;
+            attr.length = (AttrLength) 8;
+        }
+        else
+        {
+            attr.type = i % 3 == 0 ? TypeInt : TypeReal;
+            attr.length = (AttrLength) 4;
+        }
+        recordDescriptor.push_back(attr);
+    }
+}
+
+static void prepareWideRecord(int i, void *buffer)
+{
+    char *data = (char *) buffer;
+    unsigned nullIndicatorSize = (numColumns + CHAR_BIT - 1) / CHAR_BIT;
+    memset(data, 0, nullIndicatorSize);
+    unsigned offset = nullIndicatorSize;
+    for (unsigned column = 0; column < numColumns; column++)
+    {
+        if (column % 3 == 2)
+        {
+            int length = 1 + (i + column) % 8;
+            memcpy(data + offset, &length, sizeof(int));
+            memset(data + offset + sizeof(int), 'a' + column % 26, length);
+            offset += sizeof(int) + length;
+        }
+        else if (column % 3 == 0)
+        {
+            int value = i + column;
+            memcpy(data + offset, &value, sizeof(int));
+            offset += sizeof(int);
+        }
+        else
+        {
+            float value = i * 0.5f + column;
+            memcpy(data + offset, &value, sizeof(float));
+            offset += sizeof(float);
+        }
+    }
+}
+
+static void benchProjection(RecordBasedFileManager *rbfm, FileHandle &fileHandle, const vector<Attribute> &recordDescriptor,
+                            unsigned columns)
+{
+    // Columns spread over the whole record
+    vector<string> attributeNames;
+    for (unsigned i = 0; i < columns; i++)
+        attributeNames.push_back(recordDescriptor[i * numColumns / columns].name);
+
+    RID rid;
+    char returnedData[PAGE_SIZE];
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int round = 0; round < scanRounds; round++)
+    {
+        RBFM_ScanIterator rbfmScanIterator;
+        RC rc = rbfm->scan(fileHandle, recordDescriptor, "", NO_OP, NULL, attributeNames, rbfmScanIterator);
+        assert(rc == success && "Scanning the file should not fail.");
+        int count = 0;
+        while (rbfmScanIterator.getNextRecord(rid, returnedData) != RBFM_EOF)
+            count++;
+        assert(count == numRecords && "The scan should return every record.");
+        rbfmScanIterator.close();
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    double seconds = elapsedSeconds(start, end);
+    cout << setw(10) << columns << setw(14) << fixed << setprecision(1)
+         << seconds * 1e9 / ((double) scanRounds * numRecords) << endl;
+}
+
+int RBFBench_6(RecordBasedFileManager *rbfm)
+{
+    RC rc;
+    string fileName = "bench6";
+
+    rc = BufferPoolManager::instance()->configure(numFrames, CLOCK_REPLACEMENT);
+    assert(rc == success && "Configuring the buffer pool should not fail.");
+
+    remove(fileName.c_str());
+    rc = rbfm->createFile(fileName);
+    assert(rc == success && "Creating the file should not fail.");
+
+    FileHandle fileHandle;
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+
+    vector<Attribute> recordDescriptor;
+    createWideRecordDescriptor(recordDescriptor);
+
+    vector<void *> rows(numRecords);
+    for (int i = 0; i < numRecords; i++)
+    {
+        rows[i] = malloc(PAGE_SIZE);
+        prepareWideRecord(i, rows[i]);
+    }
+    vector<RID> rids;
+    rc = rbfm->insertRecords(fileHandle, recordDescriptor, &rows[0], numRecords, rids);
+    assert(rc == success && "Inserting a batch of records should not fail.");
+    for (int i = 0; i < numRecords; i++)
+        free(rows[i]);
+
+    cout << "Scanning " << numRecords << " records of " << numColumns << " columns" << endl;
+    cout << setw(10) << "columns" << setw(14) << "ns/record" << endl;
+    // The first scan also warms up the buffer pool
+    benchProjection(rbfm, fileHandle, recordDescriptor, numColumns);
+    benchProjection(rbfm, fileHandle, recordDescriptor, 1);
+    benchProjection(rbfm, fileHandle, recordDescriptor, 5);
+    benchProjection(rbfm, fileHandle, recordDescriptor, 20);
+    benchProjection(rbfm, fileHandle, recordDescriptor, numColumns);
+
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+    rc = rbfm->destroyFile(fileName);
+    assert(rc == success && "Destroying the file should not fail.");
+    return 0;
+}
+
+int main()
+{
+    RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
+    return RBFBench_6(rbfm);
+}
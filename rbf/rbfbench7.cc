@@ -0,0 +1,136 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <cassert>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "pfm.h"
+#include "bpm.h"
+#include "rbfm.h"
+#include "test_util.h"
+
+using namespace std;
+
+// Benchmark 7: scans with equality and range conditions on a VarChar(50)
+
+const int numRecords = 500000;
+const unsigned numFrames = 16384;    // The whole file stays cached
+const int scanRounds = 5;
+
+static double elapsedSeconds(const struct timespec &start, const struct timespec &end)
+{
+    return (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+// Record i's name: a number that scatters i, padded out to 20 to 50 characters
+static string benchName(int i, const string &stem)
+{
+    char number[16];
+    sprintf(number, "%08u", (unsigned) (i * 2654435761u) % 100000000);
+    return stem + number + string(20 + i % 31 - stem.size() - 8, 'x');
+}
+
+static void benchScan(RecordBasedFileManager *rbfm, FileHandle &fileHandle, const vector<Attribute> &recordDescriptor,
+                      const string &name, CompOp compOp, const string &value)
+{
+    vector<string> attributeNames;
+    attributeNames.push_back("Id");
+    char condition[VARCHAR_LENGTH_SIZE + 50];
+    uint32_t length = value.size();
+    memcpy(condition, &length, VARCHAR_LENGTH_SIZE);
+    memcpy(condition + VARCHAR_LENGTH_SIZE, value.data(), length);
+
+    RID rid;
+    char returnedData[1 + INT_SIZE];
+    int count = 0;
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int round = 0; round < scanRounds; round++)
+    {
+        RBFM_ScanIterator rbfmScanIterator;
+        RC rc = rbfm->scan(fileHandle, recordDescriptor, "Name", compOp, condition, attributeNames, rbfmScanIterator);
+        assert(rc == success && "Scanning the file should not fail.");
+        count = 0;
+        while (rbfmScanIterator.getNextRecord(rid, returnedData) != RBFM_EOF)
+            count++;
+        rbfmScanIterator.close();
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    double seconds = elapsedSeconds(start, end) / scanRounds;
+    cout << setw(28) << name << setw(10) << count
+         << setw(12) << fixed << setprecision(2) << seconds * 1000
+         << setw(14) << setprecision(0) << numRecords / seconds << endl;
+}
+
+int RBFBench_7(RecordBasedFileManager *rbfm)
+{
+    RC rc;
+    string fileName = "bench7";
+
+    rc = BufferPoolManager::instance()->configure(numFrames, CLOCK_REPLACEMENT);
+    assert(rc == success && "Configuring the buffer pool should not fail.");
+
+    remove(fileName.c_str());
+    rc = rbfm->createFile(fileName);
+    assert(rc == success && "Creating the file should not fail.");
+
+    FileHandle fileHandle;
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+
+    // Id, then Name as a VarChar(50); half the names share a 9 character stem
+    vector<Attribute> recordDescriptor;
+    Attribute attr;
+    attr.name = "Id";
+    attr.type = TypeInt;
+    attr.length = (AttrLength) 4;
+    recordDescriptor.push_back(attr);
+    attr.name = "Name";
+    attr.type = TypeVarChar;
+    attr.length = (AttrLength) 50;
+    recordDescriptor.push_back(attr);
+
+    vector<void *> rows(numRecords);
+    for (int i = 0; i < numRecords; i++)
+    {
+        string name = benchName(i, i % 2 ? "customer-" : "");
+        uint32_t length = name.size();
+        char *row = (char *) malloc(1 + INT_SIZE + VARCHAR_LENGTH_SIZE + length);
+        row[0] = 0;
+        memcpy(row + 1, &i, INT_SIZE);
+        memcpy(row + 1 + INT_SIZE, &length, VARCHAR_LENGTH_SIZE);
+        memcpy(row + 1 + INT_SIZE + VARCHAR_LENGTH_SIZE, name.data(), length);
+        rows[i] = row;
+    }
+    vector<RID> rids;
+    rc = rbfm->insertRecords(fileHandle, recordDescriptor, &rows[0], numRecords, rids);
+    assert(rc == success && "Inserting a batch of records should not fail.");
+    for (int i = 0; i < numRecords; i++)
+        free(rows[i]);
+
+    cout << "Scanning " << numRecords << " records" << endl;
+    cout << setw(28) << "condition" << setw(10) << "matches" << setw(12) << "ms" << setw(14) << "records/s" << endl;
+    // The first scan also warms up the buffer pool
+    benchScan(rbfm, fileHandle, recordDescriptor, "Name = (no match)", EQ_OP, "none");
+    benchScan(rbfm, fileHandle, recordDescriptor, "Name = name of 1000", EQ_OP, benchName(1000, ""));
+    benchScan(rbfm, fileHandle, recordDescriptor, "Name = name of 1001", EQ_OP, benchName(1001, "customer-"));
+    benchScan(rbfm, fileHandle, recordDescriptor, "Name < \"1\"", LT_OP, "1");
+    benchScan(rbfm, fileHandle, recordDescriptor, "Name >= \"5\"", GE_OP, "5");
+    benchScan(rbfm, fileHandle, recordDescriptor, "Name < \"customer-1\"", LT_OP, "customer-1");
+
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+    rc = rbfm->destroyFile(fileName);
+    assert(rc == success && "Destroying the file should not fail.");
+    return 0;
+}
+
+int main()
+{
+    RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
+    return RBFBench_7(rbfm);
+}
@@ -0,0 +1,131 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <cassert>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "pfm.h"
+#include "bpm.h"
+#include "rbfm.h"
+#include "test_util.h"
+
+using namespace std;
+
+// Benchmark 8: predicate tree scans, with the terms of an AND written in the worst and the
+// best order. The scan reorders them by how often they pass, so both should cost about the same.
+
+const int numRecords = 500000;
+const unsigned numFrames = 8192;    // The whole file stays cached
+const int scanRounds = 5;
+
+static double elapsedSeconds(const struct timespec &start, const struct timespec &end)
+{
+    return (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+static void benchScan(RecordBasedFileManager *rbfm, FileHandle &fileHandle, const vector<Attribute> &recordDescriptor,
+                      const string &name, const Predicate &predicate)
+{
+    vector<string> attributeNames;
+    attributeNames.push_back("Salary");
+
+    RID rid;
+    char returnedData[1 + INT_SIZE];
+    int count = 0;
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int round = 0; round < scanRounds; round++)
+    {
+        RBFM_ScanIterator rbfmScanIterator;
+        RC rc = rbfm->scan(fileHandle, recordDescriptor, predicate, attributeNames, rbfmScanIterator);
+        assert(rc == success && "Scanning the file should not fail.");
+        count = 0;
+        while (rbfmScanIterator.getNextRecord(rid, returnedData) != RBFM_EOF)
+            count++;
+        rbfmScanIterator.close();
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    double seconds = elapsedSeconds(start, end) / scanRounds;
+    cout << setw(36) << name << setw(10) << count
+         << setw(12) << fixed << setprecision(2) << seconds * 1000
+         << setw(14) << setprecision(0) << numRecords / seconds << endl;
+}
+
+int RBFBench_8(RecordBasedFileManager *rbfm)
+{
+    RC rc;
+    string fileName = "bench8";
+
+    rc = BufferPoolManager::instance()->configure(numFrames, CLOCK_REPLACEMENT);
+    assert(rc == success && "Configuring the buffer pool should not fail.");
+
+    remove(fileName.c_str());
+    rc = rbfm->createFile(fileName);
+    assert(rc == success && "Creating the file should not fail.");
+
+    FileHandle fileHandle;
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+
+    vector<Attribute> recordDescriptor;
+    createRecordDescriptor(recordDescriptor);
+
+    // Age and Height run 0 to 99 across the records, names are 1 to 8 characters
+    unsigned char nullsIndicator = 0;
+    vector<void *> rows(numRecords);
+    int recordSize = 0;
+    for (int i = 0; i < numRecords; i++)
+    {
+        rows[i] = malloc(100);
+        prepareRecord(recordDescriptor.size(), &nullsIndicator, 1 + i % 8, string(1 + i % 8, 'a' + i % 26),
+                      i % 100, i % 100, i, rows[i], &recordSize);
+    }
+    vector<RID> rids;
+    rc = rbfm->insertRecords(fileHandle, recordDescriptor, &rows[0], numRecords, rids);
+    assert(rc == success && "Inserting a batch of records should not fail.");
+    for (int i = 0; i < numRecords; i++)
+        free(rows[i]);
+
+    // Terms that pass for nearly every record, and one that passes for 1 in 100
+    int zero = 0, one = 1;
+    float zeroReal = 0.0f;
+    char empty[VARCHAR_LENGTH_SIZE] = { 0 };
+    vector<Predicate> common;
+    common.push_back(Predicate::compare("EmpName", GT_OP, empty));
+    common.push_back(Predicate::compare("Height", GE_OP, &zeroReal));
+    common.push_back(Predicate::compare("Salary", GE_OP, &zero));
+    common.push_back(Predicate::isNotNull("Age"));
+    Predicate rare = Predicate::compare("Age", LT_OP, &one);
+
+    vector<Predicate> worst(common);
+    worst.push_back(rare);
+    vector<Predicate> best(1, rare);
+    best.insert(best.end(), common.begin(), common.end());
+
+    cout << "Scanning " << numRecords << " records" << endl;
+    cout << setw(36) << "condition" << setw(10) << "matches" << setw(12) << "ms" << setw(14) << "records/s" << endl;
+    // The first scan also warms up the buffer pool
+    benchScan(rbfm, fileHandle, recordDescriptor, "none", Predicate::allOf(vector<Predicate>()));
+    benchScan(rbfm, fileHandle, recordDescriptor, "none", Predicate::allOf(vector<Predicate>()));
+    benchScan(rbfm, fileHandle, recordDescriptor, "Age < 1 alone", rare);
+    benchScan(rbfm, fileHandle, recordDescriptor, "AND, Age < 1 written last", Predicate::allOf(worst));
+    benchScan(rbfm, fileHandle, recordDescriptor, "AND, Age < 1 written first", Predicate::allOf(best));
+    benchScan(rbfm, fileHandle, recordDescriptor, "OR, Age < 1 written first",
+              Predicate::negate(Predicate::anyOf(Predicate::negate(rare), Predicate::negate(Predicate::allOf(common)))));
+
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+    rc = rbfm->destroyFile(fileName);
+    assert(rc == success && "Destroying the file should not fail.");
+    return 0;
+}
+
+int main()
+{
+    RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
+    return RBFBench_8(rbfm);
+}
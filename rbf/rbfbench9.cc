@@ -0,0 +1,173 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <cassert>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "pfm.h"
+#include "bpm.h"
+#include "rbfm.h"
+#include "test_util.h"
+
+using namespace std;
+
+// Benchmark 9: scans touching 2 of 30 columns, of a file of row pages and one of PAX pages
+
+const int numRecords = 200000;
+const unsigned numColumns = 30;
+const unsigned numFrames = 32768;    // Both files stay cached
+const int scanRounds = 5;
+
+static double elapsedSeconds(const struct timespec &start, const struct timespec &end)
+{
+    return (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+// Every third column is a VarChar of up to 8 characters, the rest alternate Int and Real
+static void createWideRecordDescriptor(vector<Attribute> &recordDescriptor)
+{
+    for (unsigned i = 0; i < numColumns; i++)
+    {
+        Attribute attr;
+        attr.name = "C" + to_string(i);
+        if (i % 3 == 2)
+        {
+            attr.type = TypeVarChar;
+            attr.length = (AttrLength) 8;
+        }
+        else
+        {
+            attr.type = i % 3 == 0 ? TypeInt : TypeReal;
+            attr.length = (AttrLength) 4;
+        }
+        recordDescriptor.push_back(attr);
+    }
+}
+
+static void prepareWideRecord(int i, void *buffer)
+{
+    char *data = (char *) buffer;
+    unsigned nullIndicatorSize = (numColumns + CHAR_BIT - 1) / CHAR_BIT;
+    memset(data, 0, nullIndicatorSize);
+    unsigned offset = nullIndicatorSize;
+    for (unsigned column = 0; column < numColumns; column++)
+    {
+        if (column % 3 == 2)
+        {
+            int length = 1 + (i + column) % 8;
+            memcpy(data + offset, &length, sizeof(int));
+            memset(data + offset + sizeof(int), 'a' + column % 26, length);
+            offset += sizeof(int) + length;
+        }
+        else if (column % 3 == 0)
+        {
+            int value = i + column;
+            memcpy(data + offset, &value, sizeof(int));
+            offset += sizeof(int);
+        }
+        else
+        {
+            float value = i * 0.5f + column;
+            memcpy(data + offset, &value, sizeof(float));
+            offset += sizeof(float);
+        }
+    }
+}
+
+// Scans for the records whose C0 is below limit, projecting C3 and C17
+static double benchScan(RecordBasedFileManager *rbfm, FileHandle &fileHandle, const vector<Attribute> &recordDescriptor,
+                        CompOp compOp, int limit, int expected)
+{
+    vector<string> attributeNames;
+    attributeNames.push_back("C3");
+    attributeNames.push_back("C17");
+
+    RID rid;
+    char returnedData[PAGE_SIZE];
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int round = 0; round < scanRounds; round++)
+    {
+        RBFM_ScanIterator rbfmScanIterator;
+        RC rc = rbfm->scan(fileHandle, recordDescriptor, "C0", compOp, &limit, attributeNames, rbfmScanIterator);
+        assert(rc == success && "Scanning the file should not fail.");
+        int count = 0;
+        while (rbfmScanIterator.getNextRecord(rid, returnedData) != RBFM_EOF)
+            count++;
+        assert(count == expected && "The scan should return the matching records.");
+        rbfmScanIterator.close();
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return elapsedSeconds(start, end) * 1e9 / ((double) scanRounds * numRecords);
+}
+
+static void createBenchFile(RecordBasedFileManager *rbfm, const string &fileName, unsigned flags,
+                            const vector<Attribute> &recordDescriptor, const vector<void *> &rows, FileHandle &fileHandle)
+{
+    remove(fileName.c_str());
+    RC rc = rbfm->createFile(fileName, flags);
+    assert(rc == success && "Creating the file should not fail.");
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+    vector<RID> rids;
+    rc = rbfm->insertRecords(fileHandle, recordDescriptor, &rows[0], numRecords, rids);
+    assert(rc == success && "Inserting a batch of records should not fail.");
+}
+
+int RBFBench_9(RecordBasedFileManager *rbfm)
+{
+    RC rc = BufferPoolManager::instance()->configure(numFrames, CLOCK_REPLACEMENT);
+    assert(rc == success && "Configuring the buffer pool should not fail.");
+
+    vector<Attribute> recordDescriptor;
+    createWideRecordDescriptor(recordDescriptor);
+    vector<void *> rows(numRecords);
+    for (int i = 0; i < numRecords; i++)
+    {
+        rows[i] = malloc(PAGE_SIZE);
+        prepareWideRecord(i, rows[i]);
+    }
+
+    FileHandle rowHandle, paxHandle;
+    createBenchFile(rbfm, "bench9_rows", PFM_CHECKSUMS, recordDescriptor, rows, rowHandle);
+    createBenchFile(rbfm, "bench9_pax", PFM_CHECKSUMS | RBFM_PAX, recordDescriptor, rows, paxHandle);
+    for (int i = 0; i < numRecords; i++)
+        free(rows[i]);
+
+    cout << "Scanning " << numRecords << " records of " << numColumns << " columns for 2 of them" << endl;
+    cout << "Pages: " << rowHandle.getNumberOfPages() << " row, " << paxHandle.getNumberOfPages() << " PAX" << endl;
+    cout << setw(14) << "condition" << setw(14) << "row ns/rec" << setw(14) << "PAX ns/rec" << endl;
+    // The first scans also warm up the buffer pool
+    benchScan(rbfm, rowHandle, recordDescriptor, NO_OP, 0, numRecords);
+    benchScan(rbfm, paxHandle, recordDescriptor, NO_OP, 0, numRecords);
+    int limits[] = { numRecords / 100, numRecords / 10, numRecords };
+    const char *names[] = { "C0 < 1%", "C0 < 10%", "C0 < 100%" };
+    for (unsigned i = 0; i < sizeof(limits) / sizeof(limits[0]); i++)
+    {
+        double row = benchScan(rbfm, rowHandle, recordDescriptor, LT_OP, limits[i], limits[i]);
+        double pax = benchScan(rbfm, paxHandle, recordDescriptor, LT_OP, limits[i], limits[i]);
+        cout << setw(14) << names[i] << setw(14) << fixed << setprecision(1) << row << setw(14) << pax << endl;
+    }
+    double row = benchScan(rbfm, rowHandle, recordDescriptor, NO_OP, 0, numRecords);
+    double pax = benchScan(rbfm, paxHandle, recordDescriptor, NO_OP, 0, numRecords);
+    cout << setw(14) << "none" << setw(14) << fixed << setprecision(1) << row << setw(14) << pax << endl;
+
+    rc = rbfm->closeFile(rowHandle);
+    assert(rc == success && "Closing the file should not fail.");
+    rc = rbfm->closeFile(paxHandle);
+    assert(rc == success && "Closing the file should not fail.");
+    rc = rbfm->destroyFile("bench9_rows");
+    assert(rc == success && "Destroying the file should not fail.");
+    rc = rbfm->destroyFile("bench9_pax");
+    assert(rc == success && "Destroying the file should not fail.");
+    return 0;
+}
+
+int main()
+{
+    RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
+    return RBFBench_9(rbfm);
+}
@@ -6,8 +6,11 @@
 #include <iomanip>
 #include <iostream>
 #include <string>
+#include <unordered_set>
+#include <unistd.h>
 
 #include "rbfm.h"
+#include "filter.h"
 
 RecordBasedFileManager* RecordBasedFileManager::_rbf_manager = NULL;
 PagedFileManager *RecordBasedFileManager::_pf_manager = NULL;
@@ -30,39 +33,68 @@ RecordBasedFileManager::~RecordBasedFileManager()
 {
 }
 
-RC RecordBasedFileManager::createFile(const string &fileName) 
+RC RecordBasedFileManager::createFile(const string &fileName, unsigned flags) 
 {
     // Creating a new paged file.
-    if (_pf_manager->createFile(fileName))
+    if (_pf_manager->createFile(fileName, flags))
         return RBFM_CREATE_FAILED;
 
-    // Setting up the first page.
-    void * firstPageData = calloc(PAGE_SIZE, 1);
+    // Setting up the first page. PAX pages are laid out by their first record.
+    bool pax = (flags & (RBFM_PAX | RBFM_COMPRESSED)) != 0;
+    void * firstPageData = allocPage();
     if (firstPageData == NULL)
         return RBFM_MALLOC_FAILED;
-    newRecordBasedPage(firstPageData);
+    if (pax)
+        memset(firstPageData, 0, PAGE_SIZE);
+    else
+        newRecordBasedPage(firstPageData);
 
-    // Adds the first record based page.
+    // The free-space map root and first leaf, both knowing about the first page.
+    void * mapPageData = allocPage();
+    if (mapPageData == NULL)
+    {
+        freePage(firstPageData);
+        return RBFM_MALLOC_FAILED;
+    }
+    *(unsigned char *) mapPageData = getFreeSpaceBucket(firstPageData, pax);
+
+    // Adds the map pages and the first record based page.
     FileHandle handle;
     if (_pf_manager->openFile(fileName.c_str(), handle))
         return RBFM_OPEN_FAILED;
-    if (handle.appendPage(firstPageData))
+    if (handle.appendPage(mapPageData) || handle.appendPage(mapPageData) || handle.appendPage(firstPageData))
         return RBFM_APPEND_FAILED;
     _pf_manager->closeFile(handle);
 
-    free(firstPageData);
+    freePage(mapPageData);
+    freePage(firstPageData);
+
+    // The zone maps have a file of their own, see rbfm.h
+    if ((flags & RBFM_ZONE_MAPS) && createZoneMapFile(fileName, flags))
+    {
+        _pf_manager->destroyFile(fileName);
+        return RBFM_CREATE_FAILED;
+    }
 
     return SUCCESS;
 }
 
 RC RecordBasedFileManager::destroyFile(const string &fileName) 
 {
-    return _pf_manager->destroyFile(fileName);
+    RC rc = _pf_manager->destroyFile(fileName);
+    string zoneFileName = fileName + RBFM_ZONE_SUFFIX;
+    if (rc == SUCCESS && access(zoneFileName.c_str(), F_OK) == 0)
+        rc = _pf_manager->destroyFile(zoneFileName);
+    return rc;
 }
 
-RC RecordBasedFileManager::openFile(const string &fileName, FileHandle &fileHandle) 
+RC RecordBasedFileManager::openFile(const string &fileName, FileHandle &fileHandle, OpenMode openMode) 
 {
-    return _pf_manager->openFile(fileName.c_str(), fileHandle);
+    RC rc = _pf_manager->openFile(fileName.c_str(), fileHandle, openMode);
+    if (rc == SUCCESS && (fileHandle.getFlags() & RBFM_ZONE_MAPS) && fileHandle.getLayerState() == NULL
+        && (rc = openZoneMaps(fileName, fileHandle)))
+        _pf_manager->closeFile(fileHandle);
+    return rc;
 }
 
 RC RecordBasedFileManager::closeFile(FileHandle &fileHandle) 
@@ -72,40 +104,37 @@ RC RecordBasedFileManager::closeFile(FileHandle &fileHandle)
 
 RC RecordBasedFileManager::insertRecord(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, const void *data, RID &rid) 
 {
-    // Gets the size of the record.
-    unsigned recordSize = getRecordSize(recordDescriptor, data);
+    return insertRecord(fileHandle, *getLayout(recordDescriptor), data, rid);
+}
 
-    // Cycles through pages looking for enough free space for the new entry.
-    void *pageData = malloc(PAGE_SIZE);
-    if (pageData == NULL)
-        return RBFM_MALLOC_FAILED;
-    bool pageFound = false;
-    unsigned i;
-    unsigned numPages = fileHandle.getNumberOfPages();
-    for (i = 0; i < numPages; i++)
-    {
-        if (fileHandle.readPage(i, pageData))
-            return RBFM_READ_FAILED;
+RC RecordBasedFileManager::insertRecord(FileHandle &fileHandle, const RecordLayout &layout, const void *data, RID &rid) 
+{
+    if (isPaxFile(fileHandle))
+        return insertPaxRecord(fileHandle, layout, data, rid);
 
-        // When we find a page with enough space (accounting also for the size that will be added to the slot directory), we stop the loop.
-        if (getPageFreeSpaceSize(pageData) >= sizeof(SlotDirectoryRecordEntry) + recordSize)
-        {
-            pageFound = true;
-            break;
-        }
-    }
+    // Gets the size of the record.
+    unsigned recordSize = getRecordSize(layout, data);
 
-    // If we can't find a page with enough space, we create a new one
-    if(!pageFound)
+    // Asks the free-space map for a page with enough space (accounting also for the size that will be added to the slot directory).
+    // If no page has enough space, we get a new one.
+    void *pageData;
+    PageNum i;
+    RC rc = findFreePage(fileHandle, sizeof(SlotDirectoryRecordEntry) + recordSize, i, pageData);
+    if (rc)
+        return rc;
+    if ((rc = widenZoneMaps(fileHandle, layout, i, &data, 1)))
     {
-        newRecordBasedPage(pageData);
+        fileHandle.unpinPage(i, false);
+        return rc;
     }
+    // The map counts the page's holes as free space; close them up if the record needs their room
+    makeContiguousSpace(pageData, sizeof(SlotDirectoryRecordEntry) + recordSize);
 
     SlotDirectoryHeader slotHeader = getSlotDirectoryHeader(pageData);
 
     // Setting the return RID.
     rid.pageNum = i;
-    rid.slotNum = getOpenSlot(pageData);
+    rid.slotNum = getOpenSlot(pageData, slotHeader);
 
     // Adding the new record reference in the slot directory.
     SlotDirectoryRecordEntry newRecordEntry;
@@ -120,37 +149,106 @@ RC RecordBasedFileManager::insertRecord(FileHandle &fileHandle, const vector<Att
     setSlotDirectoryHeader(pageData, slotHeader);
 
     // Adding the record data.
-    setRecordAtOffset (pageData, newRecordEntry.offset, recordDescriptor, data);
+    setRecordAtOffset (pageData, newRecordEntry.offset, layout, data);
 
-    // Writing the page to disk.
-    if (pageFound)
-    {
-        if (fileHandle.writePage(i, pageData))
-            return RBFM_WRITE_FAILED;
-    }
-    else
+    // Record the page's new free space, then hand the modified page back to the buffer pool.
+    rc = updateFreeSpaceMap(fileHandle, i, pageData);
+    if (fileHandle.unpinPage(i, true))
+        return RBFM_WRITE_FAILED;
+
+    return rc;
+}
+
+RC RecordBasedFileManager::insertRecords(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, const void * const *rows, size_t n, vector<RID> &rids)
+{
+    rids.resize(n);
+    if (n == 0)
+        return SUCCESS;
+
+    shared_ptr<const RecordLayout> held = getLayout(recordDescriptor);
+    const RecordLayout &layout = *held;
+    if (isCompressedFile(fileHandle))
+        return insertCompressedRecords(fileHandle, layout, rows, n, rids);
+    if (isPaxFile(fileHandle))
+        return insertPaxRecords(fileHandle, layout, rows, n, rids);
+
+    void *pageData = allocPage();
+    if (pageData == NULL)
+        return RBFM_MALLOC_FAILED;
+
+    RC rc = SUCCESS;
+    size_t row = 0;
+    while (row < n && rc == SUCCESS)
     {
+        // The page goes wherever the next append lands, after any map page due there
+        if ((rc = appendFreeSpaceMapPages(fileHandle)))
+            break;
+        PageNum pageNum = fileHandle.getNumberOfPages();
+        newRecordBasedPage(pageData);
+        SlotDirectoryHeader slotHeader = getSlotDirectoryHeader(pageData);
+
+        // Fill the page until the next record doesn't fit.
+        for (; row < n; row++)
+        {
+            unsigned recordSize = getRecordSize(layout, rows[row]);
+            if (getPageFreeSpaceSize(pageData) < sizeof(SlotDirectoryRecordEntry) + recordSize)
+                break;
+
+            SlotDirectoryRecordEntry newRecordEntry;
+            newRecordEntry.length = recordSize;
+            newRecordEntry.offset = slotHeader.freeSpaceOffset - recordSize;
+            setSlotDirectoryRecordEntry(pageData, slotHeader.recordEntriesNumber, newRecordEntry);
+            setRecordAtOffset(pageData, newRecordEntry.offset, layout, rows[row]);
+
+            rids[row].pageNum = pageNum;
+            rids[row].slotNum = slotHeader.recordEntriesNumber;
+            slotHeader.freeSpaceOffset = newRecordEntry.offset;
+            slotHeader.recordEntriesNumber += 1;
+            setSlotDirectoryHeader(pageData, slotHeader);
+        }
+
+        // Not even an empty page holds this record
+        if (slotHeader.recordEntriesNumber == 0)
+        {
+            rc = RBFM_RECORD_TOO_LARGE;
+            break;
+        }
+        if ((rc = widenZoneMaps(fileHandle, layout, pageNum, rows + row - slotHeader.recordEntriesNumber, slotHeader.recordEntriesNumber)))
+            break;
+
+        // Write the full page out in one go, and let the map know what room is left on it
         if (fileHandle.appendPage(pageData))
-            return RBFM_APPEND_FAILED;
+            rc = RBFM_APPEND_FAILED;
+        else
+            rc = updateFreeSpaceMap(fileHandle, pageNum, pageData);
     }
 
-    free(pageData);
-    return SUCCESS;
+    freePage(pageData);
+    return rc;
 }
 
 RC RecordBasedFileManager::readRecord(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, const RID &rid, void *data) 
 {
+    return readRecord(fileHandle, *getLayout(recordDescriptor), rid, data);
+}
+
+RC RecordBasedFileManager::readRecord(FileHandle &fileHandle, const RecordLayout &layout, const RID &rid, void *data) 
+{
+    if (isPaxFile(fileHandle))
+        return readPaxRecord(fileHandle, layout, rid, data);
+
     // Retrieve the specific page
-    void *pageData = malloc(PAGE_SIZE);
-    if (pageData == NULL)
-        return RBFM_MALLOC_FAILED;
-    if (fileHandle.readPage(rid.pageNum, pageData))
+    void *pageData;
+    if (fileHandle.fetchPage(rid.pageNum, pageData))
         return RBFM_READ_FAILED;
 
     // Checks if the specific slot id exists in the page
     SlotDirectoryHeader slotHeader = getSlotDirectoryHeader(pageData);
     if(slotHeader.recordEntriesNumber <= rid.slotNum)
+    {
+        fileHandle.unpinPage(rid.pageNum, false);
         return RBFM_SLOT_DN_EXIST;
+    }
 
     // Gets the slot directory record entry data
     SlotDirectoryRecordEntry recordEntry = getSlotDirectoryRecordEntry(pageData, rid.slotNum);
@@ -160,37 +258,85 @@ RC RecordBasedFileManager::readRecord(FileHandle &fileHandle, const vector<Attri
     {
         // Error to read a deleted record
         case DEAD:
-            free(pageData);
+            fileHandle.unpinPage(rid.pageNum, false);
             return RBFM_READ_AFTER_DEL;
         // Get the forwarding address from the record entry and recurse
         case MOVED:
-            free(pageData);
+            fileHandle.unpinPage(rid.pageNum, false);
             RID newRid;
             newRid.pageNum = recordEntry.length;
             newRid.slotNum = -recordEntry.offset;
-            return readRecord(fileHandle, recordDescriptor, newRid, data);
+            return readRecord(fileHandle, layout, newRid, data);
         // Retrieve the actual entry data
         case VALID:
             int32_t offset = recordEntry.offset;
-            getRecordAtOffset(pageData, offset, recordDescriptor, data);
-            free(pageData);
+            getRecordAtOffset(pageData, offset, layout, data);
+            fileHandle.unpinPage(rid.pageNum, false);
             return SUCCESS;
     }
     // Not possible to reach this point, but compiler doesn't know that
     return -1;
 }
 
+RC RecordBasedFileManager::readRecordView(FileHandle &fileHandle, const RID &rid, RecordView &view)
+{
+    // Let go of whatever the view was looking at
+    view.release();
+    if (isPaxFile(fileHandle))
+        return readPaxRecordView(fileHandle, rid, view);
+
+    // Retrieve the specific page
+    void *pageData;
+    if (fileHandle.fetchPage(rid.pageNum, pageData))
+        return RBFM_READ_FAILED;
+
+    // Checks if the specific slot id exists in the page
+    SlotDirectoryHeader slotHeader = getSlotDirectoryHeader(pageData);
+    if(slotHeader.recordEntriesNumber <= rid.slotNum)
+    {
+        fileHandle.unpinPage(rid.pageNum, false);
+        return RBFM_SLOT_DN_EXIST;
+    }
+
+    SlotDirectoryRecordEntry recordEntry = getSlotDirectoryRecordEntry(pageData, rid.slotNum);
+    switch (getSlotStatus(recordEntry))
+    {
+        case DEAD:
+            fileHandle.unpinPage(rid.pageNum, false);
+            return RBFM_READ_AFTER_DEL;
+        case MOVED:
+            fileHandle.unpinPage(rid.pageNum, false);
+            RID newRid;
+            newRid.pageNum = recordEntry.length;
+            newRid.slotNum = -recordEntry.offset;
+            return readRecordView(fileHandle, newRid, view);
+        // The view keeps the page pinned
+        case VALID:
+            view.attach((const char *) pageData, recordEntry.offset);
+            view.fileHandle = &fileHandle;
+            view.pageNum = rid.pageNum;
+            return SUCCESS;
+    }
+    return -1;
+}
+
 RC RecordBasedFileManager::deleteRecord(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, const RID &rid)
 {
+    if (isPaxFile(fileHandle))
+        return deletePaxRecord(fileHandle, *getLayout(recordDescriptor), rid);
+
     // Get page
-    void *pageData = malloc(PAGE_SIZE);
-    if (fileHandle.readPage(rid.pageNum, pageData) != SUCCESS)
+    void *pageData;
+    if (fileHandle.fetchPage(rid.pageNum, pageData) != SUCCESS)
         return RBFM_READ_FAILED;
 
     // Get page header
     SlotDirectoryHeader slotHeader = getSlotDirectoryHeader(pageData);
     if (slotHeader.recordEntriesNumber <= rid.slotNum)
+    {
+        fileHandle.unpinPage(rid.pageNum, false);
         return RBFM_SLOT_DN_EXIST;
+    }
 
     // Get slot record entry data
     SlotDirectoryRecordEntry recordEntry = getSlotDirectoryRecordEntry(pageData, rid.slotNum);
@@ -198,7 +344,7 @@ RC RecordBasedFileManager::deleteRecord(FileHandle &fileHandle, const vector<Att
     // Cannot delete a deleted page
     if (status == DEAD)
     {
-        free(pageData);
+        fileHandle.unpinPage(rid.pageNum, false);
         return RBFM_SLOT_DN_EXIST;
     }
     // Recursively delete moved pages
@@ -210,7 +356,7 @@ RC RecordBasedFileManager::deleteRecord(FileHandle &fileHandle, const vector<Att
         RC rc = deleteRecord(fileHandle, recordDescriptor, newRid);
         if (rc != SUCCESS)
         {
-            free(pageData);
+            fileHandle.unpinPage(rid.pageNum, false);
             return rc;
         }
         markSlotDeleted(pageData, rid.slotNum);
@@ -218,13 +364,12 @@ RC RecordBasedFileManager::deleteRecord(FileHandle &fileHandle, const vector<Att
     else if (status == VALID)
     {
         markSlotDeleted(pageData, rid.slotNum);
-        reorganizePage(pageData);
     }
     
-    // Once we've deleted the page(s), write changes to disk
-    RC rc = fileHandle.writePage(rid.pageNum, pageData);
-    free(pageData);
-    return rc;
+    // Once we've deleted the page(s), record the freed space and hand the changes back to the buffer pool
+    RC rc = updateFreeSpaceMap(fileHandle, rid.pageNum, pageData);
+    RC unpinRc = fileHandle.unpinPage(rid.pageNum, true);
+    return rc ? rc : unpinRc;
 }
 
 // update record
@@ -234,106 +379,188 @@ RC RecordBasedFileManager::deleteRecord(FileHandle &fileHandle, const vector<Att
 // same: do nothing
 RC RecordBasedFileManager::updateRecord(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, const void *data, const RID &rid)
 {
+    return updateRecord(fileHandle, *getLayout(recordDescriptor), data, rid);
+}
+
+RC RecordBasedFileManager::updateRecord(FileHandle &fileHandle, const RecordLayout &layout, const void *data, const RID &rid)
+{
+    if (isPaxFile(fileHandle))
+        return updatePaxRecord(fileHandle, layout, data, rid);
+
     // Retrieve the specific page
-    void *pageData = malloc(PAGE_SIZE);
-    if (fileHandle.readPage(rid.pageNum, pageData))
-    {
-        free(pageData);
+    void *pageData;
+    if (fileHandle.fetchPage(rid.pageNum, pageData))
         return RBFM_READ_FAILED;
-    }
 
     // Checks if the specific slot id exists in the page
     SlotDirectoryHeader slotHeader = getSlotDirectoryHeader(pageData);
     if(slotHeader.recordEntriesNumber <= rid.slotNum)
     {
-        free(pageData);
+        fileHandle.unpinPage(rid.pageNum, false);
         return RBFM_SLOT_DN_EXIST;
     }
 
     // Gets the slot directory record entry data
     SlotDirectoryRecordEntry recordEntry = getSlotDirectoryRecordEntry(pageData, rid.slotNum);
 
+    RC rc;
     SlotStatus status = getSlotStatus(recordEntry);
     switch (status)
     {
         // Error to update a deleted record
         case DEAD:
-            free(pageData);
+            fileHandle.unpinPage(rid.pageNum, false);
             return RBFM_READ_AFTER_DEL;
-        // Get the forwarding address from the record entry and recurse
+        // Update the record where it lives. If it has to move on, point this slot straight
+        // at its new place, so the record is never more than one hop from its RID.
         case MOVED:
-            free(pageData);
             RID newRid;
-            newRid.pageNum = recordEntry.length;
-            newRid.slotNum = -recordEntry.offset;
-            return updateRecord(fileHandle, recordDescriptor, data, newRid);
+            bool moved;
+            rc = updateForwardedRecord(fileHandle, layout, data, getForwardingAddress(recordEntry), newRid, moved);
+            if (rc != SUCCESS || !moved)
+            {
+                fileHandle.unpinPage(rid.pageNum, false);
+                return rc;
+            }
+            setForwardingAddress(pageData, rid.slotNum, newRid);
+            return fileHandle.unpinPage(rid.pageNum, true);
         default:
         break;
     }
     // Do actual work
-    // Gets the size of the updated record
-    unsigned recordSize = getRecordSize(recordDescriptor, data);
-    if (recordSize  == recordEntry.length)
+    if ((rc = widenZoneMaps(fileHandle, layout, rid.pageNum, &data, 1)))
     {
-        setRecordAtOffset(pageData, recordEntry.offset, recordDescriptor, data);
-        RC rc = fileHandle.writePage(rid.pageNum, pageData);
-        free(pageData);
+        fileHandle.unpinPage(rid.pageNum, false);
         return rc;
     }
-    else if (recordSize < recordEntry.length)
+    if (!updateRecordOnPage(pageData, rid.slotNum, layout, data))
     {
-        setRecordAtOffset(pageData, recordEntry.offset, recordDescriptor, data);
-        recordEntry.length = recordSize;
-        setSlotDirectoryRecordEntry(pageData, rid.slotNum, recordEntry);
-        reorganizePage(pageData);
-        RC rc = fileHandle.writePage(rid.pageNum, pageData);
-        free(pageData);
-        return rc;
+        // Need to insert then set forward address
+        RID newRid;
+        rc = insertRecord(fileHandle, layout, data, newRid);
+        if (rc != SUCCESS)
+        {
+            fileHandle.unpinPage(rid.pageNum, false);
+            return rc;
+        }
+        setForwardingAddress(pageData, rid.slotNum, newRid);
     }
-    else if (recordSize > recordEntry.length)
+    // The record's size changed, so did the page's free space
+    rc = updateFreeSpaceMap(fileHandle, rid.pageNum, pageData);
+    RC unpinRc = fileHandle.unpinPage(rid.pageNum, true);
+    return rc ? rc : unpinRc;
+}
+
+// Update the record a forwarding address points at. If it no longer fits on its page it is
+// inserted elsewhere and its slot there freed; moved and newRid then say where it went, for
+// the RID's own slot to point at. Chains from older files collapse along the way.
+RC RecordBasedFileManager::updateForwardedRecord(FileHandle &fileHandle, const RecordLayout &layout, const void *data, const RID &rid, RID &newRid, bool &moved)
+{
+    moved = false;
+    void *pageData;
+    if (fileHandle.fetchPage(rid.pageNum, pageData))
+        return RBFM_READ_FAILED;
+
+    SlotDirectoryHeader slotHeader = getSlotDirectoryHeader(pageData);
+    if(slotHeader.recordEntriesNumber <= rid.slotNum)
     {
-        unsigned space = getPageFreeSpaceSize(pageData) + recordEntry.length;
-        if (recordSize > space)
-        {
-            // Need to insert then set forward address then reorganize
-            RID newRid;
-            RC rc = insertRecord(fileHandle, recordDescriptor, data, newRid);
+        fileHandle.unpinPage(rid.pageNum, false);
+        return RBFM_SLOT_DN_EXIST;
+    }
+
+    SlotDirectoryRecordEntry recordEntry = getSlotDirectoryRecordEntry(pageData, rid.slotNum);
+    RC rc;
+    switch (getSlotStatus(recordEntry))
+    {
+        case DEAD:
+            fileHandle.unpinPage(rid.pageNum, false);
+            return RBFM_READ_AFTER_DEL;
+        // A hop in the middle of a chain: the RID's slot will point past it
+        case MOVED:
+            rc = updateForwardedRecord(fileHandle, layout, data, getForwardingAddress(recordEntry), newRid, moved);
             if (rc != SUCCESS)
             {
-                free(pageData);
+                fileHandle.unpinPage(rid.pageNum, false);
                 return rc;
             }
-            recordEntry.length = newRid.pageNum;
-            recordEntry.offset = -newRid.slotNum;
-            setSlotDirectoryRecordEntry(pageData, rid.slotNum, recordEntry);
-            reorganizePage(pageData);
-        }
-        else
-        {
-            // Need to set header to DEAD and reorganize to consolidate free space
-            recordEntry.length = 0;
-            recordEntry.offset = 0;
-            setSlotDirectoryRecordEntry(pageData, rid.slotNum, recordEntry);
-            reorganizePage(pageData);
-
-            // Get updated slotHeader with new free space pointer
-            slotHeader = getSlotDirectoryHeader(pageData);
-            // Update record length and offset
-            recordEntry.length = recordSize;
-            recordEntry.offset = slotHeader.freeSpaceOffset - recordSize;
-            setSlotDirectoryRecordEntry(pageData, rid.slotNum, recordEntry);
-
-            // Update header with new free space pointer
-            slotHeader.freeSpaceOffset = recordEntry.offset;
-            setSlotDirectoryHeader(pageData, slotHeader);
+            if (!moved)
+                newRid = getForwardingAddress(recordEntry);
+            markSlotDeleted(pageData, rid.slotNum);
+            moved = true;
+            return fileHandle.unpinPage(rid.pageNum, true);
+        case VALID:
+            if ((rc = widenZoneMaps(fileHandle, layout, rid.pageNum, &data, 1)))
+            {
+                fileHandle.unpinPage(rid.pageNum, false);
+                return rc;
+            }
+            if (updateRecordOnPage(pageData, rid.slotNum, layout, data))
+                break;
+            // Outgrew this page too; nothing but the RID's slot points here, so free this one
+            rc = insertRecord(fileHandle, layout, data, newRid);
+            if (rc != SUCCESS)
+            {
+                fileHandle.unpinPage(rid.pageNum, false);
+                return rc;
+            }
+            markSlotDeleted(pageData, rid.slotNum);
+            moved = true;
+            break;
+    }
+    rc = updateFreeSpaceMap(fileHandle, rid.pageNum, pageData);
+    RC unpinRc = fileHandle.unpinPage(rid.pageNum, true);
+    return rc ? rc : unpinRc;
+}
 
-            // Add new record data
-            setRecordAtOffset (pageData, recordEntry.offset, recordDescriptor, data);
-        }
+// Rewrite the record in slotNum of page with data, if the page has room for it.
+// Returns false, leaving the page as it was, when it does not.
+bool RecordBasedFileManager::updateRecordOnPage(void *page, unsigned slotNum, const RecordLayout &layout, const void *data)
+{
+    SlotDirectoryRecordEntry recordEntry = getSlotDirectoryRecordEntry(page, slotNum);
+    // Gets the size of the updated record
+    unsigned recordSize = getRecordSize(layout, data);
+    if (recordSize == recordEntry.length)
+    {
+        setRecordAtOffset(page, recordEntry.offset, layout, data);
+        return true;
     }
-    RC rc = fileHandle.writePage(rid.pageNum, pageData);
-    free(pageData);
-    return rc;
+    if (recordSize < recordEntry.length)
+    {
+        // The tail of the old record becomes a hole
+        SlotDirectoryRecordEntry tail;
+        tail.length = recordEntry.length - recordSize;
+        tail.offset = recordEntry.offset + recordSize;
+        releaseRecordSpace(page, tail);
+        setRecordAtOffset(page, recordEntry.offset, layout, data);
+        recordEntry.length = recordSize;
+        setSlotDirectoryRecordEntry(page, slotNum, recordEntry);
+        return true;
+    }
+    if (recordSize > getPageFreeSpaceSize(page) + recordEntry.length)
+        return false;
+
+    // Give up the old bytes and find contiguous room for the new ones. The slot is dead
+    // meanwhile, so compacting the page leaves the old record behind.
+    releaseRecordSpace(page, recordEntry);
+    recordEntry.length = 0;
+    recordEntry.offset = 0;
+    setSlotDirectoryRecordEntry(page, slotNum, recordEntry);
+    makeContiguousSpace(page, recordSize);
+
+    // Get updated slotHeader with new free space pointer
+    SlotDirectoryHeader slotHeader = getSlotDirectoryHeader(page);
+    // Update record length and offset
+    recordEntry.length = recordSize;
+    recordEntry.offset = slotHeader.freeSpaceOffset - recordSize;
+    setSlotDirectoryRecordEntry(page, slotNum, recordEntry);
+
+    // Update header with new free space pointer
+    slotHeader.freeSpaceOffset = recordEntry.offset;
+    setSlotDirectoryHeader(page, slotHeader);
+
+    // Add new record data
+    setRecordAtOffset (page, recordEntry.offset, layout, data);
+    return true;
 }
 
 RC RecordBasedFileManager::printRecord(const vector<Attribute> &recordDescriptor, const void *data) 
@@ -402,19 +629,20 @@ RC RecordBasedFileManager::printRecord(const vector<Attribute> &recordDescriptor
 
 RC RecordBasedFileManager::readAttribute(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, const RID &rid, const string &attributeName, void *data)
 {
-    char *pageData = (char*)malloc(PAGE_SIZE);
-    if (pageData == NULL)
-        return RBFM_MALLOC_FAILED;
-    if (fileHandle.readPage(rid.pageNum, pageData) != SUCCESS)
-    {
-        free(pageData);
+    if (isPaxFile(fileHandle))
+        return readPaxAttribute(fileHandle, *getLayout(recordDescriptor), rid, attributeName, data);
+
+    void *pageData;
+    if (fileHandle.fetchPage(rid.pageNum, pageData) != SUCCESS)
         return RBFM_READ_FAILED;
-    }
     // Get record header, recurse if forwarded
     // Checks if the specific slot id exists in the page
     SlotDirectoryHeader slotHeader = getSlotDirectoryHeader(pageData);
     if(slotHeader.recordEntriesNumber < rid.slotNum)
+    {
+        fileHandle.unpinPage(rid.pageNum, false);
         return RBFM_SLOT_DN_EXIST;
+    }
 
     // Gets the slot directory record entry data
     SlotDirectoryRecordEntry recordEntry = getSlotDirectoryRecordEntry(pageData, rid.slotNum);
@@ -424,11 +652,11 @@ RC RecordBasedFileManager::readAttribute(FileHandle &fileHandle, const vector<At
     {
         // Error to get attribute of a deleted record
         case DEAD:
-            free(pageData);
+            fileHandle.unpinPage(rid.pageNum, false);
             return RBFM_READ_AFTER_DEL;
         // Get the forwarding address from the record entry and recurse
         case MOVED:
-            free(pageData);
+            fileHandle.unpinPage(rid.pageNum, false);
             RID newRid;
             newRid.pageNum = recordEntry.length;
             newRid.slotNum = -recordEntry.offset;
@@ -444,11 +672,14 @@ RC RecordBasedFileManager::readAttribute(FileHandle &fileHandle, const vector<At
     auto iterPos = find_if(recordDescriptor.begin(), recordDescriptor.end(), pred);
     unsigned index = distance(recordDescriptor.begin(), iterPos);
     if (index == recordDescriptor.size())
+    {
+        fileHandle.unpinPage(rid.pageNum, false);
         return RBFM_NO_SUCH_ATTR;
+    }
     AttrType type = recordDescriptor[index].type;
     // Write attribute to data
     getAttributeFromRecord(pageData, offset, index, type, data);
-    free(pageData);
+    fileHandle.unpinPage(rid.pageNum, false);
     return SUCCESS;
 }
 
@@ -459,73 +690,394 @@ RC RecordBasedFileManager::readAttribute(FileHandle &fileHandle, const vector<At
       const CompOp compOp,                  // comparision type such as "<" and "="
       const void *value,                    // used in the comparison
       const vector<string> &attributeNames, // a list of projected attributes
-      RBFM_ScanIterator &rbfm_ScanIterator)
+      RBFM_ScanIterator &rbfm_ScanIterator,
+      ScanMode scanMode)
+{
+    return rbfm_ScanIterator.scanInit(fileHandle, *getLayout(recordDescriptor), conditionAttribute, compOp, value, attributeNames, scanMode);
+}
+
+  RC RecordBasedFileManager::scan(FileHandle &fileHandle,
+      const RecordLayout &layout,
+      const string &conditionAttribute,
+      const CompOp compOp,
+      const void *value,
+      const vector<string> &attributeNames,
+      RBFM_ScanIterator &rbfm_ScanIterator,
+      ScanMode scanMode)
+{
+    return rbfm_ScanIterator.scanInit(fileHandle, layout, conditionAttribute, compOp, value, attributeNames, scanMode);
+}
+
+  RC RecordBasedFileManager::scan(FileHandle &fileHandle,
+      const vector<Attribute> &recordDescriptor,
+      const Predicate &predicate,
+      const vector<string> &attributeNames,
+      RBFM_ScanIterator &rbfm_ScanIterator,
+      ScanMode scanMode)
+{
+    return rbfm_ScanIterator.scanInit(fileHandle, *getLayout(recordDescriptor), predicate, attributeNames, scanMode);
+}
+
+  RC RecordBasedFileManager::scan(FileHandle &fileHandle,
+      const RecordLayout &layout,
+      const Predicate &predicate,
+      const vector<string> &attributeNames,
+      RBFM_ScanIterator &rbfm_ScanIterator,
+      ScanMode scanMode)
+{
+    return rbfm_ScanIterator.scanInit(fileHandle, layout, predicate, attributeNames, scanMode);
+}
+
+// A RID as one number, for sets of them
+static uint64_t ridKey(const RID &rid)
+{
+    return ((uint64_t) rid.pageNum << 32) | rid.slotNum;
+}
+
+RC RecordBasedFileManager::vacuum(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, VacuumStats &stats)
 {
-    return rbfm_ScanIterator.scanInit(fileHandle, recordDescriptor, conditionAttribute, compOp, value, attributeNames);
+    memset(&stats, 0, sizeof(VacuumStats));
+    shared_ptr<const RecordLayout> held = getLayout(recordDescriptor);
+    const RecordLayout &layout = *held;
+    RC rc = isPaxFile(fileHandle) ? vacuumPax(fileHandle, layout, stats) : vacuumRows(fileHandle, stats);
+    // Zones only ever widen until now
+    if (rc == SUCCESS)
+        rc = rebuildZoneMaps(fileHandle, layout);
+    return rc;
+}
+
+RC RecordBasedFileManager::vacuumRows(FileHandle &fileHandle, VacuumStats &stats)
+{
+    PageNum numPages = fileHandle.getNumberOfPages();
+
+    // Slots a forwarding address points at hold moved records or the middle of a chain;
+    // every other forwarding slot is the RID of a record
+    unordered_set<uint64_t> forwarded;
+    for (PageNum pageNum = 0; pageNum < numPages; pageNum++)
+    {
+        if (isFreeSpaceMapPage(pageNum))
+            continue;
+        void *pageData;
+        if (fileHandle.fetchPage(pageNum, pageData))
+            return RBFM_READ_FAILED;
+        SlotDirectoryHeader slotHeader = getSlotDirectoryHeader(pageData);
+        for (unsigned i = 0; i < slotHeader.recordEntriesNumber; i++)
+        {
+            SlotDirectoryRecordEntry recordEntry = getSlotDirectoryRecordEntry(pageData, i);
+            if (getSlotStatus(recordEntry) == MOVED)
+                forwarded.insert(ridKey(getForwardingAddress(recordEntry)));
+        }
+        fileHandle.unpinPage(pageNum, false);
+    }
+
+    // Bring each forwarded record as close to its RID as it will go
+    for (PageNum pageNum = 0; pageNum < numPages; pageNum++)
+    {
+        if (isFreeSpaceMapPage(pageNum))
+            continue;
+        void *pageData;
+        if (fileHandle.fetchPage(pageNum, pageData))
+            return RBFM_READ_FAILED;
+        SlotDirectoryHeader slotHeader = getSlotDirectoryHeader(pageData);
+        unsigned changes = stats.recordsMovedHome + stats.hopsRemoved;
+        RC rc = SUCCESS;
+        for (unsigned i = 0; i < slotHeader.recordEntriesNumber && rc == SUCCESS; i++)
+        {
+            RID home;
+            home.pageNum = pageNum;
+            home.slotNum = i;
+            if (getSlotStatus(getSlotDirectoryRecordEntry(pageData, i)) == MOVED && forwarded.count(ridKey(home)) == 0)
+                rc = vacuumForwardedRecord(fileHandle, pageData, home, stats);
+        }
+        bool changed = stats.recordsMovedHome + stats.hopsRemoved != changes;
+        if (rc == SUCCESS && changed)
+            rc = updateFreeSpaceMap(fileHandle, pageNum, pageData);
+        RC unpinRc = fileHandle.unpinPage(pageNum, changed);
+        if (rc || unpinRc)
+            return rc ? rc : unpinRc;
+    }
+
+    // Moving records left holes and dead slots behind
+    for (PageNum pageNum = 0; pageNum < numPages; pageNum++)
+    {
+        if (isFreeSpaceMapPage(pageNum))
+            continue;
+        void *pageData;
+        if (fileHandle.fetchPage(pageNum, pageData))
+            return RBFM_READ_FAILED;
+        if (!compactPage(pageData, stats))
+        {
+            fileHandle.unpinPage(pageNum, false);
+            continue;
+        }
+        RC rc = updateFreeSpaceMap(fileHandle, pageNum, pageData);
+        RC unpinRc = fileHandle.unpinPage(pageNum, true);
+        if (rc || unpinRc)
+            return rc ? rc : unpinRc;
+    }
+    return SUCCESS;
+}
+
+// Follow the forwarding address in the slot of home, on homePage, to the record. Copy the
+// record home if it fits there, otherwise point home straight at it; either way free the
+// slots of the hops in between.
+RC RecordBasedFileManager::vacuumForwardedRecord(FileHandle &fileHandle, void *homePage, const RID &home, VacuumStats &stats)
+{
+    vector<RID> hops;
+    RID target = getForwardingAddress(getSlotDirectoryRecordEntry(homePage, home.slotNum));
+    void *targetPage;
+    SlotDirectoryRecordEntry targetEntry;
+    while (true)
+    {
+        if (fileHandle.fetchPage(target.pageNum, targetPage))
+            return RBFM_READ_FAILED;
+        if (getSlotDirectoryHeader(targetPage).recordEntriesNumber <= target.slotNum)
+        {
+            fileHandle.unpinPage(target.pageNum, false);
+            return RBFM_SLOT_DN_EXIST;
+        }
+        targetEntry = getSlotDirectoryRecordEntry(targetPage, target.slotNum);
+        SlotStatus status = getSlotStatus(targetEntry);
+        if (status == VALID)
+            break;
+        fileHandle.unpinPage(target.pageNum, false);
+        if (status == DEAD)
+            return RBFM_READ_AFTER_DEL;
+        hops.push_back(target);
+        target = getForwardingAddress(targetEntry);
+    }
+
+    RC rc = SUCCESS;
+    bool targetChanged = false;
+    // The home slot is already in the directory, only the record's bytes need room
+    if (getPageFreeSpaceSize(homePage) >= targetEntry.length)
+    {
+        makeContiguousSpace(homePage, targetEntry.length);
+        // Compacting moves the record too if it lives on the home page
+        if (target.pageNum == home.pageNum)
+            targetEntry = getSlotDirectoryRecordEntry(targetPage, target.slotNum);
+        SlotDirectoryHeader slotHeader = getSlotDirectoryHeader(homePage);
+        SlotDirectoryRecordEntry homeEntry;
+        homeEntry.length = targetEntry.length;
+        homeEntry.offset = slotHeader.freeSpaceOffset - targetEntry.length;
+        memcpy((char *) homePage + homeEntry.offset, (char *) targetPage + targetEntry.offset, targetEntry.length);
+        setSlotDirectoryRecordEntry(homePage, home.slotNum, homeEntry);
+        slotHeader.freeSpaceOffset = homeEntry.offset;
+        setSlotDirectoryHeader(homePage, slotHeader);
+
+        // The target page may be the home page itself, which is fine: both are the same frame
+        markSlotDeleted(targetPage, target.slotNum);
+        rc = updateFreeSpaceMap(fileHandle, target.pageNum, targetPage);
+        targetChanged = true;
+        stats.recordsMovedHome++;
+        stats.hopsRemoved += hops.size() + 1;
+    }
+    else if (!hops.empty())
+    {
+        setForwardingAddress(homePage, home.slotNum, target);
+        stats.hopsRemoved += hops.size();
+    }
+    RC unpinRc = fileHandle.unpinPage(target.pageNum, targetChanged);
+    if (rc || unpinRc)
+        return rc ? rc : unpinRc;
+
+    // Nothing points at the hops any more
+    for (unsigned i = 0; i < hops.size(); i++)
+    {
+        void *hopPage;
+        if (fileHandle.fetchPage(hops[i].pageNum, hopPage))
+            return RBFM_READ_FAILED;
+        markSlotDeleted(hopPage, hops[i].slotNum);
+        if ((rc = fileHandle.unpinPage(hops[i].pageNum, true)))
+            return rc;
+    }
+    return SUCCESS;
+}
+
+// The first 8 bytes of a string, zero padded, as a number that orders like memcmp does
+static uint64_t varCharPrefix(const char *data, uint32_t length)
+{
+    uint64_t prefix = 0;
+    memcpy(&prefix, data, min(length, (uint32_t) sizeof(prefix)));
+    return __builtin_bswap64(prefix);
+}
+
+Predicate::Predicate(PredicateKind kind, const string &attribute, CompOp compOp, const void *value)
+: kind(kind), attribute(attribute), compOp(compOp), value(value)
+{
+}
+
+Predicate Predicate::compare(const string &attribute, CompOp compOp, const void *value)
+{
+    return Predicate(PRED_COMPARE, attribute, compOp, value);
+}
+
+Predicate Predicate::isNull(const string &attribute)
+{
+    return Predicate(PRED_IS_NULL, attribute, NO_OP, NULL);
+}
+
+Predicate Predicate::isNotNull(const string &attribute)
+{
+    return Predicate(PRED_IS_NOT_NULL, attribute, NO_OP, NULL);
+}
+
+Predicate Predicate::allOf(const vector<Predicate> &terms)
+{
+    Predicate predicate(PRED_AND, "", NO_OP, NULL);
+    predicate.terms = terms;
+    return predicate;
+}
+
+Predicate Predicate::allOf(const Predicate &left, const Predicate &right)
+{
+    Predicate predicate(PRED_AND, "", NO_OP, NULL);
+    predicate.terms.push_back(left);
+    predicate.terms.push_back(right);
+    return predicate;
+}
+
+Predicate Predicate::anyOf(const vector<Predicate> &terms)
+{
+    Predicate predicate(PRED_OR, "", NO_OP, NULL);
+    predicate.terms = terms;
+    return predicate;
+}
+
+Predicate Predicate::anyOf(const Predicate &left, const Predicate &right)
+{
+    Predicate predicate(PRED_OR, "", NO_OP, NULL);
+    predicate.terms.push_back(left);
+    predicate.terms.push_back(right);
+    return predicate;
+}
+
+Predicate Predicate::negate(const Predicate &term)
+{
+    Predicate predicate(PRED_NOT, "", NO_OP, NULL);
+    predicate.terms.push_back(term);
+    return predicate;
 }
 
 RBFM_ScanIterator::RBFM_ScanIterator()
-: currPage(0), currSlot(0), totalPage(0), totalSlot(0)
+: currPage(0), currSlot(0), totalPage(0), totalSlot(0), pageData(NULL), pageBuffer(NULL),
+  scanMode(SCAN_BUFFERED), pax(false), mappedPages(NULL), mappedPageCount(0), readAheadPage(0), rootCondition(NULL),
+  filtered(false), codesFiltered(false), pageFiltered(false), encodedPage(NULL), allFieldsDecoded(false)
 {
     rbfm = RecordBasedFileManager::instance();
 }
 
 RC RBFM_ScanIterator::close()
 {
-    free(pageData);
+    if (mappedPages != NULL)
+        fileHandle.unmapPages(mappedPages, mappedPageCount);
+    mappedPages = NULL;
+    returnPage(pageBuffer);
+    pageBuffer = NULL;
+    pageData = NULL;
     return SUCCESS;
 }
 
 // Initialize the scanIterator with all necessary state
 RC RBFM_ScanIterator::scanInit(FileHandle &fh,
-        const vector<Attribute> rd,
+        const RecordLayout &rl,
         const string &ca, 
         const CompOp co, 
         const void *v, 
-        const vector<string> &an)
+        const vector<string> &an,
+        ScanMode sm)
+{
+    // The condition is a predicate of one comparison, or none
+    layout = rl;
+    conditions.clear();
+    if (co != NO_OP)
+    {
+        RC rc = addLeafCondition(PRED_COMPARE, ca, co, v);
+        if (rc)
+            return rc;
+    }
+    return scanStart(fh, an, sm);
+}
+
+RC RBFM_ScanIterator::scanInit(FileHandle &fh,
+        const RecordLayout &rl,
+        const Predicate &predicate,
+        const vector<string> &an,
+        ScanMode sm)
+{
+    layout = rl;
+    conditions.clear();
+    RC rc = addCondition(predicate);
+    if (rc)
+        return rc;
+    return scanStart(fh, an, sm);
+}
+
+// Start the scan once layout and conditions are set
+RC RBFM_ScanIterator::scanStart(FileHandle &fh, const vector<string> &an, ScanMode sm)
 {
     // Start at page 0 slot 0
     currPage = 0;
     currSlot = 0;
     totalPage = 0;
     totalSlot = 0;
-    // Keep a buffer to hold the current page
-    pageData = malloc(PAGE_SIZE);
+    // Keep a buffer to hold the current page, from an earlier scan if there was one
+    if (pageBuffer == NULL)
+        pageBuffer = borrowPage();
+    if (pageBuffer == NULL)
+        return RBFM_MALLOC_FAILED;
+    pageData = pageBuffer;
+    scanMode = sm;
+    pax = rbfm->isPaxFile(fh);
+    mappedPages = NULL;
+    mappedPageCount = 0;
+    readAheadPage = 0;
 
     // Store the variables passed in to
     fileHandle = fh;
-    conditionAttribute = ca;
-    recordDescriptor = rd;
-    compOp = co;
-    value = v;
     attributeNames = an;
+    // The handle counts this scan's I/O
+    fileHandle.readPageCounter = 0;
+    fileHandle.writePageCounter = 0;
+    fileHandle.appendPageCounter = 0;
 
     skipList.clear();
 
-    // Get total number of pages
-    totalPage = fh.getNumberOfPages();
-    if (totalPage > 0)
+    // Resolve the attribute names once for the whole scan
+    if (layout.getProjection(attributeNames, projection))
+        return RBFM_NO_SUCH_ATTR;
+    rootCondition = conditions.empty() ? NULL : &conditions[0];
+    codesFiltered = conditions.size() == 1 && rootCondition->kind == PRED_COMPARE && rootCondition->compOp != NO_OP
+                    && rootCondition->hasValue;
+    filtered = codesFiltered && (rootCondition->type == TypeInt || rootCondition->type == TypeReal);
+    encodedPage = NULL;
+    if (pax)
     {
-        if (fh.readPage(0, pageData))
-            return RBFM_READ_FAILED;
+        decodedFields.assign(layout.getFieldCount(), false);
+        for (unsigned i = 0; i < projection.size(); i++)
+            decodedFields[projection[i]] = true;
+        for (unsigned i = 0; i < conditions.size() && !codesFiltered; i++)
+            if (conditions[i].kind == PRED_COMPARE || conditions[i].kind == PRED_IS_NULL || conditions[i].kind == PRED_IS_NOT_NULL)
+                decodedFields[conditions[i].attrIndex] = true;
     }
-    else
-        return SUCCESS;
 
-    // Get number of slots on first page
-    SlotDirectoryHeader header = rbfm->getSlotDirectoryHeader(pageData);
-    totalSlot = header.recordEntriesNumber;
+    // Get total number of pages, the scan starts on the first data page it cannot rule out
+    totalPage = fh.getNumberOfPages();
+    pruneByZoneMaps();
+    skipPages();
 
-    // If we don't need to do any comparisons, we can ignore the condition attribute
-    if (co == NO_OP)
-        return SUCCESS;
+    // Without a map we just read through the buffer pool
+    if (scanMode == SCAN_MMAP && fileHandle.mapPages(mappedPages, mappedPageCount))
+    {
+        mappedPages = NULL;
+        scanMode = SCAN_BUFFERED;
+    }
 
-    // Else, we need to find the condition attribute's index in the record descriptor
-    auto pred = [&](Attribute a) {return a.name == conditionAttribute;};
-    auto iterPos = find_if(recordDescriptor.begin(), recordDescriptor.end(), pred);
-    attrIndex = distance(recordDescriptor.begin(), iterPos);
-    if (attrIndex == recordDescriptor.size())
-        return RBFM_NO_SUCH_ATTR;
+    if (currPage < totalPage)
+    {
+        if (getNextPage())
+            return RBFM_READ_FAILED;
+    }
 
     return SUCCESS;
 }
@@ -536,175 +1088,447 @@ RC RBFM_ScanIterator::getNextRecord(RID &rid, void *data)
     if (rc)
         return rc;
 
-    // If we are not returning any results, we can just set the RID and return
-    if (attributeNames.size() == 0)
+    // If we are not returning any results, we can just set the RID
+    if (attributeNames.size() != 0)
+        projectRecord(data, UINT_MAX);
+
+    rid.pageNum = currPage;
+    rid.slotNum = currSlot++;
+    return SUCCESS;
+}
+
+RC RBFM_ScanIterator::getNextBatch(vector<RID> &rids, void *buffer, unsigned capacity, unsigned &count)
+{
+    rids.clear();
+    count = 0;
+    unsigned used = 0;
+    RC rc;
+    while ((rc = getNextSlot()) == SUCCESS)
     {
+        // Without a projection nothing is written, but each record still takes the room of its
+        // RID so that one call cannot drain the scan
+        unsigned size = sizeof(RID);
+        if (attributeNames.size() != 0)
+            size = projectRecord((char *) buffer + used, capacity - used);
+        else if (capacity - used < size)
+            size = 0;
+        // Leave the record where it is for the next call
+        if (size == 0)
+            break;
+        used += size;
+
+        RID rid;
         rid.pageNum = currPage;
         rid.slotNum = currSlot++;
-        return SUCCESS;
+        rids.push_back(rid);
     }
+    count = rids.size();
+    if (count > 0)
+        return SUCCESS;
+    return rc == SUCCESS ? RBFM_BATCH_TOO_SMALL : rc;
+}
 
-    // Prepare null indicator
-    unsigned nullIndicatorSize = rbfm->getNullIndicatorSize(attributeNames.size());
-    char nullIndicator[nullIndicatorSize];
-    memset(nullIndicator, 0, nullIndicatorSize);
+RC RBFM_ScanIterator::getNextRecordView(RID &rid, RecordView &view)
+{
+    view.release();
+    RC rc = getNextSlot();
+    if (rc)
+        return rc;
 
-    SlotDirectoryRecordEntry recordEntry = rbfm->getSlotDirectoryRecordEntry(pageData, currSlot);
+    // The view may read any field
+    if (encodedPage != NULL && !allFieldsDecoded)
+        decodePage(true);
+    attachView(view, currSlot);
+    rid.pageNum = currPage;
+    rid.slotNum = currSlot++;
+    return SUCCESS;
+}
 
-    // Unsure how large each attribute will be, set to size of page to be safe
-    void *buffer = malloc(PAGE_SIZE);
-    if (buffer == NULL)
-        return RBFM_MALLOC_FAILED;
+// Private helper methods ///////////////////////////////////////////////////////////////////
 
-    // Keep track of offset into data
-    unsigned dataOffset = nullIndicatorSize;
+// Append the conditions of predicate, its root first
+RC RBFM_ScanIterator::addCondition(const Predicate &predicate)
+{
+    if (predicate.kind == PRED_COMPARE || predicate.kind == PRED_IS_NULL || predicate.kind == PRED_IS_NOT_NULL)
+        return addLeafCondition(predicate.kind, predicate.attribute, predicate.compOp, predicate.value);
+
+    unsigned index = conditions.size();
+    ScanCondition condition = ScanCondition();
+    condition.kind = predicate.kind;
+    conditions.push_back(condition);
+    for (unsigned i = 0; i < predicate.terms.size(); i++)
+    {
+        conditions[index].terms.push_back(conditions.size());
+        RC rc = addCondition(predicate.terms[i]);
+        if (rc)
+            return rc;
+    }
+    return SUCCESS;
+}
 
-    for (unsigned i = 0; i < attributeNames.size(); i++)
+RC RBFM_ScanIterator::addLeafCondition(PredicateKind kind, const string &attribute, CompOp compOp, const void *value)
+{
+    ScanCondition condition = ScanCondition();
+    condition.kind = kind;
+    condition.attrIndex = layout.getIndex(attribute);
+    if (condition.attrIndex == layout.getFieldCount())
+        return RBFM_NO_SUCH_ATTR;
+    condition.type = layout.getType(condition.attrIndex);
+    condition.compOp = compOp;
+    condition.hasValue = value != NULL;
+    if (condition.type == TypeInt && value != NULL)
+        memcpy(&condition.intValue, value, INT_SIZE);
+    if (condition.type == TypeReal && value != NULL)
+        memcpy(&condition.realValue, value, REAL_SIZE);
+    if (condition.type == TypeVarChar && value != NULL)
     {
-        // Get index and type of attribute in record
-        auto pred = [&](Attribute a) {return a.name == attributeNames[i];};
-        auto iterPos = find_if(recordDescriptor.begin(), recordDescriptor.end(), pred);
-        unsigned index = distance(recordDescriptor.begin(), iterPos);
-        if (index == recordDescriptor.size())
-            return RBFM_NO_SUCH_ATTR;
-        AttrType type = recordDescriptor[index].type;
-
-        // Read attribute into buffer
-        rbfm->getAttributeFromRecord(pageData, recordEntry.offset, index, type, buffer);
-        // Determine if null
-        char null;
-        memcpy (&null, buffer, 1);
-        if (null)
+        memcpy(&condition.stringLength, value, VARCHAR_LENGTH_SIZE);
+        condition.stringValue = (const char *) value + VARCHAR_LENGTH_SIZE;
+        condition.stringPrefix = varCharPrefix(condition.stringValue, condition.stringLength);
+    }
+    conditions.push_back(condition);
+    return SUCCESS;
+}
+
+RC RBFM_ScanIterator::getNextSlot()
+{
+    // Walk the slots until one holds a record that meets the scan condition
+    while (true)
+    {
+        // If we're done with the current page, or we've read the last page
+        if (currSlot >= totalSlot || currPage >= totalPage)
         {
-            int indicatorIndex = i / CHAR_BIT;
-            char indicatorMask  = 1 << (CHAR_BIT - 1 - (i % CHAR_BIT));
-            nullIndicator[indicatorIndex] |= indicatorMask;
+            // Reinitialize the current slot and increment page number
+            currSlot = 0;
+            currPage++;
+            skipPages();
+            // If we're done with last page, return EOF
+            if (currPage >= totalPage)
+                return RBFM_EOF;
+            // Otherwise get next page ready
+            RC rc = getNextPage();
+            if (rc)
+                return rc;
+            continue;
         }
-        // Read from buffer into data
-        else if (type == TypeInt)
+
+        // The page's selection already says which slots match
+        if (pageFiltered)
         {
-            memcpy ((char*)data + dataOffset, (char*)buffer + 1, INT_SIZE);
-            dataOffset += INT_SIZE;
+            currSlot = nextSelectedSlot(currSlot);
+            if (currSlot < totalSlot)
+                return SUCCESS;
+            continue;
         }
-        else if (type == TypeReal)
+
+        // Check the slot holds a record, or for PAX pages the row is used, and that it meets
+        // the scan condition
+        bool valid = pax ? paxBitIsSet((const char *) pageData + sizeof(PaxPageHeader), currSlot)
+                         : rbfm->getSlotStatus(rbfm->getSlotDirectoryRecordEntry(pageData, currSlot)) == VALID;
+        if (valid && checkScanCondition())
+            return SUCCESS;
+        currSlot++;
+    }
+}
+
+// Point view at the record in slotNum of the current page
+void RBFM_ScanIterator::attachView(RecordView &view, unsigned slotNum)
+{
+    if (pax)
+    {
+        view.attachPax((const char *) pageData, slotNum);
+        return;
+    }
+    SlotDirectoryRecordEntry recordEntry = rbfm->getSlotDirectoryRecordEntry(pageData, slotNum);
+    view.attach((const char *) pageData, recordEntry.offset);
+}
+
+// Write the projection of the record in the current slot to data, in the format of
+// RecordBasedFileManager::insertRecord, decoding each field straight from the record's column
+// offsets, or the projected minipages of a PAX page. Returns its size, or 0 if it is larger
+// than capacity; the capacity bytes of data may then hold part of it.
+unsigned RBFM_ScanIterator::projectRecord(void *data, unsigned capacity)
+{
+    RecordView view;
+    attachView(view, currSlot);
+
+    unsigned nullIndicatorSize = rbfm->getNullIndicatorSize(projection.size());
+    if (nullIndicatorSize > capacity)
+        return 0;
+    char *out = (char *) data;
+    memset(out, 0, nullIndicatorSize);
+    unsigned dataOffset = nullIndicatorSize;
+    for (unsigned i = 0; i < projection.size(); i++)
+    {
+        unsigned index = projection[i];
+        if (view.isNull(index))
         {
-            memcpy ((char*)data + dataOffset, (char*)buffer + 1, REAL_SIZE);
-            dataOffset += REAL_SIZE;
+            out[i / CHAR_BIT] |= 1 << (CHAR_BIT - 1 - (i % CHAR_BIT));
+            continue;
+        }
+        // Ints and Reals are stored as they are returned; VarChars gain their length
+        bool varChar = layout.getType(index) == TypeVarChar;
+        uint32_t length;
+        const char *field = view.fieldData(index, varChar, length);
+        if (dataOffset + (varChar ? VARCHAR_LENGTH_SIZE : 0) + length > capacity)
+            return 0;
+        if (varChar)
+        {
+            memcpy(out + dataOffset, &length, VARCHAR_LENGTH_SIZE);
+            dataOffset += VARCHAR_LENGTH_SIZE;
         }
-        else if (type == TypeVarChar)
+        memcpy(out + dataOffset, field, length);
+        dataOffset += length;
+    }
+    return dataOffset;
+}
+
+RC RBFM_ScanIterator::getNextPage()
+{
+    // Once the file is being extended the map no longer covers it, go back to buffered reads
+    if (scanMode == SCAN_MMAP && fileHandle.getNumberOfPages() != mappedPageCount)
+        scanMode = SCAN_BUFFERED;
+
+    // Use the mapped page in place unless the buffer pool has a newer version of it
+    if (scanMode == SCAN_MMAP && currPage < mappedPageCount && !fileHandle.isPageBuffered(currPage))
+    {
+        pageData = (char *) mappedPages + (size_t) currPage * PAGE_SIZE;
+        // The map bypasses readPage, so verify the page here
+        if (!fileHandle.checkPage(pageData))
+            return RBFM_READ_FAILED;
+        startPage();
+        return SUCCESS;
+    }
+
+    readAhead();
+
+    // Copy the page out of the buffer pool so the scan sees a stable snapshot of it
+    void *page;
+    if (fileHandle.fetchPage(currPage, page))
+        return RBFM_READ_FAILED;
+    pageData = pageBuffer;
+    memcpy(pageData, page, PAGE_SIZE);
+    fileHandle.unpinPage(currPage, false);
+
+    startPage();
+    return SUCCESS;
+}
+
+// Count the slots of the page in pageData and evaluate what can be for all of them at once
+void RBFM_ScanIterator::startPage()
+{
+    encodedPage = NULL;
+    if (pax && rbfm->getPaxPageHeader(pageData).kind == RBFM_PAX_COMPRESSED)
+    {
+        startCompressedPage();
+        return;
+    }
+    totalSlot = pax ? rbfm->getPaxPageHeader(pageData).rowCount : rbfm->getSlotDirectoryHeader(pageData).recordEntriesNumber;
+    pageFiltered = filtered;
+    filterPage();
+}
+
+// Gather the condition attribute of every slot on the current page into a column and
+// evaluate the condition over all of it at once
+void RBFM_ScanIterator::filterPage()
+{
+    if (!filtered)
+        return;
+    if (pax)
+    {
+        filterPaxPage();
+        return;
+    }
+    const ScanCondition &condition = *rootCondition;
+    unsigned words = (totalSlot + 63) / 64;
+    present.assign(words, 0);
+    selection.resize(words);
+    if (condition.type == TypeInt)
+        intColumn.resize(totalSlot);
+    else
+        realColumn.resize(totalSlot);
+
+    RecordView view;
+    for (unsigned i = 0; i < totalSlot; i++)
+    {
+        SlotDirectoryRecordEntry recordEntry = rbfm->getSlotDirectoryRecordEntry(pageData, i);
+        bool hasValue = false;
+        if (rbfm->getSlotStatus(recordEntry) == VALID)
         {
-            uint32_t varcharSize;
-            memcpy(&varcharSize, (char*)buffer + 1, VARCHAR_LENGTH_SIZE);
-            memcpy((char*)data + dataOffset, &varcharSize, VARCHAR_LENGTH_SIZE);
-            dataOffset += VARCHAR_LENGTH_SIZE;
-            memcpy((char*)data + dataOffset, (char*)buffer + 1 + VARCHAR_LENGTH_SIZE, varcharSize);
-            dataOffset += varcharSize;
+            view.attach((const char *) pageData, recordEntry.offset);
+            hasValue = !view.isNull(condition.attrIndex);
         }
+        if (hasValue)
+            present[i / 64] |= (uint64_t) 1 << (i % 64);
+        if (condition.type == TypeInt)
+            intColumn[i] = hasValue ? view.getInt(condition.attrIndex) : 0;
+        else
+            realColumn[i] = hasValue ? view.getReal(condition.attrIndex) : 0;
     }
-    // Finally set null indicator of data, clean up and return
-    memcpy((char*)data, nullIndicator, nullIndicatorSize);
 
-    free (buffer);
-    rid.pageNum = currPage;
-    rid.slotNum = currSlot++;
-    return SUCCESS;
+    if (condition.type == TypeInt)
+        selectInt(intColumn.data(), totalSlot, condition.compOp, condition.intValue, selection.data());
+    else
+        selectReal(realColumn.data(), totalSlot, condition.compOp, condition.realValue, selection.data());
+    for (unsigned w = 0; w < words; w++)
+        selection[w] &= present[w];
 }
 
-// Private helper methods ///////////////////////////////////////////////////////////////////
-
-RC RBFM_ScanIterator::getNextSlot()
+// A PAX page already keeps the condition attribute as a column: evaluate the condition on its
+// minipage where it lies, then keep the used rows where the attribute is not null
+void RBFM_ScanIterator::filterPaxPage()
 {
-    // If we're done with the current page, or we've read the last page
-    if (currSlot >= totalSlot || currPage >= totalPage)
-    {
-        // Reinitialize the current slot and increment page number
-        currSlot = 0;
-        currPage++;
-        // If we're done with last page, return EOF
-        if (currPage >= totalPage)
-            return RBFM_EOF;
-        // Otherwise get next page ready
-        RC rc = getNextPage();
-        if (rc)
-            return rc;
+    const ScanCondition &condition = *rootCondition;
+    PaxPageHeader header = rbfm->getPaxPageHeader(pageData);
+    unsigned words = (totalSlot + 63) / 64;
+    selection.resize(words);
+    // Pages laid out before the attribute was added hold it for no record
+    if (condition.attrIndex >= header.fieldCount)
+    {
+        selection.assign(words, 0);
+        return;
     }
 
-    // Get slot header, check to see if valid and meets scan condition
-    SlotDirectoryRecordEntry recordEntry = rbfm->getSlotDirectoryRecordEntry(pageData, currSlot);
-
-    if (rbfm->getSlotStatus(recordEntry) != VALID || !checkScanCondition())
+    const char *used = (const char *) pageData + sizeof(PaxPageHeader);
+    const char *nulls = (const char *) pageData + paxColumnOffset(header.capacity, condition.attrIndex);
+    const char *cells = nulls + paxBitmapBytes(header.capacity);
+    if (condition.type == TypeInt)
+        selectInt((const int32_t *) cells, totalSlot, condition.compOp, condition.intValue, selection.data());
+    else
+        selectReal((const float *) cells, totalSlot, condition.compOp, condition.realValue, selection.data());
+    for (unsigned w = 0; w < words; w++)
     {
-        // If not, try next slot
-        currSlot++;
-        return getNextSlot();
+        uint64_t usedRows, nullRows;
+        memcpy(&usedRows, used + w * sizeof(uint64_t), sizeof(uint64_t));
+        memcpy(&nullRows, nulls + w * sizeof(uint64_t), sizeof(uint64_t));
+        selection[w] &= usedRows & ~nullRows;
     }
-    return SUCCESS;
 }
 
-RC RBFM_ScanIterator::getNextPage()
+// The first selected slot at or after slotNum, totalSlot if there is none
+unsigned RBFM_ScanIterator::nextSelectedSlot(unsigned slotNum)
 {
-    // Read in page
-    if (fileHandle.readPage(currPage, pageData))
-        return RBFM_READ_FAILED;
+    unsigned words = (totalSlot + 63) / 64;
+    unsigned w = slotNum / 64;
+    uint64_t bits = selection[w] & (~(uint64_t) 0 << (slotNum % 64));
+    while (bits == 0)
+    {
+        if (++w >= words)
+            return totalSlot;
+        bits = selection[w];
+    }
+    return w * 64 + __builtin_ctzll(bits);
+}
 
-    // Update slot total
-    SlotDirectoryHeader header = rbfm->getSlotDirectoryHeader(pageData);
-    totalSlot = header.recordEntriesNumber;
-    return SUCCESS;
+// Keep the pages after the current one loading into the buffer pool
+void RBFM_ScanIterator::readAhead()
+{
+    unsigned window = fileHandle.getReadAhead();
+    if (window == 0)
+        return;
+
+    // Top the window up in one batch once half of it has been consumed
+    uint32_t first = max(readAheadPage, currPage + 1);
+    uint32_t last = min(currPage + window, totalPage - 1);
+    if (first > last || first > currPage + window / 2 + 1)
+        return;
+
+    readAheadPages.clear();
+    for (uint32_t page = first; page <= last; page++)
+        if (!isPruned(page))
+            readAheadPages.push_back(page);
+    fileHandle.prefetchPages(readAheadPages);
+    readAheadPage = last + 1;
 }
 
 bool RBFM_ScanIterator::checkScanCondition()
 {
-    if (compOp == NO_OP) return true;
-    if (value == NULL) return false;
-    Attribute attr = recordDescriptor[attrIndex];
-    // Allocate enough memory to hold attribute and 1 byte null indicator
-    void *data = malloc(1 + attr.length);
-    // Get record entry to get offset
-    SlotDirectoryRecordEntry recordEntry = rbfm->getSlotDirectoryRecordEntry(pageData, currSlot);
-    // Grab the given attribute and store it in data
-    rbfm->getAttributeFromRecord(pageData, recordEntry.offset, attrIndex, attr.type, data);
-
-    char null;
-    memcpy(&null, data, 1);
+    if (rootCondition == NULL)
+        return true;
+    // Read the attributes where they lie on the page
+    RecordView view;
+    if (pax)
+        view.attachPax((const char *) pageData, currSlot);
+    else
+        view.attach((const char *) pageData, rbfm->getSlotDirectoryRecordEntry(pageData, currSlot).offset);
+    return checkScanCondition(*rootCondition, view);
+}
 
-    bool result = false;
-    if (null)
+// Evaluate condition on the record in view
+bool RBFM_ScanIterator::checkScanCondition(ScanCondition &condition, const RecordView &view)
+{
+    switch (condition.kind)
     {
-        result = false;
+        case PRED_COMPARE:
+            if (condition.compOp == NO_OP)
+                return true;
+            if (!condition.hasValue || view.isNull(condition.attrIndex))
+                return false;
+            if (condition.type == TypeInt)
+                return checkScanCondition(view.getInt(condition.attrIndex), condition.compOp, condition.intValue);
+            if (condition.type == TypeReal)
+                return checkScanCondition(view.getReal(condition.attrIndex), condition.compOp, condition.realValue);
+            return checkScanCondition(view.getVarChar(condition.attrIndex), condition);
+        case PRED_IS_NULL: return view.isNull(condition.attrIndex);
+        case PRED_IS_NOT_NULL: return !view.isNull(condition.attrIndex);
+        case PRED_NOT: return !checkScanCondition(conditions[condition.terms[0]], view);
+        default: break;
     }
-    // Checkscan condition on record data and scan value
-    else if (attr.type == TypeInt)
+
+    // An AND is decided by the first term that fails, an OR by the first that passes
+    bool decisive = condition.kind == PRED_OR;
+    bool result = !decisive;
+    for (unsigned i = 0; i < condition.terms.size(); i++)
     {
-        int32_t recordInt;
-        memcpy(&recordInt, (char*)data + 1, INT_SIZE);
-        result = checkScanCondition(recordInt, compOp, value);
+        ScanCondition &term = conditions[condition.terms[i]];
+        bool passed = checkScanCondition(term, view);
+        term.evaluations++;
+        term.passes += passed;
+        if (passed == decisive)
+        {
+            result = decisive;
+            break;
+        }
     }
-    else if (attr.type == TypeReal)
+    if (++condition.sinceReorder >= RBFM_PREDICATE_REORDER)
+        reorderTerms(condition);
+    return result;
+}
+
+// Order the terms of an AND by how rarely they have passed, those of an OR by how often
+void RBFM_ScanIterator::reorderTerms(ScanCondition &condition)
+{
+    // Terms that have not been evaluated yet count as passing half the time. Insertion sort,
+    // as there are few terms and it keeps equal ones in place.
+    vector<unsigned> &terms = condition.terms;
+    for (unsigned i = 1; i < terms.size(); i++)
     {
-        float recordReal;
-        memcpy(&recordReal, (char*)data + 1, REAL_SIZE);
-        result = checkScanCondition(recordReal, compOp, value);
+        unsigned term = terms[i];
+        unsigned j = i;
+        for (; j > 0; j--)
+        {
+            const ScanCondition &a = conditions[term];
+            const ScanCondition &b = conditions[terms[j - 1]];
+            uint64_t rateA = (uint64_t) (a.passes + 1) * (b.evaluations + 2);
+            uint64_t rateB = (uint64_t) (b.passes + 1) * (a.evaluations + 2);
+            if (condition.kind == PRED_OR ? rateA <= rateB : rateA >= rateB)
+                break;
+            terms[j] = terms[j - 1];
+        }
+        terms[j] = term;
     }
-    else if (attr.type == TypeVarChar)
-    {
-        uint32_t varcharSize;
-        memcpy(&varcharSize, (char*)data + 1, VARCHAR_LENGTH_SIZE);
-        char recordString[varcharSize + 1];
-        memcpy(recordString, (char*)data + 1 + VARCHAR_LENGTH_SIZE, varcharSize);
-        recordString[varcharSize] = '\0';
 
-        result = checkScanCondition(recordString, compOp, value);
+    // Older evaluations count for less, so the order follows the records as the scan goes on
+    for (unsigned i = 0; i < terms.size(); i++)
+    {
+        conditions[terms[i]].evaluations /= 2;
+        conditions[terms[i]].passes /= 2;
     }
-    free (data);
-    return result;
+    condition.sinceReorder = 0;
 }
 
-bool RBFM_ScanIterator::checkScanCondition(int recordInt, CompOp compOp, const void *value)
+bool RBFM_ScanIterator::checkScanCondition(int32_t recordInt, CompOp compOp, int32_t intValue)
 {
-    int32_t intValue;
-    memcpy (&intValue, value, INT_SIZE);
-
     switch (compOp)
     {
         case EQ_OP: return recordInt == intValue;
@@ -719,11 +1543,8 @@ bool RBFM_ScanIterator::checkScanCondition(int recordInt, CompOp compOp, const v
     }
 }
 
-bool RBFM_ScanIterator::checkScanCondition(float recordReal, CompOp compOp, const void *value)
+bool RBFM_ScanIterator::checkScanCondition(float recordReal, CompOp compOp, float realValue)
 {
-    float realValue;
-    memcpy (&realValue, value, REAL_SIZE);
-
     switch (compOp)
     {
         case EQ_OP: return recordReal == realValue;
@@ -738,39 +1559,294 @@ bool RBFM_ScanIterator::checkScanCondition(float recordReal, CompOp compOp, cons
     }
 }
 
-bool RBFM_ScanIterator::checkScanCondition(char *recordString, CompOp compOp, const void *value)
+bool RBFM_ScanIterator::checkScanCondition(const VarCharView &recordString, const ScanCondition &condition)
 {
-    if (compOp == NO_OP)
-        return true;
-
-    int32_t valueSize;
-    memcpy(&valueSize, value, VARCHAR_LENGTH_SIZE);
-    char valueStr[valueSize + 1];
-    valueStr[valueSize] = '\0';
-    memcpy(valueStr, (char*) value + VARCHAR_LENGTH_SIZE, valueSize);
+    // Strings of different lengths are never equal
+    if (condition.compOp == EQ_OP || condition.compOp == NE_OP)
+    {
+        if (recordString.length != condition.stringLength)
+            return condition.compOp == NE_OP;
+        bool equal = memcmp(recordString.data, condition.stringValue, condition.stringLength) == 0;
+        return equal == (condition.compOp == EQ_OP);
+    }
 
-    int cmp = strcmp(recordString, valueStr);
-    switch (compOp)
+    // Prefixes that differ order the strings as memcmp would; otherwise compare the rest, and
+    // then the shorter string comes first
+    int cmp;
+    uint64_t recordPrefix = varCharPrefix(recordString.data, recordString.length);
+    if (recordPrefix != condition.stringPrefix)
+        cmp = recordPrefix < condition.stringPrefix ? -1 : 1;
+    else
+    {
+        cmp = memcmp(recordString.data, condition.stringValue, min(recordString.length, condition.stringLength));
+        if (cmp == 0)
+            cmp = recordString.length < condition.stringLength ? -1 : recordString.length > condition.stringLength;
+    }
+    switch (condition.compOp)
     {
-        case EQ_OP: return cmp == 0;
         case LT_OP: return cmp <  0;
         case GT_OP: return cmp >  0;
         case LE_OP: return cmp <= 0;
         case GE_OP: return cmp >= 0;
-        case NE_OP: return cmp != 0;
+        case NO_OP: return true;
         // Should never happen
         default: return false;
     }
 }
 
+// Layouts the descriptor overloads built on this thread, reused for as long as callers keep
+// passing equal descriptors
+typedef struct LayoutCache
+{
+    shared_ptr<const RecordLayout> layouts[RBFM_LAYOUT_CACHE];
+    unsigned next;      // Replaced on the next miss
+
+    LayoutCache() : next(0) {}
+} LayoutCache;
+
+static thread_local LayoutCache layoutCache;
+
+// Callers hold on to the layout for as long as they use it; the cache may drop it meanwhile
+shared_ptr<const RecordLayout> RecordBasedFileManager::getLayout(const vector<Attribute> &recordDescriptor)
+{
+    size_t key = RecordLayout::keyOf(recordDescriptor);
+    for (unsigned i = 0; i < RBFM_LAYOUT_CACHE; i++)
+        if (layoutCache.layouts[i] && layoutCache.layouts[i]->describes(recordDescriptor, key))
+            return layoutCache.layouts[i];
+
+    shared_ptr<const RecordLayout> &layout = layoutCache.layouts[layoutCache.next];
+    layoutCache.next = (layoutCache.next + 1) % RBFM_LAYOUT_CACHE;
+    layout = make_shared<const RecordLayout>(recordDescriptor);
+    return layout;
+}
+
+RecordLayout::RecordLayout()
+: key(keyOf(descriptor)), nullIndicatorSize(0), fixedPrefixFields(0), paxVarCharBytes(0), paxCapacity(0)
+{
+}
+
+RecordLayout::RecordLayout(const vector<Attribute> &recordDescriptor)
+: descriptor(recordDescriptor), key(keyOf(recordDescriptor)),
+  nullIndicatorSize((recordDescriptor.size() + CHAR_BIT - 1) / CHAR_BIT), fixedPrefixFields(0)
+{
+    types.reserve(descriptor.size());
+    for (unsigned i = 0; i < descriptor.size(); i++)
+    {
+        types.push_back(descriptor[i].type);
+        // The first of several attributes with the same name wins, as with a linear search
+        indexes.insert(make_pair(descriptor[i].name, i));
+    }
+
+    // Int and Real are both 4 bytes wide
+    while (fixedPrefixFields < types.size() && types[fixedPrefixFields] != TypeVarChar)
+        fixedPrefixFields++;
+    fixedPrefixMask.assign((fixedPrefixFields + CHAR_BIT - 1) / CHAR_BIT, 0);
+    for (unsigned i = 0; i < fixedPrefixFields; i++)
+        fixedPrefixMask[i / CHAR_BIT] |= 1 << (CHAR_BIT - 1 - (i % CHAR_BIT));
+
+    // A PAX page takes rows while their blocks and the heap room of their VarChars still fit
+    paxVarCharBytes = 0;
+    for (unsigned i = 0; i < types.size(); i++)
+        if (types[i] == TypeVarChar)
+            paxVarCharBytes += descriptor[i].length;
+    paxCapacity = 0;
+    while (paxColumnOffset(paxCapacity + 1, types.size()) + (paxCapacity + 1) * paxVarCharBytes <= RBFM_PAGE_END)
+        paxCapacity++;
+}
+
+size_t RecordLayout::keyOf(const vector<Attribute> &recordDescriptor)
+{
+    hash<string> hashName;
+    size_t key = recordDescriptor.size();
+    for (unsigned i = 0; i < recordDescriptor.size(); i++)
+    {
+        size_t attribute = hashName(recordDescriptor[i].name) ^ ((size_t) recordDescriptor[i].type << 29) ^ recordDescriptor[i].length;
+        key ^= attribute + 0x9e3779b97f4a7c15ULL + (key << 6) + (key >> 2);
+    }
+    return key;
+}
+
+bool RecordLayout::describes(const vector<Attribute> &recordDescriptor, size_t key) const
+{
+    if (key != this->key || recordDescriptor.size() != descriptor.size())
+        return false;
+    for (unsigned i = 0; i < descriptor.size(); i++)
+        if (recordDescriptor[i].type != descriptor[i].type || recordDescriptor[i].length != descriptor[i].length)
+            return false;
+    return true;
+}
+
+unsigned RecordLayout::getIndex(const string &name) const
+{
+    unordered_map<string, unsigned>::const_iterator it = indexes.find(name);
+    return it == indexes.end() ? getFieldCount() : it->second;
+}
+
+RC RecordLayout::getProjection(const vector<string> &names, vector<unsigned> &projection) const
+{
+    projection.clear();
+    for (unsigned i = 0; i < names.size(); i++)
+    {
+        unsigned index = getIndex(names[i]);
+        if (index == getFieldCount())
+            return RBFM_NO_SUCH_ATTR;
+        projection.push_back(index);
+    }
+    return SUCCESS;
+}
+
+bool RecordLayout::hasFixedPrefix(const char *nullIndicator) const
+{
+    if (fixedPrefixFields == 0)
+        return false;
+    for (unsigned i = 0; i < fixedPrefixMask.size(); i++)
+        if (nullIndicator[i] & fixedPrefixMask[i])
+            return false;
+    return true;
+}
+
+RecordView::RecordView()
+: fileHandle(NULL), pageNum(0), record(NULL), fieldCount(0), nullIndicator(NULL), directory(NULL), dataOffset(0),
+  pax(false), row(0), columnBytes(0), image(NULL)
+{
+}
+
+RecordView::~RecordView()
+{
+    release();
+}
+
+RC RecordView::release()
+{
+    RC rc = SUCCESS;
+    if (fileHandle != NULL)
+        rc = fileHandle->unpinPage(pageNum, false);
+    if (image != NULL)
+        returnPage(image);
+    image = NULL;
+    fileHandle = NULL;
+    record = NULL;
+    fieldCount = 0;
+    return rc;
+}
+
+// Point the view at the record starting at offset in page; see setRecordAtOffset for the layout
+void RecordView::attach(const char *page, int32_t offset)
+{
+    record = page + offset;
+    memcpy(&fieldCount, record, sizeof(RecordLength));
+    nullIndicator = record + sizeof(RecordLength);
+    unsigned nullIndicatorSize = (fieldCount + CHAR_BIT - 1) / CHAR_BIT;
+    directory = nullIndicator + nullIndicatorSize;
+    dataOffset = sizeof(RecordLength) + nullIndicatorSize + fieldCount * sizeof(ColumnOffset);
+    pax = false;
+}
+
+// Point the view at row of a PAX page
+void RecordView::attachPax(const char *page, unsigned row)
+{
+    PaxPageHeader header;
+    memcpy(&header, page, sizeof(PaxPageHeader));
+    // Field 0's block follows the used rows bitmap, which is as large as a null bitmap
+    unsigned bitmapBytes = paxBitmapBytes(header.capacity);
+    record = page;
+    fieldCount = header.fieldCount;
+    nullIndicator = page + sizeof(PaxPageHeader) + bitmapBytes;
+    directory = nullIndicator + bitmapBytes;
+    columnBytes = paxColumnBytes(header.capacity);
+    pax = true;
+    this->row = row;
+}
+
+// A field starts where the one before it ends; null fields take no space
+unsigned RecordView::fieldStart(unsigned i) const
+{
+    if (i == 0)
+        return dataOffset;
+    ColumnOffset end;
+    memcpy(&end, directory + (i - 1) * sizeof(ColumnOffset), sizeof(ColumnOffset));
+    return end;
+}
+
+bool RecordView::isNull(unsigned i) const
+{
+    if (i >= fieldCount)
+        return true;
+    if (pax)
+        return paxBitIsSet(nullIndicator + i * columnBytes, row);
+    return (nullIndicator[i / CHAR_BIT] & (1 << (CHAR_BIT - 1 - (i % CHAR_BIT)))) != 0;
+}
+
+int32_t RecordView::getInt(unsigned i) const
+{
+    int32_t value = 0;
+    uint32_t length;
+    if (!isNull(i))
+        memcpy(&value, fieldData(i, false, length), INT_SIZE);
+    return value;
+}
+
+float RecordView::getReal(unsigned i) const
+{
+    float value = 0;
+    uint32_t length;
+    if (!isNull(i))
+        memcpy(&value, fieldData(i, false, length), REAL_SIZE);
+    return value;
+}
+
+unsigned RecordView::fieldEnd(unsigned i) const
+{
+    ColumnOffset end;
+    memcpy(&end, directory + i * sizeof(ColumnOffset), sizeof(ColumnOffset));
+    return end;
+}
+
+VarCharView RecordView::getVarChar(unsigned i) const
+{
+    VarCharView value = { record, 0 };
+    if (isNull(i))
+        return value;
+    value.data = fieldData(i, true, value.length);
+    return value;
+}
+
+// The bytes of non-null field i and their count: the record's own bytes, or a PAX row's cell
+// or VarChar
+const char *RecordView::fieldData(unsigned i, bool varChar, uint32_t &length) const
+{
+    if (!pax)
+    {
+        // As fieldStart and fieldEnd, read together
+        ColumnOffset start = dataOffset, end;
+        if (i > 0)
+            memcpy(&start, directory + (i - 1) * sizeof(ColumnOffset), sizeof(ColumnOffset));
+        memcpy(&end, directory + i * sizeof(ColumnOffset), sizeof(ColumnOffset));
+        length = end - start;
+        return record + start;
+    }
+    const char *cell = directory + i * columnBytes + row * RBFM_PAX_CELL_SIZE;
+    if (!varChar)
+    {
+        length = INT_SIZE;
+        return cell;
+    }
+    PaxVarChar value;
+    memcpy(&value, cell, sizeof(PaxVarChar));
+    length = value.length;
+    return record + value.offset;
+}
+
 // Configures a new record based page, and puts it in "page".
 void RecordBasedFileManager::newRecordBasedPage(void * page)
 {
     memset(page, 0, PAGE_SIZE);
     // Writes the slot directory header.
     SlotDirectoryHeader slotHeader;
-    slotHeader.freeSpaceOffset = PAGE_SIZE;
+    slotHeader.freeSpaceOffset = RBFM_PAGE_END;
     slotHeader.recordEntriesNumber = 0;
+    slotHeader.freeSlotHead = RBFM_NO_FREE_SLOT;
+    slotHeader.fragmentedBytes = 0;
     setSlotDirectoryHeader(page, slotHeader);
 }
 
@@ -811,32 +1887,65 @@ void RecordBasedFileManager::setSlotDirectoryRecordEntry(void * page, unsigned r
             );
 }
 
-// Computes the free space of a page (function of the free space pointer and the slot directory size).
+// Computes the free space of a page: the gap between the slot directory and the free space pointer, plus the holes past it.
 unsigned RecordBasedFileManager::getPageFreeSpaceSize(void * page) 
+{
+    return getContiguousFreeSpaceSize(page) + getSlotDirectoryHeader(page).fragmentedBytes;
+}
+
+// Computes the free space a record can be written to without compacting the page.
+unsigned RecordBasedFileManager::getContiguousFreeSpaceSize(void * page) 
 {
     SlotDirectoryHeader slotHeader = getSlotDirectoryHeader(page);
     return slotHeader.freeSpaceOffset - slotHeader.recordEntriesNumber * sizeof(SlotDirectoryRecordEntry) - sizeof(SlotDirectoryHeader);
 }
 
-unsigned RecordBasedFileManager::getRecordSize(const vector<Attribute> &recordDescriptor, const void *data) 
+// Hand the bytes recordEntry covers back to the page. Bytes at the free space pointer join the
+// contiguous free space, any others become a hole.
+void RecordBasedFileManager::releaseRecordSpace(void *page, SlotDirectoryRecordEntry recordEntry)
 {
-    // Read in the null indicator
-    int nullIndicatorSize = getNullIndicatorSize(recordDescriptor.size());
-    char nullIndicator[nullIndicatorSize];
-    memset(nullIndicator, 0, nullIndicatorSize);
-    memcpy(nullIndicator, (char*) data, nullIndicatorSize);
+    SlotDirectoryHeader slotHeader = getSlotDirectoryHeader(page);
+    if ((uint32_t) recordEntry.offset == slotHeader.freeSpaceOffset)
+        slotHeader.freeSpaceOffset += recordEntry.length;
+    else
+        slotHeader.fragmentedBytes += recordEntry.length;
+    setSlotDirectoryHeader(page, slotHeader);
+}
+
+// Compact the page if fewer than size bytes lie free before the free space pointer
+void RecordBasedFileManager::makeContiguousSpace(void *page, unsigned size)
+{
+    if (getContiguousFreeSpaceSize(page) < size && getSlotDirectoryHeader(page).fragmentedBytes > 0)
+        reorganizePage(page);
+}
+
+unsigned RecordBasedFileManager::getRecordSize(const RecordLayout &layout, const void *data) 
+{
+    // The null indicator is read in place
+    unsigned nullIndicatorSize = layout.getNullIndicatorSize();
+    char *nullIndicator = (char*) data;
+    unsigned fieldCount = layout.getFieldCount();
 
     // Offset into *data. Start just after null indicator
     unsigned offset = nullIndicatorSize;
     // Running count of size. Initialize to size of header
-    unsigned size = sizeof (RecordLength) + (recordDescriptor.size()) * sizeof(ColumnOffset) + nullIndicatorSize;
+    unsigned size = sizeof (RecordLength) + fieldCount * sizeof(ColumnOffset) + nullIndicatorSize;
 
-    for (unsigned i = 0; i < (unsigned) recordDescriptor.size(); i++)
+    // Leading fixed width fields all present: take them in one step
+    unsigned i = 0;
+    if (layout.hasFixedPrefix(nullIndicator))
+    {
+        size += layout.getFixedPrefixSize();
+        offset += layout.getFixedPrefixSize();
+        i = layout.getFixedPrefixFields();
+    }
+
+    for (; i < fieldCount; i++)
     {
         // Skip null fields
         if (fieldIsNull(nullIndicator, i))
             continue;
-        switch (recordDescriptor[i].type)
+        switch (layout.getType(i))
         {
             case TypeInt:
                 size += INT_SIZE;
@@ -862,7 +1971,7 @@ unsigned RecordBasedFileManager::getRecordSize(const vector<Attribute> &recordDe
 // Calculate actual bytes for nulls-indicator for the given field counts
 int RecordBasedFileManager::getNullIndicatorSize(int fieldCount) 
 {
-    return int(ceil((double) fieldCount / CHAR_BIT));
+    return (fieldCount + CHAR_BIT - 1) / CHAR_BIT;
 }
 
 bool RecordBasedFileManager::fieldIsNull(char *nullIndicator, int i)
@@ -872,13 +1981,12 @@ bool RecordBasedFileManager::fieldIsNull(char *nullIndicator, int i)
     return (nullIndicator[indicatorIndex] & indicatorMask) != 0;
 }
 
-void RecordBasedFileManager::setRecordAtOffset(void *page, unsigned offset, const vector<Attribute> &recordDescriptor, const void *data)
+void RecordBasedFileManager::setRecordAtOffset(void *page, unsigned offset, const RecordLayout &layout, const void *data)
 {
-    // Read in the null indicator
-    int nullIndicatorSize = getNullIndicatorSize(recordDescriptor.size());
-    char nullIndicator[nullIndicatorSize];
-    memset (nullIndicator, 0, nullIndicatorSize);
-    memcpy(nullIndicator, (char*) data, nullIndicatorSize);
+    // The null indicator is read in place
+    unsigned nullIndicatorSize = layout.getNullIndicatorSize();
+    char *nullIndicator = (char*) data;
+    unsigned fieldCount = layout.getFieldCount();
 
     // Points to start of record
     char *start = (char*) page + offset;
@@ -888,7 +1996,7 @@ void RecordBasedFileManager::setRecordAtOffset(void *page, unsigned offset, cons
     // Offset into page header
     unsigned header_offset = 0;
 
-    RecordLength len = recordDescriptor.size();
+    RecordLength len = fieldCount;
     memcpy(start + header_offset, &len, sizeof(len));
     header_offset += sizeof(len);
 
@@ -897,10 +2005,23 @@ void RecordBasedFileManager::setRecordAtOffset(void *page, unsigned offset, cons
 
     // Keeps track of the offset of each record
     // Offset is relative to the start of the record and points to the END of a field
-    ColumnOffset rec_offset = header_offset + (recordDescriptor.size()) * sizeof(ColumnOffset);
+    ColumnOffset rec_offset = header_offset + fieldCount * sizeof(ColumnOffset);
 
+    // Leading fixed width fields all present: the same bytes in both formats, copy them at once
     unsigned i = 0;
-    for (i = 0; i < recordDescriptor.size(); i++)
+    if (layout.hasFixedPrefix(nullIndicator))
+    {
+        memcpy(start + rec_offset, (char*) data + data_offset, layout.getFixedPrefixSize());
+        data_offset += layout.getFixedPrefixSize();
+        for (; i < layout.getFixedPrefixFields(); i++)
+        {
+            rec_offset += INT_SIZE;
+            memcpy(start + header_offset, &rec_offset, sizeof(ColumnOffset));
+            header_offset += sizeof(ColumnOffset);
+        }
+    }
+
+    for (; i < fieldCount; i++)
     {
         if (!fieldIsNull(nullIndicator, i))
         {
@@ -908,7 +2029,7 @@ void RecordBasedFileManager::setRecordAtOffset(void *page, unsigned offset, cons
             char *data_start = (char*) data + data_offset;
 
             // Read in the data for the next column, point rec_offset to end of newly inserted data
-            switch (recordDescriptor[i].type)
+            switch (layout.getType(i))
             {
                 case TypeInt:
                     memcpy (start + rec_offset, data_start, INT_SIZE);
@@ -938,14 +2059,14 @@ void RecordBasedFileManager::setRecordAtOffset(void *page, unsigned offset, cons
     }
 }
 
-void RecordBasedFileManager::getRecordAtOffset(void *page, int32_t offset, const vector<Attribute> &recordDescriptor, void *data)
+void RecordBasedFileManager::getRecordAtOffset(void *page, int32_t offset, const RecordLayout &layout, void *data)
 {
     // Pointer to start of record
     char *start = (char*) page + offset;
 
     // Allocate space for null indicator. The returned null indicator may be larger than
     // the null indicator in the table has had fields added to it
-    int nullIndicatorSize = getNullIndicatorSize(recordDescriptor.size());
+    int nullIndicatorSize = layout.getNullIndicatorSize();
     char nullIndicator[nullIndicatorSize];
     memset(nullIndicator, 0, nullIndicatorSize);
 
@@ -957,8 +2078,8 @@ void RecordBasedFileManager::getRecordAtOffset(void *page, int32_t offset, const
     // Read in the existing null indicator
     memcpy (nullIndicator, start + sizeof(RecordLength), nullIndicatorSize);
 
-    // If this new recordDescriptor has had fields added to it, we set all of the new fields to null
-    for (unsigned i = len; i < recordDescriptor.size(); i++)
+    // If this new layout has had fields added to it, we set all of the new fields to null
+    for (unsigned i = len; i < layout.getFieldCount(); i++)
     {
         int indicatorIndex = (i+1) / CHAR_BIT;
         int indicatorMask  = 1 << (CHAR_BIT - 1 - (i % CHAR_BIT));
@@ -975,7 +2096,7 @@ void RecordBasedFileManager::getRecordAtOffset(void *page, int32_t offset, const
     // directory_base: points to the start of our directory of indices
     char *directory_base = start + sizeof(RecordLength) + recordNullIndicatorSize;
     
-    for (unsigned i = 0; i < recordDescriptor.size(); i++)
+    for (unsigned i = 0; i < layout.getFieldCount(); i++)
     {
         if (fieldIsNull(nullIndicator, i))
             continue;
@@ -988,7 +2109,7 @@ void RecordBasedFileManager::getRecordAtOffset(void *page, int32_t offset, const
         uint32_t fieldSize = endPointer - rec_offset;
 
         // Special case for varchar, we must give data the size of varchar first
-        if (recordDescriptor[i].type == TypeVarChar)
+        if (layout.getType(i) == TypeVarChar)
         {
             memcpy((char*) data + data_offset, &fieldSize, VARCHAR_LENGTH_SIZE);
             data_offset += VARCHAR_LENGTH_SIZE;
@@ -1002,37 +2123,113 @@ void RecordBasedFileManager::getRecordAtOffset(void *page, int32_t offset, const
 
 SlotStatus RecordBasedFileManager::getSlotStatus(SlotDirectoryRecordEntry slot)
 {
-    if (slot.length == 0 && slot.offset == 0)
+    // Record lengths are never 0, and no record is forwarded to page 0, the free-space map root
+    if (slot.length == 0)
         return DEAD;
     if (slot.offset <= 0)
         return MOVED;
     return VALID;
 }
 
-// Get first unused slot in page. Slot is considered unused if dead
-// If not dead slots returns recordEntriesNumber
-unsigned RecordBasedFileManager::getOpenSlot(void *page)
+// Take a dead slot off the head of the free-slot chain in slotHeader, the header of page.
+// If there are no dead slots returns recordEntriesNumber. The caller writes slotHeader back.
+unsigned RecordBasedFileManager::getOpenSlot(void *page, SlotDirectoryHeader &slotHeader)
 {
-    SlotDirectoryHeader header = getSlotDirectoryHeader(page);
-    unsigned i;
-    for (i = 0; i < header.recordEntriesNumber; i++)
+    if (slotHeader.freeSlotHead == RBFM_NO_FREE_SLOT)
+        return slotHeader.recordEntriesNumber;
+    unsigned slotNum = slotHeader.freeSlotHead;
+    SlotDirectoryRecordEntry recordEntry = getSlotDirectoryRecordEntry(page, slotNum);
+    slotHeader.freeSlotHead = recordEntry.offset == 0 ? RBFM_NO_FREE_SLOT : -recordEntry.offset - 1;
+    return slotNum;
+}
+
+// Mark slot as dead, free its record's bytes, and push it onto the page's free-slot chain
+void RecordBasedFileManager::markSlotDeleted(void *page, unsigned i)
+{
+    SlotDirectoryRecordEntry recordEntry = getSlotDirectoryRecordEntry(page, i);
+    SlotStatus status = getSlotStatus(recordEntry);
+    if (status == DEAD)
+        return;
+    if (status == VALID)
+        releaseRecordSpace(page, recordEntry);
+    SlotDirectoryHeader slotHeader = getSlotDirectoryHeader(page);
+    recordEntry.length = 0;
+    recordEntry.offset = slotHeader.freeSlotHead == RBFM_NO_FREE_SLOT ? 0 : -(int32_t) slotHeader.freeSlotHead - 1;
+    setSlotDirectoryRecordEntry(page, i, recordEntry);
+    slotHeader.freeSlotHead = i;
+    setSlotDirectoryHeader(page, slotHeader);
+}
+
+// Chain the page's dead slots afresh, lowest first, after slots were dropped from the directory
+void RecordBasedFileManager::rebuildFreeSlotChain(void *page)
+{
+    SlotDirectoryHeader slotHeader = getSlotDirectoryHeader(page);
+    uint32_t next = RBFM_NO_FREE_SLOT;
+    for (unsigned i = slotHeader.recordEntriesNumber; i-- > 0;)
     {
         SlotDirectoryRecordEntry recordEntry = getSlotDirectoryRecordEntry(page, i);
-        SlotStatus status = getSlotStatus(recordEntry);
-        if (status == DEAD)
-            return i;
+        if (getSlotStatus(recordEntry) != DEAD)
+            continue;
+        recordEntry.offset = next == RBFM_NO_FREE_SLOT ? 0 : -(int32_t) next - 1;
+        setSlotDirectoryRecordEntry(page, i, recordEntry);
+        next = i;
     }
-    return i;
+    slotHeader.freeSlotHead = next;
+    setSlotDirectoryHeader(page, slotHeader);
 }
 
-// Mark slot header as dead (all 0s)
-void RecordBasedFileManager::markSlotDeleted(void *page, unsigned i)
+RID RecordBasedFileManager::getForwardingAddress(SlotDirectoryRecordEntry recordEntry)
 {
-    memset  (
-            ((char*) page + sizeof(SlotDirectoryHeader) + i * sizeof(SlotDirectoryRecordEntry)),
-            0,
-            sizeof(SlotDirectoryRecordEntry)
-            );
+    RID rid;
+    rid.pageNum = recordEntry.length;
+    rid.slotNum = -recordEntry.offset;
+    return rid;
+}
+
+// A forwarding slot keeps the page of the record in its length and the negated slot in its offset.
+// A record still in the slot gives its bytes back to the page.
+void RecordBasedFileManager::setForwardingAddress(void *page, unsigned slotNum, const RID &target)
+{
+    SlotDirectoryRecordEntry recordEntry = getSlotDirectoryRecordEntry(page, slotNum);
+    if (getSlotStatus(recordEntry) == VALID)
+        releaseRecordSpace(page, recordEntry);
+    recordEntry.length = target.pageNum;
+    recordEntry.offset = -target.slotNum;
+    setSlotDirectoryRecordEntry(page, slotNum, recordEntry);
+}
+
+// Drop the dead slots at the end of the directory and close any gaps between records.
+// Returns whether the page changed.
+bool RecordBasedFileManager::compactPage(void *page, VacuumStats &stats)
+{
+    SlotDirectoryHeader slotHeader = getSlotDirectoryHeader(page);
+    unsigned slots = slotHeader.recordEntriesNumber;
+    while (slots > 0 && getSlotStatus(getSlotDirectoryRecordEntry(page, slots - 1)) == DEAD)
+        slots--;
+
+    unsigned liveBytes = 0;
+    for (unsigned i = 0; i < slots; i++)
+    {
+        SlotDirectoryRecordEntry recordEntry = getSlotDirectoryRecordEntry(page, i);
+        if (getSlotStatus(recordEntry) == VALID)
+            liveBytes += recordEntry.length;
+    }
+    bool fragmented = RBFM_PAGE_END - slotHeader.freeSpaceOffset != liveBytes;
+    if (slots == slotHeader.recordEntriesNumber && !fragmented)
+        return false;
+
+    if (slots == 0)
+        stats.pagesReclaimed++;
+    stats.pagesCompacted++;
+    if (slots != slotHeader.recordEntriesNumber)
+    {
+        slotHeader.recordEntriesNumber = slots;
+        setSlotDirectoryHeader(page, slotHeader);
+        rebuildFreeSlotChain(page);
+    }
+    if (fragmented)
+        reorganizePage(page);
+    return true;
 }
 
 // Consolidates free space in center of page
@@ -1040,35 +2237,26 @@ void RecordBasedFileManager::reorganizePage(void *page)
 {
     SlotDirectoryHeader header = getSlotDirectoryHeader(page);
 
-    // Add all live records to vector, keeping track of slot numbers
-    vector<IndexedRecordEntry> liveRecords;
-    for (unsigned i = 0; i < header.recordEntriesNumber; i++)
-    {
-        IndexedRecordEntry entry;
-        entry.slotNum = i;
-        entry.recordEntry = getSlotDirectoryRecordEntry(page, i);
-        if (getSlotStatus(entry.recordEntry) == VALID)
-            liveRecords.push_back(entry);
-    }
-    // Sort records by offset, descending
-    auto comp = [](IndexedRecordEntry first, IndexedRecordEntry second) 
-        {return first.recordEntry.offset > second.recordEntry.offset;};
-    sort(liveRecords.begin(), liveRecords.end(), comp);
+    // Copy the record area aside, then pack the live records back against the end of the page
+    // in slot order. Working from the copy needs no sorting and no care about overlaps; the
+    // scratch page comes from the per-thread pool.
+    ScratchPage scratch;
+    char *records = (char *) scratch.data();
+    memcpy(records + header.freeSpaceOffset, (char *) page + header.freeSpaceOffset, RBFM_PAGE_END - header.freeSpaceOffset);
 
-    // Move each record back filling in any gap preceding the record
-    uint16_t pageOffset = PAGE_SIZE;
-    SlotDirectoryRecordEntry current;
-    for (unsigned i = 0; i < liveRecords.size(); i++)
+    uint32_t pageOffset = RBFM_PAGE_END;
+    for (unsigned i = 0; i < header.recordEntriesNumber; i++)
     {
-        current = liveRecords[i].recordEntry;
+        SlotDirectoryRecordEntry current = getSlotDirectoryRecordEntry(page, i);
+        if (getSlotStatus(current) != VALID)
+            continue;
         pageOffset -= current.length;
-
-        // Use memmove rather than memcpy because locations may overlap
-        memmove((char*)page + pageOffset, (char*)page + current.offset, current.length);
+        memcpy((char *) page + pageOffset, records + current.offset, current.length);
         current.offset = pageOffset;
-        setSlotDirectoryRecordEntry(page, liveRecords[i].slotNum, current);
+        setSlotDirectoryRecordEntry(page, i, current);
     }
     header.freeSpaceOffset = pageOffset;
+    header.fragmentedBytes = 0;
     setSlotDirectoryHeader(page, header);
 }
 
@@ -1118,3 +2306,150 @@ void RecordBasedFileManager::getAttributeFromRecord(void *page, unsigned offset,
     // For all types, we then copy the data into the result
     memcpy((char*)data + data_offset, start + attrStart, len);
 }
+
+// Is the page part of the free-space map rather than a data page?
+bool RecordBasedFileManager::isFreeSpaceMapPage(PageNum pageNum)
+{
+    return pageNum == RBFM_FSM_ROOT || (pageNum - 1) % (RBFM_FSM_GROUP_PAGES + 1) == 0;
+}
+
+// Free space of a page as the free-space map stores it, rounded down
+unsigned RecordBasedFileManager::getFreeSpaceBucket(void *page, bool pax)
+{
+    unsigned freeSpace = pax ? getPaxFreeSpaceSize(page) : getPageFreeSpaceSize(page);
+    return min(freeSpace / RBFM_FSM_BUCKET_BYTES, 255U);
+}
+
+// Returns a pinned data page with at least size free bytes: the first one the free-space map
+// knows of, or a new one
+RC RecordBasedFileManager::findFreePage(FileHandle &fileHandle, unsigned size, PageNum &pageNum, void *&pageData)
+{
+    // Smallest bucket that guarantees the space; records too large for any bucket go to a new page
+    unsigned bucket = (size + RBFM_FSM_BUCKET_BYTES - 1) / RBFM_FSM_BUCKET_BYTES;
+    unsigned numPages = fileHandle.getNumberOfPages();
+    if (bucket > 255 || numPages <= RBFM_FSM_ROOT + 1)
+        return appendRecordBasedPage(fileHandle, pageNum, pageData);
+
+    // The root points us at a group
+    void *root;
+    if (fileHandle.fetchPage(RBFM_FSM_ROOT, root))
+        return RBFM_READ_FAILED;
+    unsigned char *groupBuckets = (unsigned char *) root;
+    unsigned numGroups = min((numPages - 2) / (RBFM_FSM_GROUP_PAGES + 1) + 1, (unsigned) RBFM_FSM_GROUPS);
+    unsigned group = 0;
+    while (group < numGroups && groupBuckets[group] < bucket)
+        group++;
+    if (group == numGroups)
+    {
+        fileHandle.unpinPage(RBFM_FSM_ROOT, false);
+        return appendRecordBasedPage(fileHandle, pageNum, pageData);
+    }
+
+    // And the group's leaf at a page
+    PageNum leafNum = 1 + group * (RBFM_FSM_GROUP_PAGES + 1);
+    void *leaf;
+    if (fileHandle.fetchPage(leafNum, leaf))
+    {
+        fileHandle.unpinPage(RBFM_FSM_ROOT, false);
+        return RBFM_READ_FAILED;
+    }
+    unsigned char *pageBuckets = (unsigned char *) leaf;
+    unsigned numEntries = min(numPages - leafNum - 1, (unsigned) RBFM_FSM_GROUP_PAGES);
+    unsigned entry = 0;
+    while (entry < numEntries && pageBuckets[entry] < bucket)
+        entry++;
+    if (entry == numEntries)
+    {
+        // The root was ahead of the leaf, set it straight
+        groupBuckets[group] = *max_element(pageBuckets, pageBuckets + RBFM_FSM_GROUP_PAGES);
+        fileHandle.unpinPage(leafNum, false);
+        fileHandle.unpinPageLazily(RBFM_FSM_ROOT);
+        return appendRecordBasedPage(fileHandle, pageNum, pageData);
+    }
+    fileHandle.unpinPage(leafNum, false);
+    fileHandle.unpinPage(RBFM_FSM_ROOT, false);
+
+    pageNum = leafNum + 1 + entry;
+    if (fileHandle.fetchPage(pageNum, pageData))
+        return RBFM_READ_FAILED;
+    unsigned freeSpace = isPaxFile(fileHandle) ? getPaxFreeSpaceSize(pageData) : getPageFreeSpaceSize(pageData);
+    if (freeSpace >= size)
+        return SUCCESS;
+
+    // The map promised more than the page has; correct it and use a new page
+    RC rc = updateFreeSpaceMap(fileHandle, pageNum, pageData);
+    fileHandle.unpinPage(pageNum, false);
+    if (rc)
+        return rc;
+    return appendRecordBasedPage(fileHandle, pageNum, pageData);
+}
+
+// Appends an empty record based page, and the map page of a new group first if the page starts one
+RC RecordBasedFileManager::appendRecordBasedPage(FileHandle &fileHandle, PageNum &pageNum, void *&pageData)
+{
+    RC rc = appendFreeSpaceMapPages(fileHandle);
+    if (rc)
+        return rc;
+
+    if (fileHandle.newPage(pageNum, pageData))
+        return RBFM_APPEND_FAILED;
+    if (isPaxFile(fileHandle))
+        memset(pageData, 0, PAGE_SIZE);
+    else
+        newRecordBasedPage(pageData);
+    return SUCCESS;
+}
+
+// Appends empty map pages until the next page appended will be a data page
+RC RecordBasedFileManager::appendFreeSpaceMapPages(FileHandle &fileHandle)
+{
+    while (isFreeSpaceMapPage(fileHandle.getNumberOfPages()))
+    {
+        PageNum mapNum;
+        void *mapData;
+        // The bound passes INT_MAX with 64 KB pages
+        if ((uint64_t) fileHandle.getNumberOfPages() > (uint64_t) RBFM_FSM_GROUPS * (RBFM_FSM_GROUP_PAGES + 1))
+            return RBFM_FILE_FULL;
+        if (fileHandle.newPage(mapNum, mapData))
+            return RBFM_APPEND_FAILED;
+        memset(mapData, 0, PAGE_SIZE);
+        if (fileHandle.unpinPage(mapNum, true))
+            return RBFM_WRITE_FAILED;
+    }
+    return SUCCESS;
+}
+
+// Stores the free space of a data page in the free-space map
+RC RecordBasedFileManager::updateFreeSpaceMap(FileHandle &fileHandle, PageNum pageNum, void *pageData)
+{
+    return setFreeSpaceBucket(fileHandle, pageNum, getFreeSpaceBucket(pageData, isPaxFile(fileHandle)));
+}
+
+// Stores the bucket of a data page in its leaf, and the leaf's largest bucket in the root
+RC RecordBasedFileManager::setFreeSpaceBucket(FileHandle &fileHandle, PageNum pageNum, unsigned char bucket)
+{
+    unsigned group = (pageNum - 1) / (RBFM_FSM_GROUP_PAGES + 1);
+    PageNum leafNum = 1 + group * (RBFM_FSM_GROUP_PAGES + 1);
+
+    void *leaf;
+    if (fileHandle.fetchPage(leafNum, leaf))
+        return RBFM_READ_FAILED;
+    unsigned char *pageBuckets = (unsigned char *) leaf;
+    if (pageBuckets[pageNum - leafNum - 1] == bucket)
+        return fileHandle.unpinPage(leafNum, false);
+    pageBuckets[pageNum - leafNum - 1] = bucket;
+    unsigned char largest = *max_element(pageBuckets, pageBuckets + RBFM_FSM_GROUP_PAGES);
+    // The map is only a hint, findFreePage checks the page it picks, so it needn't be written
+    // through with every record
+    if (fileHandle.unpinPageLazily(leafNum))
+        return RBFM_WRITE_FAILED;
+
+    void *root;
+    if (fileHandle.fetchPage(RBFM_FSM_ROOT, root))
+        return RBFM_READ_FAILED;
+    unsigned char *groupBuckets = (unsigned char *) root;
+    if (groupBuckets[group] == largest)
+        return fileHandle.unpinPage(RBFM_FSM_ROOT, false);
+    groupBuckets[group] = largest;
+    return fileHandle.unpinPageLazily(RBFM_FSM_ROOT);
+}
@@ -4,6 +4,8 @@
 #include <string>
 #include <vector>
 #include <climits>
+#include <memory>
+#include <unordered_map>
 
 #include "../rbf/pfm.h"
 
@@ -22,6 +24,11 @@
 #define RBFM_SLOT_DN_EXIST  7
 #define RBFM_READ_AFTER_DEL 8
 #define RBFM_NO_SUCH_ATTR   9
+#define RBFM_FILE_FULL      10
+#define RBFM_RECORD_TOO_LARGE 11
+#define RBFM_BATCH_TOO_SMALL  12
+#define RBFM_NO_ZONE_MAPS     13
+#define RBFM_CANNOT_ZONE      14
 
 using namespace std;
 
@@ -58,14 +65,185 @@ typedef enum
     NO_OP       // no condition
 } CompOp;
 
+// How a scan reads pages
+//   SCAN_BUFFERED: copy each page out of the buffer pool
+//   SCAN_MMAP:     walk the pages in place through a read-only memory map of the file;
+//                  pages modified in the buffer pool and pages appended during the scan
+//                  are still read through the buffer pool
+typedef enum { SCAN_BUFFERED = 0, SCAN_MMAP } ScanMode;
+
 // Slot directory headers for page organization
 // See chapter 9.6.2 of the cow book or lecture 3 slide 16 for more information
+// 32 bits wide so the header never limits the page size.
+// Records are packed downwards from RBFM_PAGE_END; the page checksum trailer follows it.
 typedef struct SlotDirectoryHeader
 {
-    uint16_t freeSpaceOffset;
-    uint16_t recordEntriesNumber;
+    uint32_t freeSpaceOffset;
+    uint32_t recordEntriesNumber;
+    uint32_t freeSlotHead;      // Most recently freed dead slot, RBFM_NO_FREE_SLOT if none
+    uint32_t fragmentedBytes;   // Bytes of holes left between records past freeSpaceOffset
 } SlotDirectoryHeader;
 
+// Records that are deleted, shrink or move off a page leave holes rather than have the page
+// compacted every time. The holes count as free space; a page is compacted only when a record
+// needs more contiguous room than lies before freeSpaceOffset.
+
+// Dead slots are chained through the directory so an insert takes one without scanning it.
+// A dead slot has length 0 and keeps the next dead slot in its offset as -(slot + 1);
+// an offset of 0 ends the chain.
+#define RBFM_NO_FREE_SLOT 0xFFFFFFFF
+
+#define RBFM_PAGE_END (PAGE_SIZE - PFM_CHECKSUM_SIZE)
+
+// Free-space map
+// Each data page's free space is kept as a one byte bucket, free bytes / RBFM_FSM_BUCKET_BYTES,
+// so a bucket promises at least that many bytes. Page 0 is the root: one byte per group holding
+// the largest bucket in the group. A group is a leaf FSM page followed by the RBFM_FSM_GROUP_PAGES
+// data pages it describes, one byte each:
+//   [root] [leaf 0] [data x RBFM_FSM_GROUP_PAGES] [leaf 1] [data ...] ...
+// Finding a page for a record reads the root, one leaf and the data page.
+#define RBFM_FSM_BUCKET_BYTES (PAGE_SIZE / 256)
+#define RBFM_FSM_GROUP_PAGES  RBFM_PAGE_END
+#define RBFM_FSM_GROUPS       RBFM_PAGE_END
+#define RBFM_FSM_ROOT         0
+
+// PAX pages
+// Files created with RBFM_PAX keep each page's records column by column. After the header come
+// a bitmap of the rows that hold a record, then a block per field: a null bitmap followed by a
+// minipage of 4 byte cells, one per row. Int and Real cells hold the value, VarChar cells a
+// PaxVarChar pointing into the page's VarChar heap, which grows down from RBFM_PAGE_END.
+// Bitmaps are arrays of 64 bit words, bit i % 64 of word i / 64 standing for row i, and every
+// block starts 8 byte aligned. The RID of a record is its page and row.
+// Every PAX page starts with its kind; pages with rows of their own are RBFM_PAX_ROWS, as is a
+// page that has never held a record.
+// A page is laid out for the descriptor of its first record, with as many rows as fit when each
+// VarChar takes its declared length; longer VarChars are refused with RBFM_RECORD_TOO_LARGE.
+// A record so always has room in its row and never moves. The free-space map counts
+// RBFM_FSM_BUCKET_BYTES for each free row, and a page that has never held a record as empty.
+#define RBFM_PAX PFM_LAYER_FLAGS
+#define RBFM_PAX_CELL_SIZE 4
+
+#define RBFM_PAX_ROWS       0
+#define RBFM_PAX_OVERFLOW   1   // Rows of a compressed page's records that outgrew it, see below
+#define RBFM_PAX_COMPRESSED 2
+
+typedef struct PaxPageHeader
+{
+    uint32_t kind;
+    uint32_t capacity;      // Rows the page is laid out for, 0 until it takes its first record
+    uint32_t fieldCount;
+    uint32_t rowCount;      // Rows past it have never held a record
+    uint32_t liveRows;
+    uint32_t heapOffset;    // Start of the VarChar heap
+    uint32_t heapBytes;     // Heap bytes live records use; the rest of the heap is holes
+    uint32_t homePage;      // Overflow pages: the compressed page whose records they hold
+} PaxPageHeader;
+
+typedef struct PaxVarChar
+{
+    uint16_t offset;
+    uint16_t length;
+} PaxVarChar;
+
+// Where things are on a PAX page laid out for capacity rows
+unsigned paxBitmapBytes(unsigned capacity);
+unsigned paxColumnOffset(unsigned capacity, unsigned i);    // Null bitmap of field i; its cells follow
+unsigned paxColumnBytes(unsigned capacity);                 // From one field's block to the next
+bool paxBitIsSet(const char *bitmap, unsigned i);
+void setPaxBit(char *bitmap, unsigned i, bool value);
+
+// Compressed pages
+// Files created with RBFM_COMPRESSED are PAX files whose pages are encoded once they are full,
+// for tables that are mostly read: insertRecords packs as many records into each page as their
+// encodings fit, and vacuum encodes the PAX pages whose rows have all been taken. Single inserts
+// still go to PAX pages. A compressed page holds exactly rowCount rows and takes no others.
+// After the header come the used rows bitmap, a bitmap of the rows moved to overflow pages, the
+// overflow page table and then a block per field: a CompressedColumnHeader, a null bitmap
+// unless no row is null, for VarChars a dictionary of the page's distinct values in sorted order
+// (uint16_t offsets, one past the last, then the bytes), and a code per row:
+//   Int      the value less the page's smallest value (frame of reference)
+//   Real     the bits of the value
+//   VarChar  the index of the value in the dictionary
+// Codes are bit packed, width bits each in little-endian 64 bit words, or run length encoded as
+// CompressedRun pairs, whichever takes fewer bytes. Null rows take the code of the nearest
+// non-null row before them, or after them for leading ones, so they never break a run.
+// Records decode into the PAX layout, which is how RecordView and scans read them; scans
+// decode only the fields they use, and compare a lone condition with the codes rather than the
+// values, once per run when there are runs. Records of descriptors too wide for even one to fit
+// a compressed page stay on PAX pages.
+// An update re-encodes the page. A record that no longer fits moves to row
+// row % overflowCapacity of the page's overflow page row / overflowCapacity, an
+// RBFM_PAX_OVERFLOW page laid out like the file's PAX pages, and only the moved bitmap and the
+// table change on the compressed page, its row keeping the old values. The RID stays valid; as with
+// forwarded records, scans return the record with the RID of its overflow row.
+#define RBFM_COMPRESSED (PFM_LAYER_FLAGS << 1)
+
+#define RBFM_CODES_PACKED 0
+#define RBFM_CODES_RUNS   1
+
+// The first five words are as in PaxPageHeader, and both are the same size
+typedef struct CompressedPageHeader
+{
+    uint32_t kind;              // RBFM_PAX_COMPRESSED
+    uint32_t capacity;          // rowCount
+    uint32_t fieldCount;
+    uint32_t rowCount;
+    uint32_t liveRows;          // Counting the records moved to overflow pages
+    uint32_t overflowCapacity;  // Rows of an overflow page
+    uint32_t overflowPages;     // Entries of the overflow page table, 0 until a page is needed
+    uint32_t bytes;             // Of the page the encoding takes
+} CompressedPageHeader;
+
+typedef struct CompressedColumnHeader
+{
+    uint8_t type;               // AttrType
+    uint8_t encoding;           // RBFM_CODES_PACKED or RBFM_CODES_RUNS
+    uint8_t width;              // Bits of the largest code
+    uint8_t nullable;           // Whether the null bitmap is there
+    uint16_t runs;
+    uint16_t dictionarySize;    // VarChar: distinct values
+    int32_t base;               // Int: the value of code 0
+    uint32_t bytes;             // Of the whole block
+} CompressedColumnHeader;
+
+typedef struct CompressedRun
+{
+    uint32_t end;               // One past the last row of the run
+    uint32_t code;
+} CompressedRun;
+
+// Zone maps
+// Files created with RBFM_ZONE_MAPS keep, for up to RBFM_ZONE_ATTRIBUTES Int or Real attributes
+// picked with createZoneMap, a zone per data page: the smallest and largest value and how many
+// non-null values and nulls were written to it. Scans leave out the pages whose zones rule out
+// their condition without reading them. Zones only ever widen as records are inserted and
+// updated, so a deleted or overwritten value may keep a page in; vacuum tightens them again.
+// They live in a paged file of their own, the file's name with RBFM_ZONE_SUFFIX, opened along
+// with it by RecordBasedFileManager::openFile. Its page 0 is a ZoneMapHeader; then come groups of
+// RBFM_ZONE_ATTRIBUTES pages, one per attribute, each holding the zones of the next
+// RBFM_ZONES_PER_PAGE data pages (map pages included). A zone of all zeros is of a page no
+// record has been written to.
+#define RBFM_ZONE_MAPS (PFM_LAYER_FLAGS << 2)
+#define RBFM_ZONE_SUFFIX ".zones"
+#define RBFM_ZONE_ATTRIBUTES 4
+
+typedef struct ZoneMapHeader
+{
+    uint32_t attributeCount;
+    uint32_t fields[RBFM_ZONE_ATTRIBUTES];  // Index in the record descriptor
+    uint32_t types[RBFM_ZONE_ATTRIBUTES];   // AttrType
+} ZoneMapHeader;
+
+typedef struct Zone
+{
+    uint32_t min;               // The bits of an Int or a Real
+    uint32_t max;
+    uint16_t values;            // Non-null values written, saturating
+    uint16_t nulls;             // Nulls written, saturating
+} Zone;
+
+#define RBFM_ZONES_PER_PAGE (RBFM_PAGE_END / sizeof(Zone))
+
 // Assignment 2 tip: Make offset negative to represent a forwarding address
 // Negative offset => length = page #, offset = -slot #
 typedef struct SlotDirectoryRecordEntry
@@ -74,25 +252,196 @@ typedef struct SlotDirectoryRecordEntry
     int32_t offset;
 } SlotDirectoryRecordEntry;
 
-typedef struct IndexedRecordEntry
-{
-    int32_t slotNum;
-    SlotDirectoryRecordEntry recordEntry;
-} IndexedRecordEntry;
-
 typedef SlotDirectoryRecordEntry* SlotDirectory;
 
+// Offsets within a record, which is always smaller than a page
 typedef uint16_t ColumnOffset;
 
 typedef uint16_t RecordLength;
 
 
+// What RecordBasedFileManager::vacuum reclaimed
+typedef struct VacuumStats
+{
+    unsigned recordsMovedHome;  // Forwarded records copied back to the page of their RID
+    unsigned hopsRemoved;       // Forwarding hops reads no longer take
+    unsigned pagesCompacted;    // Pages whose free space or slot directory was consolidated
+    unsigned pagesReclaimed;    // Pages left with no slots at all, wholly free for new records
+    unsigned pagesCompressed;   // PAX pages of RBFM_COMPRESSED files that were encoded
+} VacuumStats;
+
+// Layouts each thread keeps for the overloads that take a record descriptor
+#define RBFM_LAYOUT_CACHE 4
+
+// Everything the record manager derives from a record descriptor, worked out once.
+// Build one per descriptor and pass it instead of the descriptor to skip the per call
+// null indicator arithmetic and attribute name searches.
+class RecordLayout {
+public:
+  RecordLayout();
+  explicit RecordLayout(const vector<Attribute> &recordDescriptor);
+
+  const vector<Attribute> &getDescriptor() const { return descriptor; }
+  unsigned getFieldCount() const { return descriptor.size(); }
+  AttrType getType(unsigned i) const { return types[i]; }
+  unsigned getNullIndicatorSize() const { return nullIndicatorSize; }
+
+  // Hash of the names, types and lengths of a descriptor; equal descriptors have equal keys
+  static size_t keyOf(const vector<Attribute> &recordDescriptor);
+  // Was this layout built from a descriptor with this key and the types and lengths of
+  // recordDescriptor? The names are only compared through the key.
+  bool describes(const vector<Attribute> &recordDescriptor, size_t key) const;
+
+  // Index of the named attribute, getFieldCount() if there is none
+  unsigned getIndex(const string &name) const;
+  // Indexes of the named attributes, in order
+  RC getProjection(const vector<string> &names, vector<unsigned> &projection) const;
+
+  // The leading Int / Real fields. When none of them is null they occupy the first
+  // fixedPrefixSize bytes after the null indicator, in the API format and in records alike.
+  unsigned getFixedPrefixFields() const { return fixedPrefixFields; }
+  unsigned getFixedPrefixSize() const { return fixedPrefixFields * INT_SIZE; }
+  bool hasFixedPrefix(const char *nullIndicator) const;
+
+  // Rows of a PAX page laid out for this descriptor, 0 if not even one fits
+  unsigned getPaxCapacity() const { return paxCapacity; }
+  unsigned getPaxVarCharBytes() const { return paxVarCharBytes; }   // Declared VarChar bytes of a record
+
+private:
+  vector<Attribute> descriptor;
+  vector<AttrType> types;
+  unordered_map<string, unsigned> indexes;
+  size_t key;
+  unsigned nullIndicatorSize;
+  unsigned fixedPrefixFields;
+  vector<unsigned char> fixedPrefixMask;  // Null indicator bits of the prefix, per byte
+  unsigned paxVarCharBytes;
+  unsigned paxCapacity;
+};
+
 /********************************************************************************
 The scan iterator is NOT required to be implemented for the part 1 of the project 
 ********************************************************************************/
 
 # define RBFM_EOF (-1)  // end of a scan operator
 
+// A VarChar field inside a page; valid for as long as the RecordView it came from
+typedef struct VarCharView
+{
+    const char *data;
+    uint32_t length;
+
+    string str() const { return string(data, length); }
+} VarCharView;
+
+// Read-only view of a record where it lies on its page. Fields are read straight
+// from the record's column offset directory, nothing is decoded up front.
+//   RecordBasedFileManager::readRecordView: the view pins the record's page until
+//       release() or destruction, so the FileHandle must outlive it.
+//   RBFM_ScanIterator::getNextRecordView: the view points into the scan's current
+//       page and is valid until the next call on the iterator.
+// Fields are indexed as in the record descriptor; fields the record predates read
+// as null, and the accessors return 0 / an empty VarChar for null fields.
+// In PAX files the view reads the record's row of each minipage instead.
+class RecordView {
+public:
+  RecordView();
+  ~RecordView();
+
+  bool isNull(unsigned i) const;
+  int32_t getInt(unsigned i) const;
+  float getReal(unsigned i) const;
+  VarCharView getVarChar(unsigned i) const;
+
+  unsigned getFieldCount() const { return fieldCount; }   // Fields stored in the record
+
+  RC release();   // Unpin the page, if the view holds it
+
+  friend class RecordBasedFileManager;
+  friend class RBFM_ScanIterator;
+
+private:
+  RecordView(const RecordView &);
+  RecordView &operator=(const RecordView &);
+
+  void attach(const char *page, int32_t offset);
+  void attachPax(const char *page, unsigned row);
+  unsigned fieldStart(unsigned i) const;
+  unsigned fieldEnd(unsigned i) const;
+  const char *fieldData(unsigned i, bool varChar, uint32_t &length) const;
+
+  FileHandle *fileHandle;   // Set while the view pins pageNum
+  PageNum pageNum;
+
+  const char *record;
+  RecordLength fieldCount;
+  const char *nullIndicator;
+  const char *directory;    // Column offsets, each the end of its field relative to record
+  unsigned dataOffset;      // Where the first field starts
+
+  // A PAX row: record is the page, nullIndicator and directory field 0's null bitmap and cells
+  bool pax;
+  unsigned row;
+  unsigned columnBytes;     // From one field's block to the next
+
+  void *image;              // A compressed record decoded as a PAX page, borrowed from the page pool
+};
+
+// Scan conditions beyond a single comparison: attributes compared with constants and tested
+// for null, combined with AND, OR and NOT. A comparison with a null attribute is false, and
+// so NOT of it is true. Values are in the API format, as for a single condition, and must
+// stay valid for the whole scan; attribute names are resolved when the scan starts.
+typedef enum { PRED_COMPARE = 0, PRED_IS_NULL, PRED_IS_NOT_NULL, PRED_AND, PRED_OR, PRED_NOT } PredicateKind;
+
+class Predicate {
+public:
+  static Predicate compare(const string &attribute, CompOp compOp, const void *value);
+  static Predicate isNull(const string &attribute);
+  static Predicate isNotNull(const string &attribute);
+  static Predicate allOf(const vector<Predicate> &terms);     // True if there are no terms
+  static Predicate allOf(const Predicate &left, const Predicate &right);
+  static Predicate anyOf(const vector<Predicate> &terms);     // False if there are no terms
+  static Predicate anyOf(const Predicate &left, const Predicate &right);
+  static Predicate negate(const Predicate &term);
+
+  friend class RBFM_ScanIterator;
+
+private:
+  Predicate(PredicateKind kind, const string &attribute, CompOp compOp, const void *value);
+
+  PredicateKind kind;
+  string attribute;
+  CompOp compOp;
+  const void *value;
+  vector<Predicate> terms;
+};
+
+// Evaluations of an AND or OR between reorderings of its terms
+#define RBFM_PREDICATE_REORDER 1024
+
+// A predicate as a scan evaluates it, with its attribute resolved and its value decoded.
+// The terms of an AND / OR are kept in the order most likely to decide it first, going by
+// how often each has passed so far; AND tries the likeliest to fail first, OR the likeliest
+// to pass, and both stop at the first term that decides them.
+typedef struct ScanCondition
+{
+    PredicateKind kind;
+    unsigned attrIndex;
+    AttrType type;
+    CompOp compOp;
+    bool hasValue;              // A comparison without a value is never true
+    int32_t intValue;
+    float realValue;
+    // VarChars compare the on-page bytes with the value, the first 8 bytes at once
+    const char *stringValue;
+    uint32_t stringLength;
+    uint64_t stringPrefix;
+    vector<unsigned> terms;     // Indexes of the conditions this one combines
+    unsigned sinceReorder;      // Evaluations since the terms were last ordered
+    uint32_t evaluations;       // Times the enclosing AND / OR evaluated this condition
+    uint32_t passes;            // ... and found it true
+} ScanCondition;
+
 // RBFM_ScanIterator is an iterator to go through records
 // The way to use it is like the following:
 //  RBFM_ScanIterator rbfmScanIterator;
@@ -102,16 +451,27 @@ The scan iterator is NOT required to be implemented for the part 1 of the projec
 //  }
 //  rbfmScanIterator.close();
 class RecordBasedFileManager;
+struct ZoneMaps;
 
 class RBFM_ScanIterator {
 public:
   RBFM_ScanIterator();
-  ~RBFM_ScanIterator() {};
+  ~RBFM_ScanIterator() { close(); };
 
   // Never keep the results in the memory. When getNextRecord() is called, 
   // a satisfying record needs to be fetched from the file.
   // "data" follows the same format as RecordBasedFileManager::insertRecord().
   RC getNextRecord(RID &rid, void *data);
+  // As many of the next matching records as fit in capacity bytes of buffer, read on across
+  // pages. They are packed back to back, each as getNextRecord returns it, and rids[i] is the
+  // RID of the i-th; count is rids.size(). RBFM_EOF once no records are left, and
+  // RBFM_BATCH_TOO_SMALL if not even the next record fits, which is then kept for the next call.
+  // With no attributes projected each record counts as sizeof(RID) bytes of capacity.
+  RC getNextBatch(vector<RID> &rids, void *buffer, unsigned capacity, unsigned &count);
+  // The next matching record in place; the projection does not apply
+  RC getNextRecordView(RID &rid, RecordView &view);
+  // The I/O of this scan so far, see FileHandle::collectCounterValues
+  RC collectCounterValues(unsigned &readPageCount, unsigned &writePageCount, unsigned &appendPageCount);
   RC close();
 
   friend class RecordBasedFileManager;
@@ -123,37 +483,88 @@ private:
   uint32_t currSlot;
 
   uint32_t totalPage;
-  uint16_t totalSlot;
-
-  void *pageData;
-
-  AttrType type;
-  unsigned attrIndex;
+  uint32_t totalSlot;
+
+  void *pageData;       // Current page, either pageBuffer or a page of the map
+  void *pageBuffer;
+
+  ScanMode scanMode;
+  bool pax;                 // The file keeps PAX pages
+  const void *mappedPages;
+  unsigned mappedPageCount;
+
+  uint32_t readAheadPage;   // First page not yet handed to read-ahead
+  vector<PageNum> readAheadPages;
+
+  // The scan condition, conditions[0] being the root; none if every record matches
+  vector<ScanCondition> conditions;
+  ScanCondition *rootCondition;   // &conditions[0] while the scan runs, NULL if there are none
+
+  // A lone Int or Real comparison is evaluated for a whole page as it is loaded, see filter.h.
+  // On compressed pages a lone comparison of any type is, on the codes.
+  bool filtered;
+  bool codesFiltered;
+  bool pageFiltered;            // selection says which slots of the current page match
+  vector<int32_t> intColumn;    // The condition attribute of every slot, 0 where there is none
+  vector<float> realColumn;
+  vector<uint64_t> present;     // Slots with a record and a non-null condition attribute
+  vector<uint64_t> selection;   // Slots whose record meets the condition
+
+  // A compressed page is decoded into a PAX page of the fields the scan reads, the rest null
+  const void *encodedPage;      // The current page when it is compressed, NULL otherwise
+  vector<char> decodedPage;
+  vector<PaxVarChar> dictionaryCells;   // The cell of each code of the VarChar being decoded
+  vector<bool> decodedFields;   // Projected, or in a condition not evaluated on the codes
+  bool allFieldsDecoded;
 
   FileHandle fileHandle;
-  vector<Attribute> recordDescriptor;
-  string conditionAttribute;
-  CompOp compOp;
-  const void* value;
+  RecordLayout layout;
+  vector<unsigned> projection;  // Layout indexes of attributeNames
   vector<string> attributeNames;
 
   vector<RID> skipList;
 
+  vector<uint64_t> prunedPages;   // Pages whose zones rule out the condition, one bit each
+
   RC scanInit(FileHandle &fh,
-        const vector<Attribute> rd,
+        const RecordLayout &rl,
         const string &ca, 
         const CompOp compOp, 
         const void *v, 
-        const vector<string> &an);
-
+        const vector<string> &an,
+        ScanMode sm);
+  RC scanInit(FileHandle &fh,
+        const RecordLayout &rl,
+        const Predicate &predicate,
+        const vector<string> &an,
+        ScanMode sm);
+  RC scanStart(FileHandle &fh, const vector<string> &an, ScanMode sm);
+  RC addCondition(const Predicate &predicate);
+  RC addLeafCondition(PredicateKind kind, const string &attribute, CompOp compOp, const void *value);
+
+  void pruneByZoneMaps();
+  bool canMatch(const ScanCondition &condition, const Zone *zones, const ZoneMapHeader &header);
+  bool isPruned(PageNum pageNum);
+  void skipPages();
   RC getNextSlot();
+  void attachView(RecordView &view, unsigned slotNum);
+  void startPage();
+  void filterPage();
+  void filterPaxPage();
+  void startCompressedPage();
+  void filterCompressedPage();
+  void decodePage(bool allFields);
+  unsigned nextSelectedSlot(unsigned slotNum);
+  unsigned projectRecord(void *data, unsigned capacity);
   RC getNextPage();
+  void readAhead();
   RC handleMovedRecord(bool &status, const RID rid, void *data);
   bool checkScanCondition();
-  RC checkScanCondition(bool &result, const RID rid);
-  bool checkScanCondition(int, CompOp, const void*);
-  bool checkScanCondition(float, CompOp, const void*);
-  bool checkScanCondition(char*, CompOp, const void*);
+  bool checkScanCondition(ScanCondition &condition, const RecordView &view);
+  bool checkScanCondition(int32_t recordInt, CompOp compOp, int32_t intValue);
+  bool checkScanCondition(float recordReal, CompOp compOp, float realValue);
+  bool checkScanCondition(const VarCharView &recordString, const ScanCondition &condition);
+  void reorderTerms(ScanCondition &condition);
 };
 
 
@@ -162,11 +573,12 @@ class RecordBasedFileManager
 public:
   static RecordBasedFileManager* instance();
 
-  RC createFile(const string &fileName);
+  // Files are checksummed unless flags say otherwise, see PagedFileManager::createFile
+  RC createFile(const string &fileName, unsigned flags = PFM_CHECKSUMS);
   
   RC destroyFile(const string &fileName);
   
-  RC openFile(const string &fileName, FileHandle &fileHandle);
+  RC openFile(const string &fileName, FileHandle &fileHandle, OpenMode openMode = OPEN_BUFFERED);
   
   RC closeFile(FileHandle &fileHandle);
 
@@ -185,8 +597,18 @@ public:
   //  !!! The same format is used for updateRecord(), the returned data of readRecord(), and readAttribute().
   // For example, refer to the Q6 of Project 1 Environment document.
   RC insertRecord(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, const void *data, RID &rid);
+  RC insertRecord(FileHandle &fileHandle, const RecordLayout &layout, const void *data, RID &rid);
+
+  // Inserts n records in the format above, rids[i] receiving the RID of rows[i].
+  // The records are packed into new pages in memory, each written with a single append,
+  // so no existing page is read or rewritten. Space left on existing pages is not reused.
+  RC insertRecords(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, const void * const *rows, size_t n, vector<RID> &rids);
 
   RC readRecord(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, const RID &rid, void *data);
+  RC readRecord(FileHandle &fileHandle, const RecordLayout &layout, const RID &rid, void *data);
+
+  // Pin the record's page and point view at the record, following forwarding addresses
+  RC readRecordView(FileHandle &fileHandle, const RID &rid, RecordView &view);
   
   // This method will be mainly used for debugging/testing. 
   // The format is as follows:
@@ -200,8 +622,11 @@ IMPORTANT, PLEASE READ: All methods below this comment (other than the construct
 ******************************************************************************************************************************************************************/
   RC deleteRecord(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, const RID &rid);
 
-  // Assume the RID does not change after an update
+  // Assume the RID does not change after an update. A record that outgrows its page moves
+  // and leaves a forwarding address in its slot; the address always names the record's
+  // current place, so reaching it never takes more than one extra page.
   RC updateRecord(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, const void *data, const RID &rid);
+  RC updateRecord(FileHandle &fileHandle, const RecordLayout &layout, const void *data, const RID &rid);
 
   RC readAttribute(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, const RID &rid, const string &attributeName, void *data);
 
@@ -212,7 +637,48 @@ IMPORTANT, PLEASE READ: All methods below this comment (other than the construct
       const CompOp compOp,                  // comparision type such as "<" and "="
       const void *value,                    // used in the comparison
       const vector<string> &attributeNames, // a list of projected attributes
-      RBFM_ScanIterator &rbfm_ScanIterator);
+      RBFM_ScanIterator &rbfm_ScanIterator,
+      ScanMode scanMode = SCAN_BUFFERED);   // read pages through the buffer pool or a memory map
+
+  RC scan(FileHandle &fileHandle,
+      const RecordLayout &layout,
+      const string &conditionAttribute,
+      const CompOp compOp,
+      const void *value,
+      const vector<string> &attributeNames,
+      RBFM_ScanIterator &rbfm_ScanIterator,
+      ScanMode scanMode = SCAN_BUFFERED);
+
+  // Scan for the records that satisfy predicate
+  RC scan(FileHandle &fileHandle,
+      const vector<Attribute> &recordDescriptor,
+      const Predicate &predicate,
+      const vector<string> &attributeNames,
+      RBFM_ScanIterator &rbfm_ScanIterator,
+      ScanMode scanMode = SCAN_BUFFERED);
+
+  RC scan(FileHandle &fileHandle,
+      const RecordLayout &layout,
+      const Predicate &predicate,
+      const vector<string> &attributeNames,
+      RBFM_ScanIterator &rbfm_ScanIterator,
+      ScanMode scanMode = SCAN_BUFFERED);
+
+  // Moves forwarded records back to the page of their RID where they now fit, points whatever
+  // is left of older forwarding chains straight at the record, then compacts every page,
+  // dropping slots at the end of a directory that no record uses. RIDs of live records stay
+  // valid; the slot of a deleted record may be gone afterwards.
+  // PAX pages close up the holes in their VarChar heap, and those left without records go
+  // back to holding none, ready to be laid out for whatever record comes next. In
+  // RBFM_COMPRESSED files, PAX pages whose rows have all been taken are encoded, and compressed
+  // pages drop their trailing unused rows, re-encode when their deleted rows save room and give up
+  // overflow pages left empty.
+  // Vacuum also rebuilds the file's zone maps.
+  RC vacuum(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, VacuumStats &stats);
+
+  // Keep zones of attributeName in a file created with RBFM_ZONE_MAPS, built from the records
+  // already there. RBFM_CANNOT_ZONE for a VarChar or once RBFM_ZONE_ATTRIBUTES have zones.
+  RC createZoneMap(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, const string &attributeName);
 
 public:
   friend class RBFM_ScanIterator;
@@ -227,6 +693,8 @@ private:
 
   // Private helper methods
 
+  shared_ptr<const RecordLayout> getLayout(const vector<Attribute> &recordDescriptor);
+
   void newRecordBasedPage(void * page);
 
   SlotDirectoryHeader getSlotDirectoryHeader(void * page);
@@ -236,22 +704,82 @@ private:
   void setSlotDirectoryRecordEntry(void * page, unsigned recordEntryNumber, SlotDirectoryRecordEntry recordEntry);
 
   unsigned getPageFreeSpaceSize(void * page);
-  unsigned getRecordSize(const vector<Attribute> &recordDescriptor, const void *data);
+  unsigned getContiguousFreeSpaceSize(void * page);
+  void releaseRecordSpace(void *page, SlotDirectoryRecordEntry recordEntry);
+  void makeContiguousSpace(void *page, unsigned size);
+  unsigned getRecordSize(const RecordLayout &layout, const void *data);
 
   int getNullIndicatorSize(int fieldCount);
   bool fieldIsNull(char *nullIndicator, int i);
 
-  void setRecordAtOffset(void *page, unsigned offset, const vector<Attribute> &recordDescriptor, const void *data);
-  void getRecordAtOffset(void *record, int32_t offset, const vector<Attribute> &recordDescriptor, void *data);
+  void setRecordAtOffset(void *page, unsigned offset, const RecordLayout &layout, const void *data);
+  void getRecordAtOffset(void *record, int32_t offset, const RecordLayout &layout, void *data);
 
   SlotStatus getSlotStatus (SlotDirectoryRecordEntry slot);
-  unsigned getOpenSlot(void *page);
+  unsigned getOpenSlot(void *page, SlotDirectoryHeader &slotHeader);
 
   void markSlotDeleted(void *page, unsigned i);
+  void rebuildFreeSlotChain(void *page);
 
   void reorganizePage(void *page);
 
+  RID getForwardingAddress(SlotDirectoryRecordEntry recordEntry);
+  void setForwardingAddress(void *page, unsigned slotNum, const RID &target);
+  bool updateRecordOnPage(void *page, unsigned slotNum, const RecordLayout &layout, const void *data);
+  RC updateForwardedRecord(FileHandle &fileHandle, const RecordLayout &layout, const void *data, const RID &rid, RID &newRid, bool &moved);
+  RC vacuumRows(FileHandle &fileHandle, VacuumStats &stats);
+  RC vacuumForwardedRecord(FileHandle &fileHandle, void *homePage, const RID &home, VacuumStats &stats);
+  bool compactPage(void *page, VacuumStats &stats);
+
   void getAttributeFromRecord(void *page, unsigned offset, unsigned attrIndex, AttrType type,void *data);
+
+  bool isFreeSpaceMapPage(PageNum pageNum);
+  unsigned getFreeSpaceBucket(void *page, bool pax);
+  RC findFreePage(FileHandle &fileHandle, unsigned size, PageNum &pageNum, void *&pageData);
+  RC appendRecordBasedPage(FileHandle &fileHandle, PageNum &pageNum, void *&pageData);
+  RC appendFreeSpaceMapPages(FileHandle &fileHandle);
+  RC updateFreeSpaceMap(FileHandle &fileHandle, PageNum pageNum, void *pageData);
+  RC setFreeSpaceBucket(FileHandle &fileHandle, PageNum pageNum, unsigned char bucket);
+
+  // PAX pages, see pax.cc
+  bool isPaxFile(FileHandle &fileHandle);
+  PaxPageHeader getPaxPageHeader(const void *page);
+  void setPaxPageHeader(void *page, const PaxPageHeader &header);
+  void newPaxPage(void *page, const RecordLayout &layout);
+  bool paxPageFits(const void *page, const RecordLayout &layout);
+  unsigned getPaxFreeSpaceSize(void *page);
+  unsigned getPaxVarCharSize(const RecordLayout &layout, const void *data);
+  unsigned takePaxRow(void *page);
+  void setPaxRecord(void *page, unsigned row, const RecordLayout &layout, const void *data);
+  void releasePaxRecord(void *page, unsigned row, const RecordLayout &layout);
+  void compactPaxHeap(void *page, const RecordLayout &layout);
+  RC fetchPaxRow(FileHandle &fileHandle, const RID &rid, void *&pageData);
+  RC insertPaxRecord(FileHandle &fileHandle, const RecordLayout &layout, const void *data, RID &rid);
+  RC insertPaxRecords(FileHandle &fileHandle, const RecordLayout &layout, const void * const *rows, size_t n, vector<RID> &rids);
+  RC readPaxRecord(FileHandle &fileHandle, const RecordLayout &layout, const RID &rid, void *data);
+  RC readPaxRecordView(FileHandle &fileHandle, const RID &rid, RecordView &view);
+  RC deletePaxRecord(FileHandle &fileHandle, const RecordLayout &layout, const RID &rid);
+  RC updatePaxRecord(FileHandle &fileHandle, const RecordLayout &layout, const void *data, const RID &rid);
+  RC readPaxAttribute(FileHandle &fileHandle, const RecordLayout &layout, const RID &rid, const string &attributeName, void *data);
+  RC vacuumPax(FileHandle &fileHandle, const RecordLayout &layout, VacuumStats &stats);
+
+  // Compressed pages, see compress.cc
+  bool isCompressedFile(FileHandle &fileHandle);
+  bool getOverflowRid(const void *page, unsigned row, RID &rid);
+  void decodeCompressedRow(const void *page, unsigned row, void *image);
+  RC insertCompressedRecords(FileHandle &fileHandle, const RecordLayout &layout, const void * const *rows, size_t n, vector<RID> &rids);
+  RC readCompressedRecordView(FileHandle &fileHandle, void *pageData, const RID &rid, RecordView &view);
+  RC deleteCompressedRecord(FileHandle &fileHandle, const RecordLayout &layout, void *pageData, const RID &rid);
+  RC updateCompressedRecord(FileHandle &fileHandle, const RecordLayout &layout, const void *data, void *pageData, const RID &rid);
+  RC vacuumCompressedPage(FileHandle &fileHandle, PageNum pageNum, void *pageData, VacuumStats &stats, bool &changed);
+  bool compressPaxPage(void *page, const RecordLayout &layout);
+
+  // Zone maps, see zonemap.cc
+  RC createZoneMapFile(const string &fileName, unsigned flags);
+  RC openZoneMaps(const string &fileName, FileHandle &fileHandle);
+  RC getZoneMaps(FileHandle &fileHandle, ZoneMaps *&zones);
+  RC widenZoneMaps(FileHandle &fileHandle, const RecordLayout &layout, PageNum pageNum, const void * const *rows, size_t n);
+  RC rebuildZoneMaps(FileHandle &fileHandle, const RecordLayout &layout);
 };
 
 #endif
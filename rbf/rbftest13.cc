@@ -0,0 +1,152 @@
+#include <iostream>
+#include <string>
+#include <cassert>
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdexcept>
+#include <stdio.h>
+
+#include "pfm.h"
+#include "bpm.h"
+#include "rbfm.h"
+#include "test_util.h"
+
+using namespace std;
+
+int RBFTest_13(PagedFileManager *pfm, ReplacementPolicy policy)
+{
+    // Functions Tested:
+    // 1. Configure the buffer pool **
+    // 2. New Page / Fetch Page / Unpin Page / Flush Page **
+    // 3. Buffer pool counters **
+    // 4. Close File
+    cout << endl << "***** In RBF Test Case 13 (" << (policy == LRU_REPLACEMENT ? "LRU" : "CLOCK") << ") *****" << endl;
+
+    RC rc;
+    string fileName = "test13";
+    BufferPoolManager *bpm = BufferPoolManager::instance();
+
+    // A tiny pool so we see evictions
+    rc = bpm->configure(4, policy);
+    assert(rc == success && "Configuring the buffer pool should not fail.");
+
+    rc = pfm->createFile(fileName);
+    assert(rc == success && "Creating the file should not fail.");
+
+    FileHandle fileHandle;
+    rc = pfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+
+    // Fill 10 pages through the buffer pool
+    for(unsigned j = 0; j < 10; j++)
+    {
+        PageNum pageNum;
+        void *page;
+        rc = fileHandle.newPage(pageNum, page);
+        assert(rc == success && "Allocating a new page should not fail.");
+        assert(pageNum == j && "New pages should be appended in order.");
+        for(unsigned i = 0; i < PAGE_SIZE; i++)
+        {
+            *((char *)page+i) = (i + j) % 94 + 32;
+        }
+        rc = fileHandle.unpinPage(pageNum, true);
+        assert(rc == success && "Unpinning a page should not fail.");
+    }
+
+    // Unpinning a page that isn't pinned is an error
+    rc = fileHandle.unpinPage(0, false);
+    assert(rc != success && "Unpinning an unpinned page should fail.");
+
+    // Pin every frame, then one more fetch has nowhere to go
+    void *pinned[4];
+    for(unsigned j = 0; j < 4; j++)
+    {
+        rc = fileHandle.fetchPage(j, pinned[j]);
+        assert(rc == success && "Fetching a page should not fail.");
+    }
+    void *page;
+    rc = fileHandle.fetchPage(4, page);
+    assert(rc != success && "Fetching with every frame pinned should fail.");
+    rc = bpm->configure(8, policy);
+    assert(rc != success && "Resizing the pool with pinned pages should fail.");
+    for(unsigned j = 0; j < 4; j++)
+    {
+        rc = fileHandle.unpinPage(j, false);
+        assert(rc == success && "Unpinning a page should not fail.");
+    }
+
+    // Read everything back twice, the hot page 9 in between every page
+    unsigned hitCount = 0, missCount = 0, evictionCount = 0;
+    for(unsigned round = 0; round < 2; round++)
+    {
+        for(unsigned j = 0; j < 10; j++)
+        {
+            PageNum pages[2] = { j, 9 };
+            for(unsigned k = 0; k < 2; k++)
+            {
+                rc = fileHandle.fetchPage(pages[k], page);
+                assert(rc == success && "Fetching a page should not fail.");
+                for(unsigned i = 0; i < PAGE_SIZE; i++)
+                {
+                    assert(*((char *)page+i) == (char)((i + pages[k]) % 94 + 32) && "Checking the integrity of the page should not fail.");
+                }
+                rc = fileHandle.unpinPage(pages[k], false);
+                assert(rc == success && "Unpinning a page should not fail.");
+            }
+        }
+    }
+
+    rc = fileHandle.collectBufferPoolCounterValues(hitCount, missCount, evictionCount);
+    assert(rc == success && "Collecting the buffer pool counters should not fail.");
+    cout << "H M E - " << hitCount << " " << missCount << " " << evictionCount << endl;
+    assert(hitCount > 0 && "The hot page should stay in the buffer pool.");
+    assert(missCount > 0 && "Pages should have been read from disk.");
+    assert(evictionCount > 0 && "A 4 frame pool should have evicted pages.");
+
+    // Modify a cached page and flush it, the file must see the change
+    rc = fileHandle.fetchPage(9, page);
+    assert(rc == success && "Fetching a page should not fail.");
+    memset(page, 'x', PAGE_SIZE);
+    rc = fileHandle.unpinPage(9, true);
+    assert(rc == success && "Unpinning a page should not fail.");
+    rc = fileHandle.flushPage(9);
+    assert(rc == success && "Flushing a page should not fail.");
+
+    void *buffer = malloc(PAGE_SIZE);
+    void *data = malloc(PAGE_SIZE);
+    memset(data, 'x', PAGE_SIZE);
+    rc = fileHandle.readPage(9, buffer);
+    assert(rc == success && "Reading a page should not fail.");
+    rc = memcmp(data, buffer, PAGE_SIZE);
+    assert(rc == success && "A flushed page should be on disk.");
+
+    rc = pfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+
+    rc = pfm->destroyFile(fileName);
+    assert(rc == success && "Destroying the file should not fail.");
+
+    rc = bpm->configure(BPM_DEFAULT_FRAMES, CLOCK_REPLACEMENT);
+    assert(rc == success && "Configuring the buffer pool should not fail.");
+
+    free(data);
+    free(buffer);
+
+    cout << "RBF Test Case 13 Finished! The result will be examined." << endl << endl;
+
+    return 0;
+}
+
+int main()
+{
+	// To test the buffer pool underneath the paged file manager
+    PagedFileManager *pfm = PagedFileManager::instance();
+
+    remove("test13");
+
+    RC rcmain = RBFTest_13(pfm, CLOCK_REPLACEMENT);
+    if (rcmain == 0)
+        rcmain = RBFTest_13(pfm, LRU_REPLACEMENT);
+    return rcmain;
+}
@@ -0,0 +1,190 @@
+#include <iostream>
+#include <string>
+#include <cassert>
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdexcept>
+#include <stdio.h>
+#include <thread>
+
+#include "pfm.h"
+#include "rbfm.h"
+#include "test_util.h"
+
+using namespace std;
+
+const int numRecords = 5000;
+const int numScanners = 4;
+const int numReaders = 2;
+
+// Scan the whole file and add up the ages
+void scanAges(RecordBasedFileManager *rbfm, FileHandle *fileHandle, const vector<Attribute> *recordDescriptor, ScanMode scanMode, long long *ageSum, int *count)
+{
+    vector<string> attributeNames;
+    attributeNames.push_back("Age");
+
+    RBFM_ScanIterator rbfmScanIterator;
+    RC rc = rbfm->scan(*fileHandle, *recordDescriptor, "", NO_OP, NULL, attributeNames, rbfmScanIterator, scanMode);
+    assert(rc == success && "Scanning the file should not fail.");
+
+    RID rid;
+    void *returnedData = malloc(100);
+    *ageSum = 0;
+    *count = 0;
+    while(rbfmScanIterator.getNextRecord(rid, returnedData) != RBFM_EOF)
+    {
+        *ageSum += *(int *)((char *)returnedData + 1);
+        (*count)++;
+    }
+    rbfmScanIterator.close();
+    free(returnedData);
+}
+
+// Read every record by RID and check its contents
+void readAll(RecordBasedFileManager *rbfm, FileHandle *fileHandle, const vector<Attribute> *recordDescriptor, const vector<RID> *rids, int *mismatches)
+{
+    unsigned char nullsIndicator = 0;
+    void *record = malloc(100);
+    void *returnedData = malloc(100);
+    int recordSize = 0;
+    *mismatches = 0;
+    for(int i = 0; i < numRecords; i++)
+    {
+        prepareRecord(recordDescriptor->size(), &nullsIndicator, 8, "Anteater", i, 170.1, i * 10, record, &recordSize);
+        RC rc = rbfm->readRecord(*fileHandle, *recordDescriptor, (*rids)[i], returnedData);
+        if(rc != success || memcmp(record, returnedData, recordSize) != 0)
+            (*mismatches)++;
+    }
+    free(record);
+    free(returnedData);
+}
+
+int RBFTest_14(RecordBasedFileManager *rbfm)
+{
+    // Functions Tested:
+    // 1. Create Record-Based File
+    // 2. Insert Records
+    // 3. Scan (buffered and memory mapped) and read records from several threads on the same file **
+    // 4. Close/Destroy Record-Based File
+    cout << endl << "***** In RBF Test Case 14 *****" << endl;
+
+    RC rc;
+    string fileName = "test14";
+
+    rc = rbfm->createFile(fileName);
+    assert(rc == success && "Creating the file should not fail.");
+
+    FileHandle fileHandle;
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+
+    vector<Attribute> recordDescriptor;
+    createRecordDescriptor(recordDescriptor);
+
+    unsigned char nullsIndicator = 0;
+    void *record = malloc(100);
+    int recordSize = 0;
+    vector<RID> rids(numRecords);
+    long long expectedSum = 0;
+    for(int i = 0; i < numRecords; i++)
+    {
+        prepareRecord(recordDescriptor.size(), &nullsIndicator, 8, "Anteater", i, 170.1, i * 10, record, &recordSize);
+        rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rids[i]);
+        assert(rc == success && "Inserting a record should not fail.");
+        expectedSum += i;
+    }
+
+    // Every thread gets its own handle on the same file
+    FileHandle handles[numScanners + numReaders];
+    for(int t = 0; t < numScanners + numReaders; t++)
+    {
+        rc = rbfm->openFile(fileName, handles[t]);
+        assert(rc == success && "Opening the file should not fail.");
+    }
+
+    long long ageSums[numScanners];
+    int counts[numScanners];
+    int mismatches[numReaders];
+    vector<thread> threads;
+    for(int t = 0; t < numScanners; t++)
+        threads.push_back(thread(scanAges, rbfm, &handles[t], &recordDescriptor, t % 2 ? SCAN_MMAP : SCAN_BUFFERED, &ageSums[t], &counts[t]));
+    for(int t = 0; t < numReaders; t++)
+        threads.push_back(thread(readAll, rbfm, &handles[numScanners + t], &recordDescriptor, &rids, &mismatches[t]));
+    for(unsigned t = 0; t < threads.size(); t++)
+        threads[t].join();
+
+    int failed = 0;
+    for(int t = 0; t < numScanners; t++)
+    {
+        cout << "Scanner " << t << (t % 2 ? " (mmap)" : "") << ": " << counts[t] << " records" << endl;
+        if(counts[t] != numRecords || ageSums[t] != expectedSum)
+            failed = 1;
+    }
+    for(int t = 0; t < numReaders; t++)
+    {
+        cout << "Reader " << t << ": " << mismatches[t] << " mismatches" << endl;
+        if(mismatches[t] != 0)
+            failed = 1;
+    }
+
+    // A mapped scan has to keep working while the file grows underneath it
+    vector<string> attributeNames;
+    attributeNames.push_back("Age");
+    RBFM_ScanIterator rbfmScanIterator;
+    rc = rbfm->scan(fileHandle, recordDescriptor, "", NO_OP, NULL, attributeNames, rbfmScanIterator, SCAN_MMAP);
+    assert(rc == success && "Scanning the file should not fail.");
+    RID rid;
+    void *returnedData = malloc(100);
+    int scanned = 0;
+    long long scannedSum = 0;
+    while(rbfmScanIterator.getNextRecord(rid, returnedData) != RBFM_EOF)
+    {
+        scannedSum += *(int *)((char *)returnedData + 1);
+        if(scanned++ % 10 == 0)
+        {
+            prepareRecord(recordDescriptor.size(), &nullsIndicator, 8, "Anteater", 0, 170.1, 0, record, &recordSize);
+            rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+            assert(rc == success && "Inserting a record should not fail.");
+        }
+    }
+    rbfmScanIterator.close();
+    free(returnedData);
+    cout << "Scanner while inserting (mmap): " << scanned << " records" << endl;
+    if(scanned < numRecords || scannedSum != expectedSum)
+        failed = 1;
+
+    for(int t = 0; t < numScanners + numReaders; t++)
+    {
+        rc = rbfm->closeFile(handles[t]);
+        assert(rc == success && "Closing the file should not fail.");
+    }
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+
+    rc = rbfm->destroyFile(fileName);
+    assert(rc == success && "Destroying the file should not fail.");
+
+    free(record);
+
+    if(failed)
+    {
+        cout << "[FAIL] Test Case 14 Failed!" << endl << endl;
+        return -1;
+    }
+
+    cout << "RBF Test Case 14 Finished! The result will be examined." << endl << endl;
+
+    return 0;
+}
+
+int main()
+{
+    // To test concurrent readers on one file
+    RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
+
+    remove("test14");
+
+    RC rcmain = RBFTest_14(rbfm);
+    return rcmain;
+}
@@ -0,0 +1,178 @@
+#include <iostream>
+#include <string>
+#include <cassert>
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdexcept>
+#include <stdio.h>
+
+#include "pfm.h"
+#include "rbfm.h"
+#include "test_util.h"
+
+using namespace std;
+
+const int numPages = 40;
+const int numRecords = 3000;
+
+// Scan the whole file and add up the ages
+void scanAges(RecordBasedFileManager *rbfm, FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, long long &ageSum, int &count)
+{
+    vector<string> attributeNames;
+    attributeNames.push_back("Age");
+
+    RBFM_ScanIterator rbfmScanIterator;
+    RC rc = rbfm->scan(fileHandle, recordDescriptor, "", NO_OP, NULL, attributeNames, rbfmScanIterator);
+    assert(rc == success && "Scanning the file should not fail.");
+
+    RID rid;
+    void *returnedData = malloc(100);
+    ageSum = 0;
+    count = 0;
+    while(rbfmScanIterator.getNextRecord(rid, returnedData) != RBFM_EOF)
+    {
+        ageSum += *(int *)((char *)returnedData + 1);
+        count++;
+    }
+    rbfmScanIterator.close();
+    free(returnedData);
+}
+
+int RBFTest_15(PagedFileManager *pfm, RecordBasedFileManager *rbfm)
+{
+    // Functions Tested:
+    // 1. Append Page
+    // 2. Read Pages / Submit Reads / Complete Reads **
+    // 3. Scan with and without read-ahead **
+    // 4. Close/Destroy File
+    cout << endl << "***** In RBF Test Case 15 *****" << endl;
+
+    RC rc;
+    string fileName = "test15";
+
+    rc = pfm->createFile(fileName);
+    assert(rc == success && "Creating the file should not fail.");
+
+    FileHandle fileHandle;
+    rc = pfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+
+    void *data = malloc(PAGE_SIZE);
+    for(unsigned j = 0; j < numPages; j++)
+    {
+        for(unsigned i = 0; i < PAGE_SIZE; i++)
+        {
+            *((char *)data+i) = (i + j) % 94 + 32;
+        }
+        rc = fileHandle.appendPage(data);
+        assert(rc == success && "Appending a page should not fail.");
+    }
+
+    // Read every other page backwards in one batch
+    vector<PageNum> pageNums;
+    vector<void *> buffers;
+    for(int j = numPages - 1; j >= 0; j -= 2)
+    {
+        pageNums.push_back(j);
+        buffers.push_back(malloc(PAGE_SIZE));
+    }
+    unsigned readBefore, readAfter, writeCount, appendCount;
+    fileHandle.collectCounterValues(readBefore, writeCount, appendCount);
+    rc = fileHandle.readPages(pageNums, &buffers[0]);
+    assert(rc == success && "Reading a batch of pages should not fail.");
+    fileHandle.collectCounterValues(readAfter, writeCount, appendCount);
+    assert(readAfter - readBefore == pageNums.size() && "Every page of a batch should be counted as a read.");
+
+    for(unsigned k = 0; k < pageNums.size(); k++)
+    {
+        for(unsigned i = 0; i < PAGE_SIZE; i++)
+        {
+            assert(*((char *)buffers[k]+i) == (char)((i + pageNums[k]) % 94 + 32) && "Checking the integrity of the page should not fail.");
+        }
+    }
+
+    // Submit and complete separately; a page past the end fails the batch
+    ReadBatch batch;
+    pageNums.push_back(numPages);
+    buffers.push_back(malloc(PAGE_SIZE));
+    rc = fileHandle.submitReads(pageNums, &buffers[0], batch);
+    assert(rc != success && "Submitting a read past the end of the file should fail.");
+    rc = fileHandle.completeReads(batch);
+    assert(rc != success && "A batch with a failed read should report it.");
+
+    for(unsigned k = 0; k < buffers.size(); k++)
+        free(buffers[k]);
+
+    rc = pfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+    rc = pfm->destroyFile(fileName);
+    assert(rc == success && "Destroying the file should not fail.");
+
+    // Scans see the same records whether or not they read ahead
+    rc = rbfm->createFile(fileName);
+    assert(rc == success && "Creating the file should not fail.");
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+
+    vector<Attribute> recordDescriptor;
+    createRecordDescriptor(recordDescriptor);
+
+    unsigned char nullsIndicator = 0;
+    void *record = malloc(100);
+    int recordSize = 0;
+    RID rid;
+    long long expectedSum = 0;
+    for(int i = 0; i < numRecords; i++)
+    {
+        prepareRecord(recordDescriptor.size(), &nullsIndicator, 8, "Anteater", i, 170.1, i * 10, record, &recordSize);
+        rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+        assert(rc == success && "Inserting a record should not fail.");
+        expectedSum += i;
+    }
+
+    int failed = 0;
+    unsigned windows[3] = { 0, PFM_DEFAULT_READ_AHEAD, 64 };
+    for(unsigned w = 0; w < 3; w++)
+    {
+        fileHandle.setReadAhead(windows[w]);
+        assert(fileHandle.getReadAhead() == windows[w] && "The read-ahead window should be the one we set.");
+
+        long long ageSum;
+        int count;
+        scanAges(rbfm, fileHandle, recordDescriptor, ageSum, count);
+        cout << "Read-ahead " << windows[w] << ": " << count << " records" << endl;
+        if(count != numRecords || ageSum != expectedSum)
+            failed = 1;
+    }
+
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+    rc = rbfm->destroyFile(fileName);
+    assert(rc == success && "Destroying the file should not fail.");
+
+    free(record);
+    free(data);
+
+    if(failed)
+    {
+        cout << "[FAIL] Test Case 15 Failed!" << endl << endl;
+        return -1;
+    }
+
+    cout << "RBF Test Case 15 Finished! The result will be examined." << endl << endl;
+
+    return 0;
+}
+
+int main()
+{
+    // To test batched asynchronous reads and scan read-ahead
+    PagedFileManager *pfm = PagedFileManager::instance();
+    RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
+
+    remove("test15");
+
+    RC rcmain = RBFTest_15(pfm, rbfm);
+    return rcmain;
+}
@@ -0,0 +1,170 @@
+#include <iostream>
+#include <string>
+#include <cassert>
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdexcept>
+#include <stdio.h>
+
+#include "pfm.h"
+#include "rbfm.h"
+#include "test_util.h"
+
+using namespace std;
+
+const int numRecords = 2000;
+
+// Scan the whole file and add up the ages
+void scanAges(RecordBasedFileManager *rbfm, FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, ScanMode scanMode, long long &ageSum, int &count)
+{
+    vector<string> attributeNames;
+    attributeNames.push_back("Age");
+
+    RBFM_ScanIterator rbfmScanIterator;
+    RC rc = rbfm->scan(fileHandle, recordDescriptor, "", NO_OP, NULL, attributeNames, rbfmScanIterator, scanMode);
+    assert(rc == success && "Scanning the file should not fail.");
+
+    RID rid;
+    void *returnedData = malloc(100);
+    ageSum = 0;
+    count = 0;
+    while(rbfmScanIterator.getNextRecord(rid, returnedData) != RBFM_EOF)
+    {
+        ageSum += *(int *)((char *)returnedData + 1);
+        count++;
+    }
+    rbfmScanIterator.close();
+    free(returnedData);
+}
+
+int RBFTest_16(RecordBasedFileManager *rbfm)
+{
+    // Functions Tested:
+    // 1. Create Record-Based File
+    // 2. Open File with O_DIRECT **
+    // 3. Insert / Read / Scan Records through direct I/O **
+    // 4. Read / Write Pages with unaligned buffers **
+    // 5. Close/Destroy Record-Based File
+    cout << endl << "***** In RBF Test Case 16 *****" << endl;
+
+    RC rc;
+    string fileName = "test16";
+
+    // Page buffers come out aligned
+    void *page = allocPage();
+    assert(page != NULL && ((size_t) page % PFM_PAGE_ALIGNMENT) == 0 && "Page buffers should be aligned.");
+    freePage(page);
+
+    rc = rbfm->createFile(fileName);
+    assert(rc == success && "Creating the file should not fail.");
+
+    FileHandle fileHandle;
+    rc = rbfm->openFile(fileName, fileHandle, OPEN_DIRECT);
+    assert(rc == success && "Opening the file should not fail.");
+    cout << "Direct I/O: " << (fileHandle.isDirect() ? "yes" : "not supported here") << endl;
+
+    vector<Attribute> recordDescriptor;
+    createRecordDescriptor(recordDescriptor);
+
+    unsigned char nullsIndicator = 0;
+    void *record = malloc(100);
+    void *returnedData = malloc(100);
+    int recordSize = 0;
+    vector<RID> rids(numRecords);
+    long long expectedSum = 0;
+    for(int i = 0; i < numRecords; i++)
+    {
+        prepareRecord(recordDescriptor.size(), &nullsIndicator, 8, "Anteater", i, 170.1, i * 10, record, &recordSize);
+        rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rids[i]);
+        assert(rc == success && "Inserting a record should not fail.");
+        expectedSum += i;
+    }
+
+    int failed = 0;
+    for(int i = 0; i < numRecords; i++)
+    {
+        prepareRecord(recordDescriptor.size(), &nullsIndicator, 8, "Anteater", i, 170.1, i * 10, record, &recordSize);
+        rc = rbfm->readRecord(fileHandle, recordDescriptor, rids[i], returnedData);
+        if(rc != success || memcmp(record, returnedData, recordSize) != 0)
+            failed = 1;
+    }
+
+    long long ageSum;
+    int count;
+    scanAges(rbfm, fileHandle, recordDescriptor, SCAN_BUFFERED, ageSum, count);
+    if(count != numRecords || ageSum != expectedSum)
+        failed = 1;
+    scanAges(rbfm, fileHandle, recordDescriptor, SCAN_MMAP, ageSum, count);
+    if(count != numRecords || ageSum != expectedSum)
+        failed = 1;
+
+    // Plain malloc'd buffers, deliberately off alignment. The file is checksummed,
+    // so the last bytes of the page belong to the trailer.
+    char *unalignedIn = (char *) malloc(PAGE_SIZE + 1) + 1;
+    char *unalignedOut = (char *) malloc(PAGE_SIZE + 1) + 1;
+    for(unsigned i = 0; i < PAGE_SIZE; i++)
+        unalignedOut[i] = i % 94 + 32;
+    rc = fileHandle.appendPage(unalignedOut);
+    assert(rc == success && "Appending a page from an unaligned buffer should not fail.");
+    PageNum lastPage = fileHandle.getNumberOfPages() - 1;
+    rc = fileHandle.readPage(lastPage, unalignedIn);
+    assert(rc == success && "Reading a page into an unaligned buffer should not fail.");
+    if(memcmp(unalignedIn, unalignedOut, PAGE_SIZE - PFM_CHECKSUM_SIZE) != 0)
+        failed = 1;
+
+    vector<PageNum> pageNums(1, lastPage);
+    void *buffers[1] = { unalignedIn };
+    memset(unalignedIn, 0, PAGE_SIZE);
+    rc = fileHandle.readPages(pageNums, buffers);
+    assert(rc == success && "Reading a batch of pages into unaligned buffers should not fail.");
+    if(memcmp(unalignedIn, unalignedOut, PAGE_SIZE - PFM_CHECKSUM_SIZE) != 0)
+        failed = 1;
+
+    free(unalignedIn - 1);
+    free(unalignedOut - 1);
+
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+
+    // Everything written directly is there for a buffered open too
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+    assert(!fileHandle.isDirect() && "A buffered open should not use direct I/O.");
+    for(int i = 0; i < numRecords; i++)
+    {
+        prepareRecord(recordDescriptor.size(), &nullsIndicator, 8, "Anteater", i, 170.1, i * 10, record, &recordSize);
+        rc = rbfm->readRecord(fileHandle, recordDescriptor, rids[i], returnedData);
+        if(rc != success || memcmp(record, returnedData, recordSize) != 0)
+            failed = 1;
+    }
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+
+    rc = rbfm->destroyFile(fileName);
+    assert(rc == success && "Destroying the file should not fail.");
+
+    free(record);
+    free(returnedData);
+
+    if(failed)
+    {
+        cout << "[FAIL] Test Case 16 Failed!" << endl << endl;
+        return -1;
+    }
+
+    cout << "RBF Test Case 16 Finished! The result will be examined." << endl << endl;
+
+    return 0;
+}
+
+int main()
+{
+    // To test direct I/O
+    RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
+
+    remove("test16");
+
+    RC rcmain = RBFTest_16(rbfm);
+    return rcmain;
+}
@@ -0,0 +1,139 @@
+#include <iostream>
+#include <string>
+#include <cassert>
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdexcept>
+#include <stdio.h>
+
+#include "pfm.h"
+#include "rbfm.h"
+#include "crc.h"
+#include "test_util.h"
+
+using namespace std;
+
+const int numRecords = 500;
+
+int RBFTest_17(PagedFileManager *pfm, RecordBasedFileManager *rbfm)
+{
+    // Functions Tested:
+    // 1. CRC32C, hardware and table based **
+    // 2. Create a checksummed Record-Based File **
+    // 3. Insert / Read Records
+    // 4. Detect a corrupted page on read **
+    // 5. Close/Destroy Record-Based File
+    cout << endl << "***** In RBF Test Case 17 *****" << endl;
+
+    RC rc;
+    string fileName = "test17";
+
+    // The standard check value, and both implementations agree at every alignment
+    const char *check = "123456789";
+    assert(crc32c(check, 9) == 0xE3069283 && "CRC32C of the check string should match.");
+    assert(crc32cSoftware(check, 9) == 0xE3069283 && "CRC32C of the check string should match.");
+    char *buffer = (char *) malloc(PAGE_SIZE + 8);
+    for(unsigned i = 0; i < PAGE_SIZE + 8; i++)
+        buffer[i] = (i * 7 + 3) % 251;
+    for(unsigned offset = 0; offset < 8; offset++)
+        assert(crc32c(buffer + offset, PAGE_SIZE - offset) == crc32cSoftware(buffer + offset, PAGE_SIZE - offset) && "Both CRC32C variants should agree.");
+    cout << "CRC32C instructions: " << (crc32cHardware() ? "yes" : "no") << endl;
+    free(buffer);
+
+    rc = rbfm->createFile(fileName);
+    assert(rc == success && "Creating the file should not fail.");
+
+    FileHandle fileHandle;
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+    assert(fileHandle.hasChecksums() && "Record-based files should be checksummed.");
+
+    vector<Attribute> recordDescriptor;
+    createRecordDescriptor(recordDescriptor);
+
+    unsigned char nullsIndicator = 0;
+    void *record = malloc(100);
+    int recordSize = 0;
+    vector<RID> rids(numRecords);
+    for(int i = 0; i < numRecords; i++)
+    {
+        prepareRecord(recordDescriptor.size(), &nullsIndicator, 8, "Anteater", i, 170.1, i * 10, record, &recordSize);
+        rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rids[i]);
+        assert(rc == success && "Inserting a record should not fail.");
+    }
+    assert(fileHandle.getNumberOfPages() > 2 && "The records should take several pages.");
+
+    void *page = malloc(PAGE_SIZE);
+    for(PageNum j = 0; j < fileHandle.getNumberOfPages(); j++)
+    {
+        rc = fileHandle.readPage(j, page);
+        assert(rc == success && "Reading an intact page should not fail.");
+        assert(fileHandle.checkPage(page) && "An intact page should match its checksum.");
+    }
+
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+
+    // Flip one byte of page 1 behind our back; page 1 is the third page of the file
+    FILE *file = fopen(fileName.c_str(), "r+b");
+    assert(file != NULL && "Opening the file directly should not fail.");
+    fseek(file, PAGE_SIZE * 2 + 100, SEEK_SET);
+    int byte = fgetc(file);
+    fseek(file, PAGE_SIZE * 2 + 100, SEEK_SET);
+    fputc(byte ^ 0x01, file);
+    fclose(file);
+
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+
+    rc = fileHandle.readPage(0, page);
+    assert(rc == success && "Reading an intact page should not fail.");
+    rc = fileHandle.readPage(1, page);
+    assert(rc == FH_CHECKSUM_FAILED && "Reading a corrupted page should fail its checksum.");
+    assert(!fileHandle.checkPage(page) && "A corrupted page should not match its checksum.");
+
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+
+    rc = rbfm->destroyFile(fileName);
+    assert(rc == success && "Destroying the file should not fail.");
+
+    // Plain paged files have no trailer: every byte of a page is the caller's
+    rc = pfm->createFile(fileName);
+    assert(rc == success && "Creating the file should not fail.");
+    rc = pfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+    assert(!fileHandle.hasChecksums() && "Plain paged files should not be checksummed.");
+    memset(page, 0xAB, PAGE_SIZE);
+    rc = fileHandle.appendPage(page);
+    assert(rc == success && "Appending a page should not fail.");
+    void *readBack = malloc(PAGE_SIZE);
+    rc = fileHandle.readPage(0, readBack);
+    assert(rc == success && "Reading a page should not fail.");
+    assert(memcmp(page, readBack, PAGE_SIZE) == 0 && "A plain page should come back whole.");
+    rc = pfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+    rc = pfm->destroyFile(fileName);
+    assert(rc == success && "Destroying the file should not fail.");
+
+    free(readBack);
+    free(page);
+    free(record);
+
+    cout << "RBF Test Case 17 Finished! The result will be examined." << endl << endl;
+
+    return 0;
+}
+
+int main()
+{
+    // To test page checksums
+    PagedFileManager *pfm = PagedFileManager::instance();
+    RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
+
+    remove("test17");
+
+    RC rcmain = RBFTest_17(pfm, rbfm);
+    return rcmain;
+}
@@ -0,0 +1,164 @@
+#include <iostream>
+#include <string>
+#include <cassert>
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdexcept>
+#include <stdio.h>
+
+#include "pfm.h"
+#include "bpm.h"
+#include "rbfm.h"
+#include "test_util.h"
+
+using namespace std;
+
+// Two records to a page, and enough of them for a second free-space map group
+const int numRecords = 2 * (RBFM_FSM_GROUP_PAGES + 200);
+const int nameLength = RBFM_PAGE_END / 3;
+
+// Buffer pool fetches so far, hits and misses alike
+unsigned fetchCount(FileHandle &fileHandle)
+{
+    unsigned hits, misses, evictions;
+    fileHandle.collectBufferPoolCounterValues(hits, misses, evictions);
+    return hits + misses;
+}
+
+int RBFTest_18(RecordBasedFileManager *rbfm)
+{
+    // Functions Tested:
+    // 1. Create Record-Based File
+    // 2. Insert Records, finding pages through the free-space map **
+    // 3. Delete / Update Records and reuse the freed space **
+    // 4. Scan past the free-space map pages **
+    // 5. Close/Destroy Record-Based File
+    cout << endl << "***** In RBF Test Case 18 *****" << endl;
+
+    RC rc;
+    string fileName = "test18";
+
+    // A small pool, so nothing but the map keeps inserts from reading the whole file
+    rc = BufferPoolManager::instance()->configure(16, CLOCK_REPLACEMENT);
+    assert(rc == success && "Configuring the buffer pool should not fail.");
+
+    rc = rbfm->createFile(fileName);
+    assert(rc == success && "Creating the file should not fail.");
+
+    FileHandle fileHandle;
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+
+    vector<Attribute> recordDescriptor;
+    createRecordDescriptor(recordDescriptor);
+
+    unsigned char nullsIndicator = 0;
+    string name(nameLength, 'a');
+    void *record = malloc(PAGE_SIZE);
+    void *returnedData = malloc(PAGE_SIZE);
+    int recordSize = 0;
+    vector<RID> rids(numRecords);
+    unsigned mostFetches = 0;
+    for(int i = 0; i < numRecords; i++)
+    {
+        prepareRecord(recordDescriptor.size(), &nullsIndicator, nameLength, name, i, 170.1, i * 10, record, &recordSize);
+        unsigned before = fetchCount(fileHandle);
+        rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rids[i]);
+        assert(rc == success && "Inserting a record should not fail.");
+        mostFetches = max(mostFetches, fetchCount(fileHandle) - before);
+    }
+    cout << "Most pages fetched by an insert: " << mostFetches << endl;
+    assert(mostFetches <= 5 && "An insert should fetch a fixed number of pages.");
+
+    // Records never land on map pages, and the second group has its own leaf
+    PageNum secondLeaf = 1 + RBFM_FSM_GROUP_PAGES + 1;
+    assert(fileHandle.getNumberOfPages() > secondLeaf + 1 && "The records should reach the second group.");
+    for(int i = 0; i < numRecords; i++)
+        assert(rids[i].pageNum != RBFM_FSM_ROOT && rids[i].pageNum != 1 && rids[i].pageNum != secondLeaf
+               && "Records should not be placed on free-space map pages.");
+
+    // Free a page early in the file; the next inserts go there instead of to the end
+    RID freed = rids[100];
+    for(int i = 0; i < numRecords; i++)
+    {
+        if(rids[i].pageNum != freed.pageNum)
+            continue;
+        rc = rbfm->deleteRecord(fileHandle, recordDescriptor, rids[i]);
+        assert(rc == success && "Deleting a record should not fail.");
+    }
+    unsigned numPages = fileHandle.getNumberOfPages();
+    RID rid;
+    for(int i = 0; i < 2; i++)
+    {
+        prepareRecord(recordDescriptor.size(), &nullsIndicator, nameLength, name, -1, 170.1, -10, record, &recordSize);
+        rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+        assert(rc == success && "Inserting a record should not fail.");
+        assert(rid.pageNum == freed.pageNum && "An insert should reuse the freed page.");
+    }
+    assert(fileHandle.getNumberOfPages() == numPages && "Reusing a page should not grow the file.");
+
+    // Shrinking a record in the second group makes room there too
+    RID shrunk = rids[numRecords - 2];
+    prepareRecord(recordDescriptor.size(), &nullsIndicator, 8, "Anteater", -2, 170.1, -20, record, &recordSize);
+    rc = rbfm->updateRecord(fileHandle, recordDescriptor, record, shrunk);
+    assert(rc == success && "Updating a record should not fail.");
+    prepareRecord(recordDescriptor.size(), &nullsIndicator, nameLength, name, -3, 170.1, -30, record, &recordSize);
+    rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+    assert(rc == success && "Inserting a record should not fail.");
+    assert(rid.pageNum == shrunk.pageNum && "The shrunk record's page should have room.");
+    assert(fileHandle.getNumberOfPages() == numPages && "Reusing a page should not grow the file.");
+    rc = rbfm->readRecord(fileHandle, recordDescriptor, rid, returnedData);
+    assert(rc == success && memcmp(record, returnedData, recordSize) == 0 && "Reading a record should not fail.");
+
+    // The scan sees every live record and nothing from the map pages
+    vector<string> attributeNames;
+    attributeNames.push_back("Age");
+    RBFM_ScanIterator rbfmScanIterator;
+    rc = rbfm->scan(fileHandle, recordDescriptor, "", NO_OP, NULL, attributeNames, rbfmScanIterator);
+    assert(rc == success && "Scanning the file should not fail.");
+    int count = 0;
+    while(rbfmScanIterator.getNextRecord(rid, returnedData) != RBFM_EOF)
+        count++;
+    rbfmScanIterator.close();
+    assert(count == numRecords + 1 && "The scan should see every live record.");
+
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+
+    // The map is on disk: a reopened file still fills the freed space before growing
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+    rc = rbfm->deleteRecord(fileHandle, recordDescriptor, rids[numRecords - 1]);
+    assert(rc == success && "Deleting a record should not fail.");
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+    rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+    assert(rc == success && "Inserting a record should not fail.");
+    assert(rid.pageNum == rids[numRecords - 1].pageNum && "The reopened file should reuse the freed page.");
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+
+    rc = rbfm->destroyFile(fileName);
+    assert(rc == success && "Destroying the file should not fail.");
+
+    free(record);
+    free(returnedData);
+
+    cout << "RBF Test Case 18 Finished! The result will be examined." << endl << endl;
+
+    return 0;
+}
+
+int main()
+{
+    // To test the free-space map
+    RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
+
+    remove("test18");
+
+    RC rcmain = RBFTest_18(rbfm);
+    return rcmain;
+}
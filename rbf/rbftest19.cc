@@ -0,0 +1,164 @@
+#include <iostream>
+#include <string>
+#include <cassert>
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdexcept>
+#include <stdio.h>
+
+#include "pfm.h"
+#include "rbfm.h"
+#include "test_util.h"
+
+using namespace std;
+
+const int numRecords = 3000;
+
+int RBFTest_19(RecordBasedFileManager *rbfm)
+{
+    // Functions Tested:
+    // 1. Create Record-Based File
+    // 2. Insert a batch of Records into pages packed in memory **
+    // 3. Read / Scan the batch
+    // 4. Insert single Records after a batch **
+    // 5. Close/Destroy Record-Based File
+    cout << endl << "***** In RBF Test Case 19 *****" << endl;
+
+    RC rc;
+    string fileName = "test19";
+
+    rc = rbfm->createFile(fileName);
+    assert(rc == success && "Creating the file should not fail.");
+
+    FileHandle fileHandle;
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+
+    vector<Attribute> recordDescriptor;
+    createRecordDescriptor(recordDescriptor);
+
+    // A record on the first page, which the batch leaves alone
+    unsigned char nullsIndicator = 0;
+    void *record = malloc(100);
+    int recordSize = 0;
+    RID firstRid;
+    prepareRecord(recordDescriptor.size(), &nullsIndicator, 8, "Anteater", -1, 170.1, -10, record, &recordSize);
+    rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, firstRid);
+    assert(rc == success && "Inserting a record should not fail.");
+
+    // Rows of varying length
+    vector<void *> rows(numRecords);
+    vector<int> sizes(numRecords);
+    string name(30, 'b');
+    for(int i = 0; i < numRecords; i++)
+    {
+        rows[i] = malloc(100);
+        prepareRecord(recordDescriptor.size(), &nullsIndicator, i % 30 + 1, name, i, 170.1, i * 10, rows[i], &sizes[i]);
+    }
+
+    unsigned readPageCount, writePageCount, appendPageCount;
+    unsigned readPageCount1, writePageCount1, appendPageCount1;
+    fileHandle.collectCounterValues(readPageCount, writePageCount, appendPageCount);
+    unsigned numPages = fileHandle.getNumberOfPages();
+
+    vector<RID> rids;
+    rc = rbfm->insertRecords(fileHandle, recordDescriptor, &rows[0], numRecords, rids);
+    assert(rc == success && "Inserting a batch of records should not fail.");
+    assert(rids.size() == (size_t) numRecords && "Every row should get a RID.");
+
+    // Every page of the batch was written exactly once, by its append
+    fileHandle.collectCounterValues(readPageCount1, writePageCount1, appendPageCount1);
+    unsigned newPages = fileHandle.getNumberOfPages() - numPages;
+    cout << "Batch pages: " << newPages << " R W A - " << readPageCount1 - readPageCount << " "
+         << writePageCount1 - writePageCount << " " << appendPageCount1 - appendPageCount << endl;
+    assert(readPageCount1 == readPageCount && "A batch should not read pages.");
+    assert(appendPageCount1 - appendPageCount == newPages && "Each batch page should be appended once.");
+    assert(rids[0].pageNum >= numPages && "The batch should start on a new page.");
+
+    // The RIDs run through the new pages in order
+    for(int i = 1; i < numRecords; i++)
+    {
+        bool nextSlot = rids[i].pageNum == rids[i - 1].pageNum && rids[i].slotNum == rids[i - 1].slotNum + 1;
+        bool nextPage = rids[i].pageNum > rids[i - 1].pageNum && rids[i].slotNum == 0;
+        assert((nextSlot || nextPage) && "The batch should fill its pages in order.");
+    }
+
+    void *returnedData = malloc(100);
+    int failed = 0;
+    for(int i = 0; i < numRecords; i++)
+    {
+        rc = rbfm->readRecord(fileHandle, recordDescriptor, rids[i], returnedData);
+        if(rc != success || memcmp(rows[i], returnedData, sizes[i]) != 0)
+            failed = 1;
+    }
+
+    // A record bigger than a page is refused
+    vector<Attribute> largeDescriptor;
+    Attribute attr;
+    attr.name = "Blob";
+    attr.type = TypeVarChar;
+    attr.length = PAGE_SIZE;
+    largeDescriptor.push_back(attr);
+    void *largeRecord = malloc(PAGE_SIZE + 8);
+    memset(largeRecord, 'c', PAGE_SIZE + 8);
+    *(char *) largeRecord = 0;
+    int largeLength = PAGE_SIZE;
+    memcpy((char *) largeRecord + 1, &largeLength, VARCHAR_LENGTH_SIZE);
+    const void *largeRows[1] = { largeRecord };
+    vector<RID> largeRids;
+    rc = rbfm->insertRecords(fileHandle, largeDescriptor, largeRows, 1, largeRids);
+    assert(rc == RBFM_RECORD_TOO_LARGE && "A record larger than a page should be refused.");
+    free(largeRecord);
+
+    // Single inserts still find the room left on the first page
+    RID rid;
+    rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+    assert(rc == success && "Inserting a record should not fail.");
+    assert(rid.pageNum == firstRid.pageNum && "A single insert should use the space before the batch.");
+
+    // The scan sees the batch and the single records
+    vector<string> attributeNames;
+    attributeNames.push_back("Age");
+    RBFM_ScanIterator rbfmScanIterator;
+    rc = rbfm->scan(fileHandle, recordDescriptor, "", NO_OP, NULL, attributeNames, rbfmScanIterator);
+    assert(rc == success && "Scanning the file should not fail.");
+    int count = 0;
+    while(rbfmScanIterator.getNextRecord(rid, returnedData) != RBFM_EOF)
+        count++;
+    rbfmScanIterator.close();
+    if(count != numRecords + 2)
+        failed = 1;
+
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+
+    rc = rbfm->destroyFile(fileName);
+    assert(rc == success && "Destroying the file should not fail.");
+
+    for(int i = 0; i < numRecords; i++)
+        free(rows[i]);
+    free(record);
+    free(returnedData);
+
+    if(failed)
+    {
+        cout << "[FAIL] Test Case 19 Failed!" << endl << endl;
+        return -1;
+    }
+
+    cout << "RBF Test Case 19 Finished! The result will be examined." << endl << endl;
+
+    return 0;
+}
+
+int main()
+{
+    // To test batch inserts
+    RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
+
+    remove("test19");
+
+    RC rcmain = RBFTest_19(rbfm);
+    return rcmain;
+}
@@ -0,0 +1,190 @@
+#include <iostream>
+#include <string>
+#include <cassert>
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdexcept>
+#include <stdio.h>
+
+#include "pfm.h"
+#include "bpm.h"
+#include "rbfm.h"
+#include "test_util.h"
+
+using namespace std;
+
+const int numRecords = 1000;
+
+// Record i has its name, height or salary null depending on i
+unsigned char nullsFor(int i)
+{
+    unsigned char nulls = 0;
+    if (i % 3 == 1)
+        nulls |= 1 << 7;
+    if (i % 5 == 2)
+        nulls |= 1 << 5;
+    if (i % 7 == 3)
+        nulls |= 1 << 4;
+    return nulls;
+}
+
+string nameFor(int i)
+{
+    return string(i % 20 + 1, 'a' + i % 26);
+}
+
+// Does the view show record i?
+bool viewMatches(const RecordView &view, int i)
+{
+    unsigned char nulls = nullsFor(i);
+    string name = nameFor(i);
+    if (view.getFieldCount() != 4)
+        return false;
+    if (view.isNull(0) != ((nulls & (1 << 7)) != 0) || view.isNull(1)
+        || view.isNull(2) != ((nulls & (1 << 5)) != 0) || view.isNull(3) != ((nulls & (1 << 4)) != 0))
+        return false;
+    if (!view.isNull(0) && view.getVarChar(0).str() != name)
+        return false;
+    if (view.isNull(0) && view.getVarChar(0).length != 0)
+        return false;
+    if (view.getInt(1) != i)
+        return false;
+    if (view.getReal(2) != (view.isNull(2) ? 0 : (float) i / 2))
+        return false;
+    if (view.getInt(3) != (view.isNull(3) ? 0 : i * 10))
+        return false;
+    // A field the record predates reads as null
+    return view.isNull(4) && view.getInt(4) == 0;
+}
+
+int RBFTest_20(RecordBasedFileManager *rbfm)
+{
+    // Functions Tested:
+    // 1. Create Record-Based File
+    // 2. Insert Records with null fields
+    // 3. Read Records in place through a RecordView **
+    // 4. Scan Records in place through a RecordView **
+    // 5. Close/Destroy Record-Based File
+    cout << endl << "***** In RBF Test Case 20 *****" << endl;
+
+    RC rc;
+    string fileName = "test20";
+    BufferPoolManager *bpm = BufferPoolManager::instance();
+
+    rc = rbfm->createFile(fileName);
+    assert(rc == success && "Creating the file should not fail.");
+
+    FileHandle fileHandle;
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+
+    vector<Attribute> recordDescriptor;
+    createRecordDescriptor(recordDescriptor);
+
+    void *record = malloc(PAGE_SIZE);
+    int recordSize = 0;
+    vector<RID> rids(numRecords);
+    for(int i = 0; i < numRecords; i++)
+    {
+        unsigned char nulls = nullsFor(i);
+        string name = nameFor(i);
+        prepareRecord(recordDescriptor.size(), &nulls, name.size(), name, i, (float) i / 2, i * 10, record, &recordSize);
+        rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rids[i]);
+        assert(rc == success && "Inserting a record should not fail.");
+    }
+
+    // Point reads
+    int failed = 0;
+    {
+        RecordView view;
+        for(int i = 0; i < numRecords; i++)
+        {
+            rc = rbfm->readRecordView(fileHandle, rids[i], view);
+            assert(rc == success && "Reading a record view should not fail.");
+            if(!viewMatches(view, i))
+                failed = 1;
+        }
+
+        // The view holds its page until released
+        rc = bpm->configure(BPM_DEFAULT_FRAMES, CLOCK_REPLACEMENT);
+        assert(rc != success && "A view should keep its page pinned.");
+        rc = view.release();
+        assert(rc == success && "Releasing a view should not fail.");
+        rc = bpm->configure(BPM_DEFAULT_FRAMES, CLOCK_REPLACEMENT);
+        assert(rc == success && "A released view should not pin its page.");
+    }
+
+    // A record moved off its page by an update is still found through its RID
+    int moved = 7;
+    string longName(RBFM_PAGE_END / 2, 'z');
+    unsigned char nulls = nullsFor(moved);
+    nulls &= ~(1 << 7);
+    prepareRecord(recordDescriptor.size(), &nulls, longName.size(), longName, moved, (float) moved / 2, moved * 10, record, &recordSize);
+    rc = rbfm->updateRecord(fileHandle, recordDescriptor, record, rids[moved]);
+    assert(rc == success && "Updating a record should not fail.");
+    {
+        RecordView view;
+        rc = rbfm->readRecordView(fileHandle, rids[moved], view);
+        assert(rc == success && "Reading a moved record view should not fail.");
+        if(view.getVarChar(0).str() != longName || view.getInt(3) != moved * 10)
+            failed = 1;
+    }
+    rc = rbfm->deleteRecord(fileHandle, recordDescriptor, rids[moved]);
+    assert(rc == success && "Deleting a record should not fail.");
+    {
+        RecordView view;
+        rc = rbfm->readRecordView(fileHandle, rids[moved], view);
+        assert(rc == RBFM_READ_AFTER_DEL && "Reading a deleted record view should fail.");
+    }
+
+    // Scan with a condition, reading the fields in place
+    int ageLimit = numRecords / 2;
+    vector<string> attributeNames;
+    attributeNames.push_back("Age");
+    RBFM_ScanIterator rbfmScanIterator;
+    rc = rbfm->scan(fileHandle, recordDescriptor, "Age", LT_OP, &ageLimit, attributeNames, rbfmScanIterator);
+    assert(rc == success && "Scanning the file should not fail.");
+    RID rid;
+    RecordView view;
+    int count = 0;
+    while(rbfmScanIterator.getNextRecordView(rid, view) != RBFM_EOF)
+    {
+        int i = view.getInt(1);
+        if(i >= ageLimit || i == moved || !viewMatches(view, i) || rid.pageNum != rids[i].pageNum || rid.slotNum != rids[i].slotNum)
+            failed = 1;
+        count++;
+    }
+    rbfmScanIterator.close();
+    if(count != ageLimit - 1)
+        failed = 1;
+
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+
+    rc = rbfm->destroyFile(fileName);
+    assert(rc == success && "Destroying the file should not fail.");
+
+    free(record);
+
+    if(failed)
+    {
+        cout << "[FAIL] Test Case 20 Failed!" << endl << endl;
+        return -1;
+    }
+
+    cout << "RBF Test Case 20 Finished! The result will be examined." << endl << endl;
+
+    return 0;
+}
+
+int main()
+{
+    // To test record views
+    RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
+
+    remove("test20");
+
+    RC rcmain = RBFTest_20(rbfm);
+    return rcmain;
+}
@@ -0,0 +1,195 @@
+#include <iostream>
+#include <string>
+#include <cassert>
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdexcept>
+#include <stdio.h>
+
+#include "pfm.h"
+#include "rbfm.h"
+#include "test_util.h"
+
+using namespace std;
+
+const int numRecords = 500;
+
+// Int, Real, Int, VarChar, Int: a three field fixed prefix
+void createPrefixDescriptor(vector<Attribute> &recordDescriptor)
+{
+    Attribute attr;
+    attr.length = 4;
+    attr.name = "Id";     attr.type = TypeInt;  recordDescriptor.push_back(attr);
+    attr.name = "Score";  attr.type = TypeReal; recordDescriptor.push_back(attr);
+    attr.name = "Rank";   attr.type = TypeInt;  recordDescriptor.push_back(attr);
+    attr.name = "Label";  attr.type = TypeVarChar; attr.length = 20; recordDescriptor.push_back(attr);
+    attr.name = "Bucket"; attr.type = TypeInt;  attr.length = 4; recordDescriptor.push_back(attr);
+}
+
+// Row i in the API format; some rows have a null inside the prefix or after it
+void prepareRow(int i, void *buffer, int *size)
+{
+    unsigned char nulls = 0;
+    if (i % 4 == 1)
+        nulls |= 1 << 6;    // Score
+    if (i % 6 == 2)
+        nulls |= 1 << 4;    // Label
+    char *data = (char *) buffer;
+    int offset = 1;
+    data[0] = nulls;
+    float score = i * 0.5f;
+    int rank = numRecords - i;
+    string label(i % 9, 'l');
+    int labelLength = label.size();
+    int bucket = i % 10;
+    memcpy(data + offset, &i, INT_SIZE); offset += INT_SIZE;
+    if (!(nulls & (1 << 6))) { memcpy(data + offset, &score, REAL_SIZE); offset += REAL_SIZE; }
+    memcpy(data + offset, &rank, INT_SIZE); offset += INT_SIZE;
+    if (!(nulls & (1 << 4)))
+    {
+        memcpy(data + offset, &labelLength, VARCHAR_LENGTH_SIZE); offset += VARCHAR_LENGTH_SIZE;
+        memcpy(data + offset, label.c_str(), labelLength); offset += labelLength;
+    }
+    memcpy(data + offset, &bucket, INT_SIZE); offset += INT_SIZE;
+    *size = offset;
+}
+
+int RBFTest_21(RecordBasedFileManager *rbfm)
+{
+    // Functions Tested:
+    // 1. Build a RecordLayout from a record descriptor **
+    // 2. Insert / Read / Update Records through the layout **
+    // 3. Scan through the layout with a projection **
+    // 4. Close/Destroy Record-Based File
+    cout << endl << "***** In RBF Test Case 21 *****" << endl;
+
+    RC rc;
+    string fileName = "test21";
+
+    vector<Attribute> recordDescriptor;
+    createPrefixDescriptor(recordDescriptor);
+    RecordLayout layout(recordDescriptor);
+
+    assert(layout.getFieldCount() == 5 && layout.getNullIndicatorSize() == 1 && "The layout should match the descriptor.");
+    assert(layout.getIndex("Label") == 3 && layout.getType(3) == TypeVarChar && "Attributes should be found by name.");
+    assert(layout.getIndex("Missing") == layout.getFieldCount() && "Unknown attributes should not be found.");
+    assert(layout.getFixedPrefixFields() == 3 && layout.getFixedPrefixSize() == 12 && "The fixed prefix should end at the VarChar.");
+    char nullIndicator = 0;
+    assert(layout.hasFixedPrefix(&nullIndicator) && "A row without nulls has its prefix.");
+    nullIndicator = 1 << 5;
+    assert(!layout.hasFixedPrefix(&nullIndicator) && "A null in the prefix breaks it.");
+    nullIndicator = 1 << 3;
+    assert(layout.hasFixedPrefix(&nullIndicator) && "A null after the prefix does not.");
+
+    vector<string> names;
+    names.push_back("Bucket");
+    names.push_back("Id");
+    vector<unsigned> projection;
+    rc = layout.getProjection(names, projection);
+    assert(rc == success && projection.size() == 2 && projection[0] == 4 && projection[1] == 0 && "The projection should follow the names.");
+    names.push_back("Missing");
+    rc = layout.getProjection(names, projection);
+    assert(rc == RBFM_NO_SUCH_ATTR && "A projection of an unknown attribute should fail.");
+
+    rc = rbfm->createFile(fileName);
+    assert(rc == success && "Creating the file should not fail.");
+
+    FileHandle fileHandle;
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+
+    // Both paths store the same bytes
+    void *row = malloc(100);
+    void *returnedData = malloc(100);
+    int rowSize = 0;
+    vector<RID> rids(numRecords);
+    int failed = 0;
+    for(int i = 0; i < numRecords; i++)
+    {
+        prepareRow(i, row, &rowSize);
+        if(i % 2)
+            rc = rbfm->insertRecord(fileHandle, layout, row, rids[i]);
+        else
+            rc = rbfm->insertRecord(fileHandle, recordDescriptor, row, rids[i]);
+        assert(rc == success && "Inserting a record should not fail.");
+    }
+    for(int i = 0; i < numRecords; i++)
+    {
+        prepareRow(i, row, &rowSize);
+        memset(returnedData, 0, 100);
+        rc = rbfm->readRecord(fileHandle, i % 3 ? layout : RecordLayout(recordDescriptor), rids[i], returnedData);
+        if(rc != success || memcmp(row, returnedData, rowSize) != 0)
+            failed = 1;
+        rc = rbfm->readRecord(fileHandle, recordDescriptor, rids[i], returnedData);
+        if(rc != success || memcmp(row, returnedData, rowSize) != 0)
+            failed = 1;
+    }
+
+    // Update through the layout: every record becomes row i + 1
+    for(int i = 0; i < numRecords; i++)
+    {
+        prepareRow(i + 1, row, &rowSize);
+        rc = rbfm->updateRecord(fileHandle, layout, row, rids[i]);
+        assert(rc == success && "Updating a record should not fail.");
+        rc = rbfm->readRecord(fileHandle, layout, rids[i], returnedData);
+        if(rc != success || memcmp(row, returnedData, rowSize) != 0)
+            failed = 1;
+    }
+
+    // Scan Bucket, Id for Rank > half
+    int rankLimit = numRecords / 2;
+    names.pop_back();
+    RBFM_ScanIterator rbfmScanIterator;
+    rc = rbfm->scan(fileHandle, layout, "Rank", GT_OP, &rankLimit, names, rbfmScanIterator);
+    assert(rc == success && "Scanning the file should not fail.");
+    RID rid;
+    int count = 0;
+    while(rbfmScanIterator.getNextRecord(rid, returnedData) != RBFM_EOF)
+    {
+        int bucket, id;
+        memcpy(&bucket, (char *) returnedData + 1, INT_SIZE);
+        memcpy(&id, (char *) returnedData + 1 + INT_SIZE, INT_SIZE);
+        if(*(char *) returnedData != 0 || bucket != id % 10 || numRecords - id <= rankLimit)
+            failed = 1;
+        count++;
+    }
+    rbfmScanIterator.close();
+    if(count != rankLimit - 1)
+        failed = 1;
+
+    // Unknown attributes are refused up front
+    rc = rbfm->scan(fileHandle, layout, "Missing", GT_OP, &rankLimit, names, rbfmScanIterator);
+    assert(rc == RBFM_NO_SUCH_ATTR && "Scanning on an unknown attribute should fail.");
+    rbfmScanIterator.close();
+
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+
+    rc = rbfm->destroyFile(fileName);
+    assert(rc == success && "Destroying the file should not fail.");
+
+    free(row);
+    free(returnedData);
+
+    if(failed)
+    {
+        cout << "[FAIL] Test Case 21 Failed!" << endl << endl;
+        return -1;
+    }
+
+    cout << "RBF Test Case 21 Finished! The result will be examined." << endl << endl;
+
+    return 0;
+}
+
+int main()
+{
+    // To test record layouts
+    RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
+
+    remove("test21");
+
+    RC rcmain = RBFTest_21(rbfm);
+    return rcmain;
+}
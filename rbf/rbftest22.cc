@@ -0,0 +1,200 @@
+#include <iostream>
+#include <string>
+#include <cassert>
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdexcept>
+#include <stdio.h>
+
+#include "pfm.h"
+#include "rbfm.h"
+#include "test_util.h"
+
+using namespace std;
+
+// Age of the record that keeps moving
+const int movingAge = -1;
+
+// Buffer pool fetches so far, hits and misses alike
+unsigned fetchCount(FileHandle &fileHandle)
+{
+    unsigned hits, misses, evictions;
+    fileHandle.collectBufferPoolCounterValues(hits, misses, evictions);
+    return hits + misses;
+}
+
+// Where a scan finds the moving record, and how many records it returns
+int findMovingRecord(RecordBasedFileManager *rbfm, FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, RID &found)
+{
+    vector<string> attributeNames;
+    attributeNames.push_back("Age");
+    RBFM_ScanIterator rbfmScanIterator;
+    RC rc = rbfm->scan(fileHandle, recordDescriptor, "", NO_OP, NULL, attributeNames, rbfmScanIterator);
+    assert(rc == success && "Scanning the file should not fail.");
+
+    RID rid;
+    char returnedData[1 + INT_SIZE];
+    int count = 0;
+    while(rbfmScanIterator.getNextRecord(rid, returnedData) != RBFM_EOF)
+    {
+        int age;
+        memcpy(&age, returnedData + 1, INT_SIZE);
+        if(age == movingAge)
+            found = rid;
+        count++;
+    }
+    rbfmScanIterator.close();
+    return count;
+}
+
+int RBFTest_22(RecordBasedFileManager *rbfm)
+{
+    // Functions Tested:
+    // 1. Create Record-Based File
+    // 2. Update a Record so it moves twice; reads still take one hop **
+    // 3. Vacuum the file: the record moves home and the empty pages come back **
+    // 4. Close/Destroy Record-Based File
+    cout << endl << "***** In RBF Test Case 22 *****" << endl;
+
+    RC rc;
+    string fileName = "test22";
+
+    rc = rbfm->createFile(fileName);
+    assert(rc == success && "Creating the file should not fail.");
+
+    FileHandle fileHandle;
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+
+    vector<Attribute> recordDescriptor;
+    createRecordDescriptor(recordDescriptor);
+
+    unsigned char nullsIndicator = 0;
+    void *record = malloc(PAGE_SIZE);
+    void *returnedData = malloc(PAGE_SIZE);
+    int recordSize = 0;
+    int failed = 0;
+
+    // A small record, then one that leaves it no room to grow on its page
+    RID movingRid, bigRid, fillerRid;
+    prepareRecord(recordDescriptor.size(), &nullsIndicator, 10, string(10, 'm'), movingAge, 170.1, 0, record, &recordSize);
+    rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, movingRid);
+    assert(rc == success && "Inserting a record should not fail.");
+    // The free-space map rounds both the page's room and the record's need to whole buckets,
+    // so the room left on a page is sized in buckets too
+    int bigLength = RBFM_PAGE_END - 214 - 2 * RBFM_FSM_BUCKET_BYTES;
+    prepareRecord(recordDescriptor.size(), &nullsIndicator, bigLength, string(bigLength, 'b'), -2, 170.1, 0, record, &recordSize);
+    rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, bigRid);
+    assert(rc == success && "Inserting a record should not fail.");
+    assert(movingRid.pageNum == bigRid.pageNum && "Both records should share a page.");
+
+    // First move: onto a page of its own
+    int movingLength = RBFM_PAGE_END - 400 - 3 * RBFM_FSM_BUCKET_BYTES;
+    prepareRecord(recordDescriptor.size(), &nullsIndicator, movingLength, string(movingLength, 'm'), movingAge, 170.1, 1, record, &recordSize);
+    rc = rbfm->updateRecord(fileHandle, recordDescriptor, record, movingRid);
+    assert(rc == success && "Updating a record should not fail.");
+    RID firstTarget;
+    findMovingRecord(rbfm, fileHandle, recordDescriptor, firstTarget);
+    assert(firstTarget.pageNum != movingRid.pageNum && "The record should have moved.");
+
+    // Fill what is left of that page, then move the record again
+    int fillerLength = 250 + 2 * RBFM_FSM_BUCKET_BYTES;
+    prepareRecord(recordDescriptor.size(), &nullsIndicator, fillerLength, string(fillerLength, 'f'), 0, 170.1, 0, record, &recordSize);
+    rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, fillerRid);
+    assert(rc == success && "Inserting a record should not fail.");
+    assert(fillerRid.pageNum == firstTarget.pageNum && "The filler should land next to the moved record.");
+
+    movingLength = RBFM_PAGE_END - 300;
+    prepareRecord(recordDescriptor.size(), &nullsIndicator, movingLength, string(movingLength, 'm'), movingAge, 170.1, 2, record, &recordSize);
+    rc = rbfm->updateRecord(fileHandle, recordDescriptor, record, movingRid);
+    assert(rc == success && "Updating a record should not fail.");
+    RID secondTarget;
+    int count = findMovingRecord(rbfm, fileHandle, recordDescriptor, secondTarget);
+    assert(secondTarget.pageNum != firstTarget.pageNum && "The record should have moved again.");
+    if(count != 3)
+        failed = 1;
+
+    // The home slot points straight at the record
+    unsigned before = fetchCount(fileHandle);
+    rc = rbfm->readRecord(fileHandle, recordDescriptor, movingRid, returnedData);
+    assert(rc == success && "Reading a record should not fail.");
+    unsigned fetches = fetchCount(fileHandle) - before;
+    cout << "Pages fetched reading a record moved twice: " << fetches << endl;
+    if(fetches != 2 || memcmp(record, returnedData, recordSize) != 0)
+        failed = 1;
+
+    // With room on its home page again, vacuum brings the record back
+    rc = rbfm->deleteRecord(fileHandle, recordDescriptor, bigRid);
+    assert(rc == success && "Deleting a record should not fail.");
+    VacuumStats stats;
+    rc = rbfm->vacuum(fileHandle, recordDescriptor, stats);
+    assert(rc == success && "Vacuuming the file should not fail.");
+    cout << "Records moved home: " << stats.recordsMovedHome << ", hops removed: " << stats.hopsRemoved
+         << ", pages compacted: " << stats.pagesCompacted << ", pages reclaimed: " << stats.pagesReclaimed << endl;
+    if(stats.recordsMovedHome != 1 || stats.hopsRemoved != 1 || stats.pagesReclaimed < 1)
+        failed = 1;
+
+    before = fetchCount(fileHandle);
+    memset(returnedData, 0, PAGE_SIZE);
+    rc = rbfm->readRecord(fileHandle, recordDescriptor, movingRid, returnedData);
+    assert(rc == success && "Reading a record should not fail.");
+    if(fetchCount(fileHandle) - before != 1 || memcmp(record, returnedData, recordSize) != 0)
+        failed = 1;
+    rc = rbfm->readRecord(fileHandle, recordDescriptor, bigRid, returnedData);
+    assert(rc != success && "Reading a deleted record should fail.");
+
+    // Once the filler goes too, its page comes back; a second vacuum has nothing to move
+    rc = rbfm->deleteRecord(fileHandle, recordDescriptor, fillerRid);
+    assert(rc == success && "Deleting a record should not fail.");
+    rc = rbfm->vacuum(fileHandle, recordDescriptor, stats);
+    assert(rc == success && "Vacuuming the file should not fail.");
+    if(stats.recordsMovedHome != 0 || stats.hopsRemoved != 0 || stats.pagesReclaimed < 1)
+        failed = 1;
+
+    RID found;
+    count = findMovingRecord(rbfm, fileHandle, recordDescriptor, found);
+    if(count != 1 || found.pageNum != movingRid.pageNum || found.slotNum != movingRid.slotNum)
+        failed = 1;
+
+    // The reclaimed pages take new records without growing the file
+    unsigned numPages = fileHandle.getNumberOfPages();
+    prepareRecord(recordDescriptor.size(), &nullsIndicator, bigLength, string(bigLength, 'b'), -2, 170.1, 0, record, &recordSize);
+    for(int i = 0; i < 2; i++)
+    {
+        rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, bigRid);
+        assert(rc == success && "Inserting a record should not fail.");
+    }
+    if(fileHandle.getNumberOfPages() != numPages)
+        failed = 1;
+
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+
+    rc = rbfm->destroyFile(fileName);
+    assert(rc == success && "Destroying the file should not fail.");
+
+    free(record);
+    free(returnedData);
+
+    if(failed)
+    {
+        cout << "[FAIL] Test Case 22 Failed!" << endl << endl;
+        return -1;
+    }
+
+    cout << "RBF Test Case 22 Finished! The result will be examined." << endl << endl;
+
+    return 0;
+}
+
+int main()
+{
+    // To test forwarding chains and vacuum
+    RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
+
+    remove("test22");
+
+    RC rcmain = RBFTest_22(rbfm);
+    return rcmain;
+}
@@ -0,0 +1,184 @@
+#include <iostream>
+#include <string>
+#include <cassert>
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdexcept>
+#include <stdio.h>
+#include <set>
+
+#include "pfm.h"
+#include "rbfm.h"
+#include "test_util.h"
+
+using namespace std;
+
+// Small records, all on the first data page
+const int numRecords = 80;
+const int numDeleted = 5;
+const unsigned deletedSlots[numDeleted] = { 3, 17, 40, 41, 79 };
+
+int RBFTest_23(RecordBasedFileManager *rbfm)
+{
+    // Functions Tested:
+    // 1. Create Record-Based File
+    // 2. Delete Records and insert new ones into their slots through the free-slot chain **
+    // 3. Keep the chain across a reopen and a vacuum **
+    // 4. Insert a Record that fits only once the page's holes are closed up **
+    // 5. Close/Destroy Record-Based File
+    cout << endl << "***** In RBF Test Case 23 *****" << endl;
+
+    RC rc;
+    string fileName = "test23";
+
+    rc = rbfm->createFile(fileName);
+    assert(rc == success && "Creating the file should not fail.");
+
+    FileHandle fileHandle;
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+
+    vector<Attribute> recordDescriptor;
+    createRecordDescriptor(recordDescriptor);
+
+    unsigned char nullsIndicator = 0;
+    void *record = malloc(100);
+    void *returnedData = malloc(100);
+    int recordSize = 0;
+    vector<RID> rids(numRecords);
+    int failed = 0;
+    for(int i = 0; i < numRecords; i++)
+    {
+        prepareRecord(recordDescriptor.size(), &nullsIndicator, 8, "Anteater", i, 170.1, i * 10, record, &recordSize);
+        rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rids[i]);
+        assert(rc == success && "Inserting a record should not fail.");
+        assert(rids[i].pageNum == rids[0].pageNum && rids[i].slotNum == (unsigned) i && "The records should fill one page in order.");
+    }
+
+    for(int i = 0; i < numDeleted; i++)
+    {
+        rc = rbfm->deleteRecord(fileHandle, recordDescriptor, rids[deletedSlots[i]]);
+        assert(rc == success && "Deleting a record should not fail.");
+        rc = rbfm->readRecord(fileHandle, recordDescriptor, rids[deletedSlots[i]], returnedData);
+        assert(rc == RBFM_READ_AFTER_DEL && "Reading a deleted record should fail.");
+    }
+
+    // The chain survives closing the file
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+
+    // New records take the dead slots, most recently freed first, before the directory grows
+    for(int i = numDeleted - 1; i >= 0; i--)
+    {
+        RID rid;
+        prepareRecord(recordDescriptor.size(), &nullsIndicator, 8, "Aardvark", 1000 + deletedSlots[i], 170.1, 0, record, &recordSize);
+        rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+        assert(rc == success && "Inserting a record should not fail.");
+        if(rid.pageNum != rids[0].pageNum || rid.slotNum != deletedSlots[i])
+            failed = 1;
+    }
+    RID rid;
+    rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+    assert(rc == success && "Inserting a record should not fail.");
+    if(rid.pageNum != rids[0].pageNum || rid.slotNum != numRecords)
+        failed = 1;
+
+    // Nothing else moved
+    set<unsigned> deleted(deletedSlots, deletedSlots + numDeleted);
+    for(int i = 0; i < numRecords; i++)
+    {
+        if(deleted.count(i))
+            prepareRecord(recordDescriptor.size(), &nullsIndicator, 8, "Aardvark", 1000 + i, 170.1, 0, record, &recordSize);
+        else
+            prepareRecord(recordDescriptor.size(), &nullsIndicator, 8, "Anteater", i, 170.1, i * 10, record, &recordSize);
+        rc = rbfm->readRecord(fileHandle, recordDescriptor, rids[i], returnedData);
+        if(rc != success || memcmp(record, returnedData, recordSize) != 0)
+            failed = 1;
+    }
+
+    // Vacuum drops the dead slot at the end and keeps the one in the middle chained
+    RID middle = rids[10];
+    rc = rbfm->deleteRecord(fileHandle, recordDescriptor, middle);
+    assert(rc == success && "Deleting a record should not fail.");
+    rc = rbfm->deleteRecord(fileHandle, recordDescriptor, rid);
+    assert(rc == success && "Deleting a record should not fail.");
+    VacuumStats stats;
+    rc = rbfm->vacuum(fileHandle, recordDescriptor, stats);
+    assert(rc == success && "Vacuuming the file should not fail.");
+    if(stats.pagesCompacted != 1)
+        failed = 1;
+    rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+    assert(rc == success && "Inserting a record should not fail.");
+    if(rid.pageNum != middle.pageNum || rid.slotNum != middle.slotNum)
+        failed = 1;
+    rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+    assert(rc == success && "Inserting a record should not fail.");
+    if(rid.pageNum != middle.pageNum || rid.slotNum != numRecords)
+        failed = 1;
+
+    // Fill the page, then punch holes in it: a record only the holes together have room for
+    // still lands on it once the page is compacted
+    PageNum pageNum = rids[0].pageNum;
+    prepareRecord(recordDescriptor.size(), &nullsIndicator, 8, "Anteater", 0, 170.1, 0, record, &recordSize);
+    while(rid.pageNum == pageNum)
+    {
+        rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+        assert(rc == success && "Inserting a record should not fail.");
+    }
+    rc = rbfm->deleteRecord(fileHandle, recordDescriptor, rid);
+    assert(rc == success && "Deleting a record should not fail.");
+    const int holes[3] = { 20, 21, 50 };
+    for(int i = 0; i < 3; i++)
+    {
+        rc = rbfm->deleteRecord(fileHandle, recordDescriptor, rids[holes[i]]);
+        assert(rc == success && "Deleting a record should not fail.");
+    }
+    prepareRecord(recordDescriptor.size(), &nullsIndicator, 40, string(40, 'c'), 2000, 170.1, 0, record, &recordSize);
+    rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+    assert(rc == success && "Inserting a record should not fail.");
+    rc = rbfm->readRecord(fileHandle, recordDescriptor, rid, returnedData);
+    if(rc != success || rid.pageNum != pageNum || memcmp(record, returnedData, recordSize) != 0)
+        failed = 1;
+    for(int i = 0; i < numRecords; i++)
+    {
+        if(deleted.count(i) || i == 10 || i == 20 || i == 21 || i == 50)
+            continue;
+        prepareRecord(recordDescriptor.size(), &nullsIndicator, 8, "Anteater", i, 170.1, i * 10, record, &recordSize);
+        rc = rbfm->readRecord(fileHandle, recordDescriptor, rids[i], returnedData);
+        if(rc != success || memcmp(record, returnedData, recordSize) != 0)
+            failed = 1;
+    }
+
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+
+    rc = rbfm->destroyFile(fileName);
+    assert(rc == success && "Destroying the file should not fail.");
+
+    free(record);
+    free(returnedData);
+
+    if(failed)
+    {
+        cout << "[FAIL] Test Case 23 Failed!" << endl << endl;
+        return -1;
+    }
+
+    cout << "RBF Test Case 23 Finished! The result will be examined." << endl << endl;
+
+    return 0;
+}
+
+int main()
+{
+    // To test the free-slot chain
+    RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
+
+    remove("test23");
+
+    RC rcmain = RBFTest_23(rbfm);
+    return rcmain;
+}
@@ -0,0 +1,189 @@
+#include <iostream>
+#include <string>
+#include <cassert>
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdexcept>
+#include <stdio.h>
+
+#include "pfm.h"
+#include "rbfm.h"
+#include "test_util.h"
+
+using namespace std;
+
+const int numRecords = 2000;
+const int ageLimit = 100;
+const unsigned batchCapacity = 200;
+
+// Size of a Salary, EmpName tuple
+unsigned tupleSize(const char *tuple)
+{
+    unsigned size = 1;
+    if (!(tuple[0] & (1 << 7)))
+        size += INT_SIZE;
+    if (!(tuple[0] & (1 << 6)))
+    {
+        int nameLength;
+        memcpy(&nameLength, tuple + size, VARCHAR_LENGTH_SIZE);
+        size += VARCHAR_LENGTH_SIZE + nameLength;
+    }
+    return size;
+}
+
+int RBFTest_24(RecordBasedFileManager *rbfm)
+{
+    // Functions Tested:
+    // 1. Create Record-Based File
+    // 2. Insert Records, then delete most of the first half
+    // 3. Scan one record at a time, and again in batches **
+    // 4. Close/Destroy Record-Based File
+    cout << endl << "***** In RBF Test Case 24 *****" << endl;
+
+    RC rc;
+    string fileName = "test24";
+
+    rc = rbfm->createFile(fileName);
+    assert(rc == success && "Creating the file should not fail.");
+
+    FileHandle fileHandle;
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+
+    vector<Attribute> recordDescriptor;
+    createRecordDescriptor(recordDescriptor);
+
+    void *record = malloc(100);
+    int recordSize = 0;
+    vector<RID> rids(numRecords);
+    for(int i = 0; i < numRecords; i++)
+    {
+        // Some names and salaries are null
+        unsigned char nullsIndicator = 0;
+        if (i % 7 == 3)
+            nullsIndicator |= 1 << 7;
+        if (i % 5 == 1)
+            nullsIndicator |= 1 << 4;
+        prepareRecord(recordDescriptor.size(), &nullsIndicator, i % 20, string(i % 20, 'n'), i, 170.1, i * 10, record, &recordSize);
+        rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rids[i]);
+        assert(rc == success && "Inserting a record should not fail.");
+    }
+    // Sparse pages, mostly dead slots
+    for(int i = 0; i < numRecords / 2; i++)
+    {
+        if (i % 10 == 0)
+            continue;
+        rc = rbfm->deleteRecord(fileHandle, recordDescriptor, rids[i]);
+        assert(rc == success && "Deleting a record should not fail.");
+    }
+
+    vector<string> attributeNames;
+    attributeNames.push_back("Salary");
+    attributeNames.push_back("EmpName");
+    int age = ageLimit;
+
+    // One record at a time, as the reference
+    RBFM_ScanIterator rbfmScanIterator;
+    rc = rbfm->scan(fileHandle, recordDescriptor, "Age", GE_OP, &age, attributeNames, rbfmScanIterator);
+    assert(rc == success && "Scanning the file should not fail.");
+    vector<RID> expectedRids;
+    string expected;
+    RID rid;
+    char tuple[100];
+    while(rbfmScanIterator.getNextRecord(rid, tuple) != RBFM_EOF)
+    {
+        expectedRids.push_back(rid);
+        expected.append(tuple, tupleSize(tuple));
+    }
+    rbfmScanIterator.close();
+    assert(expectedRids.size() == (unsigned) (numRecords - ageLimit - (numRecords / 2 - ageLimit) * 9 / 10) && "The scan should return every record at or above the limit.");
+
+    // In batches; a buffer too small for the next record keeps it for the next call
+    rc = rbfm->scan(fileHandle, recordDescriptor, "Age", GE_OP, &age, attributeNames, rbfmScanIterator);
+    assert(rc == success && "Scanning the file should not fail.");
+    char buffer[batchCapacity];
+    vector<RID> batchRids;
+    unsigned count;
+    rc = rbfmScanIterator.getNextBatch(batchRids, buffer, 3, count);
+    assert(rc == RBFM_BATCH_TOO_SMALL && count == 0 && "A record larger than the buffer should not be returned.");
+
+    vector<RID> returnedRids;
+    string returned;
+    int failed = 0;
+    unsigned batches = 0;
+    while((rc = rbfmScanIterator.getNextBatch(batchRids, buffer, batchCapacity, count)) == success)
+    {
+        if(count == 0 || count != batchRids.size())
+            failed = 1;
+        unsigned used = 0;
+        for(unsigned i = 0; i < count; i++)
+            used += tupleSize(buffer + used);
+        if(used > batchCapacity)
+            failed = 1;
+        returned.append(buffer, used);
+        returnedRids.insert(returnedRids.end(), batchRids.begin(), batchRids.end());
+        batches++;
+    }
+    assert(rc == RBFM_EOF && "The batches should end with the scan.");
+    rc = rbfmScanIterator.getNextBatch(batchRids, buffer, batchCapacity, count);
+    if(rc != RBFM_EOF || count != 0)
+        failed = 1;
+    rbfmScanIterator.close();
+    cout << expectedRids.size() << " records in " << batches << " batches" << endl;
+
+    if(returned != expected || returnedRids.size() != expectedRids.size())
+        failed = 1;
+    for(unsigned i = 0; i < returnedRids.size() && i < expectedRids.size(); i++)
+        if(returnedRids[i].pageNum != expectedRids[i].pageNum || returnedRids[i].slotNum != expectedRids[i].slotNum)
+            failed = 1;
+
+    // With nothing projected a batch still holds no more RIDs than the capacity has room for
+    rc = rbfm->scan(fileHandle, recordDescriptor, "Age", GE_OP, &age, vector<string>(), rbfmScanIterator);
+    assert(rc == success && "Scanning the file should not fail.");
+    rc = rbfmScanIterator.getNextBatch(batchRids, buffer, sizeof(RID) - 1, count);
+    assert(rc == RBFM_BATCH_TOO_SMALL && count == 0 && "No RID should be returned without room for one.");
+    returnedRids.clear();
+    while((rc = rbfmScanIterator.getNextBatch(batchRids, buffer, 4 * sizeof(RID), count)) == success)
+    {
+        if(count == 0 || count > 4)
+            failed = 1;
+        returnedRids.insert(returnedRids.end(), batchRids.begin(), batchRids.end());
+    }
+    assert(rc == RBFM_EOF && "The batches should end with the scan.");
+    rbfmScanIterator.close();
+    if(returnedRids.size() != expectedRids.size())
+        failed = 1;
+    for(unsigned i = 0; i < returnedRids.size() && i < expectedRids.size(); i++)
+        if(returnedRids[i].pageNum != expectedRids[i].pageNum || returnedRids[i].slotNum != expectedRids[i].slotNum)
+            failed = 1;
+
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+
+    rc = rbfm->destroyFile(fileName);
+    assert(rc == success && "Destroying the file should not fail.");
+
+    free(record);
+
+    if(failed)
+    {
+        cout << "[FAIL] Test Case 24 Failed!" << endl << endl;
+        return -1;
+    }
+
+    cout << "RBF Test Case 24 Finished! The result will be examined." << endl << endl;
+
+    return 0;
+}
+
+int main()
+{
+    // To test batch scans
+    RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
+
+    remove("test24");
+
+    RC rcmain = RBFTest_24(rbfm);
+    return rcmain;
+}
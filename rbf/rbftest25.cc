@@ -0,0 +1,191 @@
+#include <iostream>
+#include <string>
+#include <cassert>
+#include <cmath>
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdexcept>
+#include <stdio.h>
+
+#include "pfm.h"
+#include "rbfm.h"
+#include "filter.h"
+#include "test_util.h"
+
+using namespace std;
+
+const int numRecords = 3000;
+const unsigned columnSize = 203;   // Not a multiple of any vector width
+
+// Record i: Salary i, Age i % 100, Height i % 50 / 2, and some of each null
+void prepareVersion(int i, int v, const vector<Attribute> &recordDescriptor, void *record, int *recordSize)
+{
+    (void) v;
+    unsigned char nullsIndicator = 0;
+    if(ageIsNull(i))
+        nullsIndicator |= 1 << 6;
+    if(heightIsNull(i))
+        nullsIndicator |= 1 << 5;
+    prepareRecord(recordDescriptor.size(), &nullsIndicator, i % 10, string(i % 10, 'n'), i % 100, (i % 50) / 2.0f, i, record, recordSize);
+}
+
+bool compareInt(int a, CompOp compOp, int b)
+{
+    switch (compOp)
+    {
+        case EQ_OP: return a == b;
+        case LT_OP: return a < b;
+        case LE_OP: return a <= b;
+        case GT_OP: return a > b;
+        case GE_OP: return a >= b;
+        case NE_OP: return a != b;
+        default: return true;
+    }
+}
+
+bool compareReal(float a, CompOp compOp, float b)
+{
+    switch (compOp)
+    {
+        case EQ_OP: return a == b;
+        case LT_OP: return a < b;
+        case LE_OP: return a <= b;
+        case GT_OP: return a > b;
+        case GE_OP: return a >= b;
+        case NE_OP: return a != b;
+        default: return true;
+    }
+}
+
+int RBFTest_25(RecordBasedFileManager *rbfm)
+{
+    // Functions Tested:
+    // 1. Predicate kernels, vector and scalar **
+    // 2. Insert / Delete Records
+    // 3. Scan with Int and Real conditions, evaluated a page at a time **
+    // 4. Close/Destroy Record-Based File
+    cout << endl << "***** In RBF Test Case 25 *****" << endl;
+    cout << "Predicate kernels: " << selectKernel() << endl;
+
+    RC rc;
+    string fileName = "test25";
+    const CompOp ops[] = { EQ_OP, LT_OP, LE_OP, GT_OP, GE_OP, NE_OP, NO_OP };
+    int failed = 0;
+
+    // The kernels agree with each other and with C++ comparisons, extremes and NaN included
+    int32_t ints[columnSize];
+    float reals[columnSize];
+    for(unsigned i = 0; i < columnSize; i++)
+    {
+        ints[i] = (int32_t) (i * 2654435761u) % 9 - 4;
+        reals[i] = ints[i] * 0.5f;
+    }
+    ints[7] = INT32_MIN;
+    ints[8] = INT32_MAX;
+    reals[9] = NAN;
+    reals[10] = -INFINITY;
+    reals[11] = -0.0f;
+    uint64_t selection[(columnSize + 63) / 64];
+    uint64_t scalarSelection[(columnSize + 63) / 64];
+    for(unsigned op = 0; op < sizeof(ops) / sizeof(ops[0]); op++)
+    {
+        for(int value = -5; value <= 5; value++)
+        {
+            for(unsigned n = columnSize - 9; n <= columnSize; n++)
+            {
+                selectInt(ints, n, ops[op], value, selection);
+                selectIntScalar(ints, n, ops[op], value, scalarSelection);
+                for(unsigned i = 0; i < n; i++)
+                    if(((selection[i / 64] >> (i % 64)) & 1) != compareInt(ints[i], ops[op], value)
+                       || ((scalarSelection[i / 64] >> (i % 64)) & 1) != compareInt(ints[i], ops[op], value))
+                        failed = 1;
+                if(n % 64 && selection[n / 64] >> (n % 64))
+                    failed = 1;
+
+                float realValue = value * 0.5f;
+                selectReal(reals, n, ops[op], realValue, selection);
+                selectRealScalar(reals, n, ops[op], realValue, scalarSelection);
+                for(unsigned i = 0; i < n; i++)
+                    if(((selection[i / 64] >> (i % 64)) & 1) != compareReal(reals[i], ops[op], realValue)
+                       || ((scalarSelection[i / 64] >> (i % 64)) & 1) != compareReal(reals[i], ops[op], realValue))
+                        failed = 1;
+                if(n % 64 && selection[n / 64] >> (n % 64))
+                    failed = 1;
+            }
+        }
+    }
+    if(failed)
+        cout << "The predicate kernels disagree with C++ comparisons." << endl;
+
+    rc = rbfm->createFile(fileName);
+    assert(rc == success && "Creating the file should not fail.");
+
+    FileHandle fileHandle;
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+
+    vector<Attribute> recordDescriptor;
+    createRecordDescriptor(recordDescriptor);
+
+    void *record = malloc(100);
+    int recordSize = 0;
+    vector<RID> rids(numRecords);
+    for(int i = 0; i < numRecords; i++)
+    {
+        prepareVersion(i, 0, recordDescriptor, record, &recordSize);
+        rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rids[i]);
+        assert(rc == success && "Inserting a record should not fail.");
+    }
+    for(int i = 0; i < numRecords; i++)
+    {
+        if(!isDeleted(i))
+            continue;
+        rc = rbfm->deleteRecord(fileHandle, recordDescriptor, rids[i]);
+        assert(rc == success && "Deleting a record should not fail.");
+    }
+
+    // Every operator, on both types, returns exactly the records a record-at-a-time check does
+    vector<int> versions = liveVersions(numRecords);
+    vector<string> attributeNames;
+    attributeNames.push_back("Salary");
+    for(unsigned op = 0; op < sizeof(ops) / sizeof(ops[0]) - 1; op++)
+    {
+        int age = 37;
+        float height = 12.5f;
+        CompOp compOp = ops[op];
+        countScan(rbfm, fileHandle, recordDescriptor, "Age", compOp, &age, attributeNames, versions, prepareVersion,
+                  [=](int i, int) { return !ageIsNull(i) && compareInt(i % 100, compOp, age); }, failed);
+        countScan(rbfm, fileHandle, recordDescriptor, "Height", compOp, &height, attributeNames, versions, prepareVersion,
+                  [=](int i, int) { return !heightIsNull(i) && compareReal((i % 50) / 2.0f, compOp, height); }, failed);
+    }
+
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+
+    rc = rbfm->destroyFile(fileName);
+    assert(rc == success && "Destroying the file should not fail.");
+
+    free(record);
+
+    if(failed)
+    {
+        cout << "[FAIL] Test Case 25 Failed!" << endl << endl;
+        return -1;
+    }
+
+    cout << "RBF Test Case 25 Finished! The result will be examined." << endl << endl;
+
+    return 0;
+}
+
+int main()
+{
+    // To test page at a time predicate evaluation
+    RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
+
+    remove("test25");
+
+    RC rcmain = RBFTest_25(rbfm);
+    return rcmain;
+}
@@ -0,0 +1,160 @@
+#include <iostream>
+#include <string>
+#include <cassert>
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdexcept>
+#include <stdio.h>
+
+#include "pfm.h"
+#include "rbfm.h"
+#include "test_util.h"
+
+using namespace std;
+
+const int copies = 40;
+
+// Strings that share 8 byte prefixes, differ only in length or past a NUL, or hold bytes above 0x7f
+const string names[] = {
+    string(""), string("a"), string("a\0", 2), string("a\0b", 3), string("a\0a", 3), string("ab"),
+    string("abcdefgh"), string("abcdefgh\0", 9), string("abcdefghi"), string("abcdefgz"),
+    string("abcdefghijklmnopqrstuvwxyz"), string("abcdefghijklmnopqrstuvwxyy"), string("\xff"),
+    string("\x7f\xff"), string(50, 'z')
+};
+const unsigned numNames = sizeof(names) / sizeof(names[0]);
+
+// Record i: Id i, then Name names[i % numNames]
+void prepareVersion(int i, int v, const vector<Attribute> &recordDescriptor, void *record, int *recordSize)
+{
+    (void) v;
+    char *data = (char *) record;
+    data[0] = nameIsNull(i) ? 1 << 6 : 0;
+    memcpy(data + 1, &i, INT_SIZE);
+    *recordSize = 1 + INT_SIZE;
+    if(nameIsNull(i))
+        return;
+    const string &name = names[i % numNames];
+    uint32_t length = name.size();
+    memcpy(data + *recordSize, &length, VARCHAR_LENGTH_SIZE);
+    memcpy(data + *recordSize + VARCHAR_LENGTH_SIZE, name.data(), length);
+    *recordSize += VARCHAR_LENGTH_SIZE + length;
+}
+
+bool compareString(const string &a, CompOp compOp, const string &b)
+{
+    int cmp = a.compare(b);
+    switch (compOp)
+    {
+        case EQ_OP: return cmp == 0;
+        case LT_OP: return cmp < 0;
+        case LE_OP: return cmp <= 0;
+        case GT_OP: return cmp > 0;
+        case GE_OP: return cmp >= 0;
+        case NE_OP: return cmp != 0;
+        default: return true;
+    }
+}
+
+int RBFTest_26(RecordBasedFileManager *rbfm)
+{
+    // Functions Tested:
+    // 1. Create Record-Based File
+    // 2. Insert / Delete Records
+    // 3. Scan with VarChar conditions, embedded NULs and shared prefixes included **
+    // 4. Close/Destroy Record-Based File
+    cout << endl << "***** In RBF Test Case 26 *****" << endl;
+
+    RC rc;
+    string fileName = "test26";
+    const CompOp ops[] = { EQ_OP, LT_OP, LE_OP, GT_OP, GE_OP, NE_OP };
+    int failed = 0;
+
+    rc = rbfm->createFile(fileName);
+    assert(rc == success && "Creating the file should not fail.");
+
+    FileHandle fileHandle;
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+
+    // Id, then Name as a VarChar(50)
+    vector<Attribute> recordDescriptor;
+    Attribute attr;
+    attr.name = "Id";
+    attr.type = TypeInt;
+    attr.length = (AttrLength) 4;
+    recordDescriptor.push_back(attr);
+    attr.name = "Name";
+    attr.type = TypeVarChar;
+    attr.length = (AttrLength) 50;
+    recordDescriptor.push_back(attr);
+
+    int numRecords = copies * numNames;
+    char record[1 + INT_SIZE + VARCHAR_LENGTH_SIZE + 50];
+    int recordSize = 0;
+    vector<RID> rids(numRecords);
+    for(int i = 0; i < numRecords; i++)
+    {
+        prepareVersion(i, 0, recordDescriptor, record, &recordSize);
+        rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rids[i]);
+        assert(rc == success && "Inserting a record should not fail.");
+    }
+    for(int i = 0; i < numRecords; i++)
+    {
+        if(!isDeleted(i))
+            continue;
+        rc = rbfm->deleteRecord(fileHandle, recordDescriptor, rids[i]);
+        assert(rc == success && "Deleting a record should not fail.");
+    }
+
+    // Every operator against every name, and a few names no record holds
+    vector<string> values(names, names + numNames);
+    values.push_back(string("a\0\0", 3));
+    values.push_back(string("abcdefg"));
+    values.push_back(string("abcdefgh\0\0", 10));
+    values.push_back(string("\x80"));
+    vector<int> versions = liveVersions(numRecords);
+    vector<string> attributeNames;
+    attributeNames.push_back("Id");
+    char value[VARCHAR_LENGTH_SIZE + 50];
+    for(unsigned v = 0; v < values.size(); v++)
+    {
+        const string name = values[v];
+        uint32_t length = name.size();
+        memcpy(value, &length, VARCHAR_LENGTH_SIZE);
+        memcpy(value + VARCHAR_LENGTH_SIZE, name.data(), length);
+        for(unsigned op = 0; op < sizeof(ops) / sizeof(ops[0]); op++)
+        {
+            CompOp compOp = ops[op];
+            countScan(rbfm, fileHandle, recordDescriptor, "Name", compOp, value, attributeNames, versions, prepareVersion,
+                      [=](int i, int) { return !nameIsNull(i) && compareString(names[i % numNames], compOp, name); }, failed);
+        }
+    }
+
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+
+    rc = rbfm->destroyFile(fileName);
+    assert(rc == success && "Destroying the file should not fail.");
+
+    if(failed)
+    {
+        cout << "[FAIL] Test Case 26 Failed!" << endl << endl;
+        return -1;
+    }
+
+    cout << "RBF Test Case 26 Finished! The result will be examined." << endl << endl;
+
+    return 0;
+}
+
+int main()
+{
+    // To test VarChar scan conditions
+    RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
+
+    remove("test26");
+
+    RC rcmain = RBFTest_26(rbfm);
+    return rcmain;
+}
@@ -0,0 +1,187 @@
+#include <iostream>
+#include <string>
+#include <cassert>
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdexcept>
+#include <stdio.h>
+
+#include "pfm.h"
+#include "rbfm.h"
+#include "test_util.h"
+
+using namespace std;
+
+const int numRecords = 6000;
+
+// Record i: Salary i; EmpName, Age and Height vary, each sometimes null; every seventh is
+// deleted. Age changes pattern every 1000 records so the terms' pass rates shift along the file.
+string nameOf(int i) { return string(1 + i % 6, 'a' + i % 4); }
+int ageOf(int i) { return (i / 1000) % 2 ? i % 100 : i % 7; }
+float heightOf(int i) { return (i % 50) / 2.0f; }
+
+void prepareVersion(int i, int v, const vector<Attribute> &recordDescriptor, void *record, int *recordSize)
+{
+    (void) v;
+    unsigned char nullsIndicator = 0;
+    if(nameIsNull(i))
+        nullsIndicator |= 1 << 7;
+    if(ageIsNull(i))
+        nullsIndicator |= 1 << 6;
+    if(heightIsNull(i))
+        nullsIndicator |= 1 << 5;
+    string name = nameOf(i);
+    prepareRecord(recordDescriptor.size(), &nullsIndicator, name.size(), name, ageOf(i), heightOf(i), i, record, recordSize);
+}
+
+// A VarChar value in the API format
+string varChar(const string &s)
+{
+    uint32_t length = s.size();
+    return string((const char *) &length, VARCHAR_LENGTH_SIZE) + s;
+}
+
+int RBFTest_27(RecordBasedFileManager *rbfm)
+{
+    // Functions Tested:
+    // 1. Create Record-Based File
+    // 2. Insert / Delete Records
+    // 3. Scan with predicate trees: AND, OR, NOT, IS NULL, IS NOT NULL **
+    // 4. Close/Destroy Record-Based File
+    cout << endl << "***** In RBF Test Case 27 *****" << endl;
+
+    RC rc;
+    string fileName = "test27";
+    int failed = 0;
+
+    rc = rbfm->createFile(fileName);
+    assert(rc == success && "Creating the file should not fail.");
+
+    FileHandle fileHandle;
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+
+    vector<Attribute> recordDescriptor;
+    createRecordDescriptor(recordDescriptor);
+
+    void *record = malloc(100);
+    int recordSize = 0;
+    vector<RID> rids(numRecords);
+    for(int i = 0; i < numRecords; i++)
+    {
+        prepareVersion(i, 0, recordDescriptor, record, &recordSize);
+        rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rids[i]);
+        assert(rc == success && "Inserting a record should not fail.");
+    }
+    for(int i = 0; i < numRecords; i++)
+    {
+        if(!isDeleted(i))
+            continue;
+        rc = rbfm->deleteRecord(fileHandle, recordDescriptor, rids[i]);
+        assert(rc == success && "Deleting a record should not fail.");
+    }
+
+    vector<int> versions = liveVersions(numRecords);
+    vector<string> salary;
+    salary.push_back("Salary");
+    int three = 3, fifty = 50, ninety = 90;
+    float two = 2.0f, ten = 10.0f;
+    string bbb = varChar("bbb"), b = varChar("b");
+
+    // AND of three types; the first term passes for most records, the last for few
+    Predicate conjunction = Predicate::allOf(Predicate::allOf(Predicate::compare("Age", LT_OP, &fifty),
+                                                              Predicate::compare("Height", GE_OP, &ten)),
+                                             Predicate::compare("EmpName", EQ_OP, bbb.data()));
+    countScan(rbfm, fileHandle, recordDescriptor, conjunction, salary, versions, prepareVersion, [](int i, int) {
+        return !ageIsNull(i) && ageOf(i) < 50 && !heightIsNull(i) && heightOf(i) >= 10.0f
+               && !nameIsNull(i) && nameOf(i) == "bbb";
+    }, failed);
+
+    // OR with a null test
+    vector<Predicate> terms;
+    terms.push_back(Predicate::compare("Age", EQ_OP, &three));
+    terms.push_back(Predicate::isNull("Height"));
+    terms.push_back(Predicate::compare("EmpName", LT_OP, b.data()));
+    countScan(rbfm, fileHandle, recordDescriptor, Predicate::anyOf(terms), salary, versions, prepareVersion, [](int i, int) {
+        return (!ageIsNull(i) && ageOf(i) == 3) || heightIsNull(i) || (!nameIsNull(i) && nameOf(i) < "b");
+    }, failed);
+
+    // NOT of a comparison takes in the records where the attribute is null
+    countScan(rbfm, fileHandle, recordDescriptor, Predicate::negate(Predicate::compare("Age", LT_OP, &fifty)),
+              salary, versions, prepareVersion, [](int i, int) {
+        return ageIsNull(i) || ageOf(i) >= 50;
+    }, failed);
+
+    // NOT of an OR inside an AND
+    countScan(rbfm, fileHandle, recordDescriptor,
+              Predicate::allOf(Predicate::isNotNull("EmpName"),
+                               Predicate::negate(Predicate::anyOf(Predicate::compare("Age", GT_OP, &ninety),
+                                                                  Predicate::compare("Height", LT_OP, &two)))),
+              salary, versions, prepareVersion, [](int i, int) {
+        return !nameIsNull(i) && !(!ageIsNull(i) && ageOf(i) > 90) && !(!heightIsNull(i) && heightOf(i) < 2.0f);
+    }, failed);
+
+    // An OR of ANDs, with NE
+    countScan(rbfm, fileHandle, recordDescriptor,
+              Predicate::anyOf(Predicate::allOf(Predicate::compare("Age", NE_OP, &three), Predicate::isNull("EmpName")),
+                               Predicate::allOf(Predicate::compare("Height", LE_OP, &two), Predicate::compare("Age", GE_OP, &ninety))),
+              salary, versions, prepareVersion, [](int i, int) {
+        return (!ageIsNull(i) && ageOf(i) != 3 && nameIsNull(i))
+               || (!heightIsNull(i) && heightOf(i) <= 2.0f && !ageIsNull(i) && ageOf(i) >= 90);
+    }, failed);
+
+    // A lone comparison is still evaluated a page at a time
+    countScan(rbfm, fileHandle, recordDescriptor, Predicate::compare("Age", GE_OP, &ninety),
+              salary, versions, prepareVersion, [](int i, int) {
+        return !ageIsNull(i) && ageOf(i) >= 90;
+    }, failed);
+
+    // Empty AND / OR, and a comparison without an operator
+    terms.clear();
+    countScan(rbfm, fileHandle, recordDescriptor, Predicate::allOf(terms), salary, versions, prepareVersion,
+              [](int, int) { return true; }, failed);
+    countScan(rbfm, fileHandle, recordDescriptor, Predicate::anyOf(terms), salary, versions, prepareVersion,
+              [](int, int) { return false; }, failed);
+    countScan(rbfm, fileHandle, recordDescriptor, Predicate::compare("Age", NO_OP, NULL), salary, versions, prepareVersion,
+              [](int, int) { return true; }, failed);
+
+    // An unknown attribute anywhere in the tree fails the scan
+    vector<string> attributeNames;
+    RBFM_ScanIterator rbfmScanIterator;
+    rc = rbfm->scan(fileHandle, recordDescriptor,
+                    Predicate::anyOf(Predicate::isNull("Age"), Predicate::negate(Predicate::isNull("Weight"))),
+                    attributeNames, rbfmScanIterator);
+    if(rc != RBFM_NO_SUCH_ATTR)
+        failed = 1;
+    rbfmScanIterator.close();
+
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+
+    rc = rbfm->destroyFile(fileName);
+    assert(rc == success && "Destroying the file should not fail.");
+
+    free(record);
+
+    if(failed)
+    {
+        cout << "[FAIL] Test Case 27 Failed!" << endl << endl;
+        return -1;
+    }
+
+    cout << "RBF Test Case 27 Finished! The result will be examined." << endl << endl;
+
+    return 0;
+}
+
+int main()
+{
+    // To test predicate tree scans
+    RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
+
+    remove("test27");
+
+    RC rcmain = RBFTest_27(rbfm);
+    return rcmain;
+}
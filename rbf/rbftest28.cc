@@ -0,0 +1,251 @@
+#include <iostream>
+#include <string>
+#include <cassert>
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdexcept>
+#include <stdio.h>
+
+#include "pfm.h"
+#include "rbfm.h"
+#include "test_util.h"
+
+using namespace std;
+
+const int numRecords = 3000;
+
+// Record i at version v: Salary i; EmpName and Age change with v, each sometimes null.
+// EmpName takes every length from 0 to its declared 30.
+string nameOf(int i, int v) { return string((i + v * 7) % 31, 'a' + (i + v) % 26); }
+int ageOf(int i, int v) { return i % 100 + v; }
+float heightOf(int i) { return i / 4.0f; }
+
+void prepareVersion(int i, int v, const vector<Attribute> &recordDescriptor, void *record, int *recordSize)
+{
+    unsigned char nullsIndicator = 0;
+    if(nameIsNull(i))
+        nullsIndicator |= 1 << 7;
+    if(ageIsNull(i))
+        nullsIndicator |= 1 << 6;
+    string name = nameOf(i, v);
+    prepareRecord(recordDescriptor.size(), &nullsIndicator, name.size(), name, ageOf(i, v), heightOf(i), i, record, recordSize);
+}
+
+int RBFTest_28(RecordBasedFileManager *rbfm)
+{
+    // Functions Tested:
+    // 1. Create a PAX Record-Based File **
+    // 2. Insert / Read / Update / Delete Records, Read Attributes
+    // 3. Scan with a condition, a predicate and record views
+    // 4. Vacuum, Close, Reopen, Destroy Record-Based File
+    cout << endl << "***** In RBF Test Case 28 *****" << endl;
+
+    RC rc;
+    string fileName = "test28";
+    int failed = 0;
+
+    rc = rbfm->createFile(fileName, PFM_CHECKSUMS | RBFM_PAX);
+    assert(rc == success && "Creating the file should not fail.");
+
+    FileHandle fileHandle;
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+
+    vector<Attribute> recordDescriptor;
+    createRecordDescriptor(recordDescriptor);
+
+    char record[100];
+    int recordSize = 0;
+    vector<RID> rids(numRecords);
+    vector<int> versions(numRecords, 0);
+    for(int i = 0; i < numRecords; i++)
+    {
+        prepareVersion(i, 0, recordDescriptor, record, &recordSize);
+        rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rids[i]);
+        assert(rc == success && "Inserting a record should not fail.");
+    }
+    checkRecords(rbfm, fileHandle, recordDescriptor, rids, versions, prepareVersion, failed);
+
+    // A VarChar longer than declared has no room in a PAX row
+    unsigned char nullsIndicator = 0;
+    string tooLong(31, 'x');
+    prepareRecord(recordDescriptor.size(), &nullsIndicator, tooLong.size(), tooLong, 1, 1.0f, 1, record, &recordSize);
+    RID rid;
+    if(rbfm->insertRecord(fileHandle, recordDescriptor, record, rid) != RBFM_RECORD_TOO_LARGE)
+        failed = 1;
+    if(rbfm->updateRecord(fileHandle, recordDescriptor, record, rids[0]) != RBFM_RECORD_TOO_LARGE)
+        failed = 1;
+
+    // Updates change the VarChars' lengths; records stay in their rows
+    for(int v = 1; v <= 3; v++)
+    {
+        for(int i = v; i < numRecords; i += 3)
+        {
+            versions[i] = v;
+            prepareVersion(i, v, recordDescriptor, record, &recordSize);
+            rc = rbfm->updateRecord(fileHandle, recordDescriptor, record, rids[i]);
+            assert(rc == success && "Updating a record should not fail.");
+        }
+    }
+    checkRecords(rbfm, fileHandle, recordDescriptor, rids, versions, prepareVersion, failed);
+
+    for(int i = 0; i < numRecords; i++)
+    {
+        if(!isDeleted(i))
+            continue;
+        rc = rbfm->deleteRecord(fileHandle, recordDescriptor, rids[i]);
+        assert(rc == success && "Deleting a record should not fail.");
+        versions[i] = deleted;
+    }
+    if(rbfm->deleteRecord(fileHandle, recordDescriptor, rids[3]) != RBFM_SLOT_DN_EXIST)
+        failed = 1;
+    checkRecords(rbfm, fileHandle, recordDescriptor, rids, versions, prepareVersion, failed);
+
+    // Single attributes
+    char returnedData[100];
+    for(int i = 0; i < numRecords; i += 97)
+    {
+        if(versions[i] < 0)
+            continue;
+        rc = rbfm->readAttribute(fileHandle, recordDescriptor, rids[i], "Age", returnedData);
+        int age;
+        memcpy(&age, returnedData + 1, INT_SIZE);
+        if(rc != success || ((returnedData[0] & (1 << 7)) != 0) != ageIsNull(i)
+           || (!ageIsNull(i) && age != ageOf(i, versions[i])))
+            failed = 1;
+        rc = rbfm->readAttribute(fileHandle, recordDescriptor, rids[i], "EmpName", returnedData);
+        uint32_t length;
+        memcpy(&length, returnedData + 1, VARCHAR_LENGTH_SIZE);
+        if(rc != success || ((returnedData[0] & (1 << 7)) != 0) != nameIsNull(i)
+           || (!nameIsNull(i) && string(returnedData + 1 + VARCHAR_LENGTH_SIZE, length) != nameOf(i, versions[i])))
+            failed = 1;
+    }
+
+    // Scans evaluate Age on its minipage, in both scan modes
+    vector<string> nameAndSalary;
+    nameAndSalary.push_back("EmpName");
+    nameAndSalary.push_back("Salary");
+    int fifty = 50, ninety = 90, zero = 0;
+    countScan(rbfm, fileHandle, recordDescriptor, "Age", GE_OP, &fifty, nameAndSalary, versions, prepareVersion,
+              [](int i, int v) { return !ageIsNull(i) && ageOf(i, v) >= 50; }, failed);
+    countScan(rbfm, fileHandle, recordDescriptor, "Age", GE_OP, &ninety, nameAndSalary, versions, prepareVersion,
+              [](int i, int v) { return !ageIsNull(i) && ageOf(i, v) >= 90; }, failed, SCAN_MMAP);
+
+    // A predicate tree, read through record views
+    int ten = 10;
+    float hundred = 100.0f;
+    Predicate predicate = Predicate::allOf(Predicate::compare("Age", LT_OP, &ten),
+                                           Predicate::anyOf(Predicate::isNull("EmpName"), Predicate::compare("Height", GT_OP, &hundred)));
+    vector<string> attributeNames;
+    RBFM_ScanIterator rbfmScanIterator;
+    rc = rbfm->scan(fileHandle, recordDescriptor, predicate, attributeNames, rbfmScanIterator);
+    assert(rc == success && "Scanning the file should not fail.");
+    RecordView view;
+    int count = 0;
+    while(rbfmScanIterator.getNextRecordView(rid, view) != RBFM_EOF)
+    {
+        int i = view.getInt(3);
+        if(i < 0 || i >= numRecords || versions[i] < 0 || view.getInt(1) != ageOf(i, versions[i]) || view.getReal(2) != heightOf(i)
+           || view.isNull(0) != nameIsNull(i) || (!nameIsNull(i) && view.getVarChar(0).str() != nameOf(i, versions[i])))
+            failed = 1;
+        count++;
+    }
+    view.release();
+    rbfmScanIterator.close();
+    int expectedCount = 0;
+    for(int i = 0; i < numRecords; i++)
+        if(versions[i] >= 0 && !ageIsNull(i) && ageOf(i, versions[i]) < 10 && (nameIsNull(i) || heightOf(i) > 100.0f))
+            expectedCount++;
+    if(count != expectedCount)
+        failed = 1;
+
+    // New records take the rows the deletes freed
+    unsigned pages = fileHandle.getNumberOfPages();
+    for(int i = 0; i < numRecords; i++)
+    {
+        if(versions[i] >= 0)
+            continue;
+        versions[i] = 4;
+        prepareVersion(i, 4, recordDescriptor, record, &recordSize);
+        rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rids[i]);
+        assert(rc == success && "Inserting a record should not fail.");
+    }
+    if(fileHandle.getNumberOfPages() != pages)
+        failed = 1;
+
+    // The flag outlives the file handle
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+    checkRecords(rbfm, fileHandle, recordDescriptor, rids, versions, prepareVersion, failed);
+
+    // Vacuum closes the heaps' holes, and gives back pages without records
+    PageNum emptied = rids[0].pageNum;
+    for(int i = 0; i < numRecords; i++)
+    {
+        if(rids[i].pageNum != emptied || versions[i] < 0)
+            continue;
+        rc = rbfm->deleteRecord(fileHandle, recordDescriptor, rids[i]);
+        assert(rc == success && "Deleting a record should not fail.");
+        versions[i] = deleted;
+    }
+    VacuumStats stats;
+    rc = rbfm->vacuum(fileHandle, recordDescriptor, stats);
+    assert(rc == success && "Vacuuming the file should not fail.");
+    if(stats.pagesCompacted == 0 || stats.pagesReclaimed != 1 || stats.recordsMovedHome != 0)
+        failed = 1;
+    for(int i = 0; i < numRecords; i++)
+        if(rids[i].pageNum == emptied)
+            versions[i] = reclaimed;
+    checkRecords(rbfm, fileHandle, recordDescriptor, rids, versions, prepareVersion, failed);
+    countScan(rbfm, fileHandle, recordDescriptor, "Age", GE_OP, &zero, nameAndSalary, versions, prepareVersion,
+              [](int i, int v) { return !ageIsNull(i) && ageOf(i, v) >= 0; }, failed);
+
+    // Bulk inserts fill whole pages
+    vector<string> rows(numRecords);
+    vector<const void *> rowPointers(numRecords);
+    for(int i = 0; i < numRecords; i++)
+    {
+        prepareVersion(i, 5, recordDescriptor, record, &recordSize);
+        rows[i] = string(record, recordSize);
+        rowPointers[i] = rows[i].data();
+    }
+    vector<RID> bulkRids;
+    rc = rbfm->insertRecords(fileHandle, recordDescriptor, rowPointers.data(), numRecords, bulkRids);
+    assert(rc == success && "Inserting records should not fail.");
+    for(int i = 0; i < numRecords; i++)
+    {
+        rc = rbfm->readRecord(fileHandle, recordDescriptor, bulkRids[i], returnedData);
+        if(rc != success || rows[i] != string(returnedData, rows[i].size()))
+            failed = 1;
+    }
+
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+
+    rc = rbfm->destroyFile(fileName);
+    assert(rc == success && "Destroying the file should not fail.");
+
+    if(failed)
+    {
+        cout << "[FAIL] Test Case 28 Failed!" << endl << endl;
+        return -1;
+    }
+
+    cout << "RBF Test Case 28 Finished! The result will be examined." << endl << endl;
+
+    return 0;
+}
+
+int main()
+{
+    // To test files with PAX pages
+    RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
+
+    remove("test28");
+
+    RC rcmain = RBFTest_28(rbfm);
+    return rcmain;
+}
@@ -0,0 +1,350 @@
+#include <iostream>
+#include <string>
+#include <cassert>
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdexcept>
+#include <stdio.h>
+
+#include "pfm.h"
+#include "rbfm.h"
+#include "test_util.h"
+
+using namespace std;
+
+// As many pages at every PAGE_SIZE; the updates stay as many, as each re-encodes a whole page
+const int pageScale = PAGE_SIZE / 4096;
+const int numRecords = 4000 * pageScale;
+const int bulkRecords = 3600 * pageScale;   // The rest are inserted one at a time, onto PAX pages
+const int updateStride = 5 * pageScale;
+// A compressed page holds no more rows than decode into a PAX page's 16-bit offsets, which caps
+// what it saves with 64 KB pages
+const unsigned compressionRatio = PAGE_SIZE < 65536 ? 4 : 2;
+
+// Record i at version v: Salary i; EmpName, Age and Height repeat a lot so pages compress.
+// Version 2 gives EmpName a value of its own, which pushes records off their pages.
+const char *names[] = { "alice", "bob", "carol", "dave", "eve" };
+string nameOf(int i, int v)
+{
+    if(v != 2)
+        return names[(i + v) % 5];
+    char name[31];
+    snprintf(name, sizeof(name), "%d%s", i, string(30, 'z').c_str());
+    return string(name, 30);
+}
+int ageOf(int i, int v) { return 20 + (i / 50) % 40 + v; }
+float heightOf(int i) { return (i % 8) / 2.0f; }
+
+void prepareVersion(int i, int v, const vector<Attribute> &recordDescriptor, void *record, int *recordSize)
+{
+    unsigned char nullsIndicator = 0;
+    if(nameIsNull(i))
+        nullsIndicator |= 1 << 7;
+    if(heightIsNull(i))
+        nullsIndicator |= 1 << 5;
+    string name = nameOf(i, v);
+    prepareRecord(recordDescriptor.size(), &nullsIndicator, name.size(), name, ageOf(i, v), heightOf(i), i, record, recordSize);
+}
+
+// The conditions the scans are checked with, as the records should meet them
+bool nameIsCarol(int i, int v) { return !nameIsNull(i) && nameOf(i, v) == "carol"; }
+bool nameIsNotCarol(int i, int v) { return !nameIsNull(i) && nameOf(i, v) != "carol"; }
+bool nameAfterBz(int i, int v) { return !nameIsNull(i) && nameOf(i, v) > "bz"; }
+bool nameUpToCarol(int i, int v) { return !nameIsNull(i) && nameOf(i, v) <= "carol"; }
+bool ageAtLeast40(int i, int v) { return ageOf(i, v) >= 40; }
+bool ageBelow23(int i, int v) { return ageOf(i, v) < 23; }
+bool heightAbove2(int i, int v) { (void) v; return !heightIsNull(i) && heightOf(i) > 2.0f; }
+
+// Scans with a condition on each type for EmpName and Salary
+void checkScans(RecordBasedFileManager *rbfm, FileHandle &fileHandle, const vector<Attribute> &recordDescriptor,
+                const vector<int> &versions, ScanMode scanMode, int &failed)
+{
+    char carol[10], bz[10];
+    int length = 5;
+    memcpy(carol, &length, VARCHAR_LENGTH_SIZE);
+    memcpy(carol + VARCHAR_LENGTH_SIZE, "carol", length);
+    length = 2;
+    memcpy(bz, &length, VARCHAR_LENGTH_SIZE);
+    memcpy(bz + VARCHAR_LENGTH_SIZE, "bz", length);
+    int forty = 40, twentyThree = 23;
+    float two = 2.0f;
+    vector<string> attributeNames;
+    attributeNames.push_back("EmpName");
+    attributeNames.push_back("Salary");
+    countScan(rbfm, fileHandle, recordDescriptor, "EmpName", EQ_OP, carol, attributeNames, versions, prepareVersion, nameIsCarol, failed, scanMode);
+    countScan(rbfm, fileHandle, recordDescriptor, "EmpName", NE_OP, carol, attributeNames, versions, prepareVersion, nameIsNotCarol, failed, scanMode);
+    countScan(rbfm, fileHandle, recordDescriptor, "EmpName", GT_OP, bz, attributeNames, versions, prepareVersion, nameAfterBz, failed, scanMode);
+    countScan(rbfm, fileHandle, recordDescriptor, "EmpName", LE_OP, carol, attributeNames, versions, prepareVersion, nameUpToCarol, failed, scanMode);
+    countScan(rbfm, fileHandle, recordDescriptor, "Age", GE_OP, &forty, attributeNames, versions, prepareVersion, ageAtLeast40, failed, scanMode);
+    countScan(rbfm, fileHandle, recordDescriptor, "Age", LT_OP, &twentyThree, attributeNames, versions, prepareVersion, ageBelow23, failed, scanMode);
+    countScan(rbfm, fileHandle, recordDescriptor, "Height", GT_OP, &two, attributeNames, versions, prepareVersion, heightAbove2, failed, scanMode);
+}
+
+int RBFTest_29(RecordBasedFileManager *rbfm)
+{
+    // Functions Tested:
+    // 1. Create a compressed Record-Based File **
+    // 2. Insert Records in bulk and one at a time, Read Records and Attributes
+    // 3. Scan with conditions on each type, a predicate and record views
+    // 4. Update Records in place and off their pages, Delete Records
+    // 5. Vacuum, Close, Reopen, Destroy Record-Based File
+    cout << endl << "***** In RBF Test Case 29 *****" << endl;
+
+    RC rc;
+    string fileName = "test29";
+    string paxFileName = "test29pax";
+    int failed = 0;
+
+    rc = rbfm->createFile(fileName, PFM_CHECKSUMS | RBFM_COMPRESSED);
+    assert(rc == success && "Creating the file should not fail.");
+    rc = rbfm->createFile(paxFileName, RBFM_PAX);
+    assert(rc == success && "Creating the file should not fail.");
+
+    FileHandle fileHandle, paxFileHandle;
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+    rc = rbfm->openFile(paxFileName, paxFileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+
+    vector<Attribute> recordDescriptor;
+    createRecordDescriptor(recordDescriptor);
+
+    // Bulk inserts encode whole pages, taking a fraction of the pages PAX does
+    char record[100];
+    int recordSize = 0;
+    vector<string> rows(bulkRecords);
+    vector<const void *> rowPointers(bulkRecords);
+    for(int i = 0; i < bulkRecords; i++)
+    {
+        prepareVersion(i, 0, recordDescriptor, record, &recordSize);
+        rows[i] = string(record, recordSize);
+        rowPointers[i] = rows[i].data();
+    }
+    vector<RID> rids(numRecords), paxRids;
+    vector<int> versions(numRecords, notInserted);
+    rc = rbfm->insertRecords(fileHandle, recordDescriptor, rowPointers.data(), bulkRecords, rids);
+    assert(rc == success && "Inserting records should not fail.");
+    rc = rbfm->insertRecords(paxFileHandle, recordDescriptor, rowPointers.data(), bulkRecords, paxRids);
+    assert(rc == success && "Inserting records should not fail.");
+    if(fileHandle.getNumberOfPages() * compressionRatio > paxFileHandle.getNumberOfPages())
+        failed = 1;
+    for(int i = 0; i < bulkRecords; i++)
+        versions[i] = 0;
+    checkRecords(rbfm, fileHandle, recordDescriptor, rids, versions, prepareVersion, failed);
+    checkScans(rbfm, fileHandle, recordDescriptor, versions, SCAN_BUFFERED, failed);
+
+    // Single attributes
+    char returnedData[100];
+    for(int i = 0; i < bulkRecords; i += 97)
+    {
+        rc = rbfm->readAttribute(fileHandle, recordDescriptor, rids[i], "EmpName", returnedData);
+        uint32_t length;
+        memcpy(&length, returnedData + 1, VARCHAR_LENGTH_SIZE);
+        if(rc != success || ((returnedData[0] & (1 << 7)) != 0) != nameIsNull(i)
+           || (!nameIsNull(i) && string(returnedData + 1 + VARCHAR_LENGTH_SIZE, length) != nameOf(i, versions[i])))
+            failed = 1;
+        rc = rbfm->readAttribute(fileHandle, recordDescriptor, rids[i], "Height", returnedData);
+        float height;
+        memcpy(&height, returnedData + 1, REAL_SIZE);
+        if(rc != success || ((returnedData[0] & (1 << 7)) != 0) != heightIsNull(i)
+           || (!heightIsNull(i) && height != heightOf(i)))
+            failed = 1;
+    }
+
+    // Records inserted one at a time go to PAX pages
+    for(int i = bulkRecords; i < numRecords; i++)
+    {
+        versions[i] = 0;
+        prepareVersion(i, 0, recordDescriptor, record, &recordSize);
+        rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rids[i]);
+        assert(rc == success && "Inserting a record should not fail.");
+    }
+
+    // Updates within the dictionaries stay on their pages, names of their own move records to
+    // overflow pages; either way their RIDs stay good
+    unsigned pages = fileHandle.getNumberOfPages();
+    for(int v = 1; v <= 3; v++)
+    {
+        for(int i = v; i < numRecords; i += updateStride)
+        {
+            versions[i] = v;
+            prepareVersion(i, v, recordDescriptor, record, &recordSize);
+            rc = rbfm->updateRecord(fileHandle, recordDescriptor, record, rids[i]);
+            assert(rc == success && "Updating a record should not fail.");
+        }
+    }
+    if(fileHandle.getNumberOfPages() == pages)
+        failed = 1;
+    checkRecords(rbfm, fileHandle, recordDescriptor, rids, versions, prepareVersion, failed);
+    checkScans(rbfm, fileHandle, recordDescriptor, versions, SCAN_MMAP, failed);
+
+    for(int i = 0; i < numRecords; i++)
+    {
+        if(!isDeleted(i))
+            continue;
+        rc = rbfm->deleteRecord(fileHandle, recordDescriptor, rids[i]);
+        assert(rc == success && "Deleting a record should not fail.");
+        versions[i] = deleted;
+    }
+    if(rbfm->deleteRecord(fileHandle, recordDescriptor, rids[3]) != RBFM_SLOT_DN_EXIST)
+        failed = 1;
+    checkRecords(rbfm, fileHandle, recordDescriptor, rids, versions, prepareVersion, failed);
+    checkScans(rbfm, fileHandle, recordDescriptor, versions, SCAN_BUFFERED, failed);
+
+    // A predicate tree, read through record views
+    int thirty = 30;
+    float one = 1.0f;
+    Predicate predicate = Predicate::allOf(Predicate::compare("Age", LT_OP, &thirty),
+                                           Predicate::anyOf(Predicate::isNull("EmpName"), Predicate::compare("Height", LE_OP, &one)));
+    vector<string> attributeNames;
+    RBFM_ScanIterator rbfmScanIterator;
+    rc = rbfm->scan(fileHandle, recordDescriptor, predicate, attributeNames, rbfmScanIterator);
+    assert(rc == success && "Scanning the file should not fail.");
+    RecordView view;
+    RID rid;
+    int count = 0;
+    while(rbfmScanIterator.getNextRecordView(rid, view) != RBFM_EOF)
+    {
+        int i = view.getInt(3);
+        if(i < 0 || i >= numRecords || versions[i] < 0 || view.getInt(1) != ageOf(i, versions[i])
+           || view.isNull(2) != heightIsNull(i) || (!heightIsNull(i) && view.getReal(2) != heightOf(i))
+           || view.isNull(0) != nameIsNull(i) || (!nameIsNull(i) && view.getVarChar(0).str() != nameOf(i, versions[i])))
+            failed = 1;
+        count++;
+    }
+    view.release();
+    rbfmScanIterator.close();
+    int expectedCount = 0;
+    for(int i = 0; i < numRecords; i++)
+        if(versions[i] >= 0 && ageOf(i, versions[i]) < 30 && (nameIsNull(i) || (!heightIsNull(i) && heightOf(i) <= 1.0f)))
+            expectedCount++;
+    if(count != expectedCount)
+        failed = 1;
+
+    // Vacuum encodes the full PAX pages and gives back the pages left without records
+    PageNum emptied = rids[0].pageNum;
+    for(int i = 0; i < numRecords; i++)
+    {
+        if(rids[i].pageNum != emptied || versions[i] < 0)
+            continue;
+        rc = rbfm->deleteRecord(fileHandle, recordDescriptor, rids[i]);
+        assert(rc == success && "Deleting a record should not fail.");
+        versions[i] = deleted;
+    }
+    VacuumStats stats;
+    rc = rbfm->vacuum(fileHandle, recordDescriptor, stats);
+    assert(rc == success && "Vacuuming the file should not fail.");
+    if(stats.pagesCompressed == 0 || stats.pagesCompacted == 0 || stats.pagesReclaimed == 0 || stats.recordsMovedHome != 0)
+        failed = 1;
+    for(int i = 0; i < numRecords; i++)
+    {
+        if(rids[i].pageNum == emptied)
+            versions[i] = reclaimed;
+        else if(versions[i] == deleted)
+            versions[i] = vacuumed;
+    }
+    checkRecords(rbfm, fileHandle, recordDescriptor, rids, versions, prepareVersion, failed);
+    checkScans(rbfm, fileHandle, recordDescriptor, versions, SCAN_MMAP, failed);
+
+    // Compressed pages take updates after vacuum too
+    for(int i = 0; i < numRecords; i += 11)
+    {
+        if(versions[i] < 0)
+            continue;
+        versions[i] = 2;
+        prepareVersion(i, 2, recordDescriptor, record, &recordSize);
+        rc = rbfm->updateRecord(fileHandle, recordDescriptor, record, rids[i]);
+        assert(rc == success && "Updating a record should not fail.");
+    }
+
+    // The flag outlives the file handle
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+    checkRecords(rbfm, fileHandle, recordDescriptor, rids, versions, prepareVersion, failed);
+    checkScans(rbfm, fileHandle, recordDescriptor, versions, SCAN_BUFFERED, failed);
+
+    // A page where EmpName is null in every row has an empty dictionary
+    string nullsFileName = "test29nulls";
+    const int nullRecords = 500;
+    rc = rbfm->createFile(nullsFileName, RBFM_COMPRESSED);
+    assert(rc == success && "Creating the file should not fail.");
+    FileHandle nullsFileHandle;
+    rc = rbfm->openFile(nullsFileName, nullsFileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+    unsigned char nullsIndicator = 1 << 7;
+    for(int i = 0; i < nullRecords; i++)
+    {
+        prepareRecord(recordDescriptor.size(), &nullsIndicator, 0, "", ageOf(i, 0), heightOf(i), i, record, &recordSize);
+        rows[i] = string(record, recordSize);
+        rowPointers[i] = rows[i].data();
+    }
+    vector<RID> nullRids;
+    rc = rbfm->insertRecords(nullsFileHandle, recordDescriptor, rowPointers.data(), nullRecords, nullRids);
+    assert(rc == success && "Inserting records should not fail.");
+    attributeNames.push_back("EmpName");
+    attributeNames.push_back("Salary");
+    RBFM_ScanIterator nullsScanIterator;
+    rc = rbfm->scan(nullsFileHandle, recordDescriptor, "", NO_OP, NULL, attributeNames, nullsScanIterator);
+    assert(rc == success && "Scanning the file should not fail.");
+    count = 0;
+    while(nullsScanIterator.getNextRecord(rid, returnedData) != RBFM_EOF)
+    {
+        int i;
+        memcpy(&i, returnedData + 1, INT_SIZE);
+        if(!(returnedData[0] & (1 << 7)) || i != count)
+            failed = 1;
+        count++;
+    }
+    nullsScanIterator.close();
+    if(count != nullRecords)
+        failed = 1;
+    // Updating a row decodes the page's rows
+    prepareRecord(recordDescriptor.size(), &nullsIndicator, 0, "", ageOf(0, 1), heightOf(0), 0, record, &recordSize);
+    rc = rbfm->updateRecord(nullsFileHandle, recordDescriptor, record, nullRids[0]);
+    assert(rc == success && "Updating a record should not fail.");
+    rc = rbfm->readRecord(nullsFileHandle, recordDescriptor, nullRids[nullRecords - 1], returnedData);
+    prepareRecord(recordDescriptor.size(), &nullsIndicator, 0, "", ageOf(nullRecords - 1, 0), heightOf(nullRecords - 1),
+                  nullRecords - 1, record, &recordSize);
+    if(rc != success || memcmp(record, returnedData, recordSize) != 0)
+        failed = 1;
+    rc = rbfm->closeFile(nullsFileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+    rc = rbfm->destroyFile(nullsFileName);
+    assert(rc == success && "Destroying the file should not fail.");
+
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+    rc = rbfm->closeFile(paxFileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+
+    rc = rbfm->destroyFile(fileName);
+    assert(rc == success && "Destroying the file should not fail.");
+    rc = rbfm->destroyFile(paxFileName);
+    assert(rc == success && "Destroying the file should not fail.");
+
+    if(failed)
+    {
+        cout << "[FAIL] Test Case 29 Failed!" << endl << endl;
+        return -1;
+    }
+
+    cout << "RBF Test Case 29 Finished! The result will be examined." << endl << endl;
+
+    return 0;
+}
+
+int main()
+{
+    // To test files with compressed pages
+    RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
+
+    remove("test29");
+    remove("test29pax");
+    remove("test29nulls");
+
+    RC rcmain = RBFTest_29(rbfm);
+    return rcmain;
+}
@@ -0,0 +1,286 @@
+#include <iostream>
+#include <string>
+#include <cassert>
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdexcept>
+#include <stdio.h>
+
+#include "pfm.h"
+#include "bpm.h"
+#include "rbfm.h"
+#include "test_util.h"
+
+using namespace std;
+
+// As many pages at every PAGE_SIZE, and the same salaries spread over them; the updates stay
+// as many, as those of compressed pages re-encode a whole page
+const int pageScale = PAGE_SIZE / 4096;
+const int numRecords = 3000 * pageScale;
+const int bulkRecords = 2000 * pageScale;   // The rest are inserted one at a time, after the zone maps exist
+const int updateStride = 37 * pageScale;
+const unsigned numFrames = 16;  // Few enough that a scan of the whole file reads most of it
+
+// Record i at version v: Salary grows with i, so the pages of a range of them are few, while Age
+// is all over the file. Heights are null for runs of records. Version 1 gives a record a
+// Salary past every other and a name long enough to move it off its page.
+const char *names[] = { "alice", "bob", "carol", "dave", "eve" };
+bool inNullHeightRun(int i) { return (i / (300 * pageScale)) % 5 == 2; }
+string nameOf(int i, int v)
+{
+    if(v != 1)
+        return names[i % 5];
+    char name[31];
+    snprintf(name, sizeof(name), "%d%s", i, string(30, 'z').c_str());
+    return string(name, 30);
+}
+int ageOf(int i) { return 20 + i % 40; }
+float heightOf(int i) { return (i % 8) / 2.0f; }
+int salaryOf(int i, int v) { return v == 1 ? 100000 + i : i / pageScale; }
+
+void prepareVersion(int i, int v, const vector<Attribute> &recordDescriptor, void *record, int *recordSize)
+{
+    unsigned char nullsIndicator = 0;
+    if(inNullHeightRun(i))
+        nullsIndicator |= 1 << 5;
+    string name = nameOf(i, v);
+    prepareRecord(recordDescriptor.size(), &nullsIndicator, name.size(), name, ageOf(i), heightOf(i), salaryOf(i, v), record, recordSize);
+}
+
+// The conditions the scans are checked with, as the records should meet them
+bool salaryBelow100(int i, int v) { return salaryOf(i, v) < 100; }
+bool salaryIs1500(int i, int v) { return salaryOf(i, v) == 1500; }
+bool salaryAtLeast2900(int i, int v) { return salaryOf(i, v) >= 2900; }
+bool salaryNot1500(int i, int v) { return salaryOf(i, v) != 1500; }
+bool salaryMoved(int i, int v) { return salaryOf(i, v) >= 100000; }
+bool ageIs33(int i, int v) { (void) v; return ageOf(i) == 33; }
+bool heightNull(int i, int v) { (void) v; return inNullHeightRun(i); }
+bool heightAbove3(int i, int v) { (void) v; return !inNullHeightRun(i) && heightOf(i) > 3.0f; }
+bool lowOrHigh(int i, int v) { return salaryOf(i, v) <= 50 || (salaryOf(i, v) > 2950 && salaryOf(i, v) < 100000); }
+bool lowAndNull(int i, int v) { return salaryOf(i, v) < 1000 && inNullHeightRun(i); }
+bool notLow(int i, int v) { return !(salaryOf(i, v) < 2900); }
+
+// Scans for Salary the records meeting predicate, checking them against wanted; reads is what the
+// scan read from the file
+void checkScan(RecordBasedFileManager *rbfm, FileHandle &fileHandle, const vector<Attribute> &recordDescriptor,
+               const vector<int> &versions, const Predicate &predicate, Wanted wanted,
+               ScanMode scanMode, unsigned &reads, int &failed)
+{
+    vector<string> attributeNames;
+    attributeNames.push_back("Salary");
+    RBFM_ScanIterator rbfmScanIterator;
+    RC rc = rbfm->scan(fileHandle, recordDescriptor, predicate, attributeNames, rbfmScanIterator, scanMode);
+    assert(rc == success && "Scanning the file should not fail.");
+    countScanned(rbfmScanIterator, recordDescriptor, attributeNames, versions, prepareVersion, wanted, failed);
+    unsigned writes, appends;
+    rbfmScanIterator.collectCounterValues(reads, writes, appends);
+    rbfmScanIterator.close();
+}
+
+void checkScans(RecordBasedFileManager *rbfm, FileHandle &fileHandle, const vector<Attribute> &recordDescriptor,
+                const vector<int> &versions, ScanMode scanMode, int &failed)
+{
+    int hundred = 100, fifteenHundred = 1500, twentyNineHundred = 2900, fifty = 50, twentyNineFifty = 2950;
+    int thousand = 1000, movedSalaries = 100000, thirtyThree = 33;
+    float three = 3.0f;
+    unsigned reads;
+    checkScan(rbfm, fileHandle, recordDescriptor, versions, Predicate::compare("Salary", LT_OP, &hundred), salaryBelow100, scanMode, reads, failed);
+    checkScan(rbfm, fileHandle, recordDescriptor, versions, Predicate::compare("Salary", EQ_OP, &fifteenHundred), salaryIs1500, scanMode, reads, failed);
+    checkScan(rbfm, fileHandle, recordDescriptor, versions, Predicate::compare("Salary", GE_OP, &twentyNineHundred), salaryAtLeast2900, scanMode, reads, failed);
+    checkScan(rbfm, fileHandle, recordDescriptor, versions, Predicate::compare("Salary", NE_OP, &fifteenHundred), salaryNot1500, scanMode, reads, failed);
+    checkScan(rbfm, fileHandle, recordDescriptor, versions, Predicate::compare("Salary", GE_OP, &movedSalaries), salaryMoved, scanMode, reads, failed);
+    checkScan(rbfm, fileHandle, recordDescriptor, versions, Predicate::compare("Age", EQ_OP, &thirtyThree), ageIs33, scanMode, reads, failed);
+    checkScan(rbfm, fileHandle, recordDescriptor, versions, Predicate::isNull("Height"), heightNull, scanMode, reads, failed);
+    checkScan(rbfm, fileHandle, recordDescriptor, versions, Predicate::compare("Height", GT_OP, &three), heightAbove3, scanMode, reads, failed);
+    checkScan(rbfm, fileHandle, recordDescriptor, versions,
+              Predicate::anyOf(Predicate::compare("Salary", LE_OP, &fifty),
+                               Predicate::allOf(Predicate::compare("Salary", GT_OP, &twentyNineFifty),
+                                                Predicate::compare("Salary", LT_OP, &movedSalaries))),
+              lowOrHigh, scanMode, reads, failed);
+    checkScan(rbfm, fileHandle, recordDescriptor, versions,
+              Predicate::allOf(Predicate::compare("Salary", LT_OP, &thousand), Predicate::isNull("Height")),
+              lowAndNull, scanMode, reads, failed);
+    checkScan(rbfm, fileHandle, recordDescriptor, versions, Predicate::negate(Predicate::compare("Salary", LT_OP, &twentyNineHundred)),
+              notLow, scanMode, reads, failed);
+}
+
+// Pages read by a scan the zone maps cannot help, then by one they rule out most pages for
+void checkPruning(RecordBasedFileManager *rbfm, FileHandle &fileHandle, const vector<Attribute> &recordDescriptor,
+                  const vector<int> &versions, int &failed)
+{
+    int thirtyThree = 33, hundred = 100;
+    unsigned fullReads, prunedReads;
+    checkScan(rbfm, fileHandle, recordDescriptor, versions, Predicate::compare("Age", EQ_OP, &thirtyThree), ageIs33, SCAN_BUFFERED, fullReads, failed);
+    checkScan(rbfm, fileHandle, recordDescriptor, versions, Predicate::compare("Salary", LT_OP, &hundred), salaryBelow100, SCAN_BUFFERED, prunedReads, failed);
+    if(fullReads < 8 || prunedReads * 4 > fullReads)
+        failed = 1;
+}
+
+void testFile(RecordBasedFileManager *rbfm, const string &fileName, unsigned flags, int &failed)
+{
+    RC rc = rbfm->createFile(fileName, flags);
+    assert(rc == success && "Creating the file should not fail.");
+    FileHandle fileHandle;
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+
+    vector<Attribute> recordDescriptor;
+    createRecordDescriptor(recordDescriptor);
+
+    // Zone maps built from the records already there
+    char record[100];
+    int recordSize = 0;
+    vector<string> rows(bulkRecords);
+    vector<const void *> rowPointers(bulkRecords);
+    for(int i = 0; i < bulkRecords; i++)
+    {
+        prepareVersion(i, 0, recordDescriptor, record, &recordSize);
+        rows[i] = string(record, recordSize);
+        rowPointers[i] = rows[i].data();
+    }
+    vector<RID> rids(numRecords);
+    vector<int> versions(numRecords, notInserted);
+    rc = rbfm->insertRecords(fileHandle, recordDescriptor, rowPointers.data(), bulkRecords, rids);
+    assert(rc == success && "Inserting records should not fail.");
+    for(int i = 0; i < bulkRecords; i++)
+        versions[i] = 0;
+    rc = rbfm->createZoneMap(fileHandle, recordDescriptor, "Salary");
+    assert(rc == success && "Creating a zone map should not fail.");
+    rc = rbfm->createZoneMap(fileHandle, recordDescriptor, "Height");
+    assert(rc == success && "Creating a zone map should not fail.");
+    if(rbfm->createZoneMap(fileHandle, recordDescriptor, "EmpName") != RBFM_CANNOT_ZONE
+       || rbfm->createZoneMap(fileHandle, recordDescriptor, "Weight") != RBFM_NO_SUCH_ATTR
+       || rbfm->createZoneMap(fileHandle, recordDescriptor, "Salary") != success)
+        failed = 1;
+    checkScans(rbfm, fileHandle, recordDescriptor, versions, SCAN_BUFFERED, failed);
+
+    // Inserts widen the zones of their pages
+    for(int i = bulkRecords; i < numRecords; i++)
+    {
+        versions[i] = 0;
+        prepareVersion(i, 0, recordDescriptor, record, &recordSize);
+        rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rids[i]);
+        assert(rc == success && "Inserting a record should not fail.");
+    }
+    checkRecords(rbfm, fileHandle, recordDescriptor, rids, versions, prepareVersion, failed);
+    checkScans(rbfm, fileHandle, recordDescriptor, versions, SCAN_MMAP, failed);
+    checkPruning(rbfm, fileHandle, recordDescriptor, versions, failed);
+
+    // So do updates, wherever the records end up
+    for(int i = 0; i < numRecords; i += updateStride)
+    {
+        versions[i] = 1;
+        prepareVersion(i, 1, recordDescriptor, record, &recordSize);
+        rc = rbfm->updateRecord(fileHandle, recordDescriptor, record, rids[i]);
+        assert(rc == success && "Updating a record should not fail.");
+    }
+    checkRecords(rbfm, fileHandle, recordDescriptor, rids, versions, prepareVersion, failed);
+    checkScans(rbfm, fileHandle, recordDescriptor, versions, SCAN_BUFFERED, failed);
+
+    // Deleted records keep their pages in until vacuum tightens the zones
+    for(int i = 0; i < numRecords; i++)
+    {
+        if(!isDeleted(i) && !(salaryOf(i, 0) >= 1400 && salaryOf(i, 0) < 1600))
+            continue;
+        rc = rbfm->deleteRecord(fileHandle, recordDescriptor, rids[i]);
+        assert(rc == success && "Deleting a record should not fail.");
+        versions[i] = deleted;
+    }
+    checkScans(rbfm, fileHandle, recordDescriptor, versions, SCAN_MMAP, failed);
+    VacuumStats stats;
+    rc = rbfm->vacuum(fileHandle, recordDescriptor, stats);
+    assert(rc == success && "Vacuuming the file should not fail.");
+    for(int i = 0; i < numRecords; i++)
+        if(versions[i] == deleted)
+            versions[i] = vacuumed;
+    checkRecords(rbfm, fileHandle, recordDescriptor, rids, versions, prepareVersion, failed);
+    checkScans(rbfm, fileHandle, recordDescriptor, versions, SCAN_BUFFERED, failed);
+
+    // The zone maps outlive the file handle
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+    rc = rbfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+    checkScans(rbfm, fileHandle, recordDescriptor, versions, SCAN_MMAP, failed);
+    checkPruning(rbfm, fileHandle, recordDescriptor, versions, failed);
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+
+    // Opened around the record-based file manager, the file cannot keep its zone maps up
+    rc = PagedFileManager::instance()->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+    RID rid;
+    if(rbfm->insertRecord(fileHandle, recordDescriptor, record, rid) != RBFM_NO_ZONE_MAPS)
+        failed = 1;
+    rc = PagedFileManager::instance()->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+
+    // Destroying the file destroys its zone maps
+    rc = rbfm->destroyFile(fileName);
+    assert(rc == success && "Destroying the file should not fail.");
+    struct stat sb;
+    if(stat((fileName + RBFM_ZONE_SUFFIX).c_str(), &sb) == 0)
+        failed = 1;
+}
+
+int RBFTest_30(RecordBasedFileManager *rbfm)
+{
+    // Functions Tested:
+    // 1. Create Record-Based Files with zone maps, of row, PAX and compressed pages **
+    // 2. Create Zone Maps, Insert Records in bulk and one at a time
+    // 3. Scan with conditions and predicate trees, reading only the pages that may match
+    // 4. Update Records, Delete Records, Vacuum
+    // 5. Close, Reopen, Destroy Record-Based Files
+    cout << endl << "***** In RBF Test Case 30 *****" << endl;
+
+    RC rc = BufferPoolManager::instance()->configure(numFrames, CLOCK_REPLACEMENT);
+    assert(rc == success && "Configuring the buffer pool should not fail.");
+    int failed = 0;
+
+    testFile(rbfm, "test30", PFM_CHECKSUMS | RBFM_ZONE_MAPS, failed);
+    testFile(rbfm, "test30pax", RBFM_PAX | RBFM_ZONE_MAPS, failed);
+    testFile(rbfm, "test30compressed", PFM_CHECKSUMS | RBFM_COMPRESSED | RBFM_ZONE_MAPS, failed);
+
+    // Only files created with zone maps have them
+    rc = rbfm->createFile("test30plain");
+    assert(rc == success && "Creating the file should not fail.");
+    FileHandle fileHandle;
+    rc = rbfm->openFile("test30plain", fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+    vector<Attribute> recordDescriptor;
+    createRecordDescriptor(recordDescriptor);
+    if(rbfm->createZoneMap(fileHandle, recordDescriptor, "Salary") != RBFM_NO_ZONE_MAPS)
+        failed = 1;
+    rc = rbfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+    rc = rbfm->destroyFile("test30plain");
+    assert(rc == success && "Destroying the file should not fail.");
+
+    if(failed)
+    {
+        cout << "[FAIL] Test Case 30 Failed!" << endl << endl;
+        return -1;
+    }
+
+    cout << "RBF Test Case 30 Finished! The result will be examined." << endl << endl;
+
+    return 0;
+}
+
+int main()
+{
+    // To test files with zone maps
+    RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
+
+    remove("test30");
+    remove("test30.zones");
+    remove("test30pax");
+    remove("test30pax.zones");
+    remove("test30compressed");
+    remove("test30compressed.zones");
+    remove("test30plain");
+
+    RC rcmain = RBFTest_30(rbfm);
+    return rcmain;
+}
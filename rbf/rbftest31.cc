@@ -0,0 +1,112 @@
+#include <iostream>
+#include <string>
+#include <cassert>
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdexcept>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "pfm.h"
+#include "rbfm.h"
+#include "test_util.h"
+
+using namespace std;
+
+const unsigned numPages = 8;
+const unsigned groupMillis = 20;
+
+// Dirties the first pages through the buffer pool, fewer than a group holds
+void dirtyPages(FileHandle &fileHandle, unsigned count, char fill)
+{
+    for(PageNum pageNum = 0; pageNum < count; pageNum++)
+    {
+        void *page;
+        RC rc = fileHandle.fetchPage(pageNum, page);
+        assert(rc == success && "Fetching a page should not fail.");
+        memset(page, fill, PAGE_SIZE);
+        rc = fileHandle.unpinPage(pageNum, true);
+        assert(rc == success && "Unpinning a page should not fail.");
+    }
+}
+
+// Waits up to ten time limits for the group committer to write every page back
+bool committed(FileHandle &fileHandle, unsigned count)
+{
+    for(unsigned waited = 0; waited < 10 * groupMillis; waited++)
+    {
+        bool buffered = false;
+        for(PageNum pageNum = 0; pageNum < count; pageNum++)
+            buffered = buffered || fileHandle.isPageBuffered(pageNum);
+        if(!buffered)
+            return true;
+        usleep(1000);
+    }
+    return false;
+}
+
+int RBFTest_31(PagedFileManager *pfm)
+{
+    // Functions Tested:
+    // 1. Set Durability (GROUP)
+    // 2. Fetch Page / Unpin Page
+    // 3. Commit of an idle GROUP file once its time limit passes
+    cout << endl << "***** In RBF Test Case 31 *****" << endl;
+
+    RC rc;
+    string fileName = "test31";
+
+    if(FileExists(fileName))
+        pfm->destroyFile(fileName);
+    rc = pfm->createFile(fileName);
+    assert(rc == success && "Creating the file should not fail.");
+
+    FileHandle fileHandle;
+    rc = pfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+
+    void *data = malloc(PAGE_SIZE);
+    memset(data, 0, PAGE_SIZE);
+    for(unsigned i = 0; i < numPages; i++)
+    {
+        rc = fileHandle.appendPage(data);
+        assert(rc == success && "Appending a page should not fail.");
+    }
+
+    rc = fileHandle.setDurability(DURABILITY_GROUP, 1000, groupMillis);
+    assert(rc == success && "Setting the durability should not fail.");
+
+    // No more writes follow either burst, so only the time limit commits them
+    dirtyPages(fileHandle, numPages, 'a');
+    assert(committed(fileHandle, numPages) && "An idle GROUP file should be committed after its time limit.");
+    dirtyPages(fileHandle, numPages / 2, 'b');
+    assert(committed(fileHandle, numPages / 2) && "A second burst should be committed as well.");
+
+    // The committed pages are what the file holds
+    rc = fileHandle.readPage(0, data);
+    assert(rc == success && "Reading a page should not fail.");
+    assert(((char *) data)[PAGE_SIZE - 1] == 'b' && "The page should hold the second burst.");
+    rc = fileHandle.readPage(numPages - 1, data);
+    assert(rc == success && "Reading a page should not fail.");
+    assert(((char *) data)[0] == 'a' && "The page should hold the first burst.");
+
+    rc = pfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+    rc = pfm->destroyFile(fileName);
+    assert(rc == success && "Destroying the file should not fail.");
+
+    free(data);
+
+    cout << "RBF Test Case 31 Finished! The result will be examined." << endl << endl;
+
+    return 0;
+}
+
+int main()
+{
+    PagedFileManager *pfm = PagedFileManager::instance();
+
+    RC rcmain = RBFTest_31(pfm);
+    return rcmain;
+}
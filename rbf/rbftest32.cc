@@ -0,0 +1,116 @@
+#include <iostream>
+#include <string>
+#include <cassert>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdexcept>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "pfm.h"
+#include "rbfm.h"
+#include "test_util.h"
+
+using namespace std;
+
+// Appends count pages filled with their own number, then dies without closing the file
+void appendAndDie(const string &fileName, unsigned first, unsigned count)
+{
+    PagedFileManager *pfm = PagedFileManager::instance();
+    FileHandle fileHandle;
+    if(pfm->openFile(fileName, fileHandle) != success)
+        _exit(1);
+    void *data = malloc(PAGE_SIZE);
+    for(unsigned i = first; i < first + count; i++)
+    {
+        memset(data, i % 255 + 1, PAGE_SIZE);
+        if(fileHandle.appendPage(data) != success)
+            _exit(1);
+    }
+    _exit(0);
+}
+
+void runChild(const string &fileName, unsigned first, unsigned count)
+{
+    pid_t pid = fork();
+    assert(pid >= 0 && "Forking should not fail.");
+    if(pid == 0)
+        appendAndDie(fileName, first, count);
+    int status;
+    waitpid(pid, &status, 0);
+    assert(WIFEXITED(status) && WEXITSTATUS(status) == 0 && "The child should have appended its pages.");
+}
+
+// Every page holds its own number
+void checkPages(FileHandle &fileHandle, unsigned count)
+{
+    void *data = malloc(PAGE_SIZE);
+    for(unsigned i = 0; i < count; i++)
+    {
+        RC rc = fileHandle.readPage(i, data);
+        assert(rc == success && "Reading a page should not fail.");
+        assert(((unsigned char *) data)[PAGE_SIZE - 1] == i % 255 + 1 && "The page should hold what was appended.");
+    }
+    free(data);
+}
+
+int RBFTest_32(PagedFileManager *pfm)
+{
+    // Functions Tested:
+    // 1. Append Page (IMMEDIATE) by a process that never closes the file
+    // 2. Open File recovering the logical end of file past the header page
+    cout << endl << "***** In RBF Test Case 32 *****" << endl;
+
+    RC rc;
+    string fileName = "test32";
+    unsigned extentPages = pfm->getExtentPages();
+    unsigned firstCount = extentPages / 2;
+    unsigned secondCount = 2 * extentPages + 1;
+
+    if(FileExists(fileName))
+        pfm->destroyFile(fileName);
+    rc = pfm->createFile(fileName);
+    assert(rc == success && "Creating the file should not fail.");
+
+    // Within the first extent, then across two more
+    runChild(fileName, 0, firstCount);
+    FileHandle fileHandle;
+    rc = pfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+    assert(fileHandle.getNumberOfPages() == firstCount && "Every appended page should be recovered.");
+    checkPages(fileHandle, firstCount);
+    rc = pfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+
+    runChild(fileName, firstCount, secondCount);
+    rc = pfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+    assert(fileHandle.getNumberOfPages() == firstCount + secondCount && "Every appended page should be recovered.");
+    checkPages(fileHandle, firstCount + secondCount);
+    rc = pfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+
+    // Closing made the header exact again
+    rc = pfm->openFile(fileName, fileHandle);
+    assert(rc == success && "Opening the file should not fail.");
+    assert(fileHandle.getNumberOfPages() == firstCount + secondCount && "The page count should survive a close.");
+    rc = pfm->closeFile(fileHandle);
+    assert(rc == success && "Closing the file should not fail.");
+
+    rc = pfm->destroyFile(fileName);
+    assert(rc == success && "Destroying the file should not fail.");
+
+    cout << "RBF Test Case 32 Finished! The result will be examined." << endl << endl;
+
+    return 0;
+}
+
+int main()
+{
+    PagedFileManager *pfm = PagedFileManager::instance();
+
+    RC rcmain = RBFTest_32(pfm);
+    return rcmain;
+}
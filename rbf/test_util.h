@@ -7,6 +7,8 @@
 #include <stdexcept>
 #include <stdio.h> 
 #include <math.h>
+#include <map>
+#include <functional>
 
 #include "pfm.h"
 #include "rbfm.h"
@@ -287,3 +289,176 @@ void createLargeRecordDescriptor2(vector<Attribute> &recordDescriptor) {
 	}
 	free(suffix);
 }
+
+// The records of the scan tests, by number: which are deleted and which fields are null
+bool isDeleted(int i) { return i % 7 == 3; }
+bool nameIsNull(int i) { return i % 17 == 3; }
+bool ageIsNull(int i) { return i % 11 == 4; }
+bool heightIsNull(int i) { return i % 13 == 6; }
+
+// Versions of records that are not live
+const int deleted = -1;
+const int reclaimed = -2;       // Vacuum gave back the record's page, and with it the record's row
+const int notInserted = -3;
+const int vacuumed = -4;        // Deleted before a vacuum, which may have dropped the record's row
+
+// Writes record i at version v in the format of insertRecord
+typedef void (*PrepareVersion)(int i, int v, const vector<Attribute> &recordDescriptor, void *record, int *recordSize);
+
+// Whether record i at version v meets the condition of a scan
+typedef function<bool(int i, int v)> Wanted;
+
+// Versions of records that never change: deleted as isDeleted has it, live at version 0 otherwise
+vector<int> liveVersions(int numRecords)
+{
+    vector<int> versions(numRecords, 0);
+    for(int i = 0; i < numRecords; i++)
+        if(isDeleted(i))
+            versions[i] = deleted;
+    return versions;
+}
+
+// Copies the attributes attributeNames of record into tuple, as a scan projecting them returns
+// them; the size of the tuple
+int projectTuple(const vector<Attribute> &recordDescriptor, const void *record, const vector<string> &attributeNames, void *tuple)
+{
+    const char *data = (const char *) record;
+    vector<int> offsets(recordDescriptor.size(), -1);
+    vector<int> sizes(recordDescriptor.size(), 0);
+    int offset = getActualByteForNullsIndicator(recordDescriptor.size());
+    for(unsigned i = 0; i < recordDescriptor.size(); i++)
+    {
+        if(data[i / CHAR_BIT] & (1 << (7 - i % CHAR_BIT)))
+            continue;
+        offsets[i] = offset;
+        sizes[i] = INT_SIZE;
+        if(recordDescriptor[i].type == TypeVarChar)
+        {
+            uint32_t length;
+            memcpy(&length, data + offset, VARCHAR_LENGTH_SIZE);
+            sizes[i] = VARCHAR_LENGTH_SIZE + length;
+        }
+        offset += sizes[i];
+    }
+
+    char *out = (char *) tuple;
+    int size = getActualByteForNullsIndicator(attributeNames.size());
+    memset(out, 0, size);
+    for(unsigned j = 0; j < attributeNames.size(); j++)
+    {
+        unsigned i = 0;
+        while(recordDescriptor[i].name != attributeNames[j])
+            i++;
+        if(offsets[i] < 0)
+        {
+            out[j / CHAR_BIT] |= 1 << (7 - j % CHAR_BIT);
+            continue;
+        }
+        memcpy(out + size, data + offsets[i], sizes[i]);
+        size += sizes[i];
+    }
+    return size;
+}
+
+// Does every record read back as its version has it: live ones as prepareVersion writes them,
+// the others as deleted or gone?
+void checkRecords(RecordBasedFileManager *rbfm, FileHandle &fileHandle, const vector<Attribute> &recordDescriptor,
+                  const vector<RID> &rids, const vector<int> &versions, PrepareVersion prepareVersion, int &failed)
+{
+    char record[PAGE_SIZE], returnedData[PAGE_SIZE];
+    int recordSize = 0;
+    for(unsigned i = 0; i < versions.size(); i++)
+    {
+        if(versions[i] == notInserted)
+            continue;
+        RC rc = rbfm->readRecord(fileHandle, recordDescriptor, rids[i], returnedData);
+        if(versions[i] == vacuumed)
+        {
+            if(rc != RBFM_SLOT_DN_EXIST && rc != RBFM_READ_AFTER_DEL)
+                failed = 1;
+            continue;
+        }
+        if(versions[i] < 0)
+        {
+            if(rc != (versions[i] == reclaimed ? RBFM_SLOT_DN_EXIST : RBFM_READ_AFTER_DEL))
+                failed = 1;
+            continue;
+        }
+        prepareVersion(i, versions[i], recordDescriptor, record, &recordSize);
+        if(rc != success || memcmp(record, returnedData, recordSize) != 0)
+            failed = 1;
+    }
+}
+
+// Checks what an open scan for attributeNames returns: each record live, wanted and projected as
+// its version has it, none twice, and every wanted record returned. attributeNames must tell the
+// records apart. The number of records returned.
+int countScanned(RBFM_ScanIterator &rbfmScanIterator, const vector<Attribute> &recordDescriptor, const vector<string> &attributeNames,
+                 const vector<int> &versions, PrepareVersion prepareVersion, Wanted wanted, int &failed)
+{
+    char record[PAGE_SIZE], tuple[PAGE_SIZE], returnedData[PAGE_SIZE];
+    int recordSize = 0;
+    map<string, int> expected;
+    for(unsigned i = 0; i < versions.size(); i++)
+    {
+        if(versions[i] < 0 || !wanted(i, versions[i]))
+            continue;
+        prepareVersion(i, versions[i], recordDescriptor, record, &recordSize);
+        int tupleSize = projectTuple(recordDescriptor, record, attributeNames, tuple);
+        expected[string(tuple, tupleSize)]++;
+    }
+
+    // The attributes of the tuples, to size those returned with
+    vector<Attribute> tupleDescriptor;
+    for(unsigned j = 0; j < attributeNames.size(); j++)
+        for(unsigned i = 0; i < recordDescriptor.size(); i++)
+            if(recordDescriptor[i].name == attributeNames[j])
+                tupleDescriptor.push_back(recordDescriptor[i]);
+
+    RID rid;
+    int count = 0;
+    while(rbfmScanIterator.getNextRecord(rid, returnedData) != RBFM_EOF)
+    {
+        int tupleSize = projectTuple(tupleDescriptor, returnedData, attributeNames, tuple);
+        map<string, int>::iterator it = expected.find(string(returnedData, tupleSize));
+        if(it == expected.end() || it->second == 0)
+        {
+            failed = 1;
+            break;
+        }
+        it->second--;
+        count++;
+    }
+    for(map<string, int>::const_iterator it = expected.begin(); it != expected.end(); it++)
+        if(it->second != 0)
+            failed = 1;
+    return count;
+}
+
+// Scans with one condition for attributeNames and checks what it returns, as countScanned does
+int countScan(RecordBasedFileManager *rbfm, FileHandle &fileHandle, const vector<Attribute> &recordDescriptor,
+              const string &attribute, CompOp compOp, const void *value, const vector<string> &attributeNames,
+              const vector<int> &versions, PrepareVersion prepareVersion, Wanted wanted, int &failed,
+              ScanMode scanMode = SCAN_BUFFERED)
+{
+    RBFM_ScanIterator rbfmScanIterator;
+    RC rc = rbfm->scan(fileHandle, recordDescriptor, attribute, compOp, value, attributeNames, rbfmScanIterator, scanMode);
+    assert(rc == success && "Scanning the file should not fail.");
+    int count = countScanned(rbfmScanIterator, recordDescriptor, attributeNames, versions, prepareVersion, wanted, failed);
+    rbfmScanIterator.close();
+    return count;
+}
+
+// Scans with predicate for attributeNames and checks what it returns, as countScanned does
+int countScan(RecordBasedFileManager *rbfm, FileHandle &fileHandle, const vector<Attribute> &recordDescriptor,
+              const Predicate &predicate, const vector<string> &attributeNames,
+              const vector<int> &versions, PrepareVersion prepareVersion, Wanted wanted, int &failed,
+              ScanMode scanMode = SCAN_BUFFERED)
+{
+    RBFM_ScanIterator rbfmScanIterator;
+    RC rc = rbfm->scan(fileHandle, recordDescriptor, predicate, attributeNames, rbfmScanIterator, scanMode);
+    assert(rc == success && "Scanning the file should not fail.");
+    int count = countScanned(rbfmScanIterator, recordDescriptor, attributeNames, versions, prepareVersion, wanted, failed);
+    rbfmScanIterator.close();
+    return count;
+}
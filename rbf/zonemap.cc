@@ -0,0 +1,451 @@
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#include "rbfm.h"
+
+// Zone maps, see rbfm.h for their layout. Writes widen the zones of the page a record lands on
+// before they touch the page, so the zones cover every value the page may hold; vacuum and
+// createZoneMap rebuild them from a scan of the file.
+
+// The zone maps of an open file, kept as the layer state every handle on it shares
+typedef struct ZoneMaps
+{
+    FileHandle fileHandle;      // Of the zone map file
+    ZoneMapHeader header;
+} ZoneMaps;
+
+static void closeZoneMaps(void *state)
+{
+    ZoneMaps *zones = (ZoneMaps *) state;
+    PagedFileManager::instance()->closeFile(zones->fileHandle);
+    delete zones;
+}
+
+// Order two values of type given as their bits
+static int compareZoneValues(uint32_t type, uint32_t a, uint32_t b)
+{
+    if (type == TypeInt)
+    {
+        int32_t x = (int32_t) a, y = (int32_t) b;
+        return x < y ? -1 : x > y;
+    }
+    float x, y;
+    memcpy(&x, &a, sizeof(float));
+    memcpy(&y, &b, sizeof(float));
+    return x < y ? -1 : x > y;
+}
+
+// Let zone cover value, NULL for a null
+static void widenZone(Zone &zone, uint32_t type, const char *value)
+{
+    if (value == NULL)
+    {
+        if (zone.nulls < UINT16_MAX)
+            zone.nulls++;
+        return;
+    }
+
+    uint32_t low, high;
+    memcpy(&low, value, sizeof(uint32_t));
+    high = low;
+    // A NaN compares with nothing, so the zone gives up on its bounds
+    float real;
+    memcpy(&real, value, sizeof(float));
+    if (type == TypeReal && std::isnan(real))
+    {
+        float lowest = -INFINITY, highest = INFINITY;
+        memcpy(&low, &lowest, sizeof(float));
+        memcpy(&high, &highest, sizeof(float));
+    }
+
+    if (zone.values == 0)
+    {
+        zone.min = low;
+        zone.max = high;
+    }
+    else
+    {
+        if (compareZoneValues(type, low, zone.min) < 0)
+            zone.min = low;
+        if (compareZoneValues(type, high, zone.max) > 0)
+            zone.max = high;
+    }
+    if (zone.values < UINT16_MAX)
+        zone.values++;
+}
+
+// The zoned fields of a record in the API format, NULL where null or of another type than
+// the zones are of
+static void getZoneValues(const RecordLayout &layout, const ZoneMapHeader &header, const char *data, const char *values[])
+{
+    for (unsigned k = 0; k < header.attributeCount; k++)
+        values[k] = NULL;
+
+    unsigned offset = layout.getNullIndicatorSize();
+    for (unsigned i = 0; i < layout.getFieldCount(); i++)
+    {
+        if (data[i / CHAR_BIT] & (1 << (CHAR_BIT - 1 - i % CHAR_BIT)))
+            continue;
+        for (unsigned k = 0; k < header.attributeCount; k++)
+            if (header.fields[k] == i && header.types[k] == (uint32_t) layout.getType(i))
+                values[k] = data + offset;
+        if (layout.getType(i) == TypeVarChar)
+        {
+            uint32_t length;
+            memcpy(&length, data + offset, VARCHAR_LENGTH_SIZE);
+            offset += VARCHAR_LENGTH_SIZE + length;
+        }
+        else
+            offset += INT_SIZE;
+    }
+}
+
+// Pin the zone map page holding the zones of attribute for pageNum, appending the pages of its
+// group if they are not there yet
+static RC fetchZonePage(ZoneMaps *zones, PageNum pageNum, unsigned attribute, PageNum &zonePageNum, void *&zonePage)
+{
+    zonePageNum = 1 + pageNum / RBFM_ZONES_PER_PAGE * RBFM_ZONE_ATTRIBUTES + attribute;
+    while (zones->fileHandle.getNumberOfPages() <= zonePageNum)
+    {
+        PageNum appended;
+        void *page;
+        if (zones->fileHandle.newPage(appended, page))
+            return RBFM_APPEND_FAILED;
+        if (zones->fileHandle.unpinPage(appended, true))
+            return RBFM_WRITE_FAILED;
+    }
+    if (zones->fileHandle.fetchPage(zonePageNum, zonePage))
+        return RBFM_READ_FAILED;
+    return SUCCESS;
+}
+
+RC RecordBasedFileManager::createZoneMapFile(const string &fileName, unsigned flags)
+{
+    string zoneFileName = fileName + RBFM_ZONE_SUFFIX;
+    if (_pf_manager->createFile(zoneFileName, flags & PFM_CHECKSUMS))
+        return RBFM_CREATE_FAILED;
+
+    // A header of no attributes
+    FileHandle handle;
+    if (_pf_manager->openFile(zoneFileName, handle))
+        return RBFM_OPEN_FAILED;
+    void *headerPage = allocPage();
+    if (headerPage == NULL)
+    {
+        _pf_manager->closeFile(handle);
+        return RBFM_MALLOC_FAILED;
+    }
+    RC rc = handle.appendPage(headerPage) ? RBFM_APPEND_FAILED : SUCCESS;
+    freePage(headerPage);
+    if (_pf_manager->closeFile(handle) && rc == SUCCESS)
+        rc = RBFM_WRITE_FAILED;
+    return rc;
+}
+
+RC RecordBasedFileManager::openZoneMaps(const string &fileName, FileHandle &fileHandle)
+{
+    ZoneMaps *zones = new ZoneMaps;
+    if (_pf_manager->openFile(fileName + RBFM_ZONE_SUFFIX, zones->fileHandle))
+    {
+        delete zones;
+        return RBFM_OPEN_FAILED;
+    }
+    void *headerPage;
+    if (zones->fileHandle.fetchPage(0, headerPage))
+    {
+        closeZoneMaps(zones);
+        return RBFM_READ_FAILED;
+    }
+    memcpy(&zones->header, headerPage, sizeof(ZoneMapHeader));
+    zones->fileHandle.unpinPage(0, false);
+
+    // Another handle may have opened them first
+    if (fileHandle.setLayerState(zones, closeZoneMaps) != zones)
+        closeZoneMaps(zones);
+    return SUCCESS;
+}
+
+// NULL for a file created without zone maps. A file with them opened around
+// RecordBasedFileManager::openFile cannot keep them up, so is not written to.
+RC RecordBasedFileManager::getZoneMaps(FileHandle &fileHandle, ZoneMaps *&zones)
+{
+    zones = NULL;
+    if (!(fileHandle.getFlags() & RBFM_ZONE_MAPS))
+        return SUCCESS;
+    zones = (ZoneMaps *) fileHandle.getLayerState();
+    return zones == NULL ? RBFM_NO_ZONE_MAPS : SUCCESS;
+}
+
+// Let the zones of pageNum cover the n records in rows, in the API format
+RC RecordBasedFileManager::widenZoneMaps(FileHandle &fileHandle, const RecordLayout &layout, PageNum pageNum, const void * const *rows, size_t n)
+{
+    ZoneMaps *zones;
+    RC rc = getZoneMaps(fileHandle, zones);
+    if (rc || zones == NULL || n == 0)
+        return rc;
+
+    const ZoneMapHeader &header = zones->header;
+    unsigned offset = pageNum % RBFM_ZONES_PER_PAGE * sizeof(Zone);
+    PageNum zonePageNums[RBFM_ZONE_ATTRIBUTES];
+    void *zonePages[RBFM_ZONE_ATTRIBUTES];
+    Zone before[RBFM_ZONE_ATTRIBUTES], after[RBFM_ZONE_ATTRIBUTES];
+    unsigned fetched = 0;
+    for (; fetched < header.attributeCount; fetched++)
+    {
+        if ((rc = fetchZonePage(zones, pageNum, fetched, zonePageNums[fetched], zonePages[fetched])))
+            break;
+        memcpy(&before[fetched], (char *) zonePages[fetched] + offset, sizeof(Zone));
+        after[fetched] = before[fetched];
+    }
+
+    if (rc == SUCCESS)
+    {
+        const char *values[RBFM_ZONE_ATTRIBUTES];
+        for (size_t i = 0; i < n; i++)
+        {
+            getZoneValues(layout, header, (const char *) rows[i], values);
+            for (unsigned k = 0; k < header.attributeCount; k++)
+                widenZone(after[k], header.types[k], values[k]);
+        }
+    }
+
+    // The counts beyond the first value or null are hints, the bounds are not
+    for (unsigned k = 0; k < fetched; k++)
+    {
+        RC unpinRc;
+        if (rc)
+            unpinRc = zones->fileHandle.unpinPage(zonePageNums[k], false);
+        else
+        {
+            memcpy((char *) zonePages[k] + offset, &after[k], sizeof(Zone));
+            if (after[k].min != before[k].min || after[k].max != before[k].max
+                || (before[k].values == 0) != (after[k].values == 0) || (before[k].nulls == 0) != (after[k].nulls == 0))
+                unpinRc = zones->fileHandle.unpinPage(zonePageNums[k], true);
+            else
+                unpinRc = zones->fileHandle.unpinPageLazily(zonePageNums[k]);
+        }
+        if (unpinRc && rc == SUCCESS)
+            rc = RBFM_WRITE_FAILED;
+    }
+    return rc;
+}
+
+// Set the zones of every page to just cover the records it holds
+RC RecordBasedFileManager::rebuildZoneMaps(FileHandle &fileHandle, const RecordLayout &layout)
+{
+    ZoneMaps *zones;
+    RC rc = getZoneMaps(fileHandle, zones);
+    if (rc || zones == NULL || zones->header.attributeCount == 0)
+        return rc;
+
+    const ZoneMapHeader &header = zones->header;
+    unsigned count = header.attributeCount;
+    PageNum numPages = fileHandle.getNumberOfPages();
+    vector<Zone> built((size_t) numPages * count);
+
+    // A scan returns every record once, with the RID of the page it lives on
+    RBFM_ScanIterator iterator;
+    if ((rc = scan(fileHandle, layout, "", NO_OP, NULL, vector<string>(), iterator)))
+        return rc;
+    RID rid;
+    RecordView view;
+    while ((rc = iterator.getNextRecordView(rid, view)) == SUCCESS)
+    {
+        if (rid.pageNum >= numPages)
+            continue;
+        for (unsigned k = 0; k < count; k++)
+        {
+            unsigned field = header.fields[k];
+            const char *value = NULL;
+            uint32_t length;
+            if (field < layout.getFieldCount() && (uint32_t) layout.getType(field) == header.types[k] && !view.isNull(field))
+                value = view.fieldData(field, false, length);
+            widenZone(built[(size_t) rid.pageNum * count + k], header.types[k], value);
+        }
+    }
+    iterator.close();
+    if (rc != RBFM_EOF)
+        return rc;
+
+    for (PageNum first = 0; first < numPages; first += RBFM_ZONES_PER_PAGE)
+    {
+        PageNum last = min(numPages, (PageNum) (first + RBFM_ZONES_PER_PAGE));
+        for (unsigned k = 0; k < count; k++)
+        {
+            PageNum zonePageNum;
+            void *zonePage;
+            if ((rc = fetchZonePage(zones, first, k, zonePageNum, zonePage)))
+                return rc;
+            memset(zonePage, 0, RBFM_ZONES_PER_PAGE * sizeof(Zone));
+            for (PageNum pageNum = first; pageNum < last; pageNum++)
+                memcpy((char *) zonePage + (pageNum - first) * sizeof(Zone), &built[(size_t) pageNum * count + k], sizeof(Zone));
+            if (zones->fileHandle.unpinPage(zonePageNum, true))
+                return RBFM_WRITE_FAILED;
+        }
+    }
+    return SUCCESS;
+}
+
+RC RecordBasedFileManager::createZoneMap(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, const string &attributeName)
+{
+    ZoneMaps *zones;
+    RC rc = getZoneMaps(fileHandle, zones);
+    if (rc || zones == NULL)
+        return RBFM_NO_ZONE_MAPS;
+
+    shared_ptr<const RecordLayout> held = getLayout(recordDescriptor);
+    const RecordLayout &layout = *held;
+    unsigned field = layout.getIndex(attributeName);
+    if (field == layout.getFieldCount())
+        return RBFM_NO_SUCH_ATTR;
+    ZoneMapHeader &header = zones->header;
+    for (unsigned k = 0; k < header.attributeCount; k++)
+        if (header.fields[k] == field)
+            return SUCCESS;
+    if (layout.getType(field) == TypeVarChar || header.attributeCount == RBFM_ZONE_ATTRIBUTES)
+        return RBFM_CANNOT_ZONE;
+
+    // The zones are in place before the header says they are there
+    header.fields[header.attributeCount] = field;
+    header.types[header.attributeCount] = layout.getType(field);
+    header.attributeCount++;
+    if ((rc = rebuildZoneMaps(fileHandle, layout)))
+    {
+        header.attributeCount--;
+        return rc;
+    }
+    void *headerPage;
+    if (zones->fileHandle.fetchPage(0, headerPage))
+        return RBFM_READ_FAILED;
+    memcpy(headerPage, &header, sizeof(ZoneMapHeader));
+    if (zones->fileHandle.unpinPage(0, true))
+        return RBFM_WRITE_FAILED;
+    return SUCCESS;
+}
+
+// Set prunedPages to the pages whose zones rule out the condition. Zones that cannot be read
+// rule out nothing.
+void RBFM_ScanIterator::pruneByZoneMaps()
+{
+    prunedPages.clear();
+    ZoneMaps *zones;
+    if (rootCondition == NULL || rbfm->getZoneMaps(fileHandle, zones) || zones == NULL || zones->header.attributeCount == 0)
+        return;
+
+    const ZoneMapHeader &header = zones->header;
+    unsigned count = header.attributeCount;
+    prunedPages.assign((totalPage + 63) / 64, 0);
+    for (PageNum first = 0; first < totalPage; first += RBFM_ZONES_PER_PAGE)
+    {
+        PageNum group = 1 + first / RBFM_ZONES_PER_PAGE * RBFM_ZONE_ATTRIBUTES;
+        void *zonePages[RBFM_ZONE_ATTRIBUTES];
+        unsigned fetched = 0;
+        while (fetched < count && group + fetched < zones->fileHandle.getNumberOfPages()
+               && zones->fileHandle.fetchPage(group + fetched, zonePages[fetched]) == SUCCESS)
+            fetched++;
+
+        if (fetched == count)
+        {
+            PageNum last = min(totalPage, (PageNum) (first + RBFM_ZONES_PER_PAGE));
+            Zone pageZones[RBFM_ZONE_ATTRIBUTES];
+            for (PageNum pageNum = first; pageNum < last; pageNum++)
+            {
+                if (rbfm->isFreeSpaceMapPage(pageNum))
+                    continue;
+                for (unsigned k = 0; k < count; k++)
+                    memcpy(&pageZones[k], (char *) zonePages[k] + (pageNum - first) * sizeof(Zone), sizeof(Zone));
+                if (!canMatch(*rootCondition, pageZones, header))
+                    prunedPages[pageNum / 64] |= (uint64_t) 1 << (pageNum % 64);
+            }
+        }
+        for (unsigned k = 0; k < fetched; k++)
+            zones->fileHandle.unpinPage(group + k, false);
+    }
+}
+
+// Could a record of the page with zones meet condition?
+bool RBFM_ScanIterator::canMatch(const ScanCondition &condition, const Zone *zones, const ZoneMapHeader &header)
+{
+    switch (condition.kind)
+    {
+        case PRED_AND:
+            for (unsigned i = 0; i < condition.terms.size(); i++)
+                if (!canMatch(conditions[condition.terms[i]], zones, header))
+                    return false;
+            return true;
+        case PRED_OR:
+            for (unsigned i = 0; i < condition.terms.size(); i++)
+                if (canMatch(conditions[condition.terms[i]], zones, header))
+                    return true;
+            return false;
+        // Ruling out NOT would take zones saying its term holds for every record
+        case PRED_NOT:
+            return true;
+        default:
+            break;
+    }
+    if (condition.kind == PRED_COMPARE && condition.compOp == NO_OP)
+        return true;
+
+    unsigned k = 0;
+    while (k < header.attributeCount && (header.fields[k] != condition.attrIndex || header.types[k] != (uint32_t) condition.type))
+        k++;
+    if (k == header.attributeCount)
+        return true;
+    const Zone &zone = zones[k];
+    if (condition.kind == PRED_IS_NULL)
+        return zone.nulls > 0;
+    if (condition.kind == PRED_IS_NOT_NULL)
+        return zone.values > 0;
+    // A comparison with a null is false
+    if (!condition.hasValue || zone.values == 0)
+        return false;
+
+    // How the value compares with the smallest and largest of the page
+    int low, high;
+    if (condition.type == TypeInt)
+    {
+        uint32_t value = (uint32_t) condition.intValue;
+        low = compareZoneValues(TypeInt, value, zone.min);
+        high = compareZoneValues(TypeInt, value, zone.max);
+    }
+    else
+    {
+        if (std::isnan(condition.realValue))
+            return true;
+        uint32_t value;
+        memcpy(&value, &condition.realValue, sizeof(float));
+        low = compareZoneValues(TypeReal, value, zone.min);
+        high = compareZoneValues(TypeReal, value, zone.max);
+    }
+    switch (condition.compOp)
+    {
+        case EQ_OP: return low >= 0 && high <= 0;
+        case LT_OP: return low > 0;
+        case LE_OP: return low >= 0;
+        case GT_OP: return high < 0;
+        case GE_OP: return high <= 0;
+        case NE_OP: return low != 0 || high != 0;
+        default:    return true;
+    }
+}
+
+bool RBFM_ScanIterator::isPruned(PageNum pageNum)
+{
+    return pageNum / 64 < prunedPages.size() && (prunedPages[pageNum / 64] >> (pageNum % 64) & 1);
+}
+
+// Move currPage past the map pages and the pages the zone maps rule out
+void RBFM_ScanIterator::skipPages()
+{
+    while (currPage < totalPage && (rbfm->isFreeSpaceMapPage(currPage) || isPruned(currPage)))
+        currPage++;
+}
+
+RC RBFM_ScanIterator::collectCounterValues(unsigned &readPageCount, unsigned &writePageCount, unsigned &appendPageCount)
+{
+    return fileHandle.collectCounterValues(readPageCount, writePageCount, appendPageCount);
+}
@@ -26,6 +26,7 @@ RelationManager::~RelationManager()
 RC RelationManager::createCatalog()
 {
     RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
+    tableCache.clear();
     // Create both tables and columns tables, return error if either fails
     RC rc;
     rc = rbfm->createFile(getFileName(TABLES_TABLE_NAME));
@@ -59,6 +60,7 @@ RC RelationManager::createCatalog()
 RC RelationManager::deleteCatalog()
 {
     RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
+    tableCache.clear();
 
     RC rc;
 
@@ -77,6 +79,7 @@ RC RelationManager::createTable(const string &tableName, const vector<Attribute>
 {
     RC rc;
     RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
+    tableCache.erase(tableName);
 
     // Create the rbfm file to store the table
     if ((rc = rbfm->createFile(getFileName(tableName))))
@@ -113,6 +116,7 @@ RC RelationManager::deleteTable(const string &tableName)
         return rc;
     if (isSystem)
         return RM_CANNOT_MOD_SYS_TBL;
+    tableCache.erase(tableName);
 
     // Delete the rbfm file holding this table's entries
     rc = rbfm->destroyFile(getFileName(tableName));
@@ -282,20 +286,14 @@ RC RelationManager::insertTuple(const string &tableName, const void *data, RID &
     RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
     RC rc;
 
-    // If this is a system table, we cannot modify it
-    bool isSystem;
-    rc = isSystemTable(isSystem, tableName);
+    // Get the table's layout; if this is a system table, we cannot modify it
+    const TableInfo *info;
+    rc = getTableInfo(tableName, info);
     if (rc)
         return rc;
-    if (isSystem)
+    if (info->system)
         return RM_CANNOT_MOD_SYS_TBL;
 
-    // Get recordDescriptor
-    vector<Attribute> recordDescriptor;
-    rc = getAttributes(tableName, recordDescriptor);
-    if (rc)
-        return rc;
-
     // And get fileHandle
     FileHandle fileHandle;
     rc = rbfm->openFile(getFileName(tableName), fileHandle);
@@ -303,30 +301,50 @@ RC RelationManager::insertTuple(const string &tableName, const void *data, RID &
         return rc;
 
     // Let rbfm do all the work
-    rc = rbfm->insertRecord(fileHandle, recordDescriptor, data, rid);
+    rc = rbfm->insertRecord(fileHandle, info->layout, data, rid);
     rbfm->closeFile(fileHandle);
 
     return rc;
 }
 
-RC RelationManager::deleteTuple(const string &tableName, const RID &rid)
+RC RelationManager::insertTuples(const string &tableName, const void * const *data, size_t n, vector<RID> &rids)
 {
     RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
     RC rc;
 
-    // If this is a system table, we cannot modify it
-    bool isSystem;
-    rc = isSystemTable(isSystem, tableName);
+    // Get the table's layout; if this is a system table, we cannot modify it
+    const TableInfo *info;
+    rc = getTableInfo(tableName, info);
     if (rc)
         return rc;
-    if (isSystem)
+    if (info->system)
         return RM_CANNOT_MOD_SYS_TBL;
 
-    // Get recordDescriptor
-    vector<Attribute> recordDescriptor;
-    rc = getAttributes(tableName, recordDescriptor);
+    // And get fileHandle
+    FileHandle fileHandle;
+    rc = rbfm->openFile(getFileName(tableName), fileHandle);
+    if (rc)
+        return rc;
+
+    // Let rbfm pack the pages
+    rc = rbfm->insertRecords(fileHandle, info->layout.getDescriptor(), data, n, rids);
+    rbfm->closeFile(fileHandle);
+
+    return rc;
+}
+
+RC RelationManager::deleteTuple(const string &tableName, const RID &rid)
+{
+    RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
+    RC rc;
+
+    // Get the table's layout; if this is a system table, we cannot modify it
+    const TableInfo *info;
+    rc = getTableInfo(tableName, info);
     if (rc)
         return rc;
+    if (info->system)
+        return RM_CANNOT_MOD_SYS_TBL;
 
     // And get fileHandle
     FileHandle fileHandle;
@@ -335,7 +353,7 @@ RC RelationManager::deleteTuple(const string &tableName, const RID &rid)
         return rc;
 
     // Let rbfm do all the work
-    rc = rbfm->deleteRecord(fileHandle, recordDescriptor, rid);
+    rc = rbfm->deleteRecord(fileHandle, info->layout.getDescriptor(), rid);
     rbfm->closeFile(fileHandle);
 
     return rc;
@@ -346,20 +364,14 @@ RC RelationManager::updateTuple(const string &tableName, const void *data, const
     RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
     RC rc;
 
-    // If this is a system table, we cannot modify it
-    bool isSystem;
-    rc = isSystemTable(isSystem, tableName);
+    // Get the table's layout; if this is a system table, we cannot modify it
+    const TableInfo *info;
+    rc = getTableInfo(tableName, info);
     if (rc)
         return rc;
-    if (isSystem)
+    if (info->system)
         return RM_CANNOT_MOD_SYS_TBL;
 
-    // Get recordDescriptor
-    vector<Attribute> recordDescriptor;
-    rc = getAttributes(tableName, recordDescriptor);
-    if (rc)
-        return rc;
-
     // And get fileHandle
     FileHandle fileHandle;
     rc = rbfm->openFile(getFileName(tableName), fileHandle);
@@ -367,7 +379,7 @@ RC RelationManager::updateTuple(const string &tableName, const void *data, const
         return rc;
 
     // Let rbfm do all the work
-    rc = rbfm->updateRecord(fileHandle, recordDescriptor, data, rid);
+    rc = rbfm->updateRecord(fileHandle, info->layout, data, rid);
     rbfm->closeFile(fileHandle);
 
     return rc;
@@ -378,9 +390,9 @@ RC RelationManager::readTuple(const string &tableName, const RID &rid, void *dat
     RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
     RC rc;
 
-    // Get record descriptor
-    vector<Attribute> recordDescriptor;
-    rc = getAttributes(tableName, recordDescriptor);
+    // Get the table's layout
+    const TableInfo *info;
+    rc = getTableInfo(tableName, info);
     if (rc)
         return rc;
 
@@ -391,7 +403,7 @@ RC RelationManager::readTuple(const string &tableName, const RID &rid, void *dat
         return rc;
 
     // Let rbfm do all the work
-    rc = rbfm->readRecord(fileHandle, recordDescriptor, rid, data);
+    rc = rbfm->readRecord(fileHandle, info->layout, rid, data);
     rbfm->closeFile(fileHandle);
     return rc;
 }
@@ -408,8 +420,8 @@ RC RelationManager::readAttribute(const string &tableName, const RID &rid, const
     RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
     RC rc;
 
-    vector<Attribute> recordDescriptor;
-    rc = getAttributes(tableName, recordDescriptor);
+    const TableInfo *info;
+    rc = getTableInfo(tableName, info);
     if (rc)
         return rc;
 
@@ -418,7 +430,7 @@ RC RelationManager::readAttribute(const string &tableName, const RID &rid, const
     if (rc)
         return rc;
 
-    rc = rbfm->readAttribute(fileHandle, recordDescriptor, rid, attributeName, data);
+    rc = rbfm->readAttribute(fileHandle, info->layout.getDescriptor(), rid, attributeName, data);
     rbfm->closeFile(fileHandle);
     return rc;
 }
@@ -694,6 +706,27 @@ RC RelationManager::getTableID(const string &tableName, int32_t &tableID)
     return rc;
 }
 
+// Looks the table up in the catalog the first time it is used
+RC RelationManager::getTableInfo(const string &tableName, const TableInfo *&info)
+{
+    unordered_map<string, TableInfo>::const_iterator it = tableCache.find(tableName);
+    if (it == tableCache.end())
+    {
+        TableInfo newInfo;
+        RC rc = isSystemTable(newInfo.system, tableName);
+        if (rc)
+            return rc;
+        vector<Attribute> recordDescriptor;
+        rc = getAttributes(tableName, recordDescriptor);
+        if (rc)
+            return rc;
+        newInfo.layout = RecordLayout(recordDescriptor);
+        it = tableCache.insert(make_pair(tableName, newInfo)).first;
+    }
+    info = &it->second;
+    return SUCCESS;
+}
+
 // Determine if table tableName is a system table. Set the boolean argument as the result
 RC RelationManager::isSystemTable(bool &system, const string &tableName)
 {
@@ -826,14 +859,14 @@ RC RelationManager::scan(const string &tableName,
     if (rc)
         return rc;
 
-    // grab the record descriptor for the given tableName
-    vector<Attribute> recordDescriptor;
-    rc = getAttributes(tableName, recordDescriptor);
+    // grab the layout for the given tableName
+    const TableInfo *info;
+    rc = getTableInfo(tableName, info);
     if (rc)
         return rc;
 
     // Use the underlying rbfm_scaniterator to do all the work
-    rc = rbfm->scan(rm_ScanIterator.fileHandle, recordDescriptor, conditionAttribute,
+    rc = rbfm->scan(rm_ScanIterator.fileHandle, info->layout, conditionAttribute,
                      compOp, value, attributeNames, rm_ScanIterator.rbfm_iter);
     if (rc)
         return rc;
@@ -841,12 +874,35 @@ RC RelationManager::scan(const string &tableName,
     return SUCCESS;
 }
 
+RC RelationManager::scan(const string &tableName,
+      const Predicate &predicate,
+      const vector<string> &attributeNames,
+      RM_ScanIterator &rm_ScanIterator)
+{
+    RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
+    RC rc = rbfm->openFile(getFileName(tableName), rm_ScanIterator.fileHandle);
+    if (rc)
+        return rc;
+
+    const TableInfo *info;
+    rc = getTableInfo(tableName, info);
+    if (rc)
+        return rc;
+
+    return rbfm->scan(rm_ScanIterator.fileHandle, info->layout, predicate, attributeNames, rm_ScanIterator.rbfm_iter);
+}
+
 // Let rbfm do all the work
 RC RM_ScanIterator::getNextTuple(RID &rid, void *data)
 {
     return rbfm_iter.getNextRecord(rid, data);
 }
 
+RC RM_ScanIterator::getNextBatch(vector<RID> &rids, void *buffer, unsigned capacity, unsigned &count)
+{
+    return rbfm_iter.getNextBatch(rids, buffer, capacity, count);
+}
+
 // Close our file handle, rbfm_scaniterator
 RC RM_ScanIterator::close()
 {
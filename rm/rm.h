@@ -4,6 +4,7 @@
 
 #include <string>
 #include <vector>
+#include <unordered_map>
 
 #include "../rbf/rbfm.h"
 
@@ -60,6 +61,9 @@ public:
 
   // "data" follows the same format as RelationManager::insertTuple()
   RC getNextTuple(RID &rid, void *data);
+  // As many of the next tuples as fit in capacity bytes of buffer, packed back to back;
+  // see RBFM_ScanIterator::getNextBatch
+  RC getNextBatch(vector<RID> &rids, void *buffer, unsigned capacity, unsigned &count);
   RC close();
 
   friend class RelationManager;
@@ -87,6 +91,9 @@ public:
 
   RC insertTuple(const string &tableName, const void *data, RID &rid);
 
+  // Inserts n tuples at once into new pages, see RecordBasedFileManager::insertRecords
+  RC insertTuples(const string &tableName, const void * const *data, size_t n, vector<RID> &rids);
+
   RC deleteTuple(const string &tableName, const RID &rid);
 
   RC updateTuple(const string &tableName, const void *data, const RID &rid);
@@ -108,6 +115,12 @@ public:
       const vector<string> &attributeNames, // a list of projected attributes
       RM_ScanIterator &rm_ScanIterator);
 
+  // Scan for the tuples that satisfy predicate, evaluated inside the record manager
+  RC scan(const string &tableName,
+      const Predicate &predicate,
+      const vector<string> &attributeNames,
+      RM_ScanIterator &rm_ScanIterator);
+
 
 protected:
   RelationManager();
@@ -142,6 +155,15 @@ private:
 
   RC isSystemTable(bool &system, const string &tableName);
 
+  // What tuple operations need to know about a table, read from the catalog on first use
+  typedef struct TableInfo
+  {
+      RecordLayout layout;
+      bool system;
+  } TableInfo;
+  unordered_map<string, TableInfo> tableCache;
+  RC getTableInfo(const string &tableName, const TableInfo *&info);
+
 
 
   // Utility functions for converting single values to/from api format